@@ -358,7 +358,9 @@ src = {
   'src/main.c',
   'src/util.c',
   'src/core/fs.c',
+  'src/core/job.c',
   ('src/core/os_%s.c'):format(target),
+  'src/core/profile.c',
   'src/core/zip.c',
   'src/api/api.c',
   'src/api/l_lovr.c'
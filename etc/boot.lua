@@ -118,7 +118,9 @@ function lovr.boot()
       spatializer = nil
     },
     graphics = {
-      debug = false
+      debug = false,
+      shadercache = false,
+      fontcache = true
     },
     headset = {
       drivers = { 'openxr', 'webxr', 'desktop' },
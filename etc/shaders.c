@@ -2,11 +2,12 @@
 
 const char* lovrShaderVertexPrefix = ""
 "#define VERTEX VERTEX \n"
-"#define MAX_BONES 48 \n"
+"#define MAX_BONES 256 \n"
 "#define MAX_DRAWS 256 \n"
 "#define lovrView lovrViews[lovrViewID] \n"
 "#define lovrProjection lovrProjections[lovrViewID] \n"
-"#define lovrModel lovrModels[lovrDrawID] \n"
+"#define lovrInstanceTransform mat4(lovrInstanceTransform0, lovrInstanceTransform1, lovrInstanceTransform2, lovrInstanceTransform3) \n"
+"#define lovrModel (lovrInstanceTransform * lovrModels[lovrDrawID]) \n"
 "#define lovrTransform (lovrView * lovrModel) \n"
 "#ifdef FLAG_uniformScale \n"
 "#define lovrNormalMatrix mat3(lovrModel) \n"
@@ -34,6 +35,12 @@ const char* lovrShaderVertexPrefix = ""
 "in uvec4 lovrBones; \n"
 "in vec4 lovrBoneWeights; \n"
 "in uint lovrDrawID; \n"
+"in vec4 lovrInstanceColor; \n"
+"in vec4 lovrInstanceTransform0; \n"
+"in vec4 lovrInstanceTransform1; \n"
+"in vec4 lovrInstanceTransform2; \n"
+"in vec4 lovrInstanceTransform3; \n"
+"in ivec4 lovrPackedNormal; \n"
 "out vec2 texCoord; \n"
 "out vec4 vertexColor; \n"
 "out vec4 lovrGraphicsColor; \n"
@@ -42,8 +49,25 @@ const char* lovrShaderVertexPrefix = ""
 "layout(std140) uniform lovrFrameBlock { mat4 lovrViews[2]; mat4 lovrProjections[2]; }; \n"
 "uniform mat3 lovrMaterialTransform; \n"
 "uniform float lovrPointSize; \n"
-"uniform mat4 lovrPose[MAX_BONES]; \n"
+"layout(std140) uniform lovrPoseBlock { mat4 lovrPose[MAX_BONES]; }; \n"
 "uniform lowp int lovrViewportCount; \n"
+"vec3 lovrDecodeOctahedral(vec2 e) { \n"
+"  vec3 v = vec3(e, 1. - abs(e.x) - abs(e.y)); \n"
+"  float t = max(-v.z, 0.); \n"
+"  v.xy += vec2(v.x >= 0. ? -t : t, v.y >= 0. ? -t : t); \n"
+"  return normalize(v); \n"
+"} \n"
+"vec3 lovrGetNormal() { \n"
+"  if (lovrPackedNormal.x == -32768) return lovrNormal; \n"
+"  return lovrDecodeOctahedral(vec2(lovrPackedNormal.xy) / 32767.); \n"
+"} \n"
+"vec4 lovrGetTangent() { \n"
+"  if (lovrPackedNormal.x == -32768) return lovrTangent; \n"
+"  vec3 tangent = lovrDecodeOctahedral(vec2(lovrPackedNormal.z, lovrPackedNormal.w & ~1) / 32767.); \n"
+"  return vec4(tangent, (lovrPackedNormal.w & 1) != 0 ? -1. : 1.); \n"
+"} \n"
+"#define lovrNormal lovrGetNormal() \n"
+"#define lovrTangent lovrGetTangent() \n"
 "#if defined MULTIVIEW \n"
 "layout(num_views = 2) in; \n"
 "#define lovrViewID (int(gl_ViewID_OVR)) \n"
@@ -61,7 +85,7 @@ const char* lovrShaderVertexSuffix = ""
 "void main() { \n"
 "  texCoord = (lovrMaterialTransform * vec3(lovrTexCoord, 1.)).xy; \n"
 "  vertexColor = lovrVertexColor; \n"
-"  lovrGraphicsColor = lovrColors[lovrDrawID]; \n"
+"  lovrGraphicsColor = lovrColors[lovrDrawID] * lovrInstanceColor; \n"
 "#if defined INSTANCED_STEREO \n"
 "  gl_ViewportIndex = gl_InstanceID % lovrViewportCount; \n"
 "#endif \n"
@@ -1,4 +1,6 @@
 #include "api.h"
+#include "core/job.h"
+#include "core/os.h"
 #include "util.h"
 #include <lua.h>
 #include <lauxlib.h>
@@ -391,6 +393,13 @@ void luax_atexit(lua_State* L, voidFn* destructor) {
   lua_pop(L, 1);
 }
 
+// Each Lua state that opens lovr or lovr.data holds a reference to the job pool until it's closed.
+// Modules are destroyed in reverse order, so the pool outlives graphics in the main state.
+void luax_retainjobs(lua_State* L) {
+  job_init(MAX(os_get_core_count(), 2) - 1);
+  luax_atexit(L, job_destroy);
+}
+
 uint32_t _luax_checku32(lua_State* L, int index) {
   double x = lua_tonumber(L, index);
 
@@ -23,6 +23,7 @@ extern StringEntry lovrAttributeType[];
 extern StringEntry lovrAudioMaterial[];
 extern StringEntry lovrAudioShareMode[];
 extern StringEntry lovrAudioType[];
+extern StringEntry lovrBatchBreak[];
 extern StringEntry lovrBlendAlphaMode[];
 extern StringEntry lovrBlendMode[];
 extern StringEntry lovrBlockType[];
@@ -38,6 +39,7 @@ extern StringEntry lovrDrawStyle[];
 extern StringEntry lovrEffect[];
 extern StringEntry lovrEventType[];
 extern StringEntry lovrFilterMode[];
+extern StringEntry lovrFlushReason[];
 extern StringEntry lovrHeadsetDriver[];
 extern StringEntry lovrHeadsetOrigin[];
 extern StringEntry lovrHorizontalAlign[];
@@ -52,6 +54,7 @@ extern StringEntry lovrShaderType[];
 extern StringEntry lovrShapeType[];
 extern StringEntry lovrSmoothMode[];
 extern StringEntry lovrStencilAction[];
+extern StringEntry lovrStreamType[];
 extern StringEntry lovrTextureFormat[];
 extern StringEntry lovrTextureType[];
 extern StringEntry lovrTimeUnit[];
@@ -118,6 +121,7 @@ void luax_pushconf(struct lua_State* L);
 int luax_setconf(struct lua_State* L);
 void luax_setmainthread(struct lua_State* L);
 void luax_atexit(struct lua_State* L, void (*destructor)(void));
+void luax_retainjobs(struct lua_State* L);
 uint32_t _luax_checku32(struct lua_State* L, int index);
 void luax_readcolor(struct lua_State* L, int index, struct Color* color);
 int luax_readmesh(struct lua_State* L, int index, float** vertices, uint32_t* vertexCount, uint32_t** indices, uint32_t* indexCount, bool* shouldFree);
@@ -127,6 +131,7 @@ int luax_readmesh(struct lua_State* L, int index, float** vertices, uint32_t* ve
 #ifndef LOVR_DISABLE_DATA
 struct Blob;
 struct Blob* luax_readblob(struct lua_State* L, int index, const char* debug);
+struct Blob* luax_mapblob(struct lua_State* L, int index, const char* debug);
 #endif
 
 #ifndef LOVR_DISABLE_EVENT
@@ -146,6 +151,9 @@ struct Uniform;
 int luax_checkuniform(struct lua_State* L, int index, const struct Uniform* uniform, void* dest, const char* debug);
 int luax_optmipmap(struct lua_State* L, int index, struct Texture* texture);
 void luax_readattachments(struct lua_State* L, int index, struct Attachment* attachments, int* count);
+struct InstanceData;
+struct InstanceData* luax_readinstances(struct lua_State* L, int index, uint32_t* count, struct InstanceData* instances);
+void luax_tracebatchbreaks(struct lua_State* L);
 #endif
 
 #ifndef LOVR_DISABLE_MATH
@@ -79,10 +79,23 @@ static int l_lovrDataNewImage(lua_State* L) {
 }
 
 static int l_lovrDataNewModelData(lua_State* L) {
-  Blob* blob = luax_readblob(L, 1, "Model");
+  bool optimize = false;
+  if (lua_istable(L, 2)) {
+    lua_getfield(L, 2, "optimize");
+    optimize = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+  }
+
+  Blob* blob = luax_mapblob(L, 1, "Model");
   ModelData* modelData = lovrModelDataCreate(blob, luax_readfile);
-  luax_pushtype(L, ModelData, modelData);
   lovrRelease(blob, lovrBlobDestroy);
+
+  // ModelData:optimize returns the ACMR, the load option doesn't measure it
+  if (optimize) {
+    lovrModelDataOptimize(modelData, NULL, NULL);
+  }
+
+  luax_pushtype(L, ModelData, modelData);
   lovrRelease(modelData, lovrModelDataDestroy);
   return 1;
 }
@@ -157,5 +170,6 @@ int luaopen_lovr_data(lua_State* L) {
   luax_registertype(L, ModelData);
   luax_registertype(L, Rasterizer);
   luax_registertype(L, Sound);
+  luax_retainjobs(L);
   return 1;
 }
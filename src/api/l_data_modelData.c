@@ -1,5 +1,6 @@
 #include "api.h"
 #include "data/modelData.h"
+#include "data/blob.h"
 #include "core/maf.h"
 #include "shaders.h"
 #include <lua.h>
@@ -497,11 +498,13 @@ static int l_lovrModelDataGetAnimationChannelKeyframe(lua_State* L) {
   ModelAnimationChannel* channel = &animation->channels[index];
   uint32_t keyframe = luax_checku32(L, 4) - 1;
   lovrCheck(keyframe < channel->keyframeCount, "Invalid keyframe index '%d'", keyframe + 1);
-  lua_pushnumber(L, channel->times[keyframe]);
+  lua_pushnumber(L, lovrModelDataGetKeyframeTime(channel, keyframe));
   size_t counts[] = { [PROP_TRANSLATION] = 3, [PROP_ROTATION] = 4, [PROP_SCALE] = 3 };
   size_t count = counts[channel->property];
+  float value[4];
+  lovrModelDataGetKeyframeValue(channel, keyframe, value);
   for (uint32_t i = 0; i < count; i++) {
-    lua_pushnumber(L, channel->data[keyframe * count + i]);
+    lua_pushnumber(L, value[i]);
   }
   return count + 1;
 }
@@ -539,6 +542,98 @@ static int l_lovrModelDataGetSkinInverseBindMatrix(lua_State* L) {
   return 16;
 }
 
+static int l_lovrModelDataOptimize(lua_State* L) {
+  ModelData* model = luax_checktype(L, 1, ModelData);
+  float before, after;
+  lovrModelDataOptimize(model, &before, &after);
+  lua_pushnumber(L, before);
+  lua_pushnumber(L, after);
+  return 2;
+}
+
+static int l_lovrModelDataGenerateLODs(lua_State* L) {
+  ModelData* model = luax_checktype(L, 1, ModelData);
+  float ratios[MAX_LODS];
+  uint32_t count = 0;
+  if (lua_istable(L, 2)) {
+    count = luax_len(L, 2);
+    lovrCheck(count <= MAX_LODS, "Too many LOD levels (max is %d)", MAX_LODS);
+    for (uint32_t i = 0; i < count; i++) {
+      lua_rawgeti(L, 2, i + 1);
+      ratios[i] = luax_checkfloat(L, -1);
+      lua_pop(L, 1);
+    }
+  } else {
+    count = lua_gettop(L) - 1;
+    lovrCheck(count <= MAX_LODS, "Too many LOD levels (max is %d)", MAX_LODS);
+    for (uint32_t i = 0; i < count; i++) {
+      ratios[i] = luax_checkfloat(L, i + 2);
+    }
+  }
+  lovrModelDataGenerateLods(model, ratios, count);
+  return 0;
+}
+
+static int l_lovrModelDataCompressAnimations(lua_State* L) {
+  ModelData* model = luax_checktype(L, 1, ModelData);
+  AnimationTolerance tolerance = {
+    .time = .001f,
+    .translation = .001f,
+    .rotation = .001f,
+    .scale = .001f
+  };
+
+  // Each tolerance is in the property's own unit: seconds, meters, radians, or scale factor
+  if (lua_istable(L, 2)) {
+    lua_getfield(L, 2, "time");
+    tolerance.time = luax_optfloat(L, -1, tolerance.time);
+    lua_getfield(L, 2, "translation");
+    tolerance.translation = luax_optfloat(L, -1, tolerance.translation);
+    lua_getfield(L, 2, "rotation");
+    tolerance.rotation = luax_optfloat(L, -1, tolerance.rotation);
+    lua_getfield(L, 2, "scale");
+    tolerance.scale = luax_optfloat(L, -1, tolerance.scale);
+    lua_pop(L, 4);
+  } else if (!lua_isnoneornil(L, 2)) {
+    return luax_typeerror(L, 2, "table or nil");
+  }
+
+  bool negative = tolerance.time < 0.f || tolerance.translation < 0.f || tolerance.rotation < 0.f || tolerance.scale < 0.f;
+  lovrCheck(!negative, "Animation tolerances can not be negative");
+
+  AnimationCompression report;
+  lovrModelDataCompressAnimations(model, &tolerance, &report);
+  lua_createtable(L, 0, 9);
+  lua_pushinteger(L, report.originalSize);
+  lua_setfield(L, -2, "originalsize");
+  lua_pushinteger(L, report.compressedSize);
+  lua_setfield(L, -2, "compressedsize");
+  lua_pushinteger(L, report.releasedSize);
+  lua_setfield(L, -2, "releasedsize");
+  lua_pushinteger(L, report.channelCount);
+  lua_setfield(L, -2, "channels");
+  lua_pushinteger(L, report.compressedCount);
+  lua_setfield(L, -2, "compressedchannels");
+  lua_pushnumber(L, report.timeError);
+  lua_setfield(L, -2, "timeerror");
+  lua_pushnumber(L, report.translationError);
+  lua_setfield(L, -2, "translationerror");
+  lua_pushnumber(L, report.rotationError);
+  lua_setfield(L, -2, "rotationerror");
+  lua_pushnumber(L, report.scaleError);
+  lua_setfield(L, -2, "scaleerror");
+  return 1;
+}
+
+// The Blob can be written to a file, newModelData and newModel load it without any parsing
+static int l_lovrModelDataSerialize(lua_State* L) {
+  ModelData* model = luax_checktype(L, 1, ModelData);
+  Blob* blob = lovrModelDataSerialize(model);
+  luax_pushtype(L, Blob, blob);
+  lovrRelease(blob, lovrBlobDestroy);
+  return 1;
+}
+
 const luaL_Reg lovrModelData[] = {
   { "getBlobCount", l_lovrModelDataGetBlobCount },
   { "getBlob", l_lovrModelDataGetBlob },
@@ -581,5 +676,9 @@ const luaL_Reg lovrModelData[] = {
   { "getSkinCount", l_lovrModelDataGetSkinCount },
   { "getSkinJoints", l_lovrModelDataGetSkinJoints },
   { "getSkinInverseBindMatrix", l_lovrModelDataGetSkinInverseBindMatrix },
+  { "optimize", l_lovrModelDataOptimize },
+  { "generateLODs", l_lovrModelDataGenerateLODs },
+  { "compressAnimations", l_lovrModelDataCompressAnimations },
+  { "serialize", l_lovrModelDataSerialize },
   { NULL, NULL }
 };
@@ -30,6 +30,24 @@ Blob* luax_readblob(lua_State* L, int index, const char* debug) {
   }
 }
 
+// Like luax_readblob, but files in directories are mapped instead of read.  The mapping is
+// copy-on-write, so the Blob's data can still be modified.
+Blob* luax_mapblob(lua_State* L, int index, const char* debug) {
+  if (lua_type(L, index) == LUA_TSTRING) {
+    const char* path = lua_tostring(L, index);
+
+    size_t size;
+    void* data = lovrFilesystemMap(path, &size);
+    if (data) {
+      Blob* blob = lovrBlobCreate(data, size, path);
+      blob->mapped = true;
+      return blob;
+    }
+  }
+
+  return luax_readblob(L, index, debug);
+}
+
 static void pushDirectoryItem(void* context, const char* path) {
   lua_State* L = context;
 
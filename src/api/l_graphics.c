@@ -2,6 +2,7 @@
 #include "graphics/graphics.h"
 #include "graphics/buffer.h"
 #include "graphics/canvas.h"
+#include "graphics/drawList.h"
 #include "graphics/material.h"
 #include "graphics/mesh.h"
 #include "graphics/model.h"
@@ -10,12 +11,15 @@
 #include "data/modelData.h"
 #include "data/rasterizer.h"
 #include "data/image.h"
+#include "filesystem/filesystem.h"
 #include "core/os.h"
+#include "core/profile.h"
 #include "util.h"
 #include <lua.h>
 #include <lauxlib.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 StringEntry lovrArcMode[] = {
@@ -36,6 +40,22 @@ StringEntry lovrAttributeType[] = {
   { 0 }
 };
 
+StringEntry lovrBatchBreak[] = {
+  [BREAK_TYPE] = ENTRY("type"),
+  [BREAK_FULL] = ENTRY("full"),
+  [BREAK_MESH] = ENTRY("mesh"),
+  [BREAK_CANVAS] = ENTRY("canvas"),
+  [BREAK_SHADER] = ENTRY("shader"),
+  [BREAK_MATERIAL] = ENTRY("material"),
+  [BREAK_BLEND] = ENTRY("blend"),
+  [BREAK_PIPELINE] = ENTRY("pipeline"),
+  [BREAK_PARAMS] = ENTRY("params"),
+  [BREAK_INSTANCED] = ENTRY("instanced"),
+  [BREAK_ORDER] = ENTRY("order"),
+  [BREAK_STREAM] = ENTRY("stream"),
+  { 0 }
+};
+
 StringEntry lovrBlendAlphaMode[] = {
   [BLEND_ALPHA_MULTIPLY] = ENTRY("alphamultiply"),
   [BLEND_PREMULTIPLIED] = ENTRY("premultiplied"),
@@ -116,6 +136,18 @@ StringEntry lovrFilterMode[] = {
   { 0 }
 };
 
+StringEntry lovrFlushReason[] = {
+  [FLUSH_STATE] = ENTRY("state"),
+  [FLUSH_CANVAS] = ENTRY("canvas"),
+  [FLUSH_SHADER] = ENTRY("shader"),
+  [FLUSH_MATERIAL] = ENTRY("material"),
+  [FLUSH_MESH] = ENTRY("mesh"),
+  [FLUSH_STREAM] = ENTRY("stream"),
+  [FLUSH_BATCHES] = ENTRY("batches"),
+  [FLUSH_DRAWS] = ENTRY("draws"),
+  { 0 }
+};
+
 StringEntry lovrHorizontalAlign[] = {
   [ALIGN_LEFT] = ENTRY("left"),
   [ALIGN_CENTER] = ENTRY("center"),
@@ -162,6 +194,17 @@ StringEntry lovrStencilAction[] = {
   { 0 }
 };
 
+StringEntry lovrStreamType[] = {
+  [STREAM_VERTEX] = ENTRY("vertex"),
+  [STREAM_DRAWID] = ENTRY("drawid"),
+  [STREAM_INDEX] = ENTRY("index"),
+  [STREAM_MODEL] = ENTRY("model"),
+  [STREAM_COLOR] = ENTRY("color"),
+  [STREAM_FRAME] = ENTRY("frame"),
+  [STREAM_INSTANCE] = ENTRY("instance"),
+  { 0 }
+};
+
 StringEntry lovrTextureFormat[] = {
   [FORMAT_RGB] = ENTRY("rgb"),
   [FORMAT_RGBA] = ENTRY("rgba"),
@@ -253,13 +296,13 @@ static uint32_t luax_getvertexcount(lua_State* L, int index) {
   }
 }
 
-static void luax_readvertices(lua_State* L, int index, float* v, uint32_t count) {
+static void luax_readvertices(lua_State* L, int index, float* v, uint32_t start, uint32_t count) {
   switch (lua_type(L, index)) {
     case LUA_TTABLE:
       lua_rawgeti(L, index, 1);
       if (lua_type(L, -1) == LUA_TNUMBER) {
         lua_pop(L, 1);
-        for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t i = start; i < start + count; i++) {
           for (int j = 0; j < 3; j++) {
             lua_rawgeti(L, index, 3 * i + j + 1);
             v[j] = lua_tonumber(L, -1);
@@ -270,7 +313,7 @@ static void luax_readvertices(lua_State* L, int index, float* v, uint32_t count)
         }
       } else {
         lua_pop(L, 1);
-        for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t i = start; i < start + count; i++) {
           lua_rawgeti(L, index, i + 1);
           vec3_init(v, luax_checkvector(L, -1, V_VEC3, NULL));
           lua_pop(L, 1);
@@ -281,7 +324,7 @@ static void luax_readvertices(lua_State* L, int index, float* v, uint32_t count)
       break;
 
     case LUA_TNUMBER:
-      for (uint32_t i = 0; i < count; i++) {
+      for (uint32_t i = start; i < start + count; i++) {
         for (int j = 0; j < 3; j++) {
           v[j] = lua_tonumber(L, index + 3 * i + j);
         }
@@ -291,7 +334,7 @@ static void luax_readvertices(lua_State* L, int index, float* v, uint32_t count)
       break;
 
     default:
-      for (uint32_t i = 0; i < count; i++) {
+      for (uint32_t i = start; i < start + count; i++) {
         vec3_init(v, luax_checkvector(L, index + i, V_VEC3, NULL));
         v[3] = v[4] = v[5] = v[6] = v[7] = 0.f;
         v += 8;
@@ -325,6 +368,14 @@ static Image* luax_checkimage(lua_State* L, int index, bool flip) {
 
 static int l_lovrGraphicsPresent(lua_State* L) {
   lovrGraphicsPresent();
+
+  // Batch break sites are per-frame, like the rest of the stats
+  lua_getfield(L, LUA_REGISTRYINDEX, "_lovrbatchsites");
+  if (lua_istable(L, -1)) {
+    lua_newtable(L);
+    lua_setfield(L, LUA_REGISTRYINDEX, "_lovrbatchsites");
+  }
+  lua_pop(L, 1);
   return 0;
 }
 
@@ -512,6 +563,23 @@ static int l_lovrGraphicsTock(lua_State* L) {
   return 1;
 }
 
+static int l_lovrGraphicsBeginZone(lua_State* L) {
+  size_t length;
+  const char* name = luaL_checklstring(L, 1, &length);
+  name = profile_intern(name, length);
+  lovrGraphicsFlush();
+  PROFILE_BEGIN(name);
+  lovrGraphicsBeginZone(name);
+  return 0;
+}
+
+static int l_lovrGraphicsEndZone(lua_State* L) {
+  lovrGraphicsFlush();
+  lovrGraphicsEndZone();
+  PROFILE_END();
+  return 0;
+}
+
 static int l_lovrGraphicsGetFeatures(lua_State* L) {
   const GpuFeatures* features = lovrGraphicsGetFeatures();
   lua_newtable(L);
@@ -525,6 +593,8 @@ static int l_lovrGraphicsGetFeatures(lua_State* L) {
   lua_setfield(L, -2, "instancedstereo");
   lua_pushboolean(L, features->multiview);
   lua_setfield(L, -2, "multiview");
+  lua_pushboolean(L, features->persistent);
+  lua_setfield(L, -2, "persistent");
   lua_pushboolean(L, features->timers);
   lua_setfield(L, -2, "timers");
   return 1;
@@ -554,12 +624,125 @@ static int l_lovrGraphicsGetLimits(lua_State* L) {
   return 1;
 }
 
+#define MAX_BREAK_SITES 8
+
+// The callback runs inside lovrGraphicsBatch, so it only counts the breaks.  The draw functions
+// turn them into call sites after the draw, on the thread that made it.
+static uint32_t pendingBreaks[MAX_BATCH_BREAKS];
+static bool breaksPending;
+
+static void onBatchBreak(void* userdata, BatchBreak reason) {
+  pendingBreaks[reason]++;
+  breaksPending = true;
+}
+
+// Break sites are keyed by the reason and traceback, and store a count
+void luax_tracebatchbreaks(lua_State* L) {
+  if (!breaksPending) {
+    return;
+  }
+
+  breaksPending = false;
+  for (uint32_t i = 0; i < MAX_BATCH_BREAKS; i++) {
+    lua_Integer pending = pendingBreaks[i];
+    if (pending == 0) continue;
+    pendingBreaks[i] = 0;
+
+    lua_getfield(L, LUA_REGISTRYINDEX, "_lovrbatchsites");
+    int top = lua_gettop(L);
+    luax_traceback(L, L, lovrBatchBreak[i].string, 1);
+    if (!lua_istable(L, top) || lua_gettop(L) == top) {
+      lua_settop(L, top - 1);
+      continue;
+    }
+
+    lua_pushvalue(L, -1);
+    lua_rawget(L, -3);
+    lua_Integer count = lua_tointeger(L, -1);
+    lua_pop(L, 1);
+    lua_pushinteger(L, count + pending);
+    lua_rawset(L, -3);
+    lua_pop(L, 1);
+  }
+}
+
+static int l_lovrGraphicsSetBatchTracing(lua_State* L) {
+  bool enable = lua_toboolean(L, 1);
+  memset(pendingBreaks, 0, sizeof(pendingBreaks));
+  breaksPending = false;
+  if (enable) {
+    lua_newtable(L);
+    lua_setfield(L, LUA_REGISTRYINDEX, "_lovrbatchsites");
+    lovrGraphicsSetBatchBreakCallback(onBatchBreak, NULL);
+  } else {
+    lovrGraphicsSetBatchBreakCallback(NULL, NULL);
+    lua_pushnil(L);
+    lua_setfield(L, LUA_REGISTRYINDEX, "_lovrbatchsites");
+  }
+  return 0;
+}
+
+// Subtables are reused when a table is passed in, so polling the stats every frame is cheap
+static void luax_getstatstable(lua_State* L, const char* name, int size) {
+  lua_getfield(L, 1, name);
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 1);
+    lua_createtable(L, 0, size);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, 1, name);
+  }
+}
+
+static void luax_pushbreaksites(lua_State* L) {
+  const char* sites[MAX_BREAK_SITES];
+  lua_Integer counts[MAX_BREAK_SITES];
+  uint32_t siteCount = 0;
+
+  // Keep the worst offenders sorted by count, the strings stay alive since they're table keys
+  lua_getfield(L, LUA_REGISTRYINDEX, "_lovrbatchsites");
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 1);
+    return;
+  }
+
+  lua_pushnil(L);
+  while (lua_next(L, -2) != 0) {
+    lua_Integer count = lua_tointeger(L, -1);
+    uint32_t i = siteCount;
+    while (i > 0 && counts[i - 1] < count) {
+      if (i < MAX_BREAK_SITES) {
+        sites[i] = sites[i - 1];
+        counts[i] = counts[i - 1];
+      }
+      i--;
+    }
+    if (i < MAX_BREAK_SITES) {
+      sites[i] = lua_tostring(L, -2);
+      counts[i] = count;
+      siteCount += siteCount < MAX_BREAK_SITES;
+    }
+    lua_pop(L, 1);
+  }
+
+  lua_createtable(L, siteCount, 0);
+  for (uint32_t i = 0; i < siteCount; i++) {
+    lua_createtable(L, 0, 2);
+    lua_pushstring(L, sites[i]);
+    lua_setfield(L, -2, "site");
+    lua_pushinteger(L, counts[i]);
+    lua_setfield(L, -2, "count");
+    lua_rawseti(L, -2, i + 1);
+  }
+  lua_setfield(L, 1, "breaksites");
+  lua_pop(L, 1);
+}
+
 static int l_lovrGraphicsGetStats(lua_State* L) {
   if (lua_gettop(L) > 0) {
     luaL_checktype(L, 1, LUA_TTABLE);
     lua_settop(L, 1);
   } else {
-    lua_createtable(L, 0, 7);
+    lua_createtable(L, 0, 19);
   }
 
   lovrGraphicsFlush();
@@ -570,6 +753,12 @@ static int l_lovrGraphicsGetStats(lua_State* L) {
   lua_setfield(L, 1, "renderpasses");
   lua_pushinteger(L, stats->drawCalls);
   lua_setfield(L, 1, "drawcalls");
+  lua_pushinteger(L, stats->mergedBatches);
+  lua_setfield(L, 1, "mergedbatches");
+  lua_pushinteger(L, stats->culledDraws);
+  lua_setfield(L, 1, "culleddraws");
+  lua_pushinteger(L, stats->fenceWaits);
+  lua_setfield(L, 1, "fencewaits");
   lua_pushinteger(L, stats->bufferCount);
   lua_setfield(L, 1, "buffers");
   lua_pushinteger(L, stats->textureCount);
@@ -578,9 +767,59 @@ static int l_lovrGraphicsGetStats(lua_State* L) {
   lua_setfield(L, 1, "buffermemory");
   lua_pushinteger(L, stats->textureMemory);
   lua_setfield(L, 1, "texturememory");
+  lua_pushinteger(L, stats->textureStreams);
+  lua_setfield(L, 1, "texturestreams");
+  lua_pushnumber(L, (double) stats->textureStreamBytes);
+  lua_setfield(L, 1, "texturestreambytes");
+  lua_pushinteger(L, stats->textureUploads);
+  lua_setfield(L, 1, "textureuploads");
+  lua_pushnumber(L, (double) stats->textureUploadBytes);
+  lua_setfield(L, 1, "textureuploadbytes");
+  lua_pushnumber(L, stats->submittedBatches > 0 ? (double) stats->submittedDraws / stats->submittedBatches : 0.);
+  lua_setfield(L, 1, "drawsperbatch");
+
+  luax_getstatstable(L, "batchbreaks", MAX_BATCH_BREAKS);
+  for (int i = 0; i < MAX_BATCH_BREAKS; i++) {
+    lua_pushinteger(L, stats->batchBreaks[i]);
+    lua_setfield(L, -2, lovrBatchBreak[i].string);
+  }
+  lua_pop(L, 1);
+
+  luax_getstatstable(L, "flushes", MAX_FLUSH_REASONS);
+  for (int i = 0; i < MAX_FLUSH_REASONS; i++) {
+    lua_pushinteger(L, stats->flushes[i]);
+    lua_setfield(L, -2, lovrFlushReason[i].string);
+  }
+  lua_pop(L, 1);
+
+  luax_getstatstable(L, "streambytes", MAX_STREAMS);
+  for (int i = 0; i < MAX_STREAMS; i++) {
+    lua_pushnumber(L, (double) stats->streamBytes[i]);
+    lua_setfield(L, -2, lovrStreamType[i].string);
+  }
+  lua_pop(L, 1);
+
+  luax_pushbreaksites(L);
+  return 1;
+}
+
+static int l_lovrGraphicsWarmShaders(lua_State* L) {
+  lua_pushboolean(L, lovrGraphicsWarmShaders());
   return 1;
 }
 
+static int l_lovrGraphicsGetTextureStreamBudget(lua_State* L) {
+  lua_pushnumber(L, (double) lovrGraphicsGetTextureStreamBudget());
+  return 1;
+}
+
+static int l_lovrGraphicsSetTextureStreamBudget(lua_State* L) {
+  lua_Number budget = luaL_checknumber(L, 1);
+  lovrAssert(budget >= 0., "Texture stream budget can not be negative");
+  lovrGraphicsSetTextureStreamBudget((size_t) budget);
+  return 0;
+}
+
 // State
 
 static int l_lovrGraphicsReset(lua_State* L) {
@@ -705,6 +944,16 @@ static int l_lovrGraphicsSetDefaultFilter(lua_State* L) {
   return 0;
 }
 
+static int l_lovrGraphicsIsDeferred(lua_State* L) {
+  lua_pushboolean(L, lovrGraphicsIsDeferred());
+  return 1;
+}
+
+static int l_lovrGraphicsSetDeferred(lua_State* L) {
+  lovrGraphicsSetDeferred(lua_toboolean(L, 1));
+  return 0;
+}
+
 static int l_lovrGraphicsGetDepthTest(lua_State* L) {
   CompareMode mode;
   bool write;
@@ -920,8 +1169,12 @@ static int l_lovrGraphicsFlush(lua_State* L) {
 static int l_lovrGraphicsPoints(lua_State* L) {
   float* vertices;
   uint32_t count = luax_getvertexcount(L, 1);
-  lovrGraphicsPoints(count, &vertices);
-  luax_readvertices(L, 1, vertices, count);
+  for (uint32_t i = 0; i < count;) {
+    uint32_t chunk = lovrGraphicsPoints(count - i, &vertices);
+    luax_readvertices(L, 1, vertices, i, chunk);
+    i += chunk;
+  }
+  luax_tracebatchbreaks(L);
   return 0;
 }
 
@@ -929,8 +1182,13 @@ static int l_lovrGraphicsLine(lua_State* L) {
   float* vertices;
   uint32_t count = luax_getvertexcount(L, 1);
   lovrAssert(count >= 2, "Need at least 2 points to draw a line");
-  lovrGraphicsLine(count, &vertices);
-  luax_readvertices(L, 1, vertices, count);
+  for (uint32_t i = 0;;) {
+    uint32_t chunk = lovrGraphicsLine(count - i, &vertices);
+    luax_readvertices(L, 1, vertices, i, chunk);
+    if (i + chunk >= count) break;
+    i += chunk - 1;
+  }
+  luax_tracebatchbreaks(L);
   return 0;
 }
 
@@ -949,6 +1207,7 @@ static int l_lovrGraphicsPlane(lua_State* L) {
   float w = luax_optfloat(L, index++, 1.f - u);
   float h = luax_optfloat(L, index++, 1.f - v);
   lovrGraphicsPlane(style, material, transform, u, v, w, h);
+  luax_tracebatchbreaks(L);
   return 0;
 }
 
@@ -963,6 +1222,7 @@ static int luax_rectangularprism(lua_State* L, int scaleComponents) {
   float transform[16];
   luax_readmat4(L, 2, transform, scaleComponents);
   lovrGraphicsBox(style, material, transform);
+  luax_tracebatchbreaks(L);
   return 0;
 }
 
@@ -993,6 +1253,7 @@ static int l_lovrGraphicsArc(lua_State* L) {
   float r2 = luax_optfloat(L, index++, 2.f * (float) M_PI);
   int segments = luaL_optinteger(L, index, 64) * (MIN(fabsf(r2 - r1), 2.f * (float) M_PI) / (2.f * (float) M_PI));
   lovrGraphicsArc(style, mode, material, transform, r1, r2, segments);
+  luax_tracebatchbreaks(L);
   return 0;
 }
 
@@ -1008,6 +1269,7 @@ static int l_lovrGraphicsCircle(lua_State* L) {
   int index = luax_readmat4(L, 2, transform, 1);
   int segments = luaL_optinteger(L, index, 32);
   lovrGraphicsCircle(style, material, transform, segments);
+  luax_tracebatchbreaks(L);
   return 0;
 }
 
@@ -1021,6 +1283,7 @@ static int l_lovrGraphicsCylinder(lua_State* L) {
   bool capped = lua_isnoneornil(L, index) ? true : lua_toboolean(L, index++);
   int segments = luaL_optinteger(L, index, (lua_Integer) floorf(16 + 16 * MAX(r1, r2)));
   lovrGraphicsCylinder(material, transform, r1, r2, capped, segments);
+  luax_tracebatchbreaks(L);
   return 0;
 }
 
@@ -1031,12 +1294,14 @@ static int l_lovrGraphicsSphere(lua_State* L) {
   index = luax_readmat4(L, index, transform, 1);
   int segments = luaL_optinteger(L, index, 30);
   lovrGraphicsSphere(material, transform, segments);
+  luax_tracebatchbreaks(L);
   return 0;
 }
 
 static int l_lovrGraphicsSkybox(lua_State* L) {
   Texture* texture = luax_checktype(L, 1, Texture);
   lovrGraphicsSkybox(texture);
+  luax_tracebatchbreaks(L);
   return 0;
 }
 
@@ -1049,6 +1314,7 @@ static int l_lovrGraphicsPrint(lua_State* L) {
   HorizontalAlign halign = luax_checkenum(L, index++, HorizontalAlign, "center");
   VerticalAlign valign = luax_checkenum(L, index++, VerticalAlign, "middle");
   lovrGraphicsPrint(str, length, transform, wrap, halign, valign);
+  luax_tracebatchbreaks(L);
   return 0;
 }
 
@@ -1077,6 +1343,7 @@ static int l_lovrGraphicsFill(lua_State* L) {
   float w = luax_optfloat(L, 4, 1.f - u);
   float h = luax_optfloat(L, 5, 1.f - v);
   lovrGraphicsFill(texture, u, v, w, h);
+  luax_tracebatchbreaks(L);
   return 0;
 }
 
@@ -1089,6 +1356,41 @@ static int l_lovrGraphicsCompute(lua_State* L) {
   return 0;
 }
 
+// Each entry is { model, animation, time, alpha }, the work is spread across the job pool
+static int l_lovrGraphicsAnimateModels(lua_State* L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  int count = luax_len(L, 1);
+  AnimationRequest* requests = lua_newuserdata(L, MAX(count, 1) * sizeof(AnimationRequest));
+  for (int i = 0; i < count; i++) {
+    lua_rawgeti(L, 1, i + 1);
+    lovrAssert(lua_istable(L, -1), "Expected a table for animation entry %d", i + 1);
+    lua_rawgeti(L, -1, 1);
+    lua_rawgeti(L, -2, 2);
+    lua_rawgeti(L, -3, 3);
+    lua_rawgeti(L, -4, 4);
+    Model* model = luax_checktype(L, -4, Model);
+    uint32_t animation;
+    if (lua_type(L, -3) == LUA_TSTRING) {
+      size_t length;
+      const char* name = lua_tolstring(L, -3, &length);
+      uint64_t index = map_get(&lovrModelGetModelData(model)->animationMap, hash64(name, length));
+      lovrAssert(index != MAP_NIL, "Model has no animation named '%s'", name);
+      animation = (uint32_t) index;
+    } else {
+      animation = luaL_checkinteger(L, -3) - 1;
+    }
+    requests[i] = (AnimationRequest) {
+      .model = model,
+      .animation = animation,
+      .time = luax_checkfloat(L, -2),
+      .alpha = luax_optfloat(L, -1, 1.f)
+    };
+    lua_pop(L, 5);
+  }
+  lovrModelAnimateAll(requests, count);
+  return 0;
+}
+
 // Types
 
 static void luax_checkuniformtype(lua_State* L, int index, UniformType* baseType, int* components) {
@@ -1221,6 +1523,23 @@ static int l_lovrGraphicsNewCanvas(lua_State* L) {
   return 1;
 }
 
+static int l_lovrGraphicsNewDrawList(lua_State* L) {
+  luaL_checktype(L, 1, LUA_TFUNCTION);
+  lua_settop(L, 1);
+  lovrGraphicsBeginDrawList();
+  int status = lua_pcall(L, 0, 0, 0);
+  DrawList* list = lovrGraphicsEndDrawList();
+
+  if (status != 0) {
+    lovrRelease(list, lovrDrawListDestroy);
+    return lua_error(L);
+  }
+
+  luax_pushtype(L, DrawList, list);
+  lovrRelease(list, lovrDrawListDestroy);
+  return 1;
+}
+
 static int l_lovrGraphicsNewFont(lua_State* L) {
   Rasterizer* rasterizer = luax_totype(L, 1, Rasterizer);
   uint32_t padding = 2;
@@ -1428,17 +1747,60 @@ static int l_lovrGraphicsNewMesh(lua_State* L) {
 }
 
 static int l_lovrGraphicsNewModel(lua_State* L) {
+  float lodRatios[MAX_LODS];
+  uint32_t lodCount = 0;
+  bool optimize = false;
+  bool quantize = false;
+  bool shared = false;
+  if (lua_istable(L, 2)) {
+    lua_getfield(L, 2, "optimize");
+    optimize = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 2, "quantize");
+    quantize = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 2, "shared");
+    shared = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+
+    lua_getfield(L, 2, "lods");
+    if (lua_istable(L, -1)) {
+      lodCount = luax_len(L, -1);
+      lovrCheck(lodCount <= MAX_LODS, "Too many LOD levels (max is %d)", MAX_LODS);
+      for (uint32_t i = 0; i < lodCount; i++) {
+        lua_rawgeti(L, -1, i + 1);
+        lodRatios[i] = luax_checkfloat(L, -1);
+        lovrCheck(lodRatios[i] > 0.f && lodRatios[i] < 1.f, "LOD ratios must be between 0 and 1");
+        lua_pop(L, 1);
+      }
+    }
+    lua_pop(L, 1);
+  }
+
+  // The optimize and lods options only apply when the Model loads its own ModelData.  An existing
+  // ModelData is used as is, so Models created from it can share its GPU resources (ModelData has
+  // optimize and generateLODs methods for preparing it once).
   ModelData* modelData = luax_totype(L, 1, ModelData);
 
   if (!modelData) {
-    Blob* blob = luax_readblob(L, 1, "Model");
+    Blob* blob = luax_mapblob(L, 1, "Model");
     modelData = lovrModelDataCreate(blob, luax_readfile);
     lovrRelease(blob, lovrBlobDestroy);
+
+    if (optimize) {
+      lovrModelDataOptimize(modelData, NULL, NULL);
+    }
+
+    if (lodCount > 0) {
+      lovrModelDataGenerateLods(modelData, lodRatios, lodCount);
+    }
   } else {
     lovrRetain(modelData);
   }
 
-  Model* model = lovrModelCreate(modelData);
+  Model* model = lovrModelCreate(modelData, quantize, shared);
   luax_pushtype(L, Model, model);
   lovrRelease(modelData, lovrModelDataDestroy);
   lovrRelease(model, lovrModelDestroy);
@@ -1512,6 +1874,7 @@ static int l_lovrGraphicsNewShader(lua_State* L) {
   ShaderFlag flags[MAX_SHADER_FLAGS];
   uint32_t flagCount = 0;
   bool multiview = true;
+  bool async = false;
   Shader* shader;
 
   if (lua_isstring(L, 1) && (lua_istable(L, 2) || lua_gettop(L) == 1)) {
@@ -1525,16 +1888,13 @@ static int l_lovrGraphicsNewShader(lua_State* L) {
       lua_getfield(L, 2, "stereo");
       multiview = lua_isnil(L, -1) ? multiview : lua_toboolean(L, -1);
       lua_pop(L, 1);
-    }
-
-    shader = lovrShaderCreateDefault(shaderType, flags, flagCount, multiview);
 
-    // Builtin uniforms
-    if (shaderType == SHADER_STANDARD) {
-      lovrShaderSetFloats(shader, "lovrExposure", (float[1]) { 1.f }, 0, 1);
-      lovrShaderSetFloats(shader, "lovrLightDirection", (float[3]) { -1.f, -1.f, -1.f }, 0, 3);
-      lovrShaderSetFloats(shader, "lovrLightColor", (float[4]) { 1.f, 1.f, 1.f, 1.f }, 0, 4);
+      lua_getfield(L, 2, "async");
+      async = lua_toboolean(L, -1);
+      lua_pop(L, 1);
     }
+
+    shader = lovrShaderCreateDefault(shaderType, flags, flagCount, multiview, async);
   } else {
     int vertexSourceLength;
     const char* vertexSource = luax_readshadersource(L, 1, &vertexSourceLength);
@@ -1549,9 +1909,13 @@ static int l_lovrGraphicsNewShader(lua_State* L) {
       lua_getfield(L, 3, "stereo");
       multiview = lua_isnil(L, -1) ? multiview : lua_toboolean(L, -1);
       lua_pop(L, 1);
+
+      lua_getfield(L, 3, "async");
+      async = lua_toboolean(L, -1);
+      lua_pop(L, 1);
     }
 
-    shader = lovrShaderCreateGraphics(vertexSource, vertexSourceLength, fragmentSource, fragmentSourceLength, flags, flagCount, multiview);
+    shader = lovrShaderCreateGraphics(vertexSource, vertexSourceLength, fragmentSource, fragmentSourceLength, flags, flagCount, multiview, async);
   }
 
   luax_pushtype(L, Shader, shader);
@@ -1666,6 +2030,7 @@ static int l_lovrGraphicsNewTexture(lua_State* L) {
   bool hasFlags = lua_istable(L, index);
   bool srgb = !blank;
   bool mipmaps = true;
+  bool stream = false;
   TextureFormat format = FORMAT_RGBA;
   int msaa = 0;
 
@@ -1689,6 +2054,43 @@ static int l_lovrGraphicsNewTexture(lua_State* L) {
     lua_getfield(L, index, "msaa");
     msaa = lua_isnil(L, -1) ? msaa : luaL_checkinteger(L, -1);
     lua_pop(L, 1);
+
+    lua_getfield(L, index, "stream");
+    stream = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+  }
+
+  if (!blank && type == TEXTURE_CUBE && depth == 0) {
+    depth = 6;
+    const char* faces[6] = { "right", "left", "top", "bottom", "back", "front" };
+    for (int i = 0; i < 6; i++) {
+      lua_pushstring(L, faces[i]);
+      lua_rawget(L, 1);
+      lovrAssert(!lua_isnil(L, -1), "Could not load cubemap texture: missing '%s' face", faces[i]);
+      lua_rawseti(L, 1, i + 1);
+    }
+  }
+
+  if (stream && !blank) {
+    Blob* blobs[6] = { NULL };
+    Image* images[6] = { NULL };
+    lovrAssert(depth <= 6, "Streamed textures can have at most 6 images");
+    for (int i = 0; i < depth; i++) {
+      lua_rawgeti(L, 1, i + 1);
+      images[i] = luax_totype(L, -1, Image);
+      blobs[i] = images[i] ? NULL : luax_readblob(L, -1, "Texture");
+      lua_pop(L, 1);
+    }
+
+    Texture* texture = lovrTextureCreateStream(type, blobs, images, depth, srgb, mipmaps);
+    lovrTextureSetFilter(texture, lovrGraphicsGetDefaultFilter());
+    for (int i = 0; i < depth; i++) {
+      lovrRelease(blobs[i], lovrBlobDestroy);
+    }
+
+    luax_pushtype(L, Texture, texture);
+    lovrRelease(texture, lovrTextureDestroy);
+    return 1;
   }
 
   Texture* texture = lovrTextureCreate(type, NULL, 0, srgb, mipmaps, msaa);
@@ -1698,17 +2100,6 @@ static int l_lovrGraphicsNewTexture(lua_State* L) {
     depth = depth ? depth : (type == TEXTURE_CUBE ? 6 : 1);
     lovrTextureAllocate(texture, width, height, depth, format);
   } else {
-    if (type == TEXTURE_CUBE && depth == 0) {
-      depth = 6;
-      const char* faces[6] = { "right", "left", "top", "bottom", "back", "front" };
-      for (int i = 0; i < 6; i++) {
-        lua_pushstring(L, faces[i]);
-        lua_rawget(L, 1);
-        lovrAssert(!lua_isnil(L, -1), "Could not load cubemap texture: missing '%s' face", faces[i]);
-        lua_rawseti(L, 1, i + 1);
-      }
-    }
-
     for (int i = 0; i < depth; i++) {
       lua_rawgeti(L, 1, i + 1);
       Image* image = luax_checkimage(L, -1, type != TEXTURE_CUBE);
@@ -1742,9 +2133,15 @@ static const luaL_Reg lovrGraphics[] = {
   { "setProjection", l_lovrGraphicsSetProjection },
   { "tick", l_lovrGraphicsTick },
   { "tock", l_lovrGraphicsTock },
+  { "beginZone", l_lovrGraphicsBeginZone },
+  { "endZone", l_lovrGraphicsEndZone },
   { "getFeatures", l_lovrGraphicsGetFeatures },
   { "getLimits", l_lovrGraphicsGetLimits },
   { "getStats", l_lovrGraphicsGetStats },
+  { "warmShaders", l_lovrGraphicsWarmShaders },
+  { "getTextureStreamBudget", l_lovrGraphicsGetTextureStreamBudget },
+  { "setTextureStreamBudget", l_lovrGraphicsSetTextureStreamBudget },
+  { "setBatchTracing", l_lovrGraphicsSetBatchTracing },
 
   // State
   { "reset", l_lovrGraphicsReset },
@@ -1764,6 +2161,8 @@ static const luaL_Reg lovrGraphics[] = {
   { "setCullingEnabled", l_lovrGraphicsSetCullingEnabled },
   { "getDefaultFilter", l_lovrGraphicsGetDefaultFilter },
   { "setDefaultFilter", l_lovrGraphicsSetDefaultFilter },
+  { "isDeferred", l_lovrGraphicsIsDeferred },
+  { "setDeferred", l_lovrGraphicsSetDeferred },
   { "getDepthTest", l_lovrGraphicsGetDepthTest },
   { "setDepthTest", l_lovrGraphicsSetDepthTest },
   { "getFont", l_lovrGraphicsGetFont },
@@ -1808,9 +2207,11 @@ static const luaL_Reg lovrGraphics[] = {
   { "stencil", l_lovrGraphicsStencil },
   { "fill", l_lovrGraphicsFill },
   { "compute", l_lovrGraphicsCompute },
+  { "animateModels", l_lovrGraphicsAnimateModels },
 
   // Types
   { "newCanvas", l_lovrGraphicsNewCanvas },
+  { "newDrawList", l_lovrGraphicsNewDrawList },
   { "newFont", l_lovrGraphicsNewFont },
   { "newMaterial", l_lovrGraphicsNewMaterial },
   { "newMesh", l_lovrGraphicsNewMesh },
@@ -1824,6 +2225,7 @@ static const luaL_Reg lovrGraphics[] = {
 };
 
 extern const luaL_Reg lovrCanvas[];
+extern const luaL_Reg lovrDrawList[];
 extern const luaL_Reg lovrFont[];
 extern const luaL_Reg lovrMaterial[];
 extern const luaL_Reg lovrMesh[];
@@ -1836,6 +2238,7 @@ int luaopen_lovr_graphics(lua_State* L) {
   lua_newtable(L);
   luax_register(L, lovrGraphics);
   luax_registertype(L, Canvas);
+  luax_registertype(L, DrawList);
   luax_registertype(L, Font);
   luax_registertype(L, Material);
   luax_registertype(L, Mesh);
@@ -1845,6 +2248,8 @@ int luaopen_lovr_graphics(lua_State* L) {
   luax_registertype(L, Texture);
 
   bool debug = false;
+  bool shaderCache = false;
+  bool fontCache = true;
 
   luax_pushconf(L);
   if (lua_istable(L, -1)) {
@@ -1853,11 +2258,27 @@ int luaopen_lovr_graphics(lua_State* L) {
       lua_getfield(L, -1, "debug");
       debug = lua_toboolean(L, -1);
       lua_pop(L, 1);
+
+      lua_getfield(L, -1, "shadercache");
+      shaderCache = lua_toboolean(L, -1);
+      lua_pop(L, 1);
+
+      lua_getfield(L, -1, "fontcache");
+      fontCache = lua_isnil(L, -1) || lua_toboolean(L, -1);
+      lua_pop(L, 1);
     }
     lua_pop(L, 1);
   }
 
-  lovrGraphicsInit(debug);
+  char shaderCachePath[1024];
+  char fontCachePath[1024];
+  const char* saveDirectory = NULL;
+#ifndef LOVR_DISABLE_FILESYSTEM
+  saveDirectory = lovrFilesystemGetSaveDirectory();
+#endif
+  shaderCache &= saveDirectory && snprintf(shaderCachePath, sizeof(shaderCachePath), "%s/shadercache", saveDirectory) < (int) sizeof(shaderCachePath);
+  fontCache &= saveDirectory && snprintf(fontCachePath, sizeof(fontCachePath), "%s/fontcache", saveDirectory) < (int) sizeof(fontCachePath);
+  lovrGraphicsInit(debug, shaderCache ? shaderCachePath : NULL, fontCache ? fontCachePath : NULL);
 
   if (lua_istable(L, -1)) {
     lua_pushcfunction(L, l_lovrGraphicsCreateWindow);
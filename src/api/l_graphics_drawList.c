@@ -0,0 +1,25 @@
+#include "api.h"
+#include "graphics/drawList.h"
+#include "util.h"
+#include <lua.h>
+#include <lauxlib.h>
+
+static int l_lovrDrawListDraw(lua_State* L) {
+  DrawList* list = luax_checktype(L, 1, DrawList);
+  float transform[16];
+  luax_readmat4(L, 2, transform, 1);
+  lovrDrawListDraw(list, transform);
+  return 0;
+}
+
+static int l_lovrDrawListGetBatchCount(lua_State* L) {
+  DrawList* list = luax_checktype(L, 1, DrawList);
+  lua_pushinteger(L, lovrDrawListGetBatchCount(list));
+  return 1;
+}
+
+const luaL_Reg lovrDrawList[] = {
+  { "draw", l_lovrDrawListDraw },
+  { "getBatchCount", l_lovrDrawListGetBatchCount },
+  { NULL, NULL }
+};
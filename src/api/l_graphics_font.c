@@ -109,6 +109,42 @@ static int l_lovrFontHasGlyphs(lua_State* L) {
   return 1;
 }
 
+// Takes a string or a range of codepoints, codepoints in a range that the font doesn't have are skipped
+static int l_lovrFontPrewarm(lua_State* L) {
+  Font* font = luax_checktype(L, 1, Font);
+  Rasterizer* rasterizer = lovrFontGetRasterizer(font);
+  uint32_t* codepoints;
+  uint32_t count = 0;
+
+  if (lua_type(L, 2) == LUA_TNUMBER) {
+    lua_Integer first = luaL_checkinteger(L, 2);
+    lua_Integer last = luaL_optinteger(L, 3, first);
+    lovrAssert(first >= 0 && first <= last && last <= 0x10ffff, "Invalid codepoint range");
+    codepoints = lua_newuserdata(L, (size_t) (last - first + 1) * sizeof(uint32_t));
+    for (lua_Integer codepoint = first; codepoint <= last; codepoint++) {
+      if (lovrRasterizerHasGlyph(rasterizer, (uint32_t) codepoint)) {
+        codepoints[count++] = (uint32_t) codepoint;
+      }
+    }
+  } else {
+    size_t length;
+    const char* string = luaL_checklstring(L, 2, &length);
+    const char* end = string + length;
+    codepoints = lua_newuserdata(L, length * sizeof(uint32_t));
+    unsigned int codepoint;
+    size_t bytes;
+    while ((bytes = utf8_decode(string, end, &codepoint)) > 0) {
+      if (codepoint != '\n' && codepoint != '\t') {
+        codepoints[count++] = codepoint;
+      }
+      string += bytes;
+    }
+  }
+
+  lovrFontPrewarm(font, codepoints, count);
+  return 0;
+}
+
 static int l_lovrFontGetFilter(lua_State* L) {
   Font* font = luax_checktype(L, 1, Font);
   TextureFilter filter = lovrFontGetFilter(font);
@@ -140,6 +176,7 @@ const luaL_Reg lovrFont[] = {
   { "setPixelDensity", l_lovrFontSetPixelDensity },
   { "getRasterizer", l_lovrFontGetRasterizer},
   { "hasGlyphs", l_lovrFontHasGlyphs },
+  { "prewarm", l_lovrFontPrewarm },
   { "getFilter", l_lovrFontGetFilter },
   { "setFilter", l_lovrFontSetFilter },
   { NULL, NULL }
@@ -3,11 +3,48 @@
 #include "graphics/graphics.h"
 #include "graphics/material.h"
 #include "graphics/mesh.h"
+#include "graphics/shader.h"
 #include "data/blob.h"
 #include <lua.h>
 #include <lauxlib.h>
 #include <limits.h>
 
+// Instances are either a count, or a Blob/ShaderBlock of mat4 transforms followed by an optional
+// Blob/ShaderBlock of vec4 colors.  Blobs are streamed to the GPU, ShaderBlocks are used directly.
+InstanceData* luax_readinstances(lua_State* L, int index, uint32_t* count, InstanceData* instances) {
+  if (lua_type(L, index) != LUA_TUSERDATA) {
+    *count = luaL_optinteger(L, index, 1);
+    return NULL;
+  }
+
+  Blob* blob;
+  ShaderBlock* block;
+  float* transforms = NULL;
+  float* colors = NULL;
+  *instances = (InstanceData) { 0 };
+
+  if ((blob = luax_totype(L, index, Blob)) != NULL) {
+    transforms = blob->data;
+    *count = (uint32_t) (blob->size / (16 * sizeof(float)));
+  } else if ((block = luax_totype(L, index, ShaderBlock)) != NULL) {
+    instances->transforms = lovrShaderBlockGetBuffer(block);
+    *count = (uint32_t) (lovrBufferGetSize(instances->transforms) / (16 * sizeof(float)));
+  } else {
+    luax_typeerror(L, index, "number, Blob, or ShaderBlock");
+  }
+
+  if ((blob = luax_totype(L, index + 1, Blob)) != NULL) {
+    lovrAssert(blob->size >= *count * 4 * sizeof(float), "Blob is too small for %d instance colors", *count);
+    colors = blob->data;
+  } else if ((block = luax_totype(L, index + 1, ShaderBlock)) != NULL) {
+    instances->colors = lovrShaderBlockGetBuffer(block);
+    lovrAssert(lovrBufferGetSize(instances->colors) >= *count * 4 * sizeof(float), "ShaderBlock is too small for %d instance colors", *count);
+  }
+
+  lovrGraphicsStreamInstances(instances, transforms, colors, *count);
+  return instances;
+}
+
 static int l_lovrMeshAttachAttributes(lua_State* L) {
   Mesh* mesh = luax_checktype(L, 1, Mesh);
   Mesh* other = luax_checktype(L, 2, Mesh);
@@ -83,8 +120,11 @@ static int l_lovrMeshDraw(lua_State* L) {
   Mesh* mesh = luax_checktype(L, 1, Mesh);
   float transform[16];
   int index = luax_readmat4(L, 2, transform, 1);
-  int instances = luaL_optinteger(L, index, 1);
-  lovrGraphicsDrawMesh(mesh, transform, instances, NULL);
+  uint32_t instances;
+  InstanceData instanceData;
+  InstanceData* data = luax_readinstances(L, index, &instances, &instanceData);
+  lovrGraphicsDrawMesh(mesh, NULL, transform, instances, data, NULL, 0, NULL, NULL);
+  luax_tracebatchbreaks(L);
   return 0;
 }
 
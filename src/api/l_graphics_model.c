@@ -1,4 +1,5 @@
 #include "api.h"
+#include "graphics/graphics.h"
 #include "graphics/material.h"
 #include "graphics/model.h"
 #include "data/modelData.h"
@@ -6,6 +7,8 @@
 #include <lua.h>
 #include <lauxlib.h>
 
+#define MAX_ANIMATION_BLENDS 16
+
 static uint32_t luax_checkanimation(lua_State* L, int index, Model* model) {
   switch (lua_type(L, index)) {
     case LUA_TSTRING: {
@@ -25,8 +28,11 @@ static int l_lovrModelDraw(lua_State* L) {
   Model* model = luax_checktype(L, 1, Model);
   float transform[16];
   int index = luax_readmat4(L, 2, transform, 1);
-  int instances = luaL_optinteger(L, index, 1);
-  lovrModelDraw(model, transform, instances);
+  uint32_t instances;
+  InstanceData instanceData;
+  InstanceData* data = luax_readinstances(L, index, &instances, &instanceData);
+  lovrModelDraw(model, transform, instances, data);
+  luax_tracebatchbreaks(L);
   return 0;
 }
 
@@ -39,6 +45,22 @@ static int l_lovrModelAnimate(lua_State* L) {
   return 0;
 }
 
+static int l_lovrModelBlend(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  AnimationBlend blends[MAX_ANIMATION_BLENDS];
+  uint32_t count = 0;
+  int top = lua_gettop(L);
+  for (int index = 2; index <= top; index += 3) {
+    lovrAssert(count < MAX_ANIMATION_BLENDS, "Too many animations to blend (max is %d)", MAX_ANIMATION_BLENDS);
+    blends[count].animation = luax_checkanimation(L, index, model);
+    blends[count].time = luax_checkfloat(L, index + 1);
+    blends[count].weight = luax_optfloat(L, index + 2, 1.f);
+    count++;
+  }
+  lovrModelBlend(model, blends, count);
+  return 0;
+}
+
 static int l_lovrModelPose(lua_State* L) {
   Model* model = luax_checktype(L, 1, Model);
 
@@ -73,31 +95,37 @@ static int l_lovrModelPose(lua_State* L) {
   return 0;
 }
 
-static int l_lovrModelGetMaterial(lua_State* L) {
-  Model* model = luax_checktype(L, 1, Model);
-
-  uint32_t material;
-  switch (lua_type(L, 2)) {
-    case LUA_TNUMBER:
-      material = lua_tointeger(L, 2) - 1;
-      break;
+static uint32_t luax_checkmaterial(lua_State* L, int index, Model* model) {
+  switch (lua_type(L, index)) {
     case LUA_TSTRING: {
       size_t length;
-      const char* name = lua_tolstring(L, 2, &length);
+      const char* name = lua_tolstring(L, index, &length);
       ModelData* modelData = lovrModelGetModelData(model);
-      uint64_t index = map_get(&modelData->materialMap, hash64(name, length));
-      lovrAssert(index != MAP_NIL, "Model has no material named '%s'", name);
-      material = (uint32_t) index;
-      break;
+      uint64_t materialIndex = map_get(&modelData->materialMap, hash64(name, length));
+      lovrAssert(materialIndex != MAP_NIL, "Model has no material named '%s'", name);
+      return (uint32_t) materialIndex;
     }
-    default:
-      return luax_typeerror(L, 2, "nil, number, or string");
+    case LUA_TNUMBER: return lua_tointeger(L, index) - 1;
+    default: return luax_typeerror(L, index, "number or string");
   }
+}
 
+static int l_lovrModelGetMaterial(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  uint32_t material = luax_checkmaterial(L, 2, model);
   luax_pushtype(L, Material, lovrModelGetMaterial(model, material));
   return 1;
 }
 
+// Passing nil restores the Model's own Material (or the shared one, for Models created with shared = true)
+static int l_lovrModelSetMaterial(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  uint32_t material = luax_checkmaterial(L, 2, model);
+  Material* override = lua_isnoneornil(L, 3) ? NULL : luax_checktype(L, 3, Material);
+  lovrModelSetMaterial(model, material, override);
+  return 0;
+}
+
 static int l_lovrModelGetAABB(lua_State* L) {
   Model* model = luax_checktype(L, 1, Model);
   float aabb[6];
@@ -108,6 +136,32 @@ static int l_lovrModelGetAABB(lua_State* L) {
   return 6;
 }
 
+static int l_lovrModelIsCulling(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  lua_pushboolean(L, lovrModelIsCulling(model));
+  return 1;
+}
+
+static int l_lovrModelSetCulling(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  lovrModelSetCulling(model, lua_toboolean(L, 2));
+  return 0;
+}
+
+static int l_lovrModelGetLODScale(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  lua_pushnumber(L, lovrModelGetLodScale(model));
+  return 1;
+}
+
+static int l_lovrModelSetLODScale(lua_State* L) {
+  Model* model = luax_checktype(L, 1, Model);
+  float scale = luax_checkfloat(L, 2);
+  lovrCheck(scale >= 0.f, "LOD scale can not be negative");
+  lovrModelSetLodScale(model, scale);
+  return 0;
+}
+
 static int l_lovrModelGetTriangles(lua_State* L) {
   Model* model = luax_checktype(L, 1, Model);
   float* vertices = NULL;
@@ -226,9 +280,15 @@ static int l_lovrModelHasJoints(lua_State* L) {
 const luaL_Reg lovrModel[] = {
   { "draw", l_lovrModelDraw },
   { "animate", l_lovrModelAnimate },
+  { "blend", l_lovrModelBlend },
   { "pose", l_lovrModelPose },
   { "getMaterial", l_lovrModelGetMaterial },
+  { "setMaterial", l_lovrModelSetMaterial },
   { "getAABB", l_lovrModelGetAABB },
+  { "isCulling", l_lovrModelIsCulling },
+  { "setCulling", l_lovrModelSetCulling },
+  { "getLODScale", l_lovrModelGetLODScale },
+  { "setLODScale", l_lovrModelSetLODScale },
   { "getTriangles", l_lovrModelGetTriangles },
   { "getNodePose", l_lovrModelGetNodePose },
   { "getAnimationName", l_lovrModelGetAnimationName },
@@ -3,189 +3,11 @@
 #include "graphics/shader.h"
 #include "data/blob.h"
 #include "core/maf.h"
+#include "util.h"
 #include <lua.h>
 #include <lauxlib.h>
 #include <stdlib.h>
-
-struct TempData {
-  void* data;
-  int size;
-};
-
-// Not thread safe
-static struct TempData tempData;
-
-int luax_checkuniform(lua_State* L, int index, const Uniform* uniform, void* dest, const char* debug) {
-  Blob* blob = luax_totype(L, index, Blob);
-  UniformType uniformType = uniform->type;
-  int components = uniform->components;
-  int count = uniform->count;
-
-  if (uniformType == UNIFORM_MATRIX) {
-    components *= components;
-  }
-
-  if (blob) {
-    size_t elements = count * components;
-    const char* s = elements == 1 ? "" : "s";
-    size_t capacity;
-
-    switch (uniformType) {
-      case UNIFORM_FLOAT:
-      case UNIFORM_MATRIX:
-        capacity = blob->size / sizeof(float);
-        lovrAssert(capacity >= elements, "Blob can only hold %d float%s, at least %d needed for uniform '%s'", capacity, s, elements, debug);
-        memcpy(dest, blob->data, elements * sizeof(float));
-        break;
-
-      case UNIFORM_INT:
-        capacity = blob->size / sizeof(int);
-        lovrAssert(capacity >= elements, "Blob can only hold %d int%s, at least %d needed for uniform '%s'", capacity, s, elements, debug);
-        memcpy(dest, blob->data, elements * sizeof(int));
-        break;
-
-      case UNIFORM_SAMPLER: lovrThrow("Sampler uniform '%s' can not be updated with a Blob", debug);
-      case UNIFORM_IMAGE: lovrThrow("Image uniform '%s' can not be updated with a Blob", debug);
-    }
-
-    return 0;
-  }
-
-  if (components == 1) {
-    bool isTable = lua_istable(L, index);
-    int length = isTable ? luax_len(L, index) : count;
-    length = MIN(length, count);
-    for (int i = 0; i < count; i++) {
-      int j = index + i;
-      if (isTable) {
-        lua_rawgeti(L, index, i + 1);
-        j = -1;
-      }
-
-      switch (uniformType) {
-        case UNIFORM_FLOAT: *((float*) dest + i) = luax_optfloat(L, j, 0.f); break;
-        case UNIFORM_INT: *((int*) dest + i) = luaL_optinteger(L, j, 0); break;
-        case UNIFORM_SAMPLER: {
-          *((Texture**) dest + i) = luax_checktype(L, j, Texture);
-          TextureType type = lovrTextureGetType(*((Texture**) dest + i));
-          lovrAssert(type == uniform->textureType, "Attempt to send %s texture to %s sampler uniform", lovrTextureType[type].string, lovrTextureType[uniform->textureType].string);
-          break;
-        }
-
-        case UNIFORM_IMAGE: {
-          StorageImage* image = (StorageImage*) dest + i;
-          image->texture = luax_checktype(L, j, Texture);
-          image->slice = -1;
-          image->mipmap = 0;
-          image->access = ACCESS_READ_WRITE;
-          TextureType type = lovrTextureGetType(image->texture);
-          lovrAssert(type == uniform->textureType, "Attempt to send %s texture to %s storage image uniform", lovrTextureType[type], lovrTextureType[uniform->textureType]);
-          break;
-        }
-
-        default: break;
-      }
-
-      if (isTable) {
-        lua_pop(L, 1);
-      }
-    }
-  } else {
-    bool wrappedTable = false;
-
-    if (lua_istable(L, index)) {
-      lua_rawgeti(L, index, 1);
-      wrappedTable = !lua_isnumber(L, -1);
-      lua_pop(L, 1);
-    }
-
-    if (wrappedTable) {
-      int length = luax_len(L, index);
-      length = MIN(length, count);
-      for (int i = 0; i < length; i++) {
-        lua_rawgeti(L, index, i + 1);
-
-        if (uniformType == UNIFORM_MATRIX && components == 16) {
-          VectorType type;
-          mat4 m = luax_tovector(L, -1, &type);
-          if (m && type == V_MAT4) {
-            mat4_init((float*) dest + i * components, m);
-            lua_pop(L, 1);
-            continue;
-          }
-        } else if (uniformType == UNIFORM_FLOAT && components == 3) {
-          VectorType type;
-          vec3 v = luax_tovector(L, -1, &type);
-          if (v && type == V_VEC3) {
-            vec3_init((float*) dest + i * components, v);
-            lua_pop(L, 1);
-            continue;
-          }
-        }
-
-        luaL_checktype(L, -1, LUA_TTABLE);
-        for (int j = 0; j < components; j++) {
-          lua_rawgeti(L, -1, j + 1);
-          switch (uniformType) {
-            case UNIFORM_FLOAT:
-            case UNIFORM_MATRIX:
-              *((float*) dest + i * components + j) = luax_optfloat(L, -1, 0.f);
-              break;
-
-            case UNIFORM_INT:
-              *((int*) dest + i * components + j) = luaL_optinteger(L, -1, 0);
-              break;
-
-            case UNIFORM_SAMPLER:
-            case UNIFORM_IMAGE:
-              lovrThrow("Unreachable");
-          }
-          lua_pop(L, 1);
-        }
-        lua_pop(L, 1);
-      }
-    } else {
-      for (int i = 0; i < count; i++) {
-        if (uniformType == UNIFORM_MATRIX && components == 16) {
-          VectorType type;
-          mat4 m = luax_tovector(L, index + i, &type);
-          if (m && type == V_MAT4) {
-            mat4_init((float*) dest + i * components, m);
-            continue;
-          }
-        } else if (uniformType == UNIFORM_FLOAT && components == 3) {
-          VectorType type;
-          vec3 v = luax_tovector(L, index + i, &type);
-          if (v && type == V_VEC3) {
-            vec3_init((float*) dest + i * components, v);
-            continue;
-          }
-        }
-
-        luaL_checktype(L, index + i, LUA_TTABLE);
-        for (int j = 0; j < components; j++) {
-          lua_rawgeti(L, index + i, j + 1);
-          switch (uniformType) {
-            case UNIFORM_FLOAT:
-            case UNIFORM_MATRIX:
-              *((float*) dest + i * components + j) = luax_optfloat(L, -1, 0.f);
-              break;
-
-            case UNIFORM_INT:
-              *((int*) dest + i * components + j) = luaL_optinteger(L, -1, 0);
-              break;
-
-            case UNIFORM_SAMPLER:
-            case UNIFORM_IMAGE:
-              lovrThrow("Unreachable");
-          }
-        }
-      }
-    }
-  }
-
-  return 0;
-}
+#include <string.h>
 
 static int l_lovrShaderGetType(lua_State* L) {
   Shader* shader = luax_checktype(L, 1, Shader);
@@ -193,6 +15,12 @@ static int l_lovrShaderGetType(lua_State* L) {
   return 1;
 }
 
+static int l_lovrShaderIsReady(lua_State* L) {
+  Shader* shader = luax_checktype(L, 1, Shader);
+  lua_pushboolean(L, lovrShaderIsReady(shader));
+  return 1;
+}
+
 static int l_lovrShaderHasUniform(lua_State* L) {
   Shader* shader = luax_checktype(L, 1, Shader);
   const char* name = luaL_checkstring(L, 2);
@@ -207,36 +35,119 @@ static int l_lovrShaderHasBlock(lua_State* L) {
   return 1;
 }
 
-static int l_lovrShaderSend(lua_State* L) {
-  Shader* shader = luax_checktype(L, 1, Shader);
-  const char* name = luaL_checkstring(L, 2);
-  const Uniform* uniform = lovrShaderGetUniform(shader, name);
-  if (!uniform) {
-    lua_pushboolean(L, false);
-    return 1;
+typedef struct {
+  arr_t(double) numbers;
+  arr_t(uint32_t) lengths;
+  arr_t(Texture*) textures;
+} UniformCapture;
+
+// Not thread safe
+static UniformCapture capture;
+
+static void luax_captureitem(lua_State* L, int index, const char* name) {
+  static const uint32_t vectorComponents[] = { [V_VEC2] = 2, [V_VEC3] = 3, [V_VEC4] = 4, [V_QUAT] = 4, [V_MAT4] = 16 };
+  Texture* texture = luax_totype(L, index, Texture);
+  VectorType type;
+  float* vector = texture ? NULL : luax_tovector(L, index, &type);
+  uint32_t length = 0;
+
+  if (texture || lua_isnoneornil(L, index)) {
+    length = 0;
+  } else if (vector) {
+    length = vectorComponents[type];
+    for (uint32_t i = 0; i < length; i++) {
+      arr_push(&capture.numbers, vector[i]);
+    }
+  } else if (lua_istable(L, index)) {
+    length = luax_len(L, index);
+    for (uint32_t i = 0; i < length; i++) {
+      lua_rawgeti(L, index, i + 1);
+      arr_push(&capture.numbers, luax_optfloat(L, -1, 0.f));
+      lua_pop(L, 1);
+    }
+  } else if (lua_type(L, index) == LUA_TNUMBER) {
+    length = 1;
+    arr_push(&capture.numbers, lua_tonumber(L, index));
+  } else {
+    lovrThrow("Expected a number, table, vector, or Texture for uniform '%s'", name);
   }
 
-  if (tempData.size < uniform->size) {
-    tempData.size = uniform->size;
-    tempData.data = realloc(tempData.data, tempData.size);
+  arr_push(&capture.lengths, length);
+  arr_push(&capture.textures, texture);
+}
+
+// The value points into the capture (or the Blob), so it's only valid until the next capture
+static void luax_captureuniform(lua_State* L, int index, UniformValue* value, const char* name) {
+  memset(value, 0, sizeof(*value));
+
+  Blob* blob = luax_totype(L, index, Blob);
+  if (blob) {
+    value->bytes = blob->data;
+    value->size = blob->size;
+    return;
   }
 
-  luax_checkuniform(L, 3, uniform, tempData.data, name);
-  switch (uniform->type) {
-    case UNIFORM_FLOAT: lovrShaderSetFloats(shader, uniform->name, tempData.data, 0, uniform->count * uniform->components); break;
-    case UNIFORM_INT: lovrShaderSetInts(shader, uniform->name, tempData.data, 0, uniform->count * uniform->components); break;
-    case UNIFORM_MATRIX: lovrShaderSetMatrices(shader, uniform->name, tempData.data, 0, uniform->count * uniform->components * uniform->components); break;
-    case UNIFORM_SAMPLER: lovrShaderSetTextures(shader, uniform->name, tempData.data, 0, uniform->count); break;
-    case UNIFORM_IMAGE: lovrShaderSetImages(shader, uniform->name, tempData.data, 0, uniform->count); break;
+  if (!capture.numbers.data) {
+    arr_init(&capture.numbers, arr_alloc);
+    arr_init(&capture.lengths, arr_alloc);
+    arr_init(&capture.textures, arr_alloc);
   }
-  lua_pushboolean(L, true);
+
+  arr_clear(&capture.numbers);
+  arr_clear(&capture.lengths);
+  arr_clear(&capture.textures);
+
+  int top = lua_gettop(L);
+  if (lua_istable(L, index)) {
+    lua_rawgeti(L, index, 1);
+    value->flat = lua_type(L, -1) == LUA_TNUMBER;
+    value->wrapped = !value->flat;
+    lua_pop(L, 1);
+  }
+
+  if (value->wrapped) {
+    int length = luax_len(L, index);
+    for (int i = 0; i < length; i++) {
+      lua_rawgeti(L, index, i + 1);
+      luax_captureitem(L, -1, name);
+      lua_pop(L, 1);
+    }
+  } else {
+    for (int i = index; i <= top; i++) {
+      luax_captureitem(L, i, name);
+    }
+  }
+
+  value->numbers = capture.numbers.data;
+  value->lengths = capture.lengths.data;
+  value->textures = capture.textures.data;
+  value->itemCount = (uint32_t) capture.lengths.length;
+}
+
+int luax_checkuniform(lua_State* L, int index, const Uniform* uniform, void* dest, const char* debug) {
+  UniformValue value;
+  char error[256];
+  luax_captureuniform(L, index, &value, debug);
+  if (!lovrShaderConvertValue(uniform, &value, dest, error, sizeof(error))) {
+    lovrThrow("%s", error);
+  }
+  return 0;
+}
+
+// Values sent while the Shader is still compiling are applied once it finishes, returning true
+static int l_lovrShaderSend(lua_State* L) {
+  Shader* shader = luax_checktype(L, 1, Shader);
+  const char* name = luaL_checkstring(L, 2);
+  UniformValue value;
+  luax_captureuniform(L, 3, &value, name);
+  lua_pushboolean(L, lovrShaderSetValue(shader, name, &value));
   return 1;
 }
 
 static int l_lovrShaderSendBlock(lua_State* L) {
   Shader* shader = luax_checktype(L, 1, Shader);
   const char* name = luaL_checkstring(L, 2);
-  lovrAssert(lovrShaderHasBlock(shader, name), "Unknown shader block '%s'", name);
+  lovrAssert(lovrShaderIsPending(shader) || lovrShaderHasBlock(shader, name), "Unknown shader block '%s'", name);
   ShaderBlock* block = luax_checktype(L, 3, ShaderBlock);
   UniformAccess access = luax_checkenum(L, 4, UniformAccess, "readwrite");
   Buffer* buffer = lovrShaderBlockGetBuffer(block);
@@ -265,6 +176,7 @@ static int l_lovrShaderSendImage(lua_State* L) {
 
 const luaL_Reg lovrShader[] = {
   { "getType", l_lovrShaderGetType },
+  { "isReady", l_lovrShaderIsReady },
   { "hasUniform", l_lovrShaderHasUniform },
   { "hasBlock", l_lovrShaderHasBlock },
   { "send", l_lovrShaderSend },
@@ -83,6 +83,12 @@ static int l_lovrTextureGetWrap(lua_State* L) {
   return 2;
 }
 
+static int l_lovrTextureIsReady(lua_State* L) {
+  Texture* texture = luax_checktype(L, 1, Texture);
+  lua_pushboolean(L, lovrTextureIsReady(texture));
+  return 1;
+}
+
 static int l_lovrTextureReplacePixels(lua_State* L) {
   Texture* texture = luax_checktype(L, 1, Texture);
   Image* image = luax_checktype(L, 2, Image);
@@ -131,6 +137,7 @@ const luaL_Reg lovrTexture[] = {
   { "getType", l_lovrTextureGetType },
   { "getWidth", l_lovrTextureGetWidth },
   { "getWrap", l_lovrTextureGetWrap },
+  { "isReady", l_lovrTextureIsReady },
   { "replacePixels", l_lovrTextureReplacePixels },
   { "setCompareMode", l_lovrTextureSetCompareMode },
   { "setFilter", l_lovrTextureSetFilter },
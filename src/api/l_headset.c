@@ -509,7 +509,7 @@ static int l_lovrHeadsetNewModel(lua_State* L) {
   ModelData* modelData = lovrHeadsetInterface->newModelData(device, animated);
 
   if (modelData) {
-    Model* model = lovrModelCreate(modelData);
+    Model* model = lovrModelCreate(modelData, false, false);
     luax_pushtype(L, Model, model);
     lovrRelease(modelData, lovrModelDataDestroy);
     lovrRelease(model, lovrModelDestroy);
@@ -19,5 +19,6 @@ static const luaL_Reg lovr[] = {
 int luaopen_lovr(lua_State* L) {
   lua_newtable(L);
   luax_register(L, lovr);
+  luax_retainjobs(L);
   return 1;
 }
@@ -1,5 +1,6 @@
 #include "api.h"
 #include "physics/physics.h"
+#include "core/profile.h"
 #include "util.h"
 #include <lua.h>
 #include <lauxlib.h>
@@ -11,7 +12,12 @@ static void collisionResolver(World* world, void* userdata) {
   lua_State* L = userdata;
   luaL_checktype(L, -1, LUA_TFUNCTION);
   luax_pushtype(L, World, world);
-  lua_call(L, 1, 0);
+
+  // Errors unwind past lovrWorldUpdate, so its profile zone is closed before rethrowing
+  if (lua_pcall(L, 1, 0, 0)) {
+    PROFILE_END();
+    lua_error(L);
+  }
 }
 
 static int nextOverlap(lua_State* L) {
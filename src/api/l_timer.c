@@ -1,7 +1,9 @@
 #include "api.h"
 #include "timer/timer.h"
+#include "core/profile.h"
 #include <lua.h>
 #include <lauxlib.h>
+#include <stdlib.h>
 
 static int l_lovrTimerGetDelta(lua_State* L) {
   lua_pushnumber(L, lovrTimerGetDelta());
@@ -34,6 +36,36 @@ static int l_lovrTimerSleep(lua_State* L) {
   return 0;
 }
 
+static int l_lovrTimerIsProfiling(lua_State* L) {
+  lua_pushboolean(L, profile_active);
+  return 1;
+}
+
+static int l_lovrTimerSetProfiling(lua_State* L) {
+  profile_set_active(lua_toboolean(L, 1));
+  return 0;
+}
+
+static int l_lovrTimerBeginZone(lua_State* L) {
+  size_t length;
+  const char* name = luaL_checklstring(L, 1, &length);
+  PROFILE_BEGIN(profile_intern(name, length));
+  return 0;
+}
+
+static int l_lovrTimerEndZone(lua_State* L) {
+  PROFILE_END();
+  return 0;
+}
+
+static int l_lovrTimerGetTrace(lua_State* L) {
+  size_t length;
+  char* trace = profile_export(&length);
+  lua_pushlstring(L, trace, length);
+  free(trace);
+  return 1;
+}
+
 static const luaL_Reg lovrTimer[] = {
   { "getDelta", l_lovrTimerGetDelta },
   { "getAverageDelta", l_lovrTimerGetAverageDelta },
@@ -41,6 +73,11 @@ static const luaL_Reg lovrTimer[] = {
   { "getTime", l_lovrTimerGetTime },
   { "step", l_lovrTimerStep },
   { "sleep", l_lovrTimerSleep },
+  { "isProfiling", l_lovrTimerIsProfiling },
+  { "setProfiling", l_lovrTimerSetProfiling },
+  { "beginZone", l_lovrTimerBeginZone },
+  { "endZone", l_lovrTimerEndZone },
+  { "getTrace", l_lovrTimerGetTrace },
   { NULL, NULL }
 };
 
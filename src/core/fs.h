@@ -28,6 +28,7 @@ bool fs_open(const char* path, OpenMode mode, fs_handle* file);
 bool fs_close(fs_handle file);
 bool fs_read(fs_handle file, void* buffer, size_t* bytes);
 bool fs_write(fs_handle file, const void* buffer, size_t* bytes);
+// Mappings are private, writes to them are copy-on-write and never reach the file
 void* fs_map(const char* path, size_t* size);
 bool fs_unmap(void* data, size_t size);
 bool fs_stat(const char* path, FileInfo* info);
@@ -0,0 +1,269 @@
+#include "core/job.h"
+#include "util.h"
+#include <stdatomic.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef LOVR_DISABLE_THREAD
+#include "lib/tinycthread/tinycthread.h"
+#endif
+
+struct Job {
+  Job* next;
+  fn_job* fn;
+  void* arg;
+  bool done;
+  bool failed;
+  char error[256];
+};
+
+#ifndef LOVR_DISABLE_THREAD
+static atomic_uint ref;
+
+static struct {
+  uint32_t workerCount;
+  thrd_t workers[JOB_MAX_WORKERS];
+  mtx_t lock;
+  cnd_t wake;
+  cnd_t finished;
+  Job* head;
+  Job* tail;
+  bool quit;
+} state;
+#endif
+
+static LOVR_THREAD_LOCAL jmp_buf* jobCatch;
+static LOVR_THREAD_LOCAL Job* jobCurrent;
+
+static void job_error(void* userdata, const char* format, va_list args) {
+  vsnprintf(jobCurrent->error, sizeof(jobCurrent->error), format, args);
+  jobCurrent->failed = true;
+  longjmp(*jobCatch, 1);
+}
+
+// Runs a job on the calling thread and captures its error, restoring the thread's error handling
+// afterwards.  Works from inside another job, so fan-outs can be nested.
+static void job_run(Job* job) {
+  errorFn* callback;
+  void* userdata;
+  lovrGetErrorCallback(&callback, &userdata);
+  jmp_buf* previousCatch = jobCatch;
+  Job* previousJob = jobCurrent;
+
+  jmp_buf env;
+  jobCatch = &env;
+  jobCurrent = job;
+  lovrSetErrorCallback(job_error, NULL);
+  if (setjmp(env) == 0) {
+    job->fn(job->arg);
+  }
+
+  lovrSetErrorCallback(callback, userdata);
+  jobCatch = previousCatch;
+  jobCurrent = previousJob;
+}
+
+#ifndef LOVR_DISABLE_THREAD
+static Job* job_pop(void) {
+  Job* job = state.head;
+  if (job) {
+    state.head = job->next;
+    state.tail = state.head ? state.tail : NULL;
+  }
+  return job;
+}
+
+static int job_worker(void* arg) {
+  mtx_lock(&state.lock);
+  for (;;) {
+    while (!state.head && !state.quit) {
+      cnd_wait(&state.wake, &state.lock);
+    }
+
+    if (state.quit) {
+      break;
+    }
+
+    Job* job = job_pop();
+    mtx_unlock(&state.lock);
+
+    job_run(job);
+
+    mtx_lock(&state.lock);
+    job->done = true;
+    cnd_broadcast(&state.finished);
+  }
+  mtx_unlock(&state.lock);
+  return 0;
+}
+#endif
+
+bool job_init(uint32_t workerCount) {
+#ifndef LOVR_DISABLE_THREAD
+  if (atomic_fetch_add(&ref, 1) > 0) return false;
+  mtx_init(&state.lock, mtx_plain);
+  cnd_init(&state.wake);
+  cnd_init(&state.finished);
+  workerCount = MIN(workerCount, JOB_MAX_WORKERS);
+  for (uint32_t i = 0; i < workerCount; i++) {
+    if (thrd_create(&state.workers[i], job_worker, NULL) != thrd_success) {
+      break;
+    }
+    state.workerCount++;
+  }
+#endif
+  return true;
+}
+
+void job_destroy() {
+#ifndef LOVR_DISABLE_THREAD
+  if (atomic_fetch_sub(&ref, 1) != 1) return;
+  mtx_lock(&state.lock);
+  state.quit = true;
+  cnd_broadcast(&state.wake);
+  mtx_unlock(&state.lock);
+  for (uint32_t i = 0; i < state.workerCount; i++) {
+    thrd_join(state.workers[i], NULL);
+  }
+  lovrAssert(!state.head, "Jobs were still pending when the job pool was destroyed");
+  cnd_destroy(&state.finished);
+  cnd_destroy(&state.wake);
+  mtx_destroy(&state.lock);
+  memset(&state, 0, sizeof(state));
+#endif
+}
+
+uint32_t job_get_worker_count() {
+#ifndef LOVR_DISABLE_THREAD
+  return state.workerCount;
+#else
+  return 0;
+#endif
+}
+
+Job* job_start(fn_job* fn, void* arg) {
+  Job* job = calloc(1, sizeof(Job));
+  lovrAssert(job, "Out of memory");
+  job->fn = fn;
+  job->arg = arg;
+
+#ifndef LOVR_DISABLE_THREAD
+  if (state.workerCount > 0) {
+    mtx_lock(&state.lock);
+    if (state.tail) {
+      state.tail->next = job;
+    } else {
+      state.head = job;
+    }
+    state.tail = job;
+    cnd_signal(&state.wake);
+    mtx_unlock(&state.lock);
+    return job;
+  }
+#endif
+
+  fn(arg);
+  job->done = true;
+  return job;
+}
+
+bool job_done(Job* job) {
+#ifndef LOVR_DISABLE_THREAD
+  if (state.workerCount > 0) {
+    mtx_lock(&state.lock);
+    bool done = job->done;
+    mtx_unlock(&state.lock);
+    return done;
+  }
+#endif
+  return job->done;
+}
+
+const char* job_wait(Job* job) {
+#ifndef LOVR_DISABLE_THREAD
+  if (state.workerCount > 0) {
+    mtx_lock(&state.lock);
+    while (!job->done) {
+      cnd_wait(&state.finished, &state.lock);
+    }
+    mtx_unlock(&state.lock);
+  }
+#endif
+  return job->failed ? job->error : NULL;
+}
+
+void job_free(Job* job) {
+  free(job);
+}
+
+// The calling thread takes the first context, then runs queued jobs (from anywhere) until all of
+// the others are finished, instead of blocking a thread that other jobs might be waiting on
+void job_run_all(fn_job* fn, void* contexts, size_t stride, uint32_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  Job* jobs = calloc(count, sizeof(Job));
+  lovrAssert(jobs, "Out of memory");
+
+  for (uint32_t i = 0; i < count; i++) {
+    jobs[i].fn = fn;
+    jobs[i].arg = (char*) contexts + i * stride;
+  }
+
+#ifndef LOVR_DISABLE_THREAD
+  if (state.workerCount > 0 && count > 1) {
+    mtx_lock(&state.lock);
+    for (uint32_t i = 1; i < count; i++) {
+      if (state.tail) {
+        state.tail->next = &jobs[i];
+      } else {
+        state.head = &jobs[i];
+      }
+      state.tail = &jobs[i];
+    }
+    cnd_broadcast(&state.wake);
+    mtx_unlock(&state.lock);
+
+    job_run(&jobs[0]);
+
+    mtx_lock(&state.lock);
+    jobs[0].done = true;
+    for (uint32_t i = 1; i < count; i++) {
+      while (!jobs[i].done) {
+        Job* job = job_pop();
+        if (job) {
+          mtx_unlock(&state.lock);
+          job_run(job);
+          mtx_lock(&state.lock);
+          job->done = true;
+          cnd_broadcast(&state.finished);
+        } else {
+          cnd_wait(&state.finished, &state.lock);
+        }
+      }
+    }
+    mtx_unlock(&state.lock);
+  } else
+#endif
+  {
+    for (uint32_t i = 0; i < count; i++) {
+      job_run(&jobs[i]);
+      jobs[i].done = true;
+    }
+  }
+
+  char error[256] = { 0 };
+  for (uint32_t i = 0; i < count; i++) {
+    if (jobs[i].failed) {
+      memcpy(error, jobs[i].error, sizeof(error));
+      break;
+    }
+  }
+
+  free(jobs);
+  lovrAssert(!error[0], "%s", error);
+}
@@ -0,0 +1,28 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Status:
+//  - Small shared worker pool for fire-and-wait work like image decoding
+//  - The pool is refcounted, each job_init needs a matching job_destroy
+//  - Lua states take a reference when they open lovr or lovr.data, so every module can use it
+//  - The first job_init and the last job_destroy must not race with each other
+//  - Errors thrown on a worker are captured and returned by job_wait
+//  - Without threads (or workers), jobs run immediately on the calling thread and errors propagate
+//  - job_run_all fans a function out over an array of contexts and rethrows the first error
+
+#pragma once
+
+#define JOB_MAX_WORKERS 16
+
+typedef struct Job Job;
+typedef void fn_job(void* arg);
+
+bool job_init(uint32_t workerCount);
+void job_destroy(void);
+uint32_t job_get_worker_count(void);
+Job* job_start(fn_job* fn, void* arg);
+bool job_done(Job* job);
+const char* job_wait(Job* job);
+void job_free(Job* job);
+void job_run_all(fn_job* fn, void* contexts, size_t stride, uint32_t count);
@@ -370,6 +370,24 @@ MAF mat4 mat4_fromQuat(mat4 m, quat q) {
   return m;
 }
 
+// Same as translating, rotating, and scaling an identity matrix, without the multiplies
+MAF mat4 mat4_fromTRS(mat4 m, vec3 t, quat r, vec3 s) {
+  mat4_fromQuat(m, r);
+  m[0] *= s[0];
+  m[1] *= s[0];
+  m[2] *= s[0];
+  m[4] *= s[1];
+  m[5] *= s[1];
+  m[6] *= s[1];
+  m[8] *= s[2];
+  m[9] *= s[2];
+  m[10] *= s[2];
+  m[12] = t[0];
+  m[13] = t[1];
+  m[14] = t[2];
+  return m;
+}
+
 MAF mat4 mat4_identity(mat4 m) {
   m[0] = 1.f;
   m[1] = 0.f;
@@ -0,0 +1,185 @@
+#include "core/profile.h"
+#include "core/os.h"
+#include "util.h"
+#include <stdatomic.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Events near the tail of a ring may be overwritten while exporting, so they're skipped
+#define PROFILE_RING_SLACK 1024
+
+typedef struct {
+  const char* name;
+  double time;
+  bool begin;
+} ProfileEvent;
+
+typedef struct {
+  ProfileEvent events[PROFILE_RING_SIZE];
+  _Atomic(uint32_t) head;
+  map_t names;
+} ProfileRing;
+
+bool profile_active;
+static _Atomic(ProfileRing*) rings[PROFILE_MAX_THREADS];
+static ProfileRing* gpuRing;
+static atomic_uint ringCount;
+static LOVR_THREAD_LOCAL ProfileRing* threadRing;
+static LOVR_THREAD_LOCAL bool ringFull;
+
+static ProfileRing* profile_ring_create(void) {
+  ProfileRing* ring = calloc(1, sizeof(ProfileRing));
+  lovrAssert(ring, "Out of memory");
+  map_init(&ring->names, 0);
+  return ring;
+}
+
+// Rings are never freed, since other threads may still be writing to them during shutdown
+static ProfileRing* profile_ring_get(void) {
+  if (!threadRing && !ringFull) {
+    uint32_t index = atomic_fetch_add(&ringCount, 1);
+    if (index < PROFILE_MAX_THREADS) {
+      threadRing = profile_ring_create();
+      atomic_store_explicit(&rings[index], threadRing, memory_order_release);
+    } else {
+      ringFull = true;
+    }
+  }
+
+  return threadRing;
+}
+
+// Only the owning thread writes to a ring, the release store publishes the event to exporters
+static void profile_record(ProfileRing* ring, const char* name, bool begin, double time) {
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  ProfileEvent* event = &ring->events[head & (PROFILE_RING_SIZE - 1)];
+  event->name = name;
+  event->time = time;
+  event->begin = begin;
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void profile_set_active(bool active) {
+  profile_active = active;
+}
+
+double profile_time() {
+  return os_get_time();
+}
+
+void profile_begin(const char* name) {
+  ProfileRing* ring = profile_ring_get();
+  if (ring) {
+    profile_record(ring, name, true, os_get_time());
+  }
+}
+
+void profile_end() {
+  ProfileRing* ring = profile_ring_get();
+  if (ring) {
+    profile_record(ring, NULL, false, os_get_time());
+  }
+}
+
+// Only called by the thread that owns the graphics context
+void profile_gpu(const char* name, bool begin, double time) {
+  if (!gpuRing) {
+    gpuRing = profile_ring_create();
+  }
+
+  profile_record(gpuRing, name, begin, time);
+}
+
+// Copies are owned by the calling thread's ring, so lookups don't need a lock
+const char* profile_intern(const char* name, size_t length) {
+  ProfileRing* ring = profile_ring_get();
+  if (!ring) {
+    return "?";
+  }
+
+  uint64_t hash = hash64(name, length);
+  uint64_t entry = map_get(&ring->names, hash);
+  if (entry != MAP_NIL) {
+    return (const char*) (uintptr_t) entry;
+  }
+
+  char* copy = malloc(length + 1);
+  lovrAssert(copy, "Out of memory");
+  memcpy(copy, name, length);
+  copy[length] = '\0';
+  map_set(&ring->names, hash, (uint64_t) (uintptr_t) copy);
+  return copy;
+}
+
+typedef arr_t(char) arr_char_t;
+
+static void profile_printf(arr_char_t* buffer, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+
+  arr_reserve(buffer, buffer->length + length + 1);
+  va_start(args, format);
+  vsnprintf(buffer->data + buffer->length, length + 1, format, args);
+  va_end(args);
+  buffer->length += length;
+}
+
+static void profile_print_name(arr_char_t* buffer, const char* name) {
+  arr_push(buffer, '"');
+  for (const char* c = name ? name : ""; *c; c++) {
+    if (*c == '"' || *c == '\\') {
+      arr_push(buffer, '\\');
+      arr_push(buffer, *c);
+    } else if ((unsigned char) *c >= 0x20) {
+      arr_push(buffer, *c);
+    }
+  }
+  arr_push(buffer, '"');
+}
+
+static void profile_print_ring(arr_char_t* buffer, ProfileRing* ring, uint32_t tid) {
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  uint32_t count = MIN(head, PROFILE_RING_SIZE - PROFILE_RING_SLACK);
+  for (uint32_t i = head - count; i != head; i++) {
+    ProfileEvent* event = &ring->events[i & (PROFILE_RING_SIZE - 1)];
+    profile_printf(buffer, ",\n{");
+    if (event->begin) {
+      profile_printf(buffer, "\"name\":");
+      profile_print_name(buffer, event->name);
+      profile_printf(buffer, ",\"ph\":\"B\"");
+    } else {
+      profile_printf(buffer, "\"ph\":\"E\"");
+    }
+    profile_printf(buffer, ",\"ts\":%.3f,\"pid\":0,\"tid\":%u}", event->time * 1e6, tid);
+  }
+}
+
+// Exports everything that's still in the rings as Chrome's trace event format (chrome://tracing)
+char* profile_export(size_t* length) {
+  arr_char_t buffer;
+  arr_init(&buffer, arr_alloc);
+  profile_printf(&buffer, "{\"traceEvents\":[\n");
+  profile_printf(&buffer, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"lovr\"}}");
+
+  uint32_t threadCount = atomic_load_explicit(&ringCount, memory_order_relaxed);
+  threadCount = MIN(threadCount, PROFILE_MAX_THREADS);
+  for (uint32_t i = 0; i < threadCount; i++) {
+    ProfileRing* ring = atomic_load_explicit(&rings[i], memory_order_acquire);
+    if (ring) {
+      profile_print_ring(&buffer, ring, i + 1);
+    }
+  }
+
+  if (gpuRing) {
+    profile_printf(&buffer, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"GPU\"}}");
+    profile_print_ring(&buffer, gpuRing, 0);
+  }
+
+  profile_printf(&buffer, "\n]}\n");
+  *length = buffer.length;
+  return buffer.data;
+}
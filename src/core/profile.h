@@ -0,0 +1,27 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Status:
+//  - Zones are recorded into a fixed-size ring per thread, only the owning thread writes to it
+//  - Older events are overwritten once a ring fills up
+//  - Zone names must outlive the profiler, use profile_intern for strings that don't
+//  - GPU zones are recorded by the renderer with timestamps already converted to CPU time
+
+#pragma once
+
+#define PROFILE_RING_SIZE (1 << 16)
+#define PROFILE_MAX_THREADS 64
+
+extern bool profile_active;
+
+#define PROFILE_BEGIN(name) do { if (profile_active) profile_begin(name); } while (0)
+#define PROFILE_END() do { if (profile_active) profile_end(); } while (0)
+
+void profile_set_active(bool active);
+double profile_time(void);
+void profile_begin(const char* name);
+void profile_end(void);
+void profile_gpu(const char* name, bool begin, double time);
+const char* profile_intern(const char* name, size_t length);
+char* profile_export(size_t* length);
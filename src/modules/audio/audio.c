@@ -2,6 +2,7 @@
 #include "audio/spatializer.h"
 #include "data/sound.h"
 #include "core/maf.h"
+#include "core/profile.h"
 #include "util.h"
 #include "lib/miniaudio/miniaudio.h"
 #include <string.h>
@@ -76,6 +77,7 @@ static void onPlayback(ma_device* device, void* out, const void* in, uint32_t co
   float* dst = out;
   float* buf = NULL; // The "current" buffer (used for fast paths)
 
+  PROFILE_BEGIN("Audio mix");
   ma_mutex_lock(&state.lock);
 
   Source* source;
@@ -168,6 +170,8 @@ static void onPlayback(ma_device* device, void* out, const void* in, uint32_t co
       count -= framesConsumed;
     }
   }
+
+  PROFILE_END();
 }
 
 static void onCapture(ma_device* device, void* output, const void* input, uint32_t count) {
@@ -1,4 +1,5 @@
 #include "data/blob.h"
+#include "core/fs.h"
 #include "util.h"
 #include <stdlib.h>
 
@@ -12,8 +13,23 @@ Blob* lovrBlobCreate(void* data, size_t size, const char* name) {
   return blob;
 }
 
+// Views point into their parent's memory and keep it alive instead of owning any memory
+Blob* lovrBlobCreateView(Blob* parent, size_t offset, size_t size, const char* name) {
+  lovrAssert(offset + size <= parent->size, "Blob view is out of range");
+  Blob* blob = lovrBlobCreate((char*) parent->data + offset, size, name);
+  blob->parent = parent;
+  lovrRetain(parent);
+  return blob;
+}
+
 void lovrBlobDestroy(void* ref) {
   Blob* blob = ref;
-  free(blob->data);
+  if (blob->parent) {
+    lovrRelease(blob->parent, lovrBlobDestroy);
+  } else if (blob->mapped) {
+    fs_unmap(blob->data, blob->size);
+  } else {
+    free(blob->data);
+  }
   free(blob);
 }
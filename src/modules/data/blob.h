@@ -1,3 +1,4 @@
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -8,7 +9,10 @@ typedef struct Blob {
   void* data;
   size_t size;
   const char* name;
+  struct Blob* parent;
+  bool mapped;
 } Blob;
 
 Blob* lovrBlobCreate(void* data, size_t size, const char* name);
+Blob* lovrBlobCreateView(Blob* parent, size_t offset, size_t size, const char* name);
 void lovrBlobDestroy(void* ref);
@@ -7,7 +7,7 @@
 
 #define FOUR_CC(a, b, c, d) ((uint32_t) (((d)<<24) | ((c)<<16) | ((b)<<8) | (a)))
 
-static size_t getPixelSize(TextureFormat format) {
+size_t lovrImageGetPixelSize(TextureFormat format) {
   switch (format) {
     case FORMAT_RGB: return 3;
     case FORMAT_RGBA: return 4;
@@ -457,7 +457,7 @@ Image* lovrImageCreate(uint32_t width, uint32_t height, Blob* contents, uint8_t
   Image* image = calloc(1, sizeof(Image));
   lovrAssert(image, "Out of memory");
   image->ref = 1;
-  size_t pixelSize = getPixelSize(format);
+  size_t pixelSize = lovrImageGetPixelSize(format);
   size_t size = width * height * pixelSize;
   lovrAssert(width > 0 && height > 0, "Image dimensions must be positive");
   lovrAssert(format < FORMAT_DXT1, "Blank images cannot be compressed");
@@ -552,7 +552,7 @@ Color lovrImageGetPixel(Image* image, uint32_t x, uint32_t y) {
   lovrAssert(image->blob->data, "Image does not have any pixel data");
   lovrAssert(x < image->width && y < image->height, "getPixel coordinates must be within Image bounds");
   size_t index = (image->height - (y + 1)) * image->width + x;
-  size_t pixelSize = getPixelSize(image->format);
+  size_t pixelSize = lovrImageGetPixelSize(image->format);
   uint8_t* u8 = (uint8_t*) image->blob->data + pixelSize * index;
   float* f32 = (float*) u8;
   switch (image->format) {
@@ -569,7 +569,7 @@ void lovrImageSetPixel(Image* image, uint32_t x, uint32_t y, Color color) {
   lovrAssert(image->blob->data, "Image does not have any pixel data");
   lovrAssert(x < image->width && y < image->height, "setPixel coordinates must be within Image bounds");
   size_t index = (image->height - (y + 1)) * image->width + x;
-  size_t pixelSize = getPixelSize(image->format);
+  size_t pixelSize = lovrImageGetPixelSize(image->format);
   uint8_t* u8 = (uint8_t*) image->blob->data + pixelSize * index;
   float* f32 = (float*) u8;
   switch (image->format) {
@@ -746,7 +746,7 @@ Blob* lovrImageEncode(Image* image) {
 void lovrImagePaste(Image* image, Image* source, uint32_t dx, uint32_t dy, uint32_t sx, uint32_t sy, uint32_t w, uint32_t h) {
   lovrAssert(image->format == source->format, "Currently Image must have the same format to paste");
   lovrAssert(image->format < FORMAT_DXT1, "Compressed Image cannot be pasted");
-  size_t pixelSize = getPixelSize(image->format);
+  size_t pixelSize = lovrImageGetPixelSize(image->format);
   lovrAssert(dx + w <= image->width && dy + h <= image->height, "Attempt to paste outside of destination Image bounds");
   lovrAssert(sx + w <= source->width && sy + h <= source->height, "Attempt to paste from outside of source Image bounds");
   uint8_t* src = (uint8_t*) source->blob->data + ((source->height - 1 - sy) * source->width + sx) * pixelSize;
@@ -69,3 +69,4 @@ Color lovrImageGetPixel(Image* image, uint32_t x, uint32_t y);
 void lovrImageSetPixel(Image* image, uint32_t x, uint32_t y, Color color);
 struct Blob* lovrImageEncode(Image* image);
 void lovrImagePaste(Image* image, Image* source, uint32_t dx, uint32_t dy, uint32_t sx, uint32_t sy, uint32_t w, uint32_t h);
+size_t lovrImageGetPixelSize(TextureFormat format);
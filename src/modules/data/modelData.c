@@ -1,14 +1,26 @@
 #include "data/modelData.h"
 #include "data/blob.h"
 #include "data/image.h"
+#include "core/job.h"
+#include "core/maf.h"
+#include "core/profile.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+// Smallest-three quaternions drop the largest component, the others are within +-sqrt(.5)
+#define QUAT_RANGE .70710678f
 
 ModelData* lovrModelDataCreate(Blob* source, ModelDataIO* io) {
   ModelData* model = calloc(1, sizeof(ModelData));
   lovrAssert(model, "Out of memory");
   model->ref = 1;
 
-  if (lovrModelDataInitGltf(model, source, io)) {
+  if (lovrModelDataInitCooked(model, source, io)) {
+    return model;
+  } else if (lovrModelDataInitGltf(model, source, io)) {
     return model;
   } else if (lovrModelDataInitObj(model, source, io)) {
     return model;
@@ -22,12 +34,18 @@ ModelData* lovrModelDataCreate(Blob* source, ModelDataIO* io) {
 
 void lovrModelDataDestroy(void* ref) {
   ModelData* model = ref;
+  for (uint32_t i = 0; i < model->channelCount; i++) {
+    free(model->channels[i].packedTimes);
+    free(model->channels[i].packedData);
+  }
   for (uint32_t i = 0; i < model->blobCount; i++) {
     lovrRelease(model->blobs[i], lovrBlobDestroy);
   }
   for (uint32_t i = 0; i < model->imageCount; i++) {
     lovrRelease(model->images[i], lovrImageDestroy);
   }
+  free(model->lodRanges);
+  free(model->lodIndices);
   map_free(&model->animationMap);
   map_free(&model->materialMap);
   map_free(&model->nodeMap);
@@ -75,3 +93,1129 @@ void lovrModelDataAllocate(ModelData* model) {
   map_init(&model->materialMap, model->materialCount);
   map_init(&model->nodeMap, model->nodeCount);
 }
+
+typedef struct {
+  Blob* blob;
+  Image* image;
+  bool flip;
+} ImageDecode;
+
+static void decodeImage(void* arg) {
+  ImageDecode* decode = arg;
+  if (decode->blob) {
+    decode->image = lovrImageCreateFromBlob(decode->blob, decode->flip);
+  }
+}
+
+// Each image is its own job on the shared pool, which runs them immediately when it doesn't have any
+// workers.  Images end up in the same order as their Blobs, which are released.  NULL Blobs result
+// in NULL images.
+void lovrModelDataDecodeImages(Blob** blobs, Image** images, uint32_t count, bool flip) {
+  if (count == 0) {
+    return;
+  }
+
+  PROFILE_BEGIN("Model image decode");
+  ImageDecode* decodes = calloc(count, sizeof(ImageDecode));
+  lovrAssert(decodes, "Out of memory");
+
+  for (uint32_t i = 0; i < count; i++) {
+    decodes[i] = (ImageDecode) { .blob = blobs[i], .flip = flip };
+  }
+
+  job_run_all(decodeImage, decodes, sizeof(ImageDecode), count);
+
+  for (uint32_t i = 0; i < count; i++) {
+    lovrRelease(blobs[i], lovrBlobDestroy);
+    images[i] = decodes[i].image;
+  }
+
+  free(decodes);
+  PROFILE_END();
+}
+
+// Quadrics are stored as the upper triangle of a symmetric 4x4 matrix
+typedef struct {
+  double q[10];
+} Quadric;
+
+typedef struct {
+  uint32_t from;
+  uint32_t to;
+  float error;
+} Collapse;
+
+static void addPlaneQuadric(Quadric* quadric, float* p0, float* p1, float* p2) {
+  float u[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+  float v[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+  double n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+  double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+  if (length == 0.) return;
+
+  // Planes are weighted by triangle area
+  double a = n[0] / length, b = n[1] / length, c = n[2] / length;
+  double d = -(a * p0[0] + b * p0[1] + c * p0[2]);
+  double w = length * .5;
+  double* q = quadric->q;
+  q[0] += w * a * a, q[1] += w * a * b, q[2] += w * a * c, q[3] += w * a * d;
+  q[4] += w * b * b, q[5] += w * b * c, q[6] += w * b * d;
+  q[7] += w * c * c, q[8] += w * c * d;
+  q[9] += w * d * d;
+}
+
+static float evaluateQuadric(Quadric* a, Quadric* b, float* p) {
+  double q[10];
+  for (int i = 0; i < 10; i++) q[i] = a->q[i] + b->q[i];
+  double x = p[0], y = p[1], z = p[2];
+  double error =
+    q[0] * x * x + 2. * q[1] * x * y + 2. * q[2] * x * z + 2. * q[3] * x +
+    q[4] * y * y + 2. * q[5] * y * z + 2. * q[6] * y +
+    q[7] * z * z + 2. * q[8] * z +
+    q[9];
+  return (float) fabs(error);
+}
+
+static int compareCollapses(const void* a, const void* b) {
+  float x = ((const Collapse*) a)->error;
+  float y = ((const Collapse*) b)->error;
+  return (x > y) - (x < y);
+}
+
+// A collapse is rejected if it would turn any of the remaining triangles around the vertex over
+static bool collapseFlips(uint32_t* indices, uint32_t* adjacency, uint32_t* offsets, uint32_t* remap, float* positions, uint32_t from, uint32_t to) {
+  float* pt = positions + 3 * to;
+  for (uint32_t i = offsets[from]; i < offsets[from + 1]; i++) {
+    uint32_t* triangle = indices + 3 * adjacency[i];
+    uint32_t corner = triangle[0] == from ? 0 : (triangle[1] == from ? 1 : 2);
+    uint32_t b = triangle[(corner + 1) % 3];
+    uint32_t c = triangle[(corner + 2) % 3];
+
+    if (remap[b] == remap[to] || remap[c] == remap[to]) {
+      continue;
+    }
+
+    float* pf = positions + 3 * from;
+    float* pb = positions + 3 * b;
+    float* pc = positions + 3 * c;
+    float n0[3], n1[3];
+    vec3_cross(vec3_sub(vec3_init(n0, pb), pf), (float[4]) { pc[0] - pf[0], pc[1] - pf[1], pc[2] - pf[2] });
+    vec3_cross(vec3_sub(vec3_init(n1, pb), pt), (float[4]) { pc[0] - pt[0], pc[1] - pt[1], pc[2] - pt[2] });
+    if (vec3_dot(n0, n1) <= 0.f) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Quadric edge collapse (Garland & Heckbert).  Vertices are collapsed onto one of their neighbors
+// instead of an optimal position, so the vertex buffer can be shared by every LOD.  Vertices on
+// mesh borders or attribute seams (several vertices at one position) never move.  Each pass sorts
+// the candidate edges by error and collapses as many independent ones as it can.  Indices are
+// rewritten in place and the new index count is returned.
+static uint32_t simplify(uint32_t* indices, uint32_t indexCount, float* positions, uint32_t vertexCount, uint32_t target) {
+  uint32_t* remap = malloc(vertexCount * sizeof(uint32_t));
+  uint32_t* collapseTo = malloc(vertexCount * sizeof(uint32_t));
+  uint32_t* offsets = calloc(vertexCount + 1, sizeof(uint32_t));
+  uint32_t* adjacency = malloc(indexCount * sizeof(uint32_t));
+  uint8_t* locked = calloc(vertexCount, sizeof(uint8_t));
+  uint8_t* touched = malloc(vertexCount * sizeof(uint8_t));
+  Quadric* quadrics = calloc(vertexCount, sizeof(Quadric));
+  Collapse* collapses = malloc(2 * indexCount * sizeof(Collapse));
+  lovrAssert(remap && collapseTo && offsets && adjacency && locked && touched && quadrics && collapses, "Out of memory");
+
+  // Vertices sharing a position get the same quadric, and are locked since they're a seam
+  map_t map;
+  map_init(&map, vertexCount);
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    uint64_t hash = hash64(positions + 3 * i, 3 * sizeof(float));
+    uint64_t other = map_get(&map, hash);
+    if (other != MAP_NIL && !memcmp(positions + 3 * i, positions + 3 * other, 3 * sizeof(float))) {
+      remap[i] = (uint32_t) other;
+      locked[i] = locked[other] = 1;
+    } else {
+      remap[i] = i;
+      map_set(&map, hash, i);
+    }
+    collapseTo[i] = i;
+  }
+
+  // Edges only used by one triangle are on the border
+  map_clear(&map);
+  for (uint32_t i = 0; i < indexCount; i++) {
+    uint32_t a = remap[indices[i]];
+    uint32_t b = remap[indices[i - i % 3 + (i + 1) % 3]];
+    uint64_t edge = (uint64_t) MIN(a, b) << 32 | MAX(a, b);
+    uint64_t hash = hash64(&edge, sizeof(edge));
+    uint64_t count = map_get(&map, hash);
+    map_set(&map, hash, count == MAP_NIL ? 1 : count + 1);
+  }
+  for (uint32_t i = 0; i < indexCount; i++) {
+    uint32_t a = remap[indices[i]];
+    uint32_t b = remap[indices[i - i % 3 + (i + 1) % 3]];
+    uint64_t edge = (uint64_t) MIN(a, b) << 32 | MAX(a, b);
+    if (map_get(&map, hash64(&edge, sizeof(edge))) == 1) {
+      locked[indices[i]] = locked[indices[i - i % 3 + (i + 1) % 3]] = 1;
+    }
+  }
+  map_free(&map);
+
+  for (uint32_t i = 0; i < indexCount; i += 3) {
+    float* p0 = positions + 3 * indices[i + 0];
+    float* p1 = positions + 3 * indices[i + 1];
+    float* p2 = positions + 3 * indices[i + 2];
+    for (uint32_t j = 0; j < 3; j++) {
+      addPlaneQuadric(&quadrics[remap[indices[i + j]]], p0, p1, p2);
+    }
+  }
+
+  for (uint32_t pass = 0; pass < 64 && indexCount > target; pass++) {
+    uint32_t collapseCount = 0;
+    for (uint32_t i = 0; i < indexCount; i++) {
+      uint32_t a = indices[i];
+      uint32_t b = indices[i - i % 3 + (i + 1) % 3];
+      if (remap[a] == remap[b]) continue;
+      if (!locked[a]) collapses[collapseCount++] = (Collapse) { a, b, evaluateQuadric(&quadrics[a], &quadrics[remap[b]], positions + 3 * b) };
+      if (!locked[b]) collapses[collapseCount++] = (Collapse) { b, a, evaluateQuadric(&quadrics[b], &quadrics[remap[a]], positions + 3 * a) };
+    }
+
+    if (collapseCount == 0) {
+      break;
+    }
+
+    qsort(collapses, collapseCount, sizeof(Collapse), compareCollapses);
+
+    memset(offsets, 0, (vertexCount + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < indexCount; i++) {
+      offsets[indices[i] + 1]++;
+    }
+    for (uint32_t i = 0; i < vertexCount; i++) {
+      offsets[i + 1] += offsets[i];
+    }
+    for (uint32_t i = 0; i < indexCount; i++) {
+      adjacency[offsets[indices[i]]++] = i / 3;
+    }
+    for (uint32_t i = vertexCount; i > 0; i--) {
+      offsets[i] = offsets[i - 1];
+    }
+    offsets[0] = 0;
+
+    // Vertices around a collapse are touched so the flip test stays valid for the rest of the pass
+    uint32_t triangleCount = indexCount / 3;
+    uint32_t removed = 0;
+    memset(touched, 0, vertexCount * sizeof(uint8_t));
+    for (uint32_t i = 0; i < collapseCount && triangleCount - removed > target / 3; i++) {
+      uint32_t from = collapses[i].from;
+      uint32_t to = collapses[i].to;
+      if (touched[from] || touched[to] || collapseFlips(indices, adjacency, offsets, remap, positions, from, to)) {
+        continue;
+      }
+
+      for (uint32_t j = offsets[from]; j < offsets[from + 1]; j++) {
+        uint32_t* triangle = indices + 3 * adjacency[j];
+        bool degenerate = false;
+        for (uint32_t k = 0; k < 3; k++) {
+          degenerate |= remap[triangle[k]] == remap[to];
+          touched[triangle[k]] = 1;
+        }
+        removed += degenerate;
+      }
+
+      for (int j = 0; j < 10; j++) {
+        quadrics[remap[to]].q[j] += quadrics[from].q[j];
+      }
+
+      collapseTo[from] = to;
+      touched[to] = 1;
+    }
+
+    if (removed == 0) {
+      break;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < indexCount; i += 3) {
+      uint32_t a = collapseTo[indices[i + 0]];
+      uint32_t b = collapseTo[indices[i + 1]];
+      uint32_t c = collapseTo[indices[i + 2]];
+      if (remap[a] != remap[b] && remap[b] != remap[c] && remap[c] != remap[a]) {
+        indices[count++] = a;
+        indices[count++] = b;
+        indices[count++] = c;
+      }
+    }
+    indexCount = count;
+
+    for (uint32_t i = 0; i < vertexCount; i++) {
+      collapseTo[i] = i;
+    }
+  }
+
+  free(remap);
+  free(collapseTo);
+  free(offsets);
+  free(adjacency);
+  free(locked);
+  free(touched);
+  free(quadrics);
+  free(collapses);
+  return indexCount;
+}
+
+static int compareRatios(const void* a, const void* b) {
+  float x = *(const float*) a;
+  float y = *(const float*) b;
+  return (x < y) - (x > y);
+}
+
+// Builds index lists for each primitive at each ratio of its original triangle count, from most to
+// least detailed.  Every level is simplified from the previous one.  A range with a count of zero
+// means the level couldn't get any simpler, so the previous one should be used.  Only indexed or
+// unindexed triangle lists with float positions are simplified.
+void lovrModelDataGenerateLods(ModelData* model, float* ratios, uint32_t count) {
+  lovrAssert(count <= MAX_LODS, "Too many LOD levels (max is %d)", MAX_LODS);
+  for (uint32_t i = 0; i < count; i++) {
+    lovrAssert(ratios[i] > 0.f && ratios[i] < 1.f, "LOD ratios must be between 0 and 1");
+  }
+
+  // Models that already exist keep their resources, new ones will create them again
+  model->resources = NULL;
+
+  free(model->lodRanges);
+  free(model->lodIndices);
+  memcpy(model->lodRatios, ratios, count * sizeof(float));
+  qsort(model->lodRatios, count, sizeof(float), compareRatios);
+  model->lodCount = count;
+  model->lodRanges = calloc(2 * count * MAX(model->primitiveCount, 1), sizeof(uint32_t));
+  lovrAssert(model->lodRanges, "Out of memory");
+
+  arr_t(uint32_t) lodIndices;
+  arr_init(&lodIndices, arr_alloc);
+
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    ModelPrimitive* primitive = &model->primitives[i];
+    ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+    ModelAttribute* index = primitive->indices;
+
+    if (primitive->mode != DRAW_TRIANGLES || !position || position->type != F32 || position->components < 3) {
+      continue;
+    }
+
+    ModelBuffer* buffer = &model->buffers[position->buffer];
+    if (!buffer->data || (index && (!model->buffers[index->buffer].data || (index->type != U16 && index->type != U32)))) {
+      continue;
+    }
+
+    uint32_t vertexCount = position->count;
+    uint32_t indexCount = (index ? index->count : vertexCount) / 3 * 3;
+    if (indexCount == 0) {
+      continue;
+    }
+
+    float* positions = malloc(3 * vertexCount * sizeof(float));
+    uint32_t* indices = malloc(indexCount * sizeof(uint32_t));
+    lovrAssert(positions && indices, "Out of memory");
+
+    size_t stride = buffer->stride ? buffer->stride : 3 * sizeof(float);
+    char* data = buffer->data + position->offset;
+    for (uint32_t j = 0; j < vertexCount; j++, data += stride) {
+      memcpy(positions + 3 * j, data, 3 * sizeof(float));
+    }
+
+    if (index) {
+      ModelBuffer* indexBuffer = &model->buffers[index->buffer];
+      char* data = indexBuffer->data + index->offset;
+      for (uint32_t j = 0; j < indexCount; j++) {
+        indices[j] = index->type == U16 ? ((uint16_t*) data)[j] : ((uint32_t*) data)[j];
+        lovrAssert(indices[j] < vertexCount, "Mesh index %d is out of range", indices[j]);
+      }
+    } else {
+      for (uint32_t j = 0; j < indexCount; j++) {
+        indices[j] = j;
+      }
+    }
+
+    uint32_t current = indexCount;
+    for (uint32_t level = 0; level < count; level++) {
+      uint32_t target = (uint32_t) (indexCount * model->lodRatios[level]) / 3 * 3;
+      uint32_t simplified = target < current ? simplify(indices, current, positions, vertexCount, target) : current;
+      if (simplified < current) {
+        uint32_t* range = model->lodRanges + 2 * (level * model->primitiveCount + i);
+        range[0] = (uint32_t) lodIndices.length;
+        range[1] = simplified;
+        arr_append(&lodIndices, indices, simplified);
+        current = simplified;
+      }
+    }
+
+    free(positions);
+    free(indices);
+  }
+
+  model->lodIndices = lodIndices.data;
+  model->lodIndexCount = (uint32_t) lodIndices.length;
+}
+
+#define ACMR_CACHE_SIZE 16
+#define FORSYTH_CACHE_SIZE 32
+
+static size_t getAttributeSize(ModelAttribute* attribute) {
+  size_t sizes[] = { [I8] = 1, [U8] = 1, [I16] = 2, [U16] = 2, [I32] = 4, [U32] = 4, [F32] = 4 };
+  return sizes[attribute->type] * attribute->components;
+}
+
+static bool canOptimize(ModelData* model, ModelPrimitive* primitive) {
+  ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+  ModelAttribute* index = primitive->indices;
+  return primitive->mode == DRAW_TRIANGLES && position && index && index->count >= 3 &&
+    (index->type == U16 || index->type == U32) && model->buffers[index->buffer].data;
+}
+
+static uint32_t* readIndices(ModelData* model, ModelAttribute* index, uint32_t vertexCount) {
+  char* data = model->buffers[index->buffer].data + index->offset;
+  uint32_t* indices = malloc(index->count * sizeof(uint32_t));
+  lovrAssert(indices, "Out of memory");
+  for (uint32_t i = 0; i < index->count; i++) {
+    indices[i] = index->type == U16 ? ((uint16_t*) data)[i] : ((uint32_t*) data)[i];
+    if (indices[i] >= vertexCount) {
+      free(indices);
+      return NULL;
+    }
+  }
+  return indices;
+}
+
+static void writeIndices(ModelData* model, ModelAttribute* index, uint32_t* indices) {
+  char* data = model->buffers[index->buffer].data + index->offset;
+  for (uint32_t i = 0; i < index->count; i++) {
+    if (index->type == U16) {
+      ((uint16_t*) data)[i] = (uint16_t) indices[i];
+    } else {
+      ((uint32_t*) data)[i] = indices[i];
+    }
+  }
+}
+
+// Simulates a FIFO cache, a vertex is in the cache if it was loaded less than ACMR_CACHE_SIZE misses ago
+static uint32_t countCacheMisses(uint32_t* indices, uint32_t count, uint32_t vertexCount) {
+  uint32_t* timestamps = calloc(vertexCount, sizeof(uint32_t));
+  lovrAssert(timestamps, "Out of memory");
+  uint32_t time = ACMR_CACHE_SIZE + 1;
+  uint32_t misses = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (time - timestamps[indices[i]] > ACMR_CACHE_SIZE) {
+      timestamps[indices[i]] = time++;
+      misses++;
+    }
+  }
+  free(timestamps);
+  return misses;
+}
+
+static float getForsythScore(int32_t position, uint32_t valence) {
+  if (valence == 0) {
+    return -1.f;
+  }
+
+  float score = 0.f;
+  if (position >= 0 && position < 3) {
+    score = .75f;
+  } else if (position >= 3) {
+    score = powf(1.f - (position - 3) / (float) (FORSYTH_CACHE_SIZE - 3), 1.5f);
+  }
+
+  return score + 2.f / sqrtf((float) valence);
+}
+
+// Tom Forsyth's linear-speed vertex cache optimization.  Triangles are emitted greedily by the
+// score of their vertices, which favors vertices near the front of a simulated LRU cache and
+// vertices with few triangles left.  Dead ends continue from the next unused triangle in order.
+static void optimizeVertexCache(uint32_t* indices, uint32_t count, uint32_t vertexCount) {
+  uint32_t triangleCount = count / 3;
+  uint32_t* offsets = calloc(vertexCount + 1, sizeof(uint32_t));
+  uint32_t* valence = calloc(vertexCount, sizeof(uint32_t));
+  uint32_t* adjacency = malloc(count * sizeof(uint32_t));
+  int32_t* cachePositions = malloc(vertexCount * sizeof(int32_t));
+  float* vertexScores = malloc(vertexCount * sizeof(float));
+  bool* emitted = calloc(triangleCount, sizeof(bool));
+  uint32_t* output = malloc(count * sizeof(uint32_t));
+  lovrAssert(offsets && valence && adjacency && cachePositions && vertexScores && emitted && output, "Out of memory");
+
+  for (uint32_t i = 0; i < count; i++) {
+    offsets[indices[i] + 1]++;
+  }
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    offsets[i + 1] += offsets[i];
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t v = indices[i];
+    adjacency[offsets[v] + valence[v]++] = i / 3;
+  }
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    cachePositions[i] = -1;
+    vertexScores[i] = getForsythScore(-1, valence[i]);
+  }
+
+  uint32_t best = 0;
+  float bestScore = -FLT_MAX;
+  for (uint32_t i = 0; i < triangleCount; i++) {
+    uint32_t* t = indices + 3 * i;
+    float score = vertexScores[t[0]] + vertexScores[t[1]] + vertexScores[t[2]];
+    if (score > bestScore) {
+      best = i;
+      bestScore = score;
+    }
+  }
+
+  uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+  uint32_t cacheSize = 0;
+  uint32_t cursor = 0;
+
+  for (uint32_t i = 0; i < triangleCount; i++) {
+    if (best == ~0u) {
+      while (emitted[cursor]) cursor++;
+      best = cursor;
+    }
+
+    uint32_t* triangle = indices + 3 * best;
+    memcpy(output + 3 * i, triangle, 3 * sizeof(uint32_t));
+    emitted[best] = true;
+
+    for (uint32_t k = 0; k < 3; k++) {
+      uint32_t v = triangle[k];
+      uint32_t* list = adjacency + offsets[v];
+      for (uint32_t j = 0; j < valence[v]; j++) {
+        if (list[j] == best) {
+          list[j] = list[--valence[v]];
+          break;
+        }
+      }
+    }
+
+    // The triangle's vertices move to the front of the cache, pushing the rest back
+    uint32_t next[FORSYTH_CACHE_SIZE + 3];
+    uint32_t nextSize = 0;
+    for (uint32_t k = 0; k < 3; k++) {
+      if ((k == 0 || triangle[k] != triangle[0]) && (k < 2 || triangle[k] != triangle[1])) {
+        next[nextSize++] = triangle[k];
+      }
+    }
+    for (uint32_t j = 0; j < cacheSize; j++) {
+      uint32_t v = cache[j];
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        next[nextSize++] = v;
+      }
+    }
+
+    for (uint32_t j = 0; j < nextSize; j++) {
+      uint32_t v = next[j];
+      cachePositions[v] = j < FORSYTH_CACHE_SIZE ? (int32_t) j : -1;
+      vertexScores[v] = getForsythScore(cachePositions[v], valence[v]);
+    }
+
+    best = ~0u;
+    bestScore = -FLT_MAX;
+    for (uint32_t j = 0; j < nextSize; j++) {
+      uint32_t v = next[j];
+      for (uint32_t k = offsets[v]; k < offsets[v] + valence[v]; k++) {
+        uint32_t* t = indices + 3 * adjacency[k];
+        float score = vertexScores[t[0]] + vertexScores[t[1]] + vertexScores[t[2]];
+        if (j < FORSYTH_CACHE_SIZE && score > bestScore) {
+          best = adjacency[k];
+          bestScore = score;
+        }
+      }
+    }
+
+    cacheSize = MIN(nextSize, FORSYTH_CACHE_SIZE);
+    memcpy(cache, next, cacheSize * sizeof(uint32_t));
+  }
+
+  memcpy(indices, output, count * sizeof(uint32_t));
+  free(offsets);
+  free(valence);
+  free(adjacency);
+  free(cachePositions);
+  free(vertexScores);
+  free(emitted);
+  free(output);
+}
+
+typedef struct {
+  float key;
+  uint32_t start;
+  uint32_t count;
+} Cluster;
+
+static int compareClusters(const void* a, const void* b) {
+  float x = ((const Cluster*) a)->key;
+  float y = ((const Cluster*) b)->key;
+  return (x < y) - (x > y);
+}
+
+// Splits the cache optimized triangles into clusters wherever the cache would start over anyway,
+// then draws the clusters facing away from the center of the mesh first, since they're more likely
+// to occlude the others.  This keeps most of the cache efficiency (Sander et al., "Fast Triangle
+// Reordering for Vertex Locality and Reduced Overdraw").
+static void optimizeOverdraw(uint32_t* indices, uint32_t count, float* positions, uint32_t vertexCount) {
+  uint32_t* timestamps = calloc(vertexCount, sizeof(uint32_t));
+  Cluster* clusters = malloc(count / 3 * sizeof(Cluster));
+  lovrAssert(timestamps && clusters, "Out of memory");
+  uint32_t clusterCount = 0;
+  uint32_t time = ACMR_CACHE_SIZE + 1;
+
+  for (uint32_t i = 0; i < count; i += 3) {
+    uint32_t misses = 0;
+    for (uint32_t k = 0; k < 3; k++) {
+      if (time - timestamps[indices[i + k]] > ACMR_CACHE_SIZE) {
+        timestamps[indices[i + k]] = time++;
+        misses++;
+      }
+    }
+
+    if (misses == 3 || clusterCount == 0) {
+      clusters[clusterCount++] = (Cluster) { 0.f, i, 0 };
+    }
+
+    clusters[clusterCount - 1].count += 3;
+  }
+
+  free(timestamps);
+
+  if (clusterCount < 2) {
+    free(clusters);
+    return;
+  }
+
+  float center[4] = { 0.f };
+  float totalArea = 0.f;
+  float (*centroids)[4] = calloc(clusterCount, sizeof(float[4]));
+  float (*normals)[4] = calloc(clusterCount, sizeof(float[4]));
+  lovrAssert(centroids && normals, "Out of memory");
+
+  for (uint32_t c = 0; c < clusterCount; c++) {
+    float area = 0.f;
+    for (uint32_t i = clusters[c].start; i < clusters[c].start + clusters[c].count; i += 3) {
+      float* p0 = positions + 3 * indices[i + 0];
+      float* p1 = positions + 3 * indices[i + 1];
+      float* p2 = positions + 3 * indices[i + 2];
+      float u[4] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+      float v[4] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+      vec3_cross(u, v);
+      float a = vec3_length(u);
+      for (int k = 0; k < 3; k++) {
+        centroids[c][k] += (p0[k] + p1[k] + p2[k]) / 3.f * a;
+        normals[c][k] += u[k];
+      }
+      area += a;
+    }
+
+    for (int k = 0; k < 3; k++) {
+      center[k] += centroids[c][k];
+      centroids[c][k] /= area > 0.f ? area : 1.f;
+    }
+    totalArea += area;
+  }
+
+  vec3_scale(center, totalArea > 0.f ? 1.f / totalArea : 0.f);
+
+  for (uint32_t c = 0; c < clusterCount; c++) {
+    float length = vec3_length(normals[c]);
+    float* centroid = centroids[c];
+    float offset[4] = { centroid[0] - center[0], centroid[1] - center[1], centroid[2] - center[2] };
+    clusters[c].key = length > 0.f ? vec3_dot(offset, normals[c]) / length : 0.f;
+  }
+
+  qsort(clusters, clusterCount, sizeof(Cluster), compareClusters);
+
+  uint32_t* output = malloc(count * sizeof(uint32_t));
+  lovrAssert(output, "Out of memory");
+  for (uint32_t c = 0, n = 0; c < clusterCount; n += clusters[c].count, c++) {
+    memcpy(output + n, indices + clusters[c].start, clusters[c].count * sizeof(uint32_t));
+  }
+
+  memcpy(indices, output, count * sizeof(uint32_t));
+  free(output);
+  free(centroids);
+  free(normals);
+  free(clusters);
+}
+
+// Vertices of primitives that share all of their attributes are renumbered in the order they're
+// first used.  This is skipped if any of the attributes are also used by other primitives.
+static void optimizeVertexFetch(ModelData* model, uint32_t first, bool* visited) {
+  ModelPrimitive* primitive = &model->primitives[first];
+  ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+  uint32_t vertexCount = position->count;
+  bool valid = true;
+
+  for (uint32_t i = first; i < model->primitiveCount; i++) {
+    ModelPrimitive* other = &model->primitives[i];
+    bool same = !memcmp(other->attributes, primitive->attributes, sizeof(primitive->attributes));
+
+    if (same) {
+      visited[i] = true;
+      valid &= canOptimize(model, other);
+    } else {
+      for (uint32_t j = 0; j < MAX_DEFAULT_ATTRIBUTES && valid; j++) {
+        for (uint32_t k = 0; k < MAX_DEFAULT_ATTRIBUTES && valid; k++) {
+          valid = !other->attributes[j] || other->attributes[j] != primitive->attributes[k];
+        }
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < MAX_DEFAULT_ATTRIBUTES && valid; i++) {
+    ModelAttribute* attribute = primitive->attributes[i];
+    valid = !attribute || (attribute->count == vertexCount && model->buffers[attribute->buffer].data);
+    for (uint32_t j = 0; j < i && valid; j++) {
+      valid = !attribute || primitive->attributes[j] != attribute;
+    }
+  }
+
+  // Primitives before the first one were already checked when their own group was visited
+  for (uint32_t i = 0; i < first && valid; i++) {
+    for (uint32_t j = 0; j < MAX_DEFAULT_ATTRIBUTES && valid; j++) {
+      for (uint32_t k = 0; k < MAX_DEFAULT_ATTRIBUTES && valid; k++) {
+        valid = !model->primitives[i].attributes[j] || model->primitives[i].attributes[j] != primitive->attributes[k];
+      }
+    }
+  }
+
+  if (!valid) {
+    return;
+  }
+
+  uint32_t* remap = malloc(vertexCount * sizeof(uint32_t));
+  lovrAssert(remap, "Out of memory");
+  memset(remap, 0xff, vertexCount * sizeof(uint32_t));
+  uint32_t next = 0;
+
+  uint32_t** groupIndices = calloc(model->primitiveCount, sizeof(uint32_t*));
+  lovrAssert(groupIndices, "Out of memory");
+
+  for (uint32_t i = first; i < model->primitiveCount && valid; i++) {
+    if (!memcmp(model->primitives[i].attributes, primitive->attributes, sizeof(primitive->attributes))) {
+      groupIndices[i] = readIndices(model, model->primitives[i].indices, vertexCount);
+      valid = groupIndices[i] != NULL;
+      for (uint32_t j = 0; valid && j < model->primitives[i].indices->count; j++) {
+        uint32_t v = groupIndices[i][j];
+        remap[v] = remap[v] == ~0u ? next++ : remap[v];
+      }
+    }
+  }
+
+  if (valid) {
+    for (uint32_t i = 0; i < vertexCount; i++) {
+      remap[i] = remap[i] == ~0u ? next++ : remap[i];
+    }
+
+    for (uint32_t i = 0; i < MAX_DEFAULT_ATTRIBUTES; i++) {
+      ModelAttribute* attribute = primitive->attributes[i];
+      if (!attribute) continue;
+
+      ModelBuffer* buffer = &model->buffers[attribute->buffer];
+      size_t size = getAttributeSize(attribute);
+      size_t stride = buffer->stride ? buffer->stride : size;
+      char* data = buffer->data + attribute->offset;
+      char* copy = malloc(vertexCount * size);
+      lovrAssert(copy, "Out of memory");
+      for (uint32_t j = 0; j < vertexCount; j++) {
+        memcpy(copy + remap[j] * size, data + j * stride, size);
+      }
+      for (uint32_t j = 0; j < vertexCount; j++) {
+        memcpy(data + j * stride, copy + j * size, size);
+      }
+      free(copy);
+    }
+
+    for (uint32_t i = first; i < model->primitiveCount; i++) {
+      if (!groupIndices[i]) continue;
+
+      for (uint32_t j = 0; j < model->primitives[i].indices->count; j++) {
+        groupIndices[i][j] = remap[groupIndices[i][j]];
+      }
+      writeIndices(model, model->primitives[i].indices, groupIndices[i]);
+
+      for (uint32_t level = 0; level < model->lodCount; level++) {
+        uint32_t* range = model->lodRanges + 2 * (level * model->primitiveCount + i);
+        for (uint32_t j = range[0]; j < range[0] + range[1]; j++) {
+          model->lodIndices[j] = remap[model->lodIndices[j]];
+        }
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    free(groupIndices[i]);
+  }
+  free(groupIndices);
+  free(remap);
+}
+
+static void* rebase(void* pointer, Blob* from, Blob* to) {
+  char* p = pointer;
+  char* base = from->data;
+  return p && p >= base && p < base + from->size ? (char*) to->data + (p - base) : pointer;
+}
+
+// Blobs that anything else has a reference to (a Blob passed in from Lua, or a view) are copied
+// before they're written to, and everything that pointed into the old data is moved to the copy
+static void detachBlob(ModelData* model, uint32_t index) {
+  Blob* blob = model->blobs[index];
+  if (!blob || (blob->ref == 1 && !blob->parent)) {
+    return;
+  }
+
+  void* data = malloc(blob->size);
+  lovrAssert(data, "Out of memory");
+  memcpy(data, blob->data, blob->size);
+  Blob* copy = lovrBlobCreate(data, blob->size, blob->name);
+
+  for (uint32_t i = 0; i < model->bufferCount; i++) {
+    if (model->buffers[i].blob == index) {
+      model->buffers[i].data = rebase(model->buffers[i].data, blob, copy);
+    }
+  }
+
+  for (uint32_t i = 0; i < model->channelCount; i++) {
+    model->channels[i].times = rebase(model->channels[i].times, blob, copy);
+    model->channels[i].data = rebase(model->channels[i].data, blob, copy);
+  }
+
+  for (uint32_t i = 0; i < model->skinCount; i++) {
+    model->skins[i].inverseBindMatrices = rebase(model->skins[i].inverseBindMatrices, blob, copy);
+  }
+
+  model->blobs[index] = copy;
+  lovrRelease(blob, lovrBlobDestroy);
+}
+
+// Rewrites index and vertex data, copying any Blob that's shared first (see detachBlob).  ACMR is
+// the average number of cache misses per triangle for a 16 vertex FIFO cache.  It's only measured
+// when acmrBefore and acmrAfter aren't NULL.
+void lovrModelDataOptimize(ModelData* model, float* acmrBefore, float* acmrAfter) {
+  model->resources = NULL;
+  bool measure = acmrBefore && acmrAfter;
+  uint64_t missesBefore = 0;
+  uint64_t missesAfter = 0;
+  uint64_t triangles = 0;
+
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    ModelPrimitive* primitive = &model->primitives[i];
+    if (canOptimize(model, primitive)) {
+      detachBlob(model, model->buffers[primitive->indices->buffer].blob);
+      for (uint32_t j = 0; j < MAX_DEFAULT_ATTRIBUTES; j++) {
+        if (primitive->attributes[j]) {
+          detachBlob(model, model->buffers[primitive->attributes[j]->buffer].blob);
+        }
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    ModelPrimitive* primitive = &model->primitives[i];
+    if (!canOptimize(model, primitive)) {
+      continue;
+    }
+
+    ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+    uint32_t vertexCount = position->count;
+    uint32_t count = primitive->indices->count / 3 * 3;
+    uint32_t* indices = readIndices(model, primitive->indices, vertexCount);
+    if (!indices) {
+      continue;
+    }
+
+    missesBefore += measure ? countCacheMisses(indices, count, vertexCount) : 0;
+    optimizeVertexCache(indices, count, vertexCount);
+
+    ModelBuffer* buffer = &model->buffers[position->buffer];
+    if (position->type == F32 && position->components >= 3 && buffer->data) {
+      float* positions = malloc(3 * vertexCount * sizeof(float));
+      lovrAssert(positions, "Out of memory");
+      size_t stride = buffer->stride ? buffer->stride : 3 * sizeof(float);
+      for (uint32_t j = 0; j < vertexCount; j++) {
+        memcpy(positions + 3 * j, buffer->data + position->offset + j * stride, 3 * sizeof(float));
+      }
+      optimizeOverdraw(indices, count, positions, vertexCount);
+      free(positions);
+    }
+
+    missesAfter += measure ? countCacheMisses(indices, count, vertexCount) : 0;
+    triangles += count / 3;
+    writeIndices(model, primitive->indices, indices);
+    free(indices);
+  }
+
+  bool* visited = calloc(model->primitiveCount + 1, sizeof(bool));
+  lovrAssert(visited, "Out of memory");
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    if (!visited[i] && canOptimize(model, &model->primitives[i])) {
+      optimizeVertexFetch(model, i, visited);
+    }
+  }
+  free(visited);
+
+  if (measure) {
+    *acmrBefore = triangles > 0 ? (float) missesBefore / triangles : 0.f;
+    *acmrAfter = triangles > 0 ? (float) missesAfter / triangles : 0.f;
+  }
+}
+
+// Rotations (other than cubic tangents) use smallest-three, everything else is range-quantized
+static bool isSmallestThree(ModelAnimationChannel* channel) {
+  return channel->property == PROP_ROTATION && channel->smoothing != SMOOTH_CUBIC;
+}
+
+static uint32_t getPackedComponents(ModelAnimationChannel* channel) {
+  return isSmallestThree(channel) ? 3 : (channel->property == PROP_ROTATION ? 4 : 3);
+}
+
+// 15 bits per component, the index of the dropped component goes in the top bits of the first two
+static void packQuaternion(const float* q, uint16_t* bits) {
+  float length = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  uint32_t largest = 0;
+  for (uint32_t i = 1; i < 4; i++) {
+    if (fabsf(q[i]) > fabsf(q[largest])) {
+      largest = i;
+    }
+  }
+
+  float scale = (q[largest] < 0.f ? -1.f : 1.f) / (length > 0.f ? length : 1.f);
+  for (uint32_t i = 0, j = 0; i < 4; i++) {
+    if (i != largest) {
+      float x = CLAMP(q[i] * scale, -QUAT_RANGE, QUAT_RANGE);
+      bits[j++] = (uint16_t) roundf((x + QUAT_RANGE) / (2.f * QUAT_RANGE) * 32767.f);
+    }
+  }
+
+  bits[0] |= (largest & 1) << 15;
+  bits[1] |= (largest >> 1) << 15;
+}
+
+static void unpackQuaternion(const uint16_t* bits, float* q) {
+  uint32_t largest = (bits[0] >> 15) | ((bits[1] >> 15) << 1);
+  float sum = 0.f;
+  for (uint32_t i = 0, j = 0; i < 4; i++) {
+    if (i != largest) {
+      q[i] = (bits[j++] & 0x7fff) / 32767.f * (2.f * QUAT_RANGE) - QUAT_RANGE;
+      sum += q[i] * q[i];
+    }
+  }
+  q[largest] = sqrtf(MAX(1.f - sum, 0.f));
+}
+
+// Index is in elements of the data array, so cubic channels have 3 per keyframe
+void lovrModelDataGetKeyframeValue(ModelAnimationChannel* channel, uint32_t index, float* value) {
+  uint32_t n = channel->property == PROP_ROTATION ? 4 : 3;
+  if (channel->data) {
+    memcpy(value, channel->data + index * n, n * sizeof(float));
+  } else if (isSmallestThree(channel)) {
+    unpackQuaternion(channel->packedData + index * 3, value);
+  } else {
+    uint16_t* bits = channel->packedData + index * n;
+    for (uint32_t i = 0; i < n; i++) {
+      value[i] = channel->dataBase[i] + bits[i] * channel->dataStep[i];
+    }
+  }
+}
+
+// Times are only packed if every keyframe still lands on a distinct step
+static bool compressTimes(ModelAnimationChannel* channel, float maxError, float* error) {
+  uint32_t count = channel->keyframeCount;
+  float* times = channel->times;
+  if (count < 2 || times[count - 1] <= times[0]) {
+    return false;
+  }
+
+  float base = times[0];
+  float step = (times[count - 1] - base) / 65535.f;
+  for (uint32_t i = 1; i < count; i++) {
+    if (times[i] - times[i - 1] <= step) {
+      return false;
+    }
+  }
+
+  uint16_t* packed = malloc(count * sizeof(uint16_t));
+  lovrAssert(packed, "Out of memory");
+  float maxDelta = 0.f;
+  for (uint32_t i = 0; i < count; i++) {
+    packed[i] = (uint16_t) roundf((times[i] - base) / step);
+    maxDelta = MAX(maxDelta, fabsf(base + packed[i] * step - times[i]));
+  }
+
+  if (maxDelta > maxError) {
+    free(packed);
+    return false;
+  }
+
+  channel->packedTimes = packed;
+  channel->timeBase = base;
+  channel->timeStep = step;
+  channel->times = NULL;
+  *error = MAX(*error, maxDelta);
+  return true;
+}
+
+static bool compressData(ModelAnimationChannel* channel, float maxError, float* error) {
+  uint32_t n = channel->property == PROP_ROTATION ? 4 : 3;
+  uint32_t elements = channel->keyframeCount * (channel->smoothing == SMOOTH_CUBIC ? 3 : 1);
+  uint32_t components = getPackedComponents(channel);
+  float* data = channel->data;
+
+  ModelAnimationChannel packed = *channel;
+  packed.data = NULL;
+  packed.packedData = malloc(elements * components * sizeof(uint16_t));
+  lovrAssert(packed.packedData, "Out of memory");
+
+  if (isSmallestThree(channel)) {
+    for (uint32_t i = 0; i < elements; i++) {
+      packQuaternion(data + i * n, packed.packedData + i * 3);
+    }
+  } else {
+    for (uint32_t c = 0; c < n; c++) {
+      float min = HUGE_VALF;
+      float max = -HUGE_VALF;
+      for (uint32_t i = 0; i < elements; i++) {
+        min = MIN(min, data[i * n + c]);
+        max = MAX(max, data[i * n + c]);
+      }
+
+      packed.dataBase[c] = min;
+      packed.dataStep[c] = (max - min) / 65535.f;
+      for (uint32_t i = 0; i < elements; i++) {
+        float x = packed.dataStep[c] > 0.f ? (data[i * n + c] - min) / packed.dataStep[c] : 0.f;
+        packed.packedData[i * n + c] = (uint16_t) roundf(x);
+      }
+    }
+  }
+
+  // Error is measured on the decoded values, rotations as an angle in radians
+  float maxDelta = 0.f;
+  for (uint32_t i = 0; i < elements; i++) {
+    float value[4];
+    float* original = data + i * n;
+    lovrModelDataGetKeyframeValue(&packed, i, value);
+    if (isSmallestThree(channel)) {
+      float length = sqrtf(original[0] * original[0] + original[1] * original[1] + original[2] * original[2] + original[3] * original[3]);
+      float dot = fabsf(original[0] * value[0] + original[1] * value[1] + original[2] * value[2] + original[3] * value[3]);
+      maxDelta = MAX(maxDelta, 2.f * acosf(MIN(dot / (length > 0.f ? length : 1.f), 1.f)));
+    } else {
+      for (uint32_t c = 0; c < n; c++) {
+        maxDelta = MAX(maxDelta, fabsf(value[c] - original[c]));
+      }
+    }
+  }
+
+  if (maxDelta > maxError) {
+    free(packed.packedData);
+    return false;
+  }
+
+  *channel = packed;
+  *error = MAX(*error, maxDelta);
+  return true;
+}
+
+static bool containsPointer(ModelBuffer* buffer, void* pointer) {
+  return buffer->data && (char*) pointer >= buffer->data && (char*) pointer < buffer->data + buffer->size;
+}
+
+// Packs keyframe times and values into 16 bit integers, keeping the float versions of anything
+// that can't be packed within the tolerance for its property.  Afterwards, any blob that was only used by packed channels
+// is released.  Blobs referenced by primitives, skins, images, or unpacked channels are kept.
+void lovrModelDataCompressAnimations(ModelData* model, AnimationTolerance* tolerance, AnimationCompression* report) {
+  memset(report, 0, sizeof(*report));
+
+  float tolerances[] = {
+    [PROP_TRANSLATION] = tolerance->translation,
+    [PROP_ROTATION] = tolerance->rotation,
+    [PROP_SCALE] = tolerance->scale
+  };
+
+  for (uint32_t i = 0; i < model->channelCount; i++) {
+    ModelAnimationChannel* channel = &model->channels[i];
+    uint32_t n = channel->property == PROP_ROTATION ? 4 : 3;
+    uint32_t elements = channel->keyframeCount * (channel->smoothing == SMOOTH_CUBIC ? 3 : 1);
+    float* errors[] = {
+      [PROP_TRANSLATION] = &report->translationError,
+      [PROP_ROTATION] = &report->rotationError,
+      [PROP_SCALE] = &report->scaleError
+    };
+
+    if (channel->times) {
+      compressTimes(channel, tolerance->time, &report->timeError);
+    }
+
+    if (channel->data) {
+      compressData(channel, tolerances[channel->property], errors[channel->property]);
+    }
+
+    size_t timeSize = channel->times ? sizeof(float) : sizeof(uint16_t);
+    size_t dataSize = channel->data ? n * sizeof(float) : getPackedComponents(channel) * sizeof(uint16_t);
+    report->originalSize += channel->keyframeCount * sizeof(float) + elements * n * sizeof(float);
+    report->compressedSize += channel->keyframeCount * timeSize + elements * dataSize;
+    report->compressedCount += !channel->times || !channel->data;
+    report->channelCount++;
+  }
+
+  if (model->blobCount == 0) {
+    return;
+  }
+
+  // Buffers that aren't used by any accessor are probably images, so they count as used
+  bool* used = calloc(model->bufferCount, sizeof(bool));
+  bool* referenced = calloc(model->bufferCount, sizeof(bool));
+  lovrAssert(used && referenced, "Out of memory");
+
+  for (uint32_t i = 0; i < model->attributeCount; i++) {
+    referenced[model->attributes[i].buffer] = true;
+  }
+
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    ModelPrimitive* primitive = &model->primitives[i];
+    for (uint32_t j = 0; j < MAX_DEFAULT_ATTRIBUTES; j++) {
+      if (primitive->attributes[j]) {
+        used[primitive->attributes[j]->buffer] = true;
+      }
+    }
+
+    if (primitive->indices) {
+      used[primitive->indices->buffer] = true;
+    }
+  }
+
+  for (uint32_t i = 0; i < model->bufferCount; i++) {
+    ModelBuffer* buffer = &model->buffers[i];
+    used[i] |= !referenced[i];
+
+    for (uint32_t j = 0; j < model->skinCount && !used[i]; j++) {
+      used[i] = containsPointer(buffer, model->skins[j].inverseBindMatrices);
+    }
+
+    for (uint32_t j = 0; j < model->channelCount && !used[i]; j++) {
+      used[i] = containsPointer(buffer, model->channels[j].times) || containsPointer(buffer, model->channels[j].data);
+    }
+  }
+
+  for (uint32_t i = 0; i < model->blobCount; i++) {
+    bool keep = !model->blobs[i];
+    for (uint32_t j = 0; j < model->bufferCount && !keep; j++) {
+      keep = model->buffers[j].blob == i && used[j];
+    }
+
+    if (!keep) {
+      report->releasedSize += model->blobs[i]->size;
+      lovrRelease(model->blobs[i], lovrBlobDestroy);
+      model->blobs[i] = NULL;
+      for (uint32_t j = 0; j < model->bufferCount; j++) {
+        if (model->buffers[j].blob == i) {
+          model->buffers[j].data = NULL;
+        }
+      }
+    }
+  }
+
+  free(referenced);
+  free(used);
+}
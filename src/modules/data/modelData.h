@@ -5,10 +5,12 @@
 
 #pragma once
 
-#define MAX_BONES 48
+#define MAX_BONES 256
+#define MAX_LODS 8
 
 struct Blob;
 struct Image;
+struct ModelResources;
 
 typedef enum {
   ATTR_POSITION,
@@ -131,6 +133,12 @@ typedef struct {
   uint32_t keyframeCount;
   float* times;
   float* data;
+  uint16_t* packedTimes;
+  uint16_t* packedData;
+  float timeBase;
+  float timeStep;
+  float dataBase[4];
+  float dataStep[4];
 } ModelAnimationChannel;
 
 typedef struct {
@@ -213,16 +221,56 @@ typedef struct ModelData {
   uint32_t jointCount;
   uint32_t charCount;
 
+  uint32_t lodCount;
+  float lodRatios[MAX_LODS];
+  uint32_t* lodRanges;
+  uint32_t* lodIndices;
+  uint32_t lodIndexCount;
+
+  // Shared GPU objects of the Models created from this ModelData, owned by the graphics module
+  struct ModelResources* resources;
+
   map_t animationMap;
   map_t materialMap;
   map_t nodeMap;
 } ModelData;
 
+typedef struct {
+  float time; // seconds
+  float translation; // meters
+  float rotation; // radians
+  float scale; // scale factor
+} AnimationTolerance;
+
+typedef struct {
+  size_t originalSize;
+  size_t compressedSize;
+  size_t releasedSize;
+  uint32_t channelCount;
+  uint32_t compressedCount;
+  float timeError;
+  float translationError;
+  float rotationError;
+  float scaleError;
+} AnimationCompression;
+
 typedef void* ModelDataIO(const char* filename, size_t* bytesRead);
 
 ModelData* lovrModelDataCreate(struct Blob* blob, ModelDataIO* io);
+ModelData* lovrModelDataInitCooked(ModelData* model, struct Blob* blob, ModelDataIO* io);
 ModelData* lovrModelDataInitGltf(ModelData* model, struct Blob* blob, ModelDataIO* io);
 ModelData* lovrModelDataInitObj(ModelData* model, struct Blob* blob, ModelDataIO* io);
 ModelData* lovrModelDataInitStl(ModelData* model, struct Blob* blob, ModelDataIO* io);
 void lovrModelDataDestroy(void* ref);
 void lovrModelDataAllocate(ModelData* model);
+void lovrModelDataDecodeImages(struct Blob** blobs, struct Image** images, uint32_t count, bool flip);
+struct Blob* lovrModelDataSerialize(ModelData* model);
+void lovrModelDataOptimize(ModelData* model, float* acmrBefore, float* acmrAfter);
+void lovrModelDataGenerateLods(ModelData* model, float* ratios, uint32_t count);
+void lovrModelDataCompressAnimations(ModelData* model, AnimationTolerance* tolerance, AnimationCompression* report);
+void lovrModelDataGetKeyframeValue(ModelAnimationChannel* channel, uint32_t index, float* value);
+
+// Packed channels have NULL times/data, see lovrModelDataCompressAnimations
+static inline float lovrModelDataGetKeyframeTime(ModelAnimationChannel* channel, uint32_t index) {
+  return channel->times ? channel->times[index] : channel->timeBase + channel->packedTimes[index] * channel->timeStep;
+}
@@ -0,0 +1,650 @@
+#include "data/modelData.h"
+#include "data/blob.h"
+#include "data/image.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+
+// A cooked model is a header, followed by the ModelData arrays with their pointers replaced by
+// offsets, followed by the buffer, image, and packed animation data.  Loading one copies the arrays
+// and fixes up their pointers, the bulk data is used directly from the source Blob (which is
+// usually a mapped file).  Arrays keep the struct layout of the build that cooked them, so they
+// aren't portable between builds with different pointer sizes.
+//
+// Pointers into the file are stored as offsets, pointers into other arrays are stored as indices
+// plus one, and pointers to names are offsets into the chars section plus one.  Zero is NULL.
+
+#define MAGIC_LMDL 0x4c444d4c
+#define COOKED_VERSION 1
+#define COOKED_ALIGNMENT 16
+
+enum {
+  SECTION_BUFFERS,
+  SECTION_IMAGES,
+  SECTION_MATERIALS,
+  SECTION_ATTRIBUTES,
+  SECTION_PRIMITIVES,
+  SECTION_ANIMATIONS,
+  SECTION_SKINS,
+  SECTION_NODES,
+  SECTION_CHANNELS,
+  SECTION_CHILDREN,
+  SECTION_JOINTS,
+  SECTION_CHARS,
+  SECTION_LOD_RANGES,
+  SECTION_LOD_INDICES,
+  MAX_SECTIONS
+};
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t pointerSize;
+  uint32_t rootNode;
+  uint32_t bufferCount;
+  uint32_t imageCount;
+  uint32_t materialCount;
+  uint32_t attributeCount;
+  uint32_t primitiveCount;
+  uint32_t animationCount;
+  uint32_t skinCount;
+  uint32_t nodeCount;
+  uint32_t channelCount;
+  uint32_t childCount;
+  uint32_t jointCount;
+  uint32_t charCount;
+  uint32_t lodCount;
+  uint32_t lodIndexCount;
+  float lodRatios[MAX_LODS];
+  uint64_t sections[MAX_SECTIONS];
+} CookedHeader;
+
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+  uint32_t format;
+  uint32_t mipmapCount;
+  uint64_t data;
+  uint64_t size;
+  uint64_t mipmaps;
+} CookedImage;
+
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+  uint64_t data;
+  uint64_t size;
+} CookedMipmap;
+
+typedef arr_t(char) arr_char_t;
+
+#define ENCODE(x) ((void*) (uintptr_t) (x))
+#define DECODE(p) ((uint64_t) (uintptr_t) (p))
+
+static size_t getLodRangeCount(ModelData* model) {
+  return model->lodCount > 0 ? 2 * model->lodCount * MAX(model->primitiveCount, 1) : 0;
+}
+
+static uint64_t getPackedDataCount(ModelAnimationChannel* channel) {
+  bool cubic = channel->smoothing == SMOOTH_CUBIC;
+  uint32_t components = channel->property == PROP_ROTATION && cubic ? 4 : 3;
+  return (uint64_t) channel->keyframeCount * (cubic ? 3 : 1) * components;
+}
+
+// Serialization
+
+static uint64_t append(arr_char_t* out, const void* data, size_t size) {
+  while (out->length % COOKED_ALIGNMENT) {
+    arr_push(out, 0);
+  }
+
+  uint64_t offset = out->length;
+  if (size > 0) {
+    arr_append(out, (const char*) data, size);
+  }
+  return offset;
+}
+
+static void* appendName(arr_char_t* chars, const char* name) {
+  if (!name) {
+    return NULL;
+  }
+
+  size_t offset = chars->length;
+  size_t length = strlen(name) + 1;
+  arr_append(chars, name, length);
+  return ENCODE(offset + 1);
+}
+
+// Channels and skins point into buffers, these become offsets into the copy of the buffer
+static void* encodeData(ModelData* model, uint64_t* bufferOffsets, void* pointer) {
+  if (!pointer) {
+    return NULL;
+  }
+
+  for (uint32_t i = 0; i < model->bufferCount; i++) {
+    ModelBuffer* buffer = &model->buffers[i];
+    if (buffer->data && (char*) pointer >= buffer->data && (char*) pointer < buffer->data + buffer->size) {
+      return ENCODE(bufferOffsets[i] + ((char*) pointer - buffer->data));
+    }
+  }
+
+  lovrThrow("ModelData references data outside of its buffers");
+  return NULL;
+}
+
+Blob* lovrModelDataSerialize(ModelData* model) {
+  arr_char_t out;
+  arr_char_t chars;
+  arr_init(&out, arr_alloc);
+  arr_init(&chars, arr_alloc);
+
+  // Everything written is built in zeroed memory, so padding bytes don't leak into the file
+  CookedHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = MAGIC_LMDL;
+  header.version = COOKED_VERSION;
+  header.pointerSize = sizeof(void*);
+  header.rootNode = model->rootNode;
+  header.bufferCount = model->bufferCount;
+  header.imageCount = model->imageCount;
+  header.materialCount = model->materialCount;
+  header.attributeCount = model->attributeCount;
+  header.primitiveCount = model->primitiveCount;
+  header.animationCount = model->animationCount;
+  header.skinCount = model->skinCount;
+  header.nodeCount = model->nodeCount;
+  header.channelCount = model->channelCount;
+  header.childCount = model->childCount;
+  header.jointCount = model->jointCount;
+  header.lodCount = model->lodCount;
+  header.lodIndexCount = model->lodIndexCount;
+
+  memcpy(header.lodRatios, model->lodRatios, sizeof(header.lodRatios));
+  append(&out, &header, sizeof(header));
+
+  // Buffers (data for released Blobs is gone, those buffers become NULL)
+  uint64_t* bufferOffsets = malloc(MAX(model->bufferCount, 1) * sizeof(uint64_t));
+  ModelBuffer* buffers = calloc(MAX(model->bufferCount, 1), sizeof(ModelBuffer));
+  lovrAssert(bufferOffsets && buffers, "Out of memory");
+  for (uint32_t i = 0; i < model->bufferCount; i++) {
+    ModelBuffer* buffer = &model->buffers[i];
+    bufferOffsets[i] = buffer->data ? append(&out, buffer->data, buffer->size) : 0;
+    buffers[i].offset = bufferOffsets[i];
+    buffers[i].size = buffer->size;
+    buffers[i].stride = buffer->stride;
+  }
+  header.sections[SECTION_BUFFERS] = append(&out, buffers, model->bufferCount * sizeof(ModelBuffer));
+  free(buffers);
+
+  // Images keep their decoded pixels and mipmaps
+  CookedImage* images = calloc(MAX(model->imageCount, 1), sizeof(CookedImage));
+  lovrAssert(images, "Out of memory");
+  for (uint32_t i = 0; i < model->imageCount; i++) {
+    Image* image = model->images[i];
+    CookedImage* cooked = &images[i];
+    if (!image) continue;
+
+    cooked->width = image->width;
+    cooked->height = image->height;
+    cooked->format = image->format;
+    cooked->mipmapCount = image->mipmapCount;
+
+    if (image->blob && image->blob->data) {
+      cooked->data = append(&out, image->blob->data, image->blob->size);
+      cooked->size = image->blob->size;
+    }
+
+    if (image->mipmapCount > 0) {
+      CookedMipmap* mipmaps = calloc(image->mipmapCount, sizeof(CookedMipmap));
+      lovrAssert(mipmaps, "Out of memory");
+      for (uint32_t j = 0; j < image->mipmapCount; j++) {
+        Mipmap* mipmap = &image->mipmaps[j];
+        mipmaps[j].width = mipmap->width;
+        mipmaps[j].height = mipmap->height;
+        mipmaps[j].data = append(&out, mipmap->data, mipmap->size);
+        mipmaps[j].size = mipmap->size;
+      }
+      cooked->mipmaps = append(&out, mipmaps, image->mipmapCount * sizeof(CookedMipmap));
+      free(mipmaps);
+    }
+  }
+  header.sections[SECTION_IMAGES] = append(&out, images, model->imageCount * sizeof(CookedImage));
+  free(images);
+
+  // Materials
+  ModelMaterial* materials = calloc(MAX(model->materialCount, 1), sizeof(ModelMaterial));
+  lovrAssert(materials, "Out of memory");
+  for (uint32_t i = 0; i < model->materialCount; i++) {
+    materials[i] = model->materials[i];
+    materials[i].name = appendName(&chars, model->materials[i].name);
+  }
+  header.sections[SECTION_MATERIALS] = append(&out, materials, model->materialCount * sizeof(ModelMaterial));
+  free(materials);
+
+  // Attributes don't have any pointers, they're copied field by field to clear the unused bitfield bits
+  ModelAttribute* attributes = calloc(MAX(model->attributeCount, 1), sizeof(ModelAttribute));
+  lovrAssert(attributes, "Out of memory");
+  for (uint32_t i = 0; i < model->attributeCount; i++) {
+    ModelAttribute* attribute = &model->attributes[i];
+    attributes[i].offset = attribute->offset;
+    attributes[i].buffer = attribute->buffer;
+    attributes[i].count = attribute->count;
+    attributes[i].type = attribute->type;
+    attributes[i].components = attribute->components;
+    attributes[i].normalized = attribute->normalized;
+    attributes[i].matrix = attribute->matrix;
+    attributes[i].hasMin = attribute->hasMin;
+    attributes[i].hasMax = attribute->hasMax;
+    memcpy(attributes[i].min, attribute->min, sizeof(attribute->min));
+    memcpy(attributes[i].max, attribute->max, sizeof(attribute->max));
+  }
+  header.sections[SECTION_ATTRIBUTES] = append(&out, attributes, model->attributeCount * sizeof(ModelAttribute));
+  free(attributes);
+
+  // Primitives
+  ModelPrimitive* primitives = calloc(MAX(model->primitiveCount, 1), sizeof(ModelPrimitive));
+  lovrAssert(primitives, "Out of memory");
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    ModelPrimitive* primitive = &model->primitives[i];
+    primitives[i] = *primitive;
+    for (uint32_t j = 0; j < MAX_DEFAULT_ATTRIBUTES; j++) {
+      primitives[i].attributes[j] = primitive->attributes[j] ? ENCODE(primitive->attributes[j] - model->attributes + 1) : NULL;
+    }
+    primitives[i].indices = primitive->indices ? ENCODE(primitive->indices - model->attributes + 1) : NULL;
+  }
+  header.sections[SECTION_PRIMITIVES] = append(&out, primitives, model->primitiveCount * sizeof(ModelPrimitive));
+  free(primitives);
+
+  // Animations
+  ModelAnimation* animations = calloc(MAX(model->animationCount, 1), sizeof(ModelAnimation));
+  lovrAssert(animations, "Out of memory");
+  for (uint32_t i = 0; i < model->animationCount; i++) {
+    ModelAnimation* animation = &model->animations[i];
+    animations[i] = *animation;
+    animations[i].name = appendName(&chars, animation->name);
+    animations[i].channels = animation->channelCount > 0 ? ENCODE(animation->channels - model->channels + 1) : NULL;
+  }
+  header.sections[SECTION_ANIMATIONS] = append(&out, animations, model->animationCount * sizeof(ModelAnimation));
+  free(animations);
+
+  // Skins
+  ModelSkin* skins = calloc(MAX(model->skinCount, 1), sizeof(ModelSkin));
+  lovrAssert(skins, "Out of memory");
+  for (uint32_t i = 0; i < model->skinCount; i++) {
+    ModelSkin* skin = &model->skins[i];
+    skins[i].jointCount = skin->jointCount;
+    skins[i].joints = skin->jointCount > 0 ? ENCODE(skin->joints - model->joints + 1) : NULL;
+    skins[i].inverseBindMatrices = encodeData(model, bufferOffsets, skin->inverseBindMatrices);
+  }
+  header.sections[SECTION_SKINS] = append(&out, skins, model->skinCount * sizeof(ModelSkin));
+  free(skins);
+
+  // Nodes
+  ModelNode* nodes = calloc(MAX(model->nodeCount, 1), sizeof(ModelNode));
+  lovrAssert(nodes, "Out of memory");
+  for (uint32_t i = 0; i < model->nodeCount; i++) {
+    ModelNode* node = &model->nodes[i];
+    memcpy(&nodes[i].transform, &node->transform, sizeof(node->transform));
+    nodes[i].childCount = node->childCount;
+    nodes[i].primitiveIndex = node->primitiveIndex;
+    nodes[i].primitiveCount = node->primitiveCount;
+    nodes[i].skin = node->skin;
+    nodes[i].matrix = node->matrix;
+    nodes[i].name = appendName(&chars, node->name);
+    nodes[i].children = node->childCount > 0 ? ENCODE(node->children - model->children + 1) : NULL;
+  }
+  header.sections[SECTION_NODES] = append(&out, nodes, model->nodeCount * sizeof(ModelNode));
+  free(nodes);
+
+  // Channels, packed keyframes are stored after the float ones
+  ModelAnimationChannel* channels = calloc(MAX(model->channelCount, 1), sizeof(ModelAnimationChannel));
+  lovrAssert(channels, "Out of memory");
+  for (uint32_t i = 0; i < model->channelCount; i++) {
+    ModelAnimationChannel* channel = &model->channels[i];
+    channels[i] = *channel;
+    channels[i].times = encodeData(model, bufferOffsets, channel->times);
+    channels[i].data = encodeData(model, bufferOffsets, channel->data);
+
+    if (channel->packedTimes) {
+      channels[i].packedTimes = ENCODE(append(&out, channel->packedTimes, channel->keyframeCount * sizeof(uint16_t)));
+    }
+
+    if (channel->packedData) {
+      channels[i].packedData = ENCODE(append(&out, channel->packedData, getPackedDataCount(channel) * sizeof(uint16_t)));
+    }
+  }
+  header.sections[SECTION_CHANNELS] = append(&out, channels, model->channelCount * sizeof(ModelAnimationChannel));
+  free(channels);
+  free(bufferOffsets);
+
+  header.sections[SECTION_CHILDREN] = append(&out, model->children, model->childCount * sizeof(uint32_t));
+  header.sections[SECTION_JOINTS] = append(&out, model->joints, model->jointCount * sizeof(uint32_t));
+  header.sections[SECTION_CHARS] = append(&out, chars.data, chars.length);
+  header.sections[SECTION_LOD_RANGES] = append(&out, model->lodRanges, getLodRangeCount(model) * sizeof(uint32_t));
+  header.sections[SECTION_LOD_INDICES] = append(&out, model->lodIndices, model->lodIndexCount * sizeof(uint32_t));
+  header.charCount = (uint32_t) chars.length;
+  arr_free(&chars);
+
+  memcpy(out.data, &header, sizeof(header));
+  return lovrBlobCreate(out.data, out.length, "Cooked ModelData");
+}
+
+// Loading
+//
+// Cooked files are untrusted, so every offset, count, and index is checked before it's used.  Sizes
+// are computed in 64 bits so a huge count can't wrap around and pass a check.
+
+#define CHECK(x) lovrAssert(x, "Cooked model '%s' is corrupt", source->name)
+
+static const size_t attributeTypeSizes[] = { [I8] = 1, [U8] = 1, [I16] = 2, [U16] = 2, [I32] = 4, [U32] = 4, [F32] = 4 };
+
+static void* resolve(Blob* source, uint64_t offset, uint64_t size) {
+  CHECK(offset <= source->size && size <= source->size - offset);
+  return (char*) source->data + offset;
+}
+
+static void* resolveIndex(Blob* source, void* encoded, void* array, size_t stride, uint32_t count, uint32_t arrayCount) {
+  uint64_t index = DECODE(encoded);
+  if (index == 0) {
+    return NULL;
+  }
+
+  CHECK(index <= arrayCount && count <= arrayCount - (index - 1));
+  return (char*) array + (index - 1) * stride;
+}
+
+static const char* resolveName(ModelData* model, Blob* source, const char* encoded) {
+  uint64_t offset = DECODE(encoded);
+  if (offset == 0) {
+    return NULL;
+  }
+
+  CHECK(offset - 1 < model->charCount && model->chars[model->charCount - 1] == '\0');
+  return model->chars + offset - 1;
+}
+
+static void* copySection(Blob* source, uint64_t offset, uint64_t size) {
+  if (size == 0) {
+    return NULL;
+  }
+
+  void* data = resolve(source, offset, size);
+  void* copy = malloc(size);
+  lovrAssert(copy, "Out of memory");
+  memcpy(copy, data, size);
+  return copy;
+}
+
+// Checks that every element of an attribute is inside its buffer
+static void checkAttribute(ModelData* model, Blob* source, ModelAttribute* attribute) {
+  CHECK(attribute->type <= F32 && attribute->components >= 1 && attribute->components <= 4);
+  CHECK(attribute->buffer < model->bufferCount);
+  if (attribute->count == 0) {
+    return;
+  }
+
+  ModelBuffer* buffer = &model->buffers[attribute->buffer];
+  uint64_t size = attributeTypeSizes[attribute->type] * attribute->components * (attribute->matrix ? attribute->components : 1);
+  uint64_t stride = buffer->stride ? buffer->stride : size;
+  CHECK(buffer->data && size <= buffer->size && attribute->offset <= buffer->size - size);
+  CHECK(attribute->count - 1 <= (buffer->size - size - attribute->offset) / stride);
+}
+
+static uint32_t getIndex(ModelData* model, ModelAttribute* indices, uint32_t i) {
+  char* data = model->buffers[indices->buffer].data + indices->offset;
+  switch (indices->type) {
+    case U8: return ((uint8_t*) data)[i];
+    case U16: return ((uint16_t*) data)[i];
+    default: return ((uint32_t*) data)[i];
+  }
+}
+
+static void checkPrimitive(ModelData* model, Blob* source, ModelPrimitive* primitive) {
+  CHECK(primitive->mode <= DRAW_TRIANGLE_FAN);
+  CHECK(primitive->material == ~0u || primitive->material < model->materialCount);
+
+  ModelAttribute* positions = primitive->attributes[ATTR_POSITION];
+  uint32_t vertexCount = positions ? positions->count : 0;
+  for (uint32_t i = 0; i < MAX_DEFAULT_ATTRIBUTES; i++) {
+    CHECK(!primitive->attributes[i] || primitive->attributes[i]->count >= vertexCount);
+  }
+
+  ModelAttribute* indices = primitive->indices;
+  if (indices) {
+    CHECK(positions && (indices->type == U8 || indices->type == U16 || indices->type == U32) && indices->components == 1);
+    for (uint32_t i = 0; i < indices->count; i++) {
+      CHECK(getIndex(model, indices, i) < vertexCount);
+    }
+  }
+}
+
+static Image* loadImage(Blob* source, CookedImage* cooked) {
+  CHECK(cooked->format <= FORMAT_ASTC_12x12);
+  bool compressed = cooked->format >= FORMAT_DXT1;
+  if (compressed) {
+    CHECK(cooked->mipmapCount > 0);
+  } else {
+    uint64_t size = (uint64_t) cooked->width * cooked->height * lovrImageGetPixelSize(cooked->format);
+    CHECK(cooked->size >= size);
+  }
+
+  resolve(source, cooked->data, cooked->size);
+  CookedMipmap* mipmaps = cooked->mipmapCount > 0 ? resolve(source, cooked->mipmaps, (uint64_t) cooked->mipmapCount * sizeof(CookedMipmap)) : NULL;
+  for (uint32_t i = 0; i < cooked->mipmapCount; i++) {
+    resolve(source, mipmaps[i].data, mipmaps[i].size);
+  }
+
+  Image* image = calloc(1, sizeof(Image));
+  lovrAssert(image, "Out of memory");
+  image->ref = 1;
+  image->width = cooked->width;
+  image->height = cooked->height;
+  image->format = cooked->format;
+  image->blob = cooked->size > 0 ? lovrBlobCreateView(source, cooked->data, cooked->size, "Image") : lovrBlobCreate(NULL, 0, NULL);
+
+  if (cooked->mipmapCount > 0) {
+    image->mipmaps = malloc(cooked->mipmapCount * sizeof(Mipmap));
+    lovrAssert(image->mipmaps, "Out of memory");
+    for (uint32_t i = 0; i < cooked->mipmapCount; i++) {
+      image->mipmaps[i] = (Mipmap) {
+        .width = mipmaps[i].width,
+        .height = mipmaps[i].height,
+        .size = mipmaps[i].size,
+        .data = (char*) source->data + mipmaps[i].data
+      };
+    }
+    image->mipmapCount = cooked->mipmapCount;
+    image->source = source;
+    lovrRetain(source);
+  }
+
+  return image;
+}
+
+ModelData* lovrModelDataInitCooked(ModelData* model, Blob* source, ModelDataIO* io) {
+  CookedHeader* header = source->data;
+  if (source->size < sizeof(CookedHeader) || header->magic != MAGIC_LMDL) {
+    return NULL;
+  }
+
+  lovrAssert(header->version == COOKED_VERSION && header->pointerSize == sizeof(void*), "Cooked model '%s' was made by an incompatible version of LÖVR", source->name);
+
+  // Check section sizes before allocating anything, so a bad count can't cause a huge allocation
+  struct { uint32_t count; size_t size; } sizes[] = {
+    [SECTION_BUFFERS] = { header->bufferCount, sizeof(ModelBuffer) },
+    [SECTION_IMAGES] = { header->imageCount, sizeof(CookedImage) },
+    [SECTION_MATERIALS] = { header->materialCount, sizeof(ModelMaterial) },
+    [SECTION_ATTRIBUTES] = { header->attributeCount, sizeof(ModelAttribute) },
+    [SECTION_PRIMITIVES] = { header->primitiveCount, sizeof(ModelPrimitive) },
+    [SECTION_ANIMATIONS] = { header->animationCount, sizeof(ModelAnimation) },
+    [SECTION_SKINS] = { header->skinCount, sizeof(ModelSkin) },
+    [SECTION_NODES] = { header->nodeCount, sizeof(ModelNode) },
+    [SECTION_CHANNELS] = { header->channelCount, sizeof(ModelAnimationChannel) },
+    [SECTION_CHILDREN] = { header->childCount, sizeof(uint32_t) },
+    [SECTION_JOINTS] = { header->jointCount, sizeof(uint32_t) },
+    [SECTION_CHARS] = { header->charCount, sizeof(char) },
+    [SECTION_LOD_RANGES] = { header->lodCount, 2 * MAX(header->primitiveCount, 1) * sizeof(uint32_t) },
+    [SECTION_LOD_INDICES] = { header->lodIndexCount, sizeof(uint32_t) }
+  };
+
+  for (uint32_t i = 0; i < MAX_SECTIONS; i++) {
+    resolve(source, header->sections[i], (uint64_t) sizes[i].count * sizes[i].size);
+  }
+
+  CHECK(header->lodCount <= MAX_LODS);
+
+  model->blobCount = 1;
+  model->bufferCount = header->bufferCount;
+  model->imageCount = header->imageCount;
+  model->materialCount = header->materialCount;
+  model->attributeCount = header->attributeCount;
+  model->primitiveCount = header->primitiveCount;
+  model->animationCount = header->animationCount;
+  model->skinCount = header->skinCount;
+  model->nodeCount = header->nodeCount;
+  model->channelCount = header->channelCount;
+  model->childCount = header->childCount;
+  model->jointCount = header->jointCount;
+  model->charCount = header->charCount;
+  lovrModelDataAllocate(model);
+
+  model->blobs[0] = source;
+  lovrRetain(source);
+  model->rootNode = header->rootNode;
+  CHECK(model->rootNode < model->nodeCount || model->nodeCount == 0);
+
+  struct { void* array; size_t size; } sections[] = {
+    [SECTION_BUFFERS] = { model->buffers, model->bufferCount * sizeof(ModelBuffer) },
+    [SECTION_MATERIALS] = { model->materials, model->materialCount * sizeof(ModelMaterial) },
+    [SECTION_ATTRIBUTES] = { model->attributes, model->attributeCount * sizeof(ModelAttribute) },
+    [SECTION_PRIMITIVES] = { model->primitives, model->primitiveCount * sizeof(ModelPrimitive) },
+    [SECTION_ANIMATIONS] = { model->animations, model->animationCount * sizeof(ModelAnimation) },
+    [SECTION_SKINS] = { model->skins, model->skinCount * sizeof(ModelSkin) },
+    [SECTION_NODES] = { model->nodes, model->nodeCount * sizeof(ModelNode) },
+    [SECTION_CHANNELS] = { model->channels, model->channelCount * sizeof(ModelAnimationChannel) },
+    [SECTION_CHILDREN] = { model->children, model->childCount * sizeof(uint32_t) },
+    [SECTION_JOINTS] = { model->joints, model->jointCount * sizeof(uint32_t) },
+    [SECTION_CHARS] = { model->chars, model->charCount }
+  };
+
+  for (uint32_t i = 0; i < COUNTOF(sections); i++) {
+    if (sections[i].size > 0) {
+      memcpy(sections[i].array, resolve(source, header->sections[i], sections[i].size), sections[i].size);
+    }
+  }
+
+  for (uint32_t i = 0; i < model->childCount; i++) {
+    CHECK(model->children[i] < model->nodeCount);
+  }
+
+  for (uint32_t i = 0; i < model->jointCount; i++) {
+    CHECK(model->joints[i] < model->nodeCount);
+  }
+
+  for (uint32_t i = 0; i < model->bufferCount; i++) {
+    ModelBuffer* buffer = &model->buffers[i];
+    buffer->data = buffer->offset > 0 ? resolve(source, buffer->offset, buffer->size) : NULL;
+    buffer->blob = 0;
+  }
+
+  for (uint32_t i = 0; i < model->attributeCount; i++) {
+    checkAttribute(model, source, &model->attributes[i]);
+  }
+
+  // Images point into the source Blob too, so they hold a reference to it
+  CookedImage* images = resolve(source, header->sections[SECTION_IMAGES], model->imageCount * sizeof(CookedImage));
+  for (uint32_t i = 0; i < model->imageCount; i++) {
+    if (images[i].width > 0) {
+      model->images[i] = loadImage(source, &images[i]);
+    }
+  }
+
+  for (uint32_t i = 0; i < model->materialCount; i++) {
+    ModelMaterial* material = &model->materials[i];
+    material->name = resolveName(model, source, material->name);
+    for (uint32_t j = 0; j < MAX_MATERIAL_TEXTURES; j++) {
+      uint32_t image = material->images[j];
+      CHECK(image == ~0u || (image < model->imageCount && model->images[image]));
+      CHECK(material->filters[j].mode <= FILTER_TRILINEAR);
+      CHECK(material->wraps[j].s <= WRAP_MIRRORED_REPEAT && material->wraps[j].t <= WRAP_MIRRORED_REPEAT && material->wraps[j].r <= WRAP_MIRRORED_REPEAT);
+    }
+    if (material->name) {
+      map_set(&model->materialMap, hash64(material->name, strlen(material->name)), i);
+    }
+  }
+
+  for (uint32_t i = 0; i < model->primitiveCount; i++) {
+    ModelPrimitive* primitive = &model->primitives[i];
+    for (uint32_t j = 0; j < MAX_DEFAULT_ATTRIBUTES; j++) {
+      primitive->attributes[j] = resolveIndex(source, primitive->attributes[j], model->attributes, sizeof(ModelAttribute), 1, model->attributeCount);
+    }
+    primitive->indices = resolveIndex(source, primitive->indices, model->attributes, sizeof(ModelAttribute), 1, model->attributeCount);
+    checkPrimitive(model, source, primitive);
+  }
+
+  for (uint32_t i = 0; i < model->animationCount; i++) {
+    ModelAnimation* animation = &model->animations[i];
+    animation->name = resolveName(model, source, animation->name);
+    animation->channels = resolveIndex(source, animation->channels, model->channels, sizeof(ModelAnimationChannel), animation->channelCount, model->channelCount);
+    CHECK(animation->channels || animation->channelCount == 0);
+    if (animation->name) {
+      map_set(&model->animationMap, hash64(animation->name, strlen(animation->name)), i);
+    }
+  }
+
+  // Packed keyframes are copied, since ModelData owns them
+  for (uint32_t i = 0; i < model->channelCount; i++) {
+    ModelAnimationChannel* channel = &model->channels[i];
+    CHECK(channel->property <= PROP_SCALE && channel->smoothing <= SMOOTH_CUBIC && channel->nodeIndex < model->nodeCount);
+    uint64_t n = channel->property == PROP_ROTATION ? 4 : 3;
+    uint64_t elements = (uint64_t) channel->keyframeCount * (channel->smoothing == SMOOTH_CUBIC ? 3 : 1);
+    channel->times = DECODE(channel->times) ? resolve(source, DECODE(channel->times), (uint64_t) channel->keyframeCount * sizeof(float)) : NULL;
+    channel->data = DECODE(channel->data) ? resolve(source, DECODE(channel->data), elements * n * sizeof(float)) : NULL;
+    channel->packedTimes = DECODE(channel->packedTimes) ? copySection(source, DECODE(channel->packedTimes), (uint64_t) channel->keyframeCount * sizeof(uint16_t)) : NULL;
+    channel->packedData = DECODE(channel->packedData) ? copySection(source, DECODE(channel->packedData), getPackedDataCount(channel) * sizeof(uint16_t)) : NULL;
+    CHECK((channel->times || channel->packedTimes) && (channel->data || channel->packedData));
+  }
+
+  for (uint32_t i = 0; i < model->skinCount; i++) {
+    ModelSkin* skin = &model->skins[i];
+    skin->joints = resolveIndex(source, skin->joints, model->joints, sizeof(uint32_t), skin->jointCount, model->jointCount);
+    skin->inverseBindMatrices = DECODE(skin->inverseBindMatrices) ? resolve(source, DECODE(skin->inverseBindMatrices), (uint64_t) skin->jointCount * 16 * sizeof(float)) : NULL;
+    CHECK(skin->joints || skin->jointCount == 0);
+  }
+
+  for (uint32_t i = 0; i < model->nodeCount; i++) {
+    ModelNode* node = &model->nodes[i];
+    node->name = resolveName(model, source, node->name);
+    node->children = resolveIndex(source, node->children, model->children, sizeof(uint32_t), node->childCount, model->childCount);
+    CHECK(node->children || node->childCount == 0);
+    CHECK(node->primitiveIndex <= model->primitiveCount && node->primitiveCount <= model->primitiveCount - node->primitiveIndex);
+    CHECK(node->skin == ~0u || node->skin < model->skinCount);
+    if (node->name) {
+      map_set(&model->nodeMap, hash64(node->name, strlen(node->name)), i);
+    }
+  }
+
+  // LOD ranges index into the LOD indices, which index into the primitive's vertices
+  if (header->lodCount > 0) {
+    model->lodCount = header->lodCount;
+    model->lodIndexCount = header->lodIndexCount;
+    memcpy(model->lodRatios, header->lodRatios, sizeof(model->lodRatios));
+    model->lodRanges = copySection(source, header->sections[SECTION_LOD_RANGES], getLodRangeCount(model) * sizeof(uint32_t));
+    model->lodIndices = copySection(source, header->sections[SECTION_LOD_INDICES], model->lodIndexCount * sizeof(uint32_t));
+
+    for (uint32_t level = 0; level < model->lodCount; level++) {
+      for (uint32_t i = 0; i < model->primitiveCount; i++) {
+        uint32_t* range = model->lodRanges + 2 * (level * model->primitiveCount + i);
+        if (range[1] == 0) continue;
+        ModelAttribute* positions = model->primitives[i].attributes[ATTR_POSITION];
+        CHECK(positions && range[0] <= model->lodIndexCount && range[1] <= model->lodIndexCount - range[0]);
+        for (uint32_t j = range[0]; j < range[0] + range[1]; j++) {
+          CHECK(model->lodIndices[j] < positions->count);
+        }
+      }
+    }
+  }
+
+  return model;
+}
@@ -656,43 +656,42 @@ ModelData* lovrModelDataInitGltf(ModelData* model, Blob* source, ModelDataIO* io
     }
   }
 
-  // Images
+  // Images are read here and decoded in parallel afterwards
   if (model->imageCount > 0) {
     jsmntok_t* token = info.images;
-    Image** image = model->images;
-    for (int i = (token++)->size; i > 0; i--, image++) {
+    Blob** blobs = calloc(model->imageCount, sizeof(Blob*));
+    lovrAssert(blobs, "Out of memory");
+    Blob** blob = blobs;
+    for (int i = (token++)->size; i > 0; i--, blob++) {
       for (int k = (token++)->size; k > 0; k--) {
         gltfString key = NOM_STR(json, token);
         if (STR_EQ(key, "bufferView")) {
           ModelBuffer* buffer = &model->buffers[NOM_INT(json, token)];
-          Blob* blob = lovrBlobCreate(buffer->data, buffer->size, NULL);
-          *image = lovrImageCreateFromBlob(blob, false);
-          blob->data = NULL; // XXX Blob data ownership
-          lovrRelease(blob, lovrBlobDestroy);
+          *blob = lovrBlobCreateView(model->blobs[buffer->blob], buffer->offset, buffer->size, NULL);
         } else if (STR_EQ(key, "uri")) {
           void* data;
-          Blob* blob;
           size_t size;
           gltfString uri = NOM_STR(json, token);
           if (uri.length >= 5 && !strncmp("data:", uri.data, 5)) {
             data = decodeBase64(uri.data, uri.length, &size);
             lovrAssert(data, "Could not decode base64 image");
-            blob = lovrBlobCreate(data, size, NULL);
+            *blob = lovrBlobCreate(data, size, NULL);
           } else {
             lovrAssert(uri.length < maxPathLength, "Image filename is too long");
             strncat(filename, uri.data, uri.length);
             data = io(filename, &size);
             lovrAssert(data && size > 0, "Unable to read image from '%s'", filename);
-            blob = lovrBlobCreate(data, size, NULL);
+            *blob = lovrBlobCreate(data, size, NULL);
           }
-          *image = lovrImageCreateFromBlob(blob, false);
-          lovrRelease(blob, lovrBlobDestroy);
           *root = '\0';
         } else {
           token += NOM_VALUE(json, token);
         }
       }
     }
+
+    lovrModelDataDecodeImages(blobs, model->images, model->imageCount, false);
+    free(blobs);
   }
 
   // Materials
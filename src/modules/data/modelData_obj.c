@@ -14,7 +14,7 @@ typedef struct {
 } objGroup;
 
 typedef arr_t(ModelMaterial) arr_material_t;
-typedef arr_t(Image*) arr_image_t;
+typedef arr_t(Blob*) arr_blob_t;
 typedef arr_t(objGroup) arr_group_t;
 
 #define STARTS_WITH(a, b) !strncmp(a, b, strlen(b))
@@ -26,7 +26,7 @@ static uint32_t nomu32(char* s, char** end) {
   return n;
 }
 
-static void parseMtl(char* path, char* base, ModelDataIO* io, arr_image_t* images, arr_material_t* materials, map_t* names) {
+static void parseMtl(char* path, char* base, ModelDataIO* io, arr_blob_t* images, arr_material_t* materials, map_t* names) {
   size_t size = 0;
   char* p = io(path, &size);
   lovrAssert(p && size > 0, "Unable to read mtl from '%s'", path);
@@ -71,14 +71,13 @@ static void parseMtl(char* path, char* base, ModelDataIO* io, arr_image_t* image
       lovrAssert(pixels && imageSize > 0, "Unable to read image from %s", path);
       Blob* blob = lovrBlobCreate(pixels, imageSize, NULL);
 
-      Image* image = lovrImageCreateFromBlob(blob, true);
+      // Images are decoded once the whole OBJ has been parsed
       lovrAssert(materials->length > 0, "Tried to set a material property without declaring a material first");
       ModelMaterial* material = &materials->data[materials->length - 1];
       material->images[TEXTURE_DIFFUSE] = (uint32_t) images->length;
       material->filters[TEXTURE_DIFFUSE].mode = FILTER_TRILINEAR;
       material->wraps[TEXTURE_DIFFUSE] = (TextureWrap) { .s = WRAP_REPEAT, .t = WRAP_REPEAT };
-      arr_push(images, image);
-      lovrRelease(blob, lovrBlobDestroy);
+      arr_push(images, blob);
     }
 
     next:
@@ -99,7 +98,7 @@ ModelData* lovrModelDataInitObj(ModelData* model, Blob* source, ModelDataIO* io)
   size_t size = source->size;
 
   arr_group_t groups;
-  arr_image_t images;
+  arr_blob_t images;
   arr_material_t materials;
   arr_t(float) vertexBlob;
   arr_t(int) indexBlob;
@@ -252,6 +251,9 @@ ModelData* lovrModelDataInitObj(ModelData* model, Blob* source, ModelDataIO* io)
   }
 
   if (vertexBlob.length == 0 || indexBlob.length == 0) {
+    for (size_t i = 0; i < images.length; i++) {
+      lovrRelease(images.data[i], lovrBlobDestroy);
+    }
     model = NULL;
     goto finish;
   }
@@ -282,7 +284,7 @@ ModelData* lovrModelDataInitObj(ModelData* model, Blob* source, ModelDataIO* io)
     .stride = sizeof(int)
   };
 
-  memcpy(model->images, images.data, model->imageCount * sizeof(Image*));
+  lovrModelDataDecodeImages(images.data, model->images, model->imageCount, true);
   memcpy(model->materials, materials.data, model->materialCount * sizeof(ModelMaterial));
   memcpy(model->materialMap.hashes, materialMap.hashes, materialMap.size * sizeof(uint64_t));
   memcpy(model->materialMap.values, materialMap.values, materialMap.size * sizeof(uint64_t));
@@ -13,6 +13,7 @@ struct Rasterizer {
   uint32_t ref;
   stbtt_fontinfo font;
   struct Blob* blob;
+  uint64_t hash;
   float size;
   float scale;
   int glyphCount;
@@ -62,6 +63,15 @@ float lovrRasterizerGetSize(Rasterizer* rasterizer) {
   return rasterizer->size;
 }
 
+// Hash of the font file, computed on first use since fonts can be big
+uint64_t lovrRasterizerGetHash(Rasterizer* rasterizer) {
+  if (!rasterizer->hash) {
+    Blob* blob = rasterizer->blob;
+    rasterizer->hash = blob ? hash64(blob->data, blob->size) : hash64(etc_VarelaRound_ttf, etc_VarelaRound_ttf_len);
+  }
+  return rasterizer->hash;
+}
+
 int lovrRasterizerGetGlyphCount(Rasterizer* rasterizer) {
   return rasterizer->glyphCount;
 }
@@ -107,6 +117,7 @@ void lovrRasterizerLoadGlyph(Rasterizer* rasterizer, uint32_t character, uint32_
 
   if (stbtt_IsGlyphEmpty(&rasterizer->font, glyphIndex)) {
     memset(glyph, 0, sizeof(Glyph));
+    glyph->codepoint = character;
     glyph->advance = roundf(advance * rasterizer->scale);
     return;
   }
@@ -160,6 +171,7 @@ void lovrRasterizerLoadGlyph(Rasterizer* rasterizer, uint32_t character, uint32_
   stbtt_GetGlyphBox(&rasterizer->font, glyphIndex, &x0, &y0, &x1, &y1);
 
   // Initialize glyph data
+  glyph->codepoint = character;
   glyph->x = 0;
   glyph->y = 0;
   glyph->w = ceilf((x1 - x0) * rasterizer->scale);
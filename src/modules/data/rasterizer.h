@@ -8,6 +8,8 @@ struct Blob;
 struct Image;
 
 typedef struct {
+  uint32_t codepoint;
+  uint32_t page;
   uint32_t x;
   uint32_t y;
   uint32_t w;
@@ -24,6 +26,7 @@ typedef struct Rasterizer Rasterizer;
 Rasterizer* lovrRasterizerCreate(struct Blob* blob, float size);
 void lovrRasterizerDestroy(void* ref);
 float lovrRasterizerGetSize(Rasterizer* rasterizer);
+uint64_t lovrRasterizerGetHash(Rasterizer* rasterizer);
 int lovrRasterizerGetGlyphCount(Rasterizer* rasterizer);
 int lovrRasterizerGetHeight(Rasterizer* rasterizer);
 int lovrRasterizerGetAdvance(Rasterizer* rasterizer);
@@ -1,6 +1,7 @@
 #include "event/event.h"
 #include "thread/thread.h"
 #include "core/os.h"
+#include "core/profile.h"
 #include "util.h"
 #include <stdlib.h>
 #include <string.h>
@@ -46,7 +47,9 @@ void lovrEventDestroy() {
 }
 
 void lovrEventPump() {
+  PROFILE_BEGIN("Event pump");
   os_poll_events();
+  PROFILE_END();
 }
 
 void lovrEventPush(Event event) {
@@ -40,6 +40,7 @@ typedef struct Archive {
   bool (*stat)(struct Archive* archive, const char* path, FileInfo* info);
   void (*list)(struct Archive* archive, const char* path, fs_list_cb callback, void* context);
   bool (*read)(struct Archive* archive, const char* path, size_t bytes, size_t* bytesRead, void** data);
+  void* (*map)(struct Archive* archive, const char* path, size_t* size);
   void (*close)(struct Archive* archive);
   zip_state zip;
   strpool strings;
@@ -299,6 +300,13 @@ void* lovrFilesystemRead(const char* path, size_t bytes, size_t* bytesRead) {
   return NULL;
 }
 
+// Files in zip archives can't be mapped, NULL means the file should be read instead
+void* lovrFilesystemMap(const char* path, size_t* size) {
+  FileInfo info;
+  Archive* archive = archiveStat(path, &info);
+  return archive && archive->map && info.type == FILE_REGULAR ? archive->map(archive, path, size) : NULL;
+}
+
 void lovrFilesystemGetDirectoryItems(const char* path, void (*callback)(void* context, const char* path), void* context) {
   if (valid(path)) {
     FOREACH_ARCHIVE(archive) {
@@ -504,6 +512,11 @@ static bool dir_read(Archive* archive, const char* path, size_t bytes, size_t* b
   return true;
 }
 
+static void* dir_map(Archive* archive, const char* path, size_t* size) {
+  char resolved[LOVR_PATH_MAX];
+  return dir_resolve(resolved, archive, path) ? fs_map(resolved, size) : NULL;
+}
+
 static void dir_close(Archive* archive) {
   arr_free(&archive->strings);
 }
@@ -517,6 +530,7 @@ static bool dir_init(Archive* archive, const char* path, const char* mountpoint,
   archive->stat = dir_stat;
   archive->list = dir_list;
   archive->read = dir_read;
+  archive->map = dir_map;
   archive->close = dir_close;
   return true;
 }
@@ -724,6 +738,7 @@ static bool zip_init(Archive* archive, const char* filename, const char* mountpo
   archive->stat = zip_stat;
   archive->list = zip_list;
   archive->read = zip_read;
+  archive->map = NULL;
   archive->close = zip_close;
   return true;
 }
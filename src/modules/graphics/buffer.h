@@ -20,6 +20,7 @@ typedef enum {
 
 typedef struct Buffer Buffer;
 Buffer* lovrBufferCreate(size_t size, void* data, BufferType type, BufferUsage usage, bool readable);
+Buffer* lovrBufferCreatePersistent(size_t size, BufferType type);
 void lovrBufferDestroy(void* ref);
 size_t lovrBufferGetSize(Buffer* buffer);
 bool lovrBufferIsReadable(Buffer* buffer);
@@ -28,3 +29,5 @@ void* lovrBufferMap(Buffer* buffer, size_t offset, bool unsynchronized);
 void lovrBufferFlush(Buffer* buffer, size_t offset, size_t size);
 void lovrBufferUnmap(Buffer* buffer);
 void lovrBufferDiscard(Buffer* buffer);
+void lovrBufferLock(Buffer* buffer, size_t offset, size_t size);
+void lovrBufferUnlock(Buffer* buffer, size_t offset, size_t size);
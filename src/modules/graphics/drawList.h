@@ -0,0 +1,8 @@
+#include <stdint.h>
+
+#pragma once
+
+typedef struct DrawList DrawList;
+void lovrDrawListDestroy(void* ref);
+void lovrDrawListDraw(DrawList* list, float* transform);
+uint32_t lovrDrawListGetBatchCount(DrawList* list);
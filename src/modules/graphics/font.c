@@ -3,24 +3,46 @@
 #include "graphics/texture.h"
 #include "data/rasterizer.h"
 #include "data/image.h"
+#include "data/blob.h"
+#include "core/fs.h"
+#include "core/job.h"
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
+
+#define FONT_CACHE_MAGIC 0x544e464c // LFNT
+#define FONT_CACHE_VERSION 1
+#define FONT_LAYOUT_CACHE_SIZE 64
+#define FONT_LAYOUT_MAX_GLYPHS 1024
+#define FONT_PAGE_MAX_SIZE 2048
 
 typedef struct {
   uint32_t x;
   uint32_t y;
-  uint32_t width;
-  uint32_t height;
+  uint32_t size;
   uint32_t rowHeight;
   uint32_t padding;
   arr_t(Glyph) glyphs;
   map_t glyphMap;
+  arr_t(Texture*) pages;
+  arr_t(uint32_t) pending;
 } FontAtlas;
 
+typedef struct {
+  FontLayout layout;
+  uint64_t hash;
+  uint32_t tick;
+  char* string;
+  size_t length;
+  float wrap;
+  HorizontalAlign halign;
+  size_t capacity;
+  size_t pageCapacity;
+} FontLayoutEntry;
+
 struct Font {
   uint32_t ref;
   Rasterizer* rasterizer;
-  Texture* texture;
   FontAtlas atlas;
   map_t kerning;
   double spread;
@@ -29,8 +51,44 @@ struct Font {
   float pixelDensity;
   TextureFilter filter;
   bool flip;
+  char* cachePath;
+  uint32_t cachedGlyphs;
+  FontLayoutEntry layouts[FONT_LAYOUT_CACHE_SIZE];
+  FontLayoutEntry scratchLayout;
+  map_t layoutMap;
+  uint32_t layoutTick;
+  arr_t(float) renderVertices;
+  arr_t(uint32_t) renderPages;
 };
 
+// Cache files are a header followed by the metrics and MTSDF pixels of each glyph
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t glyphCount;
+} FontCacheHeader;
+
+typedef struct {
+  uint32_t codepoint;
+  uint32_t w;
+  uint32_t h;
+  uint32_t tw;
+  uint32_t th;
+  int32_t dx;
+  int32_t dy;
+  int32_t advance;
+  uint32_t hasPixels;
+} FontCacheGlyph;
+
+typedef struct {
+  Rasterizer* rasterizer;
+  const uint32_t* codepoints;
+  Glyph* glyphs;
+  uint32_t count;
+  uint32_t padding;
+  double spread;
+} GlyphBatch;
+
 static float* lovrFontAlignLine(float* x, float* lineEnd, float width, HorizontalAlign halign) {
   while (x < lineEnd) {
     if (halign == ALIGN_CENTER) {
@@ -46,9 +104,14 @@ static float* lovrFontAlignLine(float* x, float* lineEnd, float width, Horizonta
 }
 
 static Glyph* lovrFontGetGlyph(Font* font, uint32_t codepoint);
+static Glyph* lovrFontInsertGlyph(Font* font, Glyph* glyph);
 static void lovrFontAddGlyph(Font* font, Glyph* glyph);
-static void lovrFontExpandTexture(Font* font);
-static void lovrFontCreateTexture(Font* font);
+static void lovrFontAddPage(Font* font);
+static void lovrFontUploadGlyphs(Font* font);
+static uint32_t lovrFontRender(Font* font, const char* str, size_t length, float wrap, HorizontalAlign halign);
+static void lovrFontClearLayouts(Font* font);
+static void lovrFontLoadCache(Font* font);
+static void lovrFontSaveCache(Font* font);
 
 Font* lovrFontCreate(Rasterizer* rasterizer, uint32_t padding, double spread) {
   Font* font = calloc(1, sizeof(Font));
@@ -63,6 +126,10 @@ Font* lovrFontCreate(Rasterizer* rasterizer, uint32_t padding, double spread) {
   font->pixelDensity = (float) lovrRasterizerGetHeight(rasterizer);
   font->filter = lovrGraphicsGetDefaultFilter();
   map_init(&font->kerning, 0);
+  map_init(&font->layoutMap, FONT_LAYOUT_CACHE_SIZE);
+
+  arr_init(&font->renderVertices, arr_alloc);
+  arr_init(&font->renderPages, arr_alloc);
 
   // Atlas
   // The atlas padding affects the padding of the edges of the atlas and the space between rows.
@@ -70,33 +137,66 @@ Font* lovrFontCreate(Rasterizer* rasterizer, uint32_t padding, double spread) {
   uint32_t atlasPadding = 1;
   font->atlas.x = atlasPadding;
   font->atlas.y = atlasPadding;
-  font->atlas.width = 256;
-  font->atlas.height = 256;
   font->atlas.padding = atlasPadding;
   arr_init(&font->atlas.glyphs, arr_alloc);
   map_init(&font->atlas.glyphMap, 0);
-
-  // Set initial atlas size
-  while (font->atlas.height < 4 * lovrRasterizerGetSize(rasterizer)) {
-    lovrFontExpandTexture(font);
+  arr_init(&font->atlas.pages, arr_alloc);
+  arr_init(&font->atlas.pending, arr_alloc);
+
+  // Pages have a fixed size, big enough for a few rows of glyphs and ideally a few hundred glyphs.
+  // New pages are added when one fills up, so existing glyphs never move.
+  float size = lovrRasterizerGetSize(rasterizer);
+  font->atlas.size = 256;
+  while (font->atlas.size < 4 * size || (font->atlas.size < 16 * size && font->atlas.size < FONT_PAGE_MAX_SIZE)) {
+    font->atlas.size *= 2;
   }
 
-  // Create the texture
-  lovrFontCreateTexture(font);
+  // Cache files are named after everything that affects the rasterized glyphs
+  const char* cache = lovrGraphicsGetFontCache();
+  if (cache) {
+    char path[1024];
+    uint64_t hash = lovrRasterizerGetHash(rasterizer);
+    float size = lovrRasterizerGetSize(rasterizer);
+    int length = snprintf(path, sizeof(path), "%s/%016llx-%g-%u-%g", cache, (unsigned long long) hash, size, padding, spread);
+    if (length > 0 && length < (int) sizeof(path)) {
+      font->cachePath = malloc(length + 1);
+      lovrAssert(font->cachePath, "Out of memory");
+      memcpy(font->cachePath, path, length + 1);
+      lovrFontLoadCache(font);
+    }
+  }
 
   return font;
 }
 
 void lovrFontDestroy(void* ref) {
   Font* font = ref;
+  if (font->cachePath && font->atlas.glyphs.length > font->cachedGlyphs) {
+    lovrFontSaveCache(font);
+  }
+  free(font->cachePath);
   lovrRelease(font->rasterizer, lovrRasterizerDestroy);
-  lovrRelease(font->texture, lovrTextureDestroy);
+  for (size_t i = 0; i < font->atlas.pages.length; i++) {
+    lovrRelease(font->atlas.pages.data[i], lovrTextureDestroy);
+  }
   for (size_t i = 0; i < font->atlas.glyphs.length; i++) {
     lovrRelease(font->atlas.glyphs.data[i].data, lovrImageDestroy);
   }
+  arr_free(&font->atlas.pages);
+  arr_free(&font->atlas.pending);
   arr_free(&font->atlas.glyphs);
   map_free(&font->atlas.glyphMap);
   map_free(&font->kerning);
+  for (uint32_t i = 0; i < FONT_LAYOUT_CACHE_SIZE; i++) {
+    free(font->layouts[i].layout.vertices);
+    free(font->layouts[i].layout.pageCounts);
+    free(font->layouts[i].string);
+  }
+  free(font->scratchLayout.layout.vertices);
+  free(font->scratchLayout.layout.pageCounts);
+  map_free(&font->layoutMap);
+  arr_free(&font->renderVertices);
+  arr_free(&font->renderPages);
   free(font);
 }
 
@@ -104,8 +204,18 @@ Rasterizer* lovrFontGetRasterizer(Font* font) {
   return font->rasterizer;
 }
 
-Texture* lovrFontGetTexture(Font* font) {
-  return font->texture;
+uint32_t lovrFontGetPageCount(Font* font) {
+  return (uint32_t) font->atlas.pages.length;
+}
+
+// New glyphs are uploaded the next time a page is needed for drawing
+Texture* lovrFontGetTexture(Font* font, uint32_t page) {
+  lovrAssert(page < font->atlas.pages.length, "Invalid font atlas page %d", page);
+  if (font->atlas.pending.length > 0) {
+    lovrFontUploadGlyphs(font);
+  }
+
+  return font->atlas.pages.data[page];
 }
 
 TextureFilter lovrFontGetFilter(Font* font) {
@@ -115,37 +225,137 @@ TextureFilter lovrFontGetFilter(Font* font) {
 void lovrFontSetFilter(Font* font, TextureFilter filter) {
   if (font->filter.mode != filter.mode || font->filter.anisotropy != filter.anisotropy) {
     font->filter = filter;
-    lovrTextureSetFilter(font->texture, filter);
+    for (size_t i = 0; i < font->atlas.pages.length; i++) {
+      lovrTextureSetFilter(font->atlas.pages.data[i], filter);
+    }
+  }
+}
+
+// Layouts are cached by string, wrap, and alignment.  Font settings that change the vertices clear
+// the cache, and vertical alignment is applied by the caller using the layout's height.
+const FontLayout* lovrFontLayout(Font* font, const char* str, size_t length, float wrap, HorizontalAlign halign) {
+  uint32_t wrapBits;
+  memcpy(&wrapBits, &wrap, sizeof(wrapBits));
+  uint64_t key[2] = { hash64(str, length), ((uint64_t) halign << 32) | wrapBits };
+  uint64_t hash = hash64(key, sizeof(key));
+  uint64_t index = map_get(&font->layoutMap, hash);
+
+  if (index != MAP_NIL) {
+    FontLayoutEntry* entry = &font->layouts[index];
+    if (entry->length == length && entry->wrap == wrap && entry->halign == halign && !memcmp(entry->string, str, length)) {
+      entry->tick = ++font->layoutTick;
+      return &entry->layout;
+    }
+  }
+
+  float width, lastLineWidth, height;
+  uint32_t lineCount, glyphCount;
+  lovrFontMeasure(font, str, length, wrap, &width, &lastLineWidth, &height, &lineCount, &glyphCount);
+  glyphCount = glyphCount > 0 ? lovrFontRender(font, str, length, wrap, halign) : 0;
+  uint32_t pageCount = (uint32_t) font->atlas.pages.length;
+
+  // Long strings are laid out into scratch memory instead of evicting everything else
+  FontLayoutEntry* entry = &font->scratchLayout;
+  if (glyphCount <= FONT_LAYOUT_MAX_GLYPHS) {
+    if (index != MAP_NIL) {
+      entry = &font->layouts[index];
+    } else {
+      entry = &font->layouts[0];
+      for (uint32_t i = 1; i < FONT_LAYOUT_CACHE_SIZE && entry->string; i++) {
+        if (!font->layouts[i].string || font->layouts[i].tick < entry->tick) {
+          entry = &font->layouts[i];
+        }
+      }
+    }
+
+    if (entry->string) {
+      map_remove(&font->layoutMap, entry->hash);
+      free(entry->string);
+      entry->string = NULL;
+    }
+
+    entry->string = malloc(length + 1);
+    lovrAssert(entry->string, "Out of memory");
+    memcpy(entry->string, str, length);
+    entry->string[length] = '\0';
+    entry->length = length;
+    entry->wrap = wrap;
+    entry->halign = halign;
+    entry->hash = hash;
+    entry->tick = ++font->layoutTick;
+    map_set(&font->layoutMap, hash, entry - font->layouts);
+  }
+
+  if (glyphCount > entry->capacity) {
+    entry->layout.vertices = realloc(entry->layout.vertices, glyphCount * 32 * sizeof(float));
+    lovrAssert(entry->layout.vertices, "Out of memory");
+    entry->capacity = glyphCount;
   }
+
+  if (pageCount > entry->pageCapacity) {
+    entry->layout.pageCounts = realloc(entry->layout.pageCounts, pageCount * sizeof(uint32_t));
+    lovrAssert(entry->layout.pageCounts, "Out of memory");
+    entry->pageCapacity = pageCount;
+  }
+
+  FontLayout* layout = &entry->layout;
+  layout->glyphCount = glyphCount;
+  layout->pageCount = pageCount;
+  layout->height = height;
+
+  // Sort the quads by page so each page can be drawn with a single batch
+  uint32_t* pages = font->renderPages.data;
+  memset(layout->pageCounts, 0, pageCount * sizeof(uint32_t));
+  for (uint32_t i = 0; i < glyphCount; i++) {
+    layout->pageCounts[pages[i]]++;
+  }
+
+  uint32_t offsets[64];
+  uint32_t* offset = pageCount <= 64 ? offsets : malloc(pageCount * sizeof(uint32_t));
+  lovrAssert(offset, "Out of memory");
+  for (uint32_t i = 0, total = 0; i < pageCount; i++) {
+    offset[i] = total;
+    total += layout->pageCounts[i];
+  }
+
+  for (uint32_t i = 0; i < glyphCount; i++) {
+    memcpy(layout->vertices + 32 * offset[pages[i]]++, font->renderVertices.data + 32 * i, 32 * sizeof(float));
+  }
+
+  if (offset != offsets) {
+    free(offset);
+  }
+
+  return layout;
 }
 
-void lovrFontRender(Font* font, const char* str, size_t length, float wrap, HorizontalAlign halign, float* vertices, uint16_t* indices, uint16_t baseVertex) {
+// Lays out quads in string order, along with the atlas page of each quad
+static uint32_t lovrFontRender(Font* font, const char* str, size_t length, float wrap, HorizontalAlign halign) {
   FontAtlas* atlas = &font->atlas;
 
   int height = lovrRasterizerGetHeight(font->rasterizer);
 
   float cx = 0.f;
   float cy = -height * .8f;
-  float u = atlas->width;
-  float v = atlas->height;
+  float u = atlas->size;
+  float v = atlas->size;
   float scale = 1.f / font->pixelDensity;
 
-  const char* start = str;
   const char* end = str + length;
   unsigned int previous = '\0';
   unsigned int codepoint;
   size_t bytes;
 
-  float* vertexCursor = vertices;
-  uint16_t* indexCursor = indices;
-  float* lineStart = vertices;
-  uint16_t I = baseVertex;
+  arr_clear(&font->renderVertices);
+  arr_clear(&font->renderPages);
+  size_t lineStart = 0;
 
   while ((bytes = utf8_decode(str, end, &codepoint)) > 0) {
 
     // Newlines
     if (codepoint == '\n' || (wrap && cx * scale > wrap && (codepoint == ' ' || previous == ' '))) {
-      lineStart = lovrFontAlignLine(lineStart, vertexCursor, cx, halign);
+      float* vertices = font->renderVertices.data;
+      lineStart = lovrFontAlignLine(vertices + lineStart, vertices + font->renderVertices.length, cx, halign) - vertices;
       cx = 0.f;
       cy -= height * font->lineHeight;
       previous = '\0';
@@ -170,12 +380,6 @@ void lovrFontRender(Font* font, const char* str, size_t length, float wrap, Hori
     // Get glyph
     Glyph* glyph = lovrFontGetGlyph(font, codepoint);
 
-    // Start over if texture was repacked
-    if (u != atlas->width || v != atlas->height) {
-      lovrFontRender(font, start, length, wrap, halign, vertices, indices, baseVertex);
-      return;
-    }
-
     // Triangles
     if (glyph->w > 0 && glyph->h > 0) {
       int32_t padding = font->padding;
@@ -195,18 +399,14 @@ void lovrFontRender(Font* font, const char* str, size_t length, float wrap, Hori
         t1 = t2; t2 = tmp;
       }
 
-      memcpy(vertexCursor, (float[32]) {
+      arr_append(&font->renderVertices, ((float[32]) {
         x1, y1, 0.f, 0.f, 0.f, 0.f, s1, t1,
         x1, y2, 0.f, 0.f, 0.f, 0.f, s1, t2,
         x2, y1, 0.f, 0.f, 0.f, 0.f, s2, t1,
         x2, y2, 0.f, 0.f, 0.f, 0.f, s2, t2
-      }, 32 * sizeof(float));
-
-      memcpy(indexCursor, (uint16_t[6]) { I + 0, I + 1, I + 2, I + 2, I + 1, I + 3 }, 6 * sizeof(uint16_t));
+      }), 32);
 
-      vertexCursor += 32;
-      indexCursor += 6;
-      I += 4;
+      arr_push(&font->renderPages, glyph->page);
     }
 
     // Advance cursor
@@ -215,7 +415,9 @@ void lovrFontRender(Font* font, const char* str, size_t length, float wrap, Hori
   }
 
   // Align the last line
-  lovrFontAlignLine(lineStart, vertexCursor, cx, halign);
+  float* vertices = font->renderVertices.data;
+  lovrFontAlignLine(vertices + lineStart, vertices + font->renderVertices.length, cx, halign);
+  return (uint32_t) font->renderPages.length;
 }
 
 void lovrFontMeasure(Font* font, const char* str, size_t length, float wrap, float* width, float* lastLineWidth, float* height, uint32_t* lineCount, uint32_t* glyphCount) {
@@ -255,6 +457,10 @@ float lovrFontGetLineHeight(Font* font) {
 }
 
 void lovrFontSetLineHeight(Font* font, float lineHeight) {
+  if (font->lineHeight != lineHeight) {
+    lovrFontClearLayouts(font);
+  }
+
   font->lineHeight = lineHeight;
 }
 
@@ -263,6 +469,10 @@ bool lovrFontIsFlipEnabled(Font* font) {
 }
 
 void lovrFontSetFlipEnabled(Font* font, bool flip) {
+  if (font->flip != flip) {
+    lovrFontClearLayouts(font);
+  }
+
   font->flip = flip;
 }
 
@@ -288,9 +498,79 @@ void lovrFontSetPixelDensity(Font* font, float pixelDensity) {
     pixelDensity = lovrRasterizerGetHeight(font->rasterizer);
   }
 
+  if (font->pixelDensity != pixelDensity) {
+    lovrFontClearLayouts(font);
+  }
+
   font->pixelDensity = pixelDensity;
 }
 
+static void lovrFontRasterizeGlyphs(void* arg) {
+  GlyphBatch* batch = arg;
+  for (uint32_t i = 0; i < batch->count; i++) {
+    lovrRasterizerLoadGlyph(batch->rasterizer, batch->codepoints[i], batch->padding, batch->spread, &batch->glyphs[i]);
+  }
+}
+
+// Rasterizes the missing glyphs in parallel, one batch per worker plus the calling thread
+void lovrFontPrewarm(Font* font, const uint32_t* codepoints, uint32_t count) {
+  FontAtlas* atlas = &font->atlas;
+  arr_t(uint32_t) missing;
+  arr_init(&missing, arr_alloc);
+  map_t seen;
+  map_init(&seen, 0);
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t hash = hash64(&codepoints[i], sizeof(uint32_t));
+    if (map_get(&atlas->glyphMap, hash) == MAP_NIL && map_get(&seen, hash) == MAP_NIL) {
+      map_set(&seen, hash, 1);
+      arr_push(&missing, codepoints[i]);
+    }
+  }
+
+  map_free(&seen);
+
+  if (missing.length == 0) {
+    arr_free(&missing);
+    return;
+  }
+
+  Glyph* glyphs = calloc(missing.length, sizeof(Glyph));
+  lovrAssert(glyphs, "Out of memory");
+
+  // Rounding the batch size up can leave fewer batches than threads, so the count is recomputed
+  GlyphBatch batches[JOB_MAX_WORKERS + 1];
+  uint32_t total = (uint32_t) missing.length;
+  uint32_t threads = MIN(job_get_worker_count() + 1, total);
+  uint32_t batchSize = (total + threads - 1) / threads;
+  uint32_t batchCount = (total + batchSize - 1) / batchSize;
+
+  for (uint32_t i = 0; i < batchCount; i++) {
+    uint32_t start = i * batchSize;
+    batches[i] = (GlyphBatch) {
+      .rasterizer = font->rasterizer,
+      .codepoints = missing.data + start,
+      .glyphs = glyphs + start,
+      .count = MIN(batchSize, total - start),
+      .padding = font->padding,
+      .spread = font->spread
+    };
+  }
+
+  job_run_all(lovrFontRasterizeGlyphs, batches, sizeof(GlyphBatch), batchCount);
+
+  for (size_t i = 0; i < missing.length; i++) {
+    lovrFontInsertGlyph(font, &glyphs[i]);
+  }
+
+  free(glyphs);
+  arr_free(&missing);
+
+  if (font->cachePath) {
+    lovrFontSaveCache(font);
+  }
+}
+
 static Glyph* lovrFontGetGlyph(Font* font, uint32_t codepoint) {
   FontAtlas* atlas = &font->atlas;
   uint64_t hash = hash64(&codepoint, sizeof(codepoint));
@@ -298,16 +578,24 @@ static Glyph* lovrFontGetGlyph(Font* font, uint32_t codepoint) {
 
   // Add the glyph to the atlas if it isn't there
   if (index == MAP_NIL) {
-    index = atlas->glyphs.length;
-    arr_reserve(&atlas->glyphs, atlas->glyphs.length + 1);
-    lovrRasterizerLoadGlyph(font->rasterizer, codepoint, font->padding, font->spread, &atlas->glyphs.data[atlas->glyphs.length++]);
-    map_set(&atlas->glyphMap, hash, index);
-    lovrFontAddGlyph(font, &atlas->glyphs.data[index]);
+    Glyph glyph;
+    lovrRasterizerLoadGlyph(font->rasterizer, codepoint, font->padding, font->spread, &glyph);
+    return lovrFontInsertGlyph(font, &glyph);
   }
 
   return &atlas->glyphs.data[index];
 }
 
+static Glyph* lovrFontInsertGlyph(Font* font, Glyph* glyph) {
+  FontAtlas* atlas = &font->atlas;
+  uint64_t hash = hash64(&glyph->codepoint, sizeof(glyph->codepoint));
+  uint64_t index = atlas->glyphs.length;
+  arr_push(&atlas->glyphs, *glyph);
+  map_set(&atlas->glyphMap, hash, index);
+  lovrFontAddGlyph(font, &atlas->glyphs.data[index]);
+  return &atlas->glyphs.data[index];
+}
+
 static void lovrFontAddGlyph(Font* font, Glyph* glyph) {
   FontAtlas* atlas = &font->atlas;
 
@@ -316,65 +604,248 @@ static void lovrFontAddGlyph(Font* font, Glyph* glyph) {
     return;
   }
 
+  uint32_t limit = atlas->size - 2 * atlas->padding;
+  lovrAssert(glyph->tw <= limit && glyph->th <= limit, "Glyph %d is too big for the font atlas", glyph->codepoint);
+
   // If the glyph does not fit, you must acquit (new row)
-  if (atlas->x + glyph->tw > atlas->width - 2 * atlas->padding) {
+  if (atlas->x + glyph->tw > limit) {
     atlas->x = atlas->padding;
     atlas->y += atlas->rowHeight + atlas->padding;
     atlas->rowHeight = 0;
   }
 
-  // Expand the texture if needed. Expanding the texture re-adds all the glyphs, so we can return.
-  if (atlas->y + glyph->th > atlas->height - 2 * atlas->padding) {
-    lovrFontExpandTexture(font);
-    return;
+  // Start a new page if the current one is full
+  if (atlas->pages.length == 0 || atlas->y + glyph->th > limit) {
+    lovrFontAddPage(font);
   }
 
   // Keep track of glyph's position in the atlas
+  glyph->page = (uint32_t) atlas->pages.length - 1;
   glyph->x = atlas->x;
   glyph->y = atlas->y;
 
-  // Paste glyph into texture
-  lovrTextureReplacePixels(font->texture, glyph->data, atlas->x, atlas->y, 0, 0);
+  // Pixels are uploaded later, so glyphs added together share an upload
+  arr_push(&atlas->pending, (uint32_t) (glyph - atlas->glyphs.data));
 
   // Advance atlas cursor
   atlas->x += glyph->tw + atlas->padding;
   atlas->rowHeight = MAX(atlas->rowHeight, glyph->th);
 }
 
-static void lovrFontExpandTexture(Font* font) {
+// TODO we only need the Image here to clear the texture, but it's a big waste of memory.
+// Could look into using glClearTexImage when supported to make this more efficient.
+static void lovrFontAddPage(Font* font) {
+  FontAtlas* atlas = &font->atlas;
+  Image* image = lovrImageCreate(atlas->size, atlas->size, NULL, 0x0, FORMAT_RGBA16F);
+  Texture* texture = lovrTextureCreate(TEXTURE_2D, &image, 1, false, false, 0);
+  lovrTextureSetFilter(texture, font->filter);
+  lovrTextureSetWrap(texture, (TextureWrap) { .s = WRAP_CLAMP, .t = WRAP_CLAMP });
+  lovrRelease(image, lovrImageDestroy);
+  arr_push(&atlas->pages, texture);
+  atlas->x = atlas->padding;
+  atlas->y = atlas->padding;
+  atlas->rowHeight = 0;
+}
+
+// Pending glyphs are in packing order, so consecutive glyphs on the same row form one rectangle
+// that contains nothing else.  Each rectangle is composited on the CPU and uploaded once.
+static void lovrFontUploadGlyphs(Font* font) {
   FontAtlas* atlas = &font->atlas;
+  size_t i = 0;
+
+  while (i < atlas->pending.length) {
+    Glyph* first = &atlas->glyphs.data[atlas->pending.data[i]];
+    uint32_t height = first->th;
+    size_t j = i + 1;
+
+    for (; j < atlas->pending.length; j++) {
+      Glyph* glyph = &atlas->glyphs.data[atlas->pending.data[j]];
+      if (glyph->page != first->page || glyph->y != first->y) break;
+      height = MAX(height, glyph->th);
+    }
+
+    Glyph* last = &atlas->glyphs.data[atlas->pending.data[j - 1]];
+    uint32_t width = last->x + last->tw - first->x;
+    Image* image = lovrImageCreate(width, height, NULL, 0x0, FORMAT_RGBA32F);
+    float* pixels = image->blob->data;
+
+    for (size_t k = i; k < j; k++) {
+      Glyph* glyph = &atlas->glyphs.data[atlas->pending.data[k]];
+      if (!glyph->data) continue;
+      float* source = glyph->data->blob->data;
+      for (uint32_t y = 0; y < glyph->th; y++) {
+        memcpy(pixels + 4 * (y * width + glyph->x - first->x), source + 4 * y * glyph->tw, 4 * glyph->tw * sizeof(float));
+      }
+    }
+
+    lovrTextureReplacePixels(atlas->pages.data[first->page], image, first->x, first->y, 0, 0);
+    lovrRelease(image, lovrImageDestroy);
+    i = j;
+  }
+
+  arr_clear(&atlas->pending);
+}
+
+static void lovrFontClearLayouts(Font* font) {
+  for (uint32_t i = 0; i < FONT_LAYOUT_CACHE_SIZE; i++) {
+    free(font->layouts[i].string);
+    font->layouts[i].string = NULL;
+  }
+
+  map_clear(&font->layoutMap);
+}
+
+// Entries are all checked before any of them are used.  A cache with a bad entry (including one
+// that is truncated) is treated as a miss: it's deleted and rebuilt from the glyphs that get used.
+static bool lovrFontCheckCache(Font* font, const char* data, size_t size, uint32_t glyphCount) {
+  FontAtlas* atlas = &font->atlas;
+  uint32_t limit = atlas->size - 2 * atlas->padding;
+  size_t offset = sizeof(FontCacheHeader);
+
+  for (uint32_t i = 0; i < glyphCount; i++) {
+    if (size - offset < sizeof(FontCacheGlyph)) {
+      return false;
+    }
 
-  if (atlas->width == atlas->height) {
-    atlas->width *= 2;
-  } else {
-    atlas->height *= 2;
+    FontCacheGlyph entry;
+    memcpy(&entry, data + offset, sizeof(entry));
+    offset += sizeof(entry);
+
+    if (entry.tw > limit || entry.th > limit) {
+      return false;
+    }
+
+    bool hasPixels = entry.hasPixels && entry.tw > 0 && entry.th > 0;
+    uint64_t pixelSize = hasPixels ? (uint64_t) entry.tw * entry.th * 4 * sizeof(float) : 0;
+    if (pixelSize > size - offset) {
+      return false;
+    }
+
+    offset += pixelSize;
   }
 
-  if (!font->texture) {
+  return offset == size;
+}
+
+static void lovrFontLoadCache(Font* font) {
+  FileInfo info;
+  fs_handle file;
+  if (!fs_stat(font->cachePath, &info) || !fs_open(font->cachePath, OPEN_READ, &file)) {
     return;
   }
 
-  // Recreate the texture
-  lovrFontCreateTexture(font);
+  size_t size = info.size;
+  char* data = malloc(MAX(size, 1));
+  lovrAssert(data, "Out of memory");
+  bool success = fs_read(file, data, &size) && size == info.size;
+  fs_close(file);
+
+  FontCacheHeader header;
+  success = success && size >= sizeof(header);
+  if (success) {
+    memcpy(&header, data, sizeof(header));
+    success = header.magic == FONT_CACHE_MAGIC && header.version == FONT_CACHE_VERSION;
+    success = success && lovrFontCheckCache(font, data, size, header.glyphCount);
+  }
 
-  // Reset the cursor
-  atlas->x = atlas->padding;
-  atlas->y = atlas->padding;
-  atlas->rowHeight = 0;
+  if (!success) {
+    fs_remove(font->cachePath);
+    free(data);
+    return;
+  }
 
-  // Re-pack all the glyphs
-  for (size_t i = 0; i < atlas->glyphs.length; i++) {
-    lovrFontAddGlyph(font, &atlas->glyphs.data[i]);
+  size_t offset = sizeof(header);
+  for (uint32_t i = 0; i < header.glyphCount; i++) {
+    FontCacheGlyph entry;
+    memcpy(&entry, data + offset, sizeof(entry));
+    offset += sizeof(entry);
+
+    bool hasPixels = entry.hasPixels && entry.tw > 0 && entry.th > 0;
+    size_t pixelSize = hasPixels ? (size_t) entry.tw * entry.th * 4 * sizeof(float) : 0;
+
+    uint64_t hash = hash64(&entry.codepoint, sizeof(entry.codepoint));
+    if (map_get(&font->atlas.glyphMap, hash) != MAP_NIL) {
+      offset += pixelSize;
+      continue;
+    }
+
+    Glyph glyph = {
+      .codepoint = entry.codepoint,
+      .w = entry.w,
+      .h = entry.h,
+      .tw = entry.tw,
+      .th = entry.th,
+      .dx = entry.dx,
+      .dy = entry.dy,
+      .advance = entry.advance
+    };
+
+    if (hasPixels) {
+      glyph.data = lovrImageCreate(entry.tw, entry.th, NULL, 0, FORMAT_RGBA32F);
+      memcpy(glyph.data->blob->data, data + offset, pixelSize);
+      offset += pixelSize;
+    }
+
+    lovrFontInsertGlyph(font, &glyph);
   }
+
+  font->cachedGlyphs = (uint32_t) font->atlas.glyphs.length;
+  free(data);
 }
 
-// TODO we only need the Image here to clear the texture, but it's a big waste of memory.
-// Could look into using glClearTexImage when supported to make this more efficient.
-static void lovrFontCreateTexture(Font* font) {
-  lovrRelease(font->texture, lovrTextureDestroy);
-  Image* image = lovrImageCreate(font->atlas.width, font->atlas.height, NULL, 0x0, FORMAT_RGBA16F);
-  font->texture = lovrTextureCreate(TEXTURE_2D, &image, 1, false, false, 0);
-  lovrTextureSetFilter(font->texture, font->filter);
-  lovrTextureSetWrap(font->texture, (TextureWrap) { .s = WRAP_CLAMP, .t = WRAP_CLAMP });
-  lovrRelease(image, lovrImageDestroy);
+static void lovrFontSaveCache(Font* font) {
+  FontAtlas* atlas = &font->atlas;
+  size_t size = sizeof(FontCacheHeader);
+  for (size_t i = 0; i < atlas->glyphs.length; i++) {
+    Glyph* glyph = &atlas->glyphs.data[i];
+    size += sizeof(FontCacheGlyph) + (glyph->data ? glyph->data->blob->size : 0);
+  }
+
+  char* data = malloc(size);
+  lovrAssert(data, "Out of memory");
+  FontCacheHeader header = { FONT_CACHE_MAGIC, FONT_CACHE_VERSION, (uint32_t) atlas->glyphs.length };
+  memcpy(data, &header, sizeof(header));
+
+  size_t offset = sizeof(header);
+  for (size_t i = 0; i < atlas->glyphs.length; i++) {
+    Glyph* glyph = &atlas->glyphs.data[i];
+    FontCacheGlyph entry = {
+      .codepoint = glyph->codepoint,
+      .w = glyph->w,
+      .h = glyph->h,
+      .tw = glyph->tw,
+      .th = glyph->th,
+      .dx = glyph->dx,
+      .dy = glyph->dy,
+      .advance = glyph->advance,
+      .hasPixels = glyph->data != NULL
+    };
+    memcpy(data + offset, &entry, sizeof(entry));
+    offset += sizeof(entry);
+
+    if (glyph->data) {
+      memcpy(data + offset, glyph->data->blob->data, glyph->data->blob->size);
+      offset += glyph->data->blob->size;
+    }
+  }
+
+  char directory[1024];
+  snprintf(directory, sizeof(directory), "%s", font->cachePath);
+  char* slash = strrchr(directory, '/');
+  if (slash) *slash = '\0';
+  fs_mkdir(directory);
+
+  fs_handle file;
+  if (fs_open(font->cachePath, OPEN_WRITE, &file)) {
+    size_t written = size;
+    bool success = fs_write(file, data, &written) && written == size;
+    fs_close(file);
+    if (success) {
+      font->cachedGlyphs = (uint32_t) atlas->glyphs.length;
+    } else {
+      fs_remove(font->cachePath);
+    }
+  }
+
+  free(data);
 }
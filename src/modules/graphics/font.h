@@ -20,14 +20,25 @@ typedef enum {
   ALIGN_BOTTOM
 } VerticalAlign;
 
+// Glyph quads are sorted by atlas page, pageCounts has the number of glyphs on each page
+typedef struct {
+  float* vertices;
+  uint32_t* pageCounts;
+  uint32_t pageCount;
+  uint32_t glyphCount;
+  float height;
+} FontLayout;
+
 typedef struct Font Font;
 Font* lovrFontCreate(struct Rasterizer* rasterizer, uint32_t padding, double spread);
 void lovrFontDestroy(void* ref);
 struct Rasterizer* lovrFontGetRasterizer(Font* font);
-struct Texture* lovrFontGetTexture(Font* font);
+uint32_t lovrFontGetPageCount(Font* font);
+struct Texture* lovrFontGetTexture(Font* font, uint32_t page);
 TextureFilter lovrFontGetFilter(Font* font);
 void lovrFontSetFilter(Font* font, TextureFilter filter);
-void lovrFontRender(Font* font, const char* str, size_t length, float wrap, HorizontalAlign halign, float* vertices, uint16_t* indices, uint16_t baseVertex);
+void lovrFontPrewarm(Font* font, const uint32_t* codepoints, uint32_t count);
+const FontLayout* lovrFontLayout(Font* font, const char* str, size_t length, float wrap, HorizontalAlign halign);
 void lovrFontMeasure(Font* font, const char* string, size_t length, float wrap, float* width, float* lastLineWidth, float* height, uint32_t* lineCount, uint32_t* glyphCount);
 uint32_t lovrFontGetPadding(Font* font);
 double lovrFontGetSpread(Font* font);
@@ -1,6 +1,7 @@
 #include "graphics/graphics.h"
 #include "graphics/buffer.h"
 #include "graphics/canvas.h"
+#include "graphics/drawList.h"
 #include "graphics/material.h"
 #include "graphics/mesh.h"
 #include "graphics/shader.h"
@@ -10,24 +11,19 @@
 #include "math/math.h"
 #include "core/maf.h"
 #include "core/os.h"
+#include "core/profile.h"
 #include "util.h"
 #include <stdlib.h>
 #include <string.h>
+#include <float.h>
 #include <math.h>
 
 #define MAX_TRANSFORMS 64
 #define MAX_BATCHES 4
 #define MAX_DRAWS 256
-
-typedef enum {
-  STREAM_VERTEX,
-  STREAM_DRAWID,
-  STREAM_INDEX,
-  STREAM_MODEL,
-  STREAM_COLOR,
-  STREAM_FRAME,
-  MAX_STREAMS
-} StreamType;
+#define STREAM_REGIONS 3
+#define MAX_STREAM_VERTICES (1 << 20)
+#define MAX_STREAM_INDICES (1 << 22)
 
 typedef enum {
   BATCH_POINTS,
@@ -52,7 +48,7 @@ typedef union {
   struct { int segments; } sphere;
   struct { float spread; } text;
   struct { float u; float v; float w; float h; } fill;
-  struct { uint32_t rangeStart; uint32_t rangeCount; uint32_t instances; float* pose; } mesh;
+  struct { uint32_t rangeStart; uint32_t rangeCount; uint32_t instances; Buffer* pose; uint32_t poseOffset; bool recordedPose; InstanceData instanceData; } mesh;
 } BatchParams;
 
 typedef struct {
@@ -68,8 +64,8 @@ typedef struct {
   uint32_t vertexCount;
   uint32_t indexCount;
   float** vertices;
-  uint16_t** indices;
-  uint16_t* baseVertex;
+  uint32_t** indices;
+  uint32_t* baseVertex;
   bool instanced;
 } BatchRequest;
 
@@ -82,22 +78,55 @@ typedef struct {
   Color* colors;
   uint32_t drawStart;
   uint32_t drawCount;
+  uint32_t lastDraw;
+  uint32_t segment;
+  uint64_t key;
   bool indexed;
 } Batch;
 
+// In deferred mode, transforms and colors are kept on the CPU until the batches are sorted
+typedef struct {
+  float transform[16];
+  Color color;
+  uint32_t prev;
+} BatchDraw;
+
 typedef struct {
   float viewMatrix[2][16];
   float projection[2][16];
 } FrameData;
 
+// While a DrawList is recording, the stream cursors are swapped with its own and stream data is
+// written to CPU memory.  When recording ends, the data is uploaded to static buffers.  Poses are
+// copied too, since the pose buffers of Models are rewritten whenever they're posed again.
+struct DrawList {
+  uint32_t ref;
+  arr_t(uint8_t) data[MAX_STREAMS];
+  arr_t(float) poses;
+  Buffer* poseBuffer;
+  uint32_t head[MAX_STREAMS];
+  uint32_t tail[MAX_STREAMS];
+  Buffer* buffers[MAX_STREAMS];
+  Mesh* mesh;
+  Mesh* instancedMesh;
+  arr_t(Batch) batches;
+  uint32_t drawSlots;
+  float parent[16];
+  bool deferred;
+};
+
 static struct {
   bool initialized;
   bool debug;
+  char* shaderCache;
+  char* fontCache;
   int width;
   int height;
   Canvas* backbuffer;
   FrameData frameData;
   bool frameDataDirty;
+  float viewProjection[2][16];
+  bool viewProjectionDirty;
   Canvas* defaultCanvas;
   Shader* defaultShaders[MAX_DEFAULT_SHADERS][2];
   Material* defaultMaterial;
@@ -117,16 +146,27 @@ static struct {
   Mesh* mesh;
   Mesh* instancedMesh;
   Buffer* identityBuffer;
+  Buffer* identityPose;
   Buffer* buffers[MAX_STREAMS];
   uint32_t head[MAX_STREAMS];
   uint32_t tail[MAX_STREAMS];
-  Batch batches[MAX_BATCHES];
-  uint8_t batchCount;
+  uint32_t region[MAX_STREAMS];
+  uint32_t capacity[MAX_STREAMS];
+  bool persistent;
+  arr_t(Batch) batches;
+  arr_t(BatchDraw) draws;
+  map_t batchMap;
+  uint32_t segment;
+  bool deferred;
+  DrawList* recording;
+  FlushReason flushReason;
+  BatchBreakCallback onBatchBreak;
+  void* batchBreakUserdata;
 } state;
 
 static const uint32_t bufferCount[] = {
-  [STREAM_VERTEX] = (1 << 16) - 1,
-  [STREAM_DRAWID] = (1 << 16) - 1,
+  [STREAM_VERTEX] = 1 << 16,
+  [STREAM_DRAWID] = 1 << 16,
   [STREAM_INDEX] = 1 << 16,
 #if defined(LOVR_WEBGL) // Work around bugs where big UBOs don't work
   [STREAM_MODEL] = MAX_DRAWS,
@@ -135,16 +175,18 @@ static const uint32_t bufferCount[] = {
   [STREAM_MODEL] = MAX_DRAWS * MAX_BATCHES,
   [STREAM_COLOR] = MAX_DRAWS * MAX_BATCHES,
 #endif
-  [STREAM_FRAME] = 4
+  [STREAM_FRAME] = 4,
+  [STREAM_INSTANCE] = 1 << 16
 };
 
 static const size_t bufferStride[] = {
   [STREAM_VERTEX] = 8 * sizeof(float),
   [STREAM_DRAWID] = sizeof(uint8_t),
-  [STREAM_INDEX] = sizeof(uint16_t),
+  [STREAM_INDEX] = sizeof(uint32_t),
   [STREAM_MODEL] = 16 * sizeof(float),
   [STREAM_COLOR] = 4 * sizeof(float),
-  [STREAM_FRAME] = sizeof(FrameData)
+  [STREAM_FRAME] = sizeof(FrameData),
+  [STREAM_INSTANCE] = 4 * sizeof(float)
 };
 
 static const BufferType bufferType[] = {
@@ -153,7 +195,8 @@ static const BufferType bufferType[] = {
   [STREAM_INDEX] = BUFFER_INDEX,
   [STREAM_MODEL] = BUFFER_UNIFORM,
   [STREAM_COLOR] = BUFFER_UNIFORM,
-  [STREAM_FRAME] = BUFFER_UNIFORM
+  [STREAM_FRAME] = BUFFER_UNIFORM,
+  [STREAM_INSTANCE] = BUFFER_VERTEX
 };
 
 static void gammaCorrect(Color* color) {
@@ -174,23 +217,125 @@ static void onResizeWindow(int width, int height) {
   lovrEventPush((Event) { .type = EVENT_RESIZE, .data.resize = { width, height } });
 }
 
+// Persistent streams are split into regions, each the size of a regular stream.  Stream cursors
+// are relative to the current region.  When a region fills up, or at the end of the frame, it's
+// fenced and writes move on to the next region once the GPU is done with it.
+static uint32_t lovrGraphicsGetBase(StreamType type) {
+  return state.region[type] * state.capacity[type];
+}
+
+static void lovrGraphicsNextRegion(StreamType type) {
+  Buffer* buffer = state.buffers[type];
+  size_t size = state.capacity[type] * bufferStride[type];
+  lovrBufferLock(buffer, state.region[type] * size, size);
+  state.region[type] = (state.region[type] + 1) % STREAM_REGIONS;
+  lovrBufferUnlock(buffer, state.region[type] * size, size);
+  state.tail[type] = 0;
+  state.head[type] = 0;
+}
+
 static void* lovrGraphicsMapBuffer(StreamType type, uint32_t count) {
-  lovrAssert(count <= bufferCount[type], "Whoa there!  Tried to get %d elements from a buffer that only has %d elements.", count, bufferCount[type]);
+  if (state.recording) {
+    arr_reserve(&state.recording->data[type], (state.head[type] + count) * bufferStride[type]);
+    return state.recording->data[type].data + state.head[type] * bufferStride[type];
+  }
+
+  lovrAssert(count <= state.capacity[type], "Whoa there!  Tried to get %d elements from a buffer that only has %d elements.", count, state.capacity[type]);
+  lovrGpuGetStats()->streamBytes[type] += count * bufferStride[type];
+
+  if (state.head[type] + count > state.capacity[type]) {
+    lovrAssert(state.batches.length == 0, "Internal error: Batches still exist during Buffer reset");
+    if (state.persistent) {
+      lovrGraphicsNextRegion(type);
+    } else {
+      lovrBufferDiscard(state.buffers[type]);
+      state.tail[type] = 0;
+      state.head[type] = 0;
+    }
+  }
+
+  return lovrBufferMap(state.buffers[type], (lovrGraphicsGetBase(type) + state.head[type]) * bufferStride[type], true);
+}
+
+static void lovrGraphicsCreateStreamMeshes(Buffer* vertexBuffer, Buffer* drawIdBuffer, Mesh** mesh, Mesh** instancedMesh) {
+  size_t stride = bufferStride[STREAM_VERTEX];
+
+  MeshAttribute position = { .buffer = vertexBuffer, .offset = 0, .stride = stride, .type = F32, .components = 3 };
+  MeshAttribute normal = { .buffer = vertexBuffer, .offset = 12, .stride = stride, .type = F32, .components = 3 };
+  MeshAttribute texCoord = { .buffer = vertexBuffer, .offset = 24, .stride = stride, .type = F32, .components = 2 };
+  MeshAttribute drawId = { .buffer = drawIdBuffer, .type = U8, .components = 1 };
+  MeshAttribute identity = { .buffer = state.identityBuffer, .type = U8, .components = 1, .divisor = 1 };
+
+  *mesh = lovrMeshCreate(DRAW_TRIANGLES, NULL, 0);
+  lovrMeshAttachAttribute(*mesh, "lovrPosition", &position);
+  lovrMeshAttachAttribute(*mesh, "lovrNormal", &normal);
+  lovrMeshAttachAttribute(*mesh, "lovrTexCoord", &texCoord);
+  lovrMeshAttachAttribute(*mesh, "lovrDrawID", &drawId);
+
+  *instancedMesh = lovrMeshCreate(DRAW_TRIANGLES, NULL, 0);
+  lovrMeshAttachAttribute(*instancedMesh, "lovrPosition", &position);
+  lovrMeshAttachAttribute(*instancedMesh, "lovrNormal", &normal);
+  lovrMeshAttachAttribute(*instancedMesh, "lovrTexCoord", &texCoord);
+  lovrMeshAttachAttribute(*instancedMesh, "lovrDrawID", &identity);
+}
+
+static Buffer* lovrGraphicsCreateStream(StreamType type) {
+  size_t size = state.capacity[type] * bufferStride[type];
+  if (state.persistent) {
+    return lovrBufferCreatePersistent(STREAM_REGIONS * size, bufferType[type]);
+  } else {
+    return lovrBufferCreate(size, NULL, bufferType[type], USAGE_STREAM, false);
+  }
+}
+
+// Streams grow to the next power of two when a single request doesn't fit in them.  The old
+// buffers are still referenced by batches and the stream meshes, so everything is flushed first.
+static void lovrGraphicsGrowStream(StreamType type, uint32_t count) {
+  while (state.capacity[type] < count) state.capacity[type] <<= 1;
+  lovrRelease(state.buffers[type], lovrBufferDestroy);
+  state.buffers[type] = lovrGraphicsCreateStream(type);
+  state.region[type] = 0;
+  state.head[type] = 0;
+  state.tail[type] = 0;
+}
+
+static void lovrGraphicsGrowStreams(uint32_t vertexCount, uint32_t indexCount) {
+  lovrAssert(vertexCount <= MAX_STREAM_VERTICES, "Whoa there!  Tried to stream %d vertices, but the limit is %d", vertexCount, MAX_STREAM_VERTICES);
+  lovrAssert(indexCount <= MAX_STREAM_INDICES, "Whoa there!  Tried to stream %d indices, but the limit is %d", indexCount, MAX_STREAM_INDICES);
+  state.flushReason = FLUSH_STREAM;
+  lovrGraphicsFlush();
 
-  if (state.head[type] + count > bufferCount[type]) {
-    lovrAssert(state.batchCount == 0, "Internal error: Batches still exist during Buffer reset");
-    lovrBufferDiscard(state.buffers[type]);
-    state.tail[type] = 0;
-    state.head[type] = 0;
+  bool remesh = vertexCount > state.capacity[STREAM_VERTEX];
+
+  for (StreamType type = STREAM_VERTEX; type <= STREAM_INDEX; type++) {
+    uint32_t count = type == STREAM_INDEX ? indexCount : vertexCount;
+    if (count > state.capacity[type]) {
+      lovrGraphicsGrowStream(type, count);
+    }
   }
 
-  return lovrBufferMap(state.buffers[type], state.head[type] * bufferStride[type], true);
+  if (remesh) {
+    lovrRelease(state.mesh, lovrMeshDestroy);
+    lovrRelease(state.instancedMesh, lovrMeshDestroy);
+    lovrGraphicsCreateStreamMeshes(state.buffers[STREAM_VERTEX], state.buffers[STREAM_DRAWID], &state.mesh, &state.instancedMesh);
+  }
 }
 
 // Base
 
-bool lovrGraphicsInit(bool debug) {
+static char* copyPath(const char* path) {
+  if (!path) return NULL;
+  size_t length = strlen(path);
+  char* copy = malloc(length + 1);
+  lovrAssert(copy, "Out of memory");
+  memcpy(copy, path, length + 1);
+  return copy;
+}
+
+bool lovrGraphicsInit(bool debug, const char* shaderCache, const char* fontCache) {
   state.debug = debug;
+  state.shaderCache = copyPath(shaderCache);
+  state.fontCache = copyPath(fontCache);
   return false; // See lovrGraphicsCreateWindow for actual initialization
 }
 
@@ -209,15 +354,31 @@ void lovrGraphicsDestroy() {
   lovrRelease(state.mesh, lovrMeshDestroy);
   lovrRelease(state.instancedMesh, lovrMeshDestroy);
   lovrRelease(state.identityBuffer, lovrBufferDestroy);
+  lovrRelease(state.identityPose, lovrBufferDestroy);
   lovrRelease(state.defaultMaterial, lovrMaterialDestroy);
   lovrRelease(state.defaultFont, lovrFontDestroy);
   lovrRelease(state.defaultCanvas, lovrCanvasDestroy);
+  arr_free(&state.batches);
+  arr_free(&state.draws);
+  map_free(&state.batchMap);
   lovrGpuDestroy();
+  free(state.shaderCache);
+  free(state.fontCache);
   memset(&state, 0, sizeof(state));
 }
 
 void lovrGraphicsPresent() {
   lovrGraphicsFlush();
+
+  if (state.persistent) {
+    for (int i = 0; i < MAX_STREAMS; i++) {
+      if (state.head[i] > 0) {
+        lovrGraphicsNextRegion(i);
+      }
+    }
+    state.frameDataDirty = true;
+  }
+
   os_window_swap();
   lovrGpuPresent();
 }
@@ -243,13 +404,15 @@ void lovrGraphicsCreateWindow(WindowFlags* flags) {
   os_on_quit(onQuitRequest);
   os_on_resize(onResizeWindow);
   os_window_get_fbsize(&state.width, &state.height);
-  lovrGpuInit(os_get_gl_proc_address, state.debug);
+  lovrGpuInit(os_get_gl_proc_address, state.debug, state.shaderCache);
 
   state.defaultCanvas = lovrCanvasCreateFromHandle(state.width, state.height, (CanvasFlags) { .stereo = false }, 0, 0, 0, 1, true);
   state.backbuffer = state.defaultCanvas;
 
+  state.persistent = lovrGpuGetFeatures()->persistent;
   for (int i = 0; i < MAX_STREAMS; i++) {
-    state.buffers[i] = lovrBufferCreate(bufferCount[i] * bufferStride[i], NULL, bufferType[i], USAGE_STREAM, false);
+    state.capacity[i] = bufferCount[i];
+    state.buffers[i] = lovrGraphicsCreateStream(i);
   }
 
   // The identity buffer is used for autoinstanced meshes and instanced primitives and maps the
@@ -260,26 +423,19 @@ void lovrGraphicsCreateWindow(WindowFlags* flags) {
   lovrBufferFlush(state.identityBuffer, 0, MAX_DRAWS);
   lovrBufferUnmap(state.identityBuffer);
 
-  Buffer* vertexBuffer = state.buffers[STREAM_VERTEX];
-  size_t stride = bufferStride[STREAM_VERTEX];
-
-  MeshAttribute position = { .buffer = vertexBuffer, .offset = 0, .stride = stride, .type = F32, .components = 3 };
-  MeshAttribute normal = { .buffer = vertexBuffer, .offset = 12, .stride = stride, .type = F32, .components = 3 };
-  MeshAttribute texCoord = { .buffer = vertexBuffer, .offset = 24, .stride = stride, .type = F32, .components = 2 };
-  MeshAttribute drawId = { .buffer = state.buffers[STREAM_DRAWID], .type = U8, .components = 1 };
-  MeshAttribute identity = { .buffer = state.identityBuffer, .type = U8, .components = 1, .divisor = 1 };
+  // Draws without a skin use identity joint matrices
+  size_t poseSize = MAX_BONES * 16 * sizeof(float);
+  state.identityPose = lovrBufferCreate(poseSize, NULL, BUFFER_UNIFORM, USAGE_STATIC, false);
+  float* pose = lovrBufferMap(state.identityPose, 0, true);
+  for (int i = 0; i < MAX_BONES; i++) mat4_identity(pose + 16 * i);
+  lovrBufferFlush(state.identityPose, 0, poseSize);
+  lovrBufferUnmap(state.identityPose);
 
-  state.mesh = lovrMeshCreate(DRAW_TRIANGLES, NULL, 0);
-  lovrMeshAttachAttribute(state.mesh, "lovrPosition", &position);
-  lovrMeshAttachAttribute(state.mesh, "lovrNormal", &normal);
-  lovrMeshAttachAttribute(state.mesh, "lovrTexCoord", &texCoord);
-  lovrMeshAttachAttribute(state.mesh, "lovrDrawID", &drawId);
+  lovrGraphicsCreateStreamMeshes(state.buffers[STREAM_VERTEX], state.buffers[STREAM_DRAWID], &state.mesh, &state.instancedMesh);
 
-  state.instancedMesh = lovrMeshCreate(DRAW_TRIANGLES, NULL, 0);
-  lovrMeshAttachAttribute(state.instancedMesh, "lovrPosition", &position);
-  lovrMeshAttachAttribute(state.instancedMesh, "lovrNormal", &normal);
-  lovrMeshAttachAttribute(state.instancedMesh, "lovrTexCoord", &texCoord);
-  lovrMeshAttachAttribute(state.instancedMesh, "lovrDrawID", &identity);
+  arr_init(&state.batches, arr_alloc);
+  arr_init(&state.draws, arr_alloc);
+  map_init(&state.batchMap, 64);
 
   lovrGraphicsReset();
   state.initialized = true;
@@ -336,6 +492,7 @@ void lovrGraphicsSetViewMatrix(uint32_t index, float* viewMatrix) {
     mat4_identity(state.frameData.viewMatrix[index]);
   }
   state.frameDataDirty = true;
+  state.viewProjectionDirty = true;
 }
 
 void lovrGraphicsGetProjection(uint32_t index, float* projection) {
@@ -354,6 +511,7 @@ void lovrGraphicsSetProjection(uint32_t index, float* projection) {
     mat4_perspective(state.frameData.projection[index], .01f, 100.f, fov, aspect);
   }
   state.frameDataDirty = true;
+  state.viewProjectionDirty = true;
 }
 
 Buffer* lovrGraphicsGetIdentityBuffer() {
@@ -376,6 +534,7 @@ void lovrGraphicsReset() {
   lovrGraphicsSetColorMask(true, true, true, true);
   lovrGraphicsSetCullingEnabled(false);
   lovrGraphicsSetDefaultFilter((TextureFilter) { .mode = FILTER_TRILINEAR });
+  lovrGraphicsSetDeferred(false);
   lovrGraphicsSetDepthTest(COMPARE_LEQUAL, true);
   lovrGraphicsSetFont(NULL);
   lovrGraphicsSetLineWidth(1.f);
@@ -421,10 +580,16 @@ Canvas* lovrGraphicsGetCanvas() {
 }
 
 void lovrGraphicsSetCanvas(Canvas* canvas) {
+  // The canvas must be flushed because if someone uses its textures to do a draw there is no way
+  // to know that using that Texture requires the Canvas' batches to be flushed.  The backbuffer is
+  // flushed too, so all of the batches in a flush draw to the same canvas and sorting them never
+  // moves a draw across a canvas switch.
+  Canvas* target = state.canvas ? state.canvas : state.backbuffer;
+  if ((canvas ? canvas : state.backbuffer) != target) {
+    lovrGraphicsFlushCanvas(target);
+  }
+
   if (state.canvas && canvas != state.canvas) {
-    // The canvas must be flushed because if someone uses its textures to do a draw there is no way
-    // to know that using that Texture requires the Canvas' batches to be flushed.
-    lovrGraphicsFlushCanvas(state.canvas);
     lovrCanvasResolve(state.canvas);
   }
 
@@ -469,6 +634,18 @@ void lovrGraphicsSetDefaultFilter(TextureFilter filter) {
   state.defaultFilter = filter;
 }
 
+bool lovrGraphicsIsDeferred() {
+  return state.deferred;
+}
+
+void lovrGraphicsSetDeferred(bool deferred) {
+  lovrAssert(!state.recording, "Deferred mode can not be changed while recording a DrawList");
+  if (state.deferred != deferred) {
+    lovrGraphicsFlush();
+    state.deferred = deferred;
+  }
+}
+
 void lovrGraphicsGetDepthTest(CompareMode* mode, bool* write) {
   *mode = state.pipeline.depthTest;
   *write = state.pipeline.depthWrite;
@@ -587,13 +764,218 @@ void lovrGraphicsMatrixTransform(mat4 transform) {
 
 // Rendering
 
+// Bounds are culled when all 8 corners are outside the same clip plane in every view.  DrawLists
+// are drawn later with a different camera, so nothing is culled while recording.
+bool lovrGraphicsCull(float bounds[6], mat4 transform) {
+  if (state.recording) {
+    return false;
+  }
+
+  if (state.viewProjectionDirty) {
+    for (int i = 0; i < 2; i++) {
+      mat4_mul(mat4_init(state.viewProjection[i], state.frameData.projection[i]), state.frameData.viewMatrix[i]);
+    }
+    state.viewProjectionDirty = false;
+  }
+
+  Canvas* canvas = state.canvas ? state.canvas : state.backbuffer;
+  int viewCount = lovrCanvasIsStereo(canvas) ? 2 : 1;
+
+  for (int i = 0; i < viewCount; i++) {
+    float m[16];
+    mat4_init(m, state.viewProjection[i]);
+    mat4_mul(m, state.transforms[state.transform]);
+    mat4_mul(m, transform);
+
+    uint8_t outside = 0x3f;
+    for (int j = 0; j < 8; j++) {
+      float x = bounds[0 + ((j >> 0) & 1)];
+      float y = bounds[2 + ((j >> 1) & 1)];
+      float z = bounds[4 + ((j >> 2) & 1)];
+      float cx = x * m[0] + y * m[4] + z * m[8] + m[12];
+      float cy = x * m[1] + y * m[5] + z * m[9] + m[13];
+      float cz = x * m[2] + y * m[6] + z * m[10] + m[14];
+      float cw = x * m[3] + y * m[7] + z * m[11] + m[15];
+      outside &= (cx < -cw) << 0 | (cx > cw) << 1 | (cy < -cw) << 2 | (cy > cw) << 3 | (cz < -cw) << 4 | (cz > cw) << 5;
+    }
+
+    if (!outside) {
+      return false;
+    }
+  }
+
+  lovrGpuGetStats()->culledDraws++;
+  return true;
+}
+
+// Returns the largest fraction of the viewport height covered by the bounding sphere of the bounds
+// in any view, for picking a level of detail.  DrawLists being recorded always get full detail.
+float lovrGraphicsGetProjectedSize(float bounds[6], mat4 transform) {
+  if (state.recording) {
+    return FLT_MAX;
+  }
+
+  float center[4] = { (bounds[0] + bounds[1]) * .5f, (bounds[2] + bounds[3]) * .5f, (bounds[4] + bounds[5]) * .5f, 1.f };
+  float extent[4] = { bounds[1] - bounds[0], bounds[3] - bounds[2], bounds[5] - bounds[4] };
+  float radius = vec3_length(extent) * .5f;
+
+  Canvas* canvas = state.canvas ? state.canvas : state.backbuffer;
+  int viewCount = lovrCanvasIsStereo(canvas) ? 2 : 1;
+  float size = 0.f;
+
+  for (int i = 0; i < viewCount; i++) {
+    float m[16];
+    mat4_init(m, state.frameData.viewMatrix[i]);
+    mat4_mul(m, state.transforms[state.transform]);
+    mat4_mul(m, transform);
+
+    float scale = MAX(m[0] * m[0] + m[1] * m[1] + m[2] * m[2], m[4] * m[4] + m[5] * m[5] + m[6] * m[6]);
+    scale = sqrtf(MAX(scale, m[8] * m[8] + m[9] * m[9] + m[10] * m[10]));
+    float p[4] = { center[0], center[1], center[2], 1.f };
+    mat4_transform(m, p);
+
+    float* projection = state.frameData.projection[i];
+    float depth = -p[2];
+    float r = radius * scale;
+
+    // Perspective projections have a zero in the last column
+    if (projection[15] != 0.f) {
+      size = MAX(size, r * projection[5]);
+    } else if (depth <= r) {
+      return FLT_MAX;
+    } else {
+      size = MAX(size, r * projection[5] / depth);
+    }
+  }
+
+  return size;
+}
+
+// Called whenever a draw has to start a new batch (excluding the first batch after a flush)
+void lovrGraphicsSetBatchBreakCallback(BatchBreakCallback callback, void* userdata) {
+  state.onBatchBreak = callback;
+  state.batchBreakUserdata = userdata;
+}
+
+static bool lovrGraphicsBatchMatches(Batch* b, BatchRequest* req, Mesh* mesh, Canvas* canvas, Shader* shader, Material* material, Pipeline* pipeline) {
+  return
+    b->type == req->type &&
+    b->drawCount < MAX_DRAWS &&
+    b->draw.mesh == mesh &&
+    b->draw.canvas == canvas &&
+    b->draw.shader == shader &&
+    b->material == material &&
+    !memcmp(&b->draw.pipeline, pipeline, sizeof(Pipeline)) &&
+    !memcmp(&b->params, &req->params, sizeof(BatchParams));
+}
+
+// Only called when a draw couldn't join a batch, so it doesn't need to be fast
+static BatchBreak lovrGraphicsGetBatchBreak(Batch* b, BatchRequest* req, Mesh* mesh, Canvas* canvas, Shader* shader, Material* material, Pipeline* pipeline) {
+  if (b->type != req->type) return BREAK_TYPE;
+  if (b->drawCount >= MAX_DRAWS) return BREAK_FULL;
+  if (b->draw.mesh != mesh) return BREAK_MESH;
+  if (b->draw.canvas != canvas) return BREAK_CANVAS;
+  if (b->draw.shader != shader) return BREAK_SHADER;
+  if (b->material != material) return BREAK_MATERIAL;
+  if (b->draw.pipeline.blendMode != pipeline->blendMode || b->draw.pipeline.blendAlphaMode != pipeline->blendAlphaMode) return BREAK_BLEND;
+  if (memcmp(&b->draw.pipeline, pipeline, sizeof(Pipeline))) return BREAK_PIPELINE;
+  if (memcmp(&b->params, &req->params, sizeof(BatchParams))) return BREAK_PARAMS;
+  return BREAK_ORDER;
+}
+
+// Draws can't be reordered when blending is on or depth test is off
+static bool lovrGraphicsCanReorder(Pipeline* pipeline) {
+  return pipeline->blendMode == BLEND_NONE && pipeline->depthTest != COMPARE_NONE;
+}
+
+static uint64_t lovrGraphicsHashBatch(BatchRequest* req, Mesh* mesh, Canvas* canvas, Shader* shader, Material* material, Pipeline* pipeline) {
+  struct {
+    BatchType type;
+    BatchParams params;
+    Mesh* mesh;
+    Canvas* canvas;
+    Shader* shader;
+    Material* material;
+    Pipeline pipeline;
+  } key;
+
+  memset(&key, 0, sizeof(key));
+  key.type = req->type;
+  key.params = req->params;
+  key.mesh = mesh;
+  key.canvas = canvas;
+  key.shader = shader;
+  key.material = material;
+  key.pipeline = *pipeline;
+  return hash64(&key, sizeof(key));
+}
+
+// Sort key, from most to least significant: shader, material, pipeline/mesh, depth.  The canvas
+// isn't part of it because changing the canvas flushes (see lovrGraphicsSetCanvas).  Only the
+// ordering of bits within each field matters, so the objects are hashed to fit.
+static uint64_t lovrGraphicsGetBatchKey(Batch* batch, float* transform) {
+  uint64_t shader = hash64(&batch->draw.shader, sizeof(Shader*)) & 0xffff;
+  uint64_t material = hash64(&batch->material, sizeof(Material*)) & 0xffff;
+  uint64_t pipeline = (hash64(&batch->draw.pipeline, sizeof(Pipeline)) ^ hash64(&batch->draw.mesh, sizeof(Mesh*))) & 0xffff;
+
+  // Positive floats sort the same way as their bits, so the top half of them works as a depth key
+  float* view = state.frameData.viewMatrix[0];
+  float depth = -(view[2] * transform[12] + view[6] * transform[13] + view[10] * transform[14] + view[14]);
+  union { float f; uint32_t u; } bits = { MAX(depth, 0.f) };
+
+  return shader << 48 | material << 32 | pipeline << 16 | bits.u >> 16;
+}
+
+static int lovrGraphicsCompareBatches(const void* a, const void* b) {
+  uint64_t x = ((const Batch*) a)->key;
+  uint64_t y = ((const Batch*) b)->key;
+  return (x > y) - (x < y);
+}
+
+static Shader* lovrGraphicsGetDefaultShader(DefaultShader type, bool stereo) {
+  if (!state.defaultShaders[type][stereo]) {
+    state.defaultShaders[type][stereo] = lovrShaderCreateDefault(type, NULL, 0, stereo, false);
+  }
+
+  return state.defaultShaders[type][stereo];
+}
+
+// Starts compiling every default shader that hasn't been created yet, returns whether they're done
+bool lovrGraphicsWarmShaders() {
+  for (int i = 0; i < MAX_DEFAULT_SHADERS; i++) {
+    for (int stereo = 0; stereo < 2; stereo++) {
+      if (!state.defaultShaders[i][stereo]) {
+        state.defaultShaders[i][stereo] = lovrShaderCreateDefault(i, NULL, 0, stereo, true);
+      }
+    }
+  }
+
+  bool ready = true;
+  for (int i = 0; i < MAX_DEFAULT_SHADERS; i++) {
+    ready &= lovrShaderIsReady(state.defaultShaders[i][false]);
+    ready &= lovrShaderIsReady(state.defaultShaders[i][true]);
+  }
+  return ready;
+}
+
+const char* lovrGraphicsGetFontCache() {
+  return state.fontCache;
+}
+
 static void lovrGraphicsBatch(BatchRequest* req) {
+  PROFILE_BEGIN("Batch");
+
+  // Make sure the request fits in the streams (DrawLists record to the CPU and have no limit)
+  if (!state.recording && (req->vertexCount > state.capacity[STREAM_VERTEX] || req->indexCount > state.capacity[STREAM_INDEX])) {
+    lovrGraphicsGrowStreams(req->vertexCount, req->indexCount);
+  }
 
   // Resolve objects
   Mesh* mesh = req->mesh ? req->mesh : (req->instanced ? state.instancedMesh : state.mesh);
   Canvas* canvas = state.canvas ? state.canvas : state.backbuffer;
   bool stereo = lovrCanvasIsStereo(canvas);
-  Shader* shader = state.shader ? state.shader : (state.defaultShaders[req->shader][stereo] ? state.defaultShaders[req->shader][stereo] : (state.defaultShaders[req->shader][stereo] = lovrShaderCreateDefault(req->shader, NULL, 0, stereo)));
+  Shader* shader = state.shader ? state.shader : lovrGraphicsGetDefaultShader(req->shader, stereo);
+  shader = lovrShaderIsReady(shader) ? shader : lovrGraphicsGetDefaultShader(req->shader, stereo);
   Pipeline* pipeline = req->pipeline ? req->pipeline : &state.pipeline;
   Material* material = req->material ? req->material : (state.defaultMaterial ? state.defaultMaterial : (state.defaultMaterial = lovrMaterialCreate()));
 
@@ -605,37 +987,57 @@ static void lovrGraphicsBatch(BatchRequest* req) {
     }
   }
 
-  if (lovrShaderHasUniform(shader, "lovrPose")) {
-    if (req->type == BATCH_MESH && req->params.mesh.pose) {
-      lovrShaderSetMatrices(shader, "lovrPose", req->params.mesh.pose, 0, MAX_BONES * 16);
-    } else {
-      lovrShaderSetMatrices(shader, "lovrPose", (float[]) MAT4_IDENTITY, 0, 16);
+  // Try to find an existing batch to use.  If there isn't one, figure out why the draw couldn't
+  // join the most recent batch (or the one with the same state, when deferred).
+  Batch* batch = NULL;
+  Batch* last = state.batches.length > 0 ? &state.batches.data[state.batches.length - 1] : NULL;
+  BatchBreak reason = MAX_BATCH_BREAKS;
+  uint64_t hash = 0;
+  if (req->type == BATCH_MESH && (req->params.mesh.instances > 1 || req->params.mesh.instanceData.count > 0)) {
+    reason = BREAK_INSTANCED;
+  } else if (state.deferred) {
+
+    // Any open batch in the current segment can be used.  Vertices of a batch have to be
+    // contiguous, so streaming batches can only be extended if nothing was streamed after them.
+    hash = lovrGraphicsHashBatch(req, mesh, canvas, shader, material, pipeline);
+    uint64_t index = map_get(&state.batchMap, hash);
+    Batch* b = index == MAP_NIL ? NULL : &state.batches.data[index];
+    if (b && b->segment == state.segment && lovrGraphicsBatchMatches(b, req, mesh, canvas, shader, material, pipeline)) {
+      StreamType stream = b->indexed ? STREAM_INDEX : STREAM_VERTEX;
+      if (req->instanced || b->draw.rangeStart + b->draw.rangeCount == state.head[stream]) {
+        batch = b;
+      } else {
+        reason = BREAK_STREAM;
+      }
+    } else if (b && b->segment != state.segment) {
+      reason = BREAK_ORDER;
+    } else if (b || last) {
+      reason = lovrGraphicsGetBatchBreak(b ? b : last, req, mesh, canvas, shader, material, pipeline);
+    }
+  } else {
+    for (int i = (int) state.batches.length - 1; i >= 0; i--) {
+      Batch* b = &state.batches.data[i];
+      if (lovrGraphicsBatchMatches(b, req, mesh, canvas, shader, material, pipeline)) {
+        batch = b;
+        break;
+      }
+
+      if (b == last) {
+        reason = lovrGraphicsGetBatchBreak(b, req, mesh, canvas, shader, material, pipeline);
+      }
+
+      // Draws can't be reordered when either of the batches are streaming their vertices (since
+      // the vertices of a batch must be contiguous)
+      if (!lovrGraphicsCanReorder(&b->draw.pipeline) || !lovrGraphicsCanReorder(pipeline)) { break; }
+      if (!req->instanced) { break; }
     }
   }
 
-  // Try to find an existing batch to use
-  Batch* batch = NULL;
-  for (int i = state.batchCount - 1; i >= 0; i--) {
-    if (req->type == BATCH_MESH && req->params.mesh.instances > 1) { break; }
-
-    Batch* b = &state.batches[i];
-    if (b->type != req->type) { goto next; }
-    if (b->drawCount >= MAX_DRAWS) { goto next; }
-    if (b->draw.mesh != mesh) { goto next; }
-    if (b->draw.canvas != canvas) { goto next; }
-    if (b->draw.shader != shader) { goto next; }
-    if (b->material != material) { goto next; }
-    if (memcmp(&b->draw.pipeline, pipeline, sizeof(Pipeline))) { goto next; }
-    if (memcmp(&b->params, &req->params, sizeof(BatchParams))) { goto next; }
-    batch = b;
-    break;
-
-next:
-    // Draws can't be reordered when blending is on, depth test is off, or either of the batches
-    // are streaming their vertices (since the vertices of a batch must be contiguous)
-    if (b->draw.pipeline.blendMode != BLEND_NONE || pipeline->blendMode != BLEND_NONE) { break; }
-    if (b->draw.pipeline.depthTest == COMPARE_NONE || pipeline->depthTest == COMPARE_NONE) { break; }
-    if (!req->instanced) { break; }
+  if (!batch && last && reason != MAX_BATCH_BREAKS && !state.recording) {
+    lovrGpuGetStats()->batchBreaks[reason]++;
+    if (state.onBatchBreak) {
+      state.onBatchBreak(state.batchBreakUserdata, reason);
+    }
   }
 
   // The final draw id isn't known until the batch is fully resolved and all the potential flushes
@@ -648,17 +1050,25 @@ next:
   //   instanced batch or any element of a stream batch) and any of the ranges go past the end.
   // - If a new batch is required but there isn't space for it, flush to make space.
   // - If a new batch is required, make sure there is space for the matrix/color UBO streams.
+  //   Deferred batches don't write to the UBO streams until they're flushed.
   // It's important to flush before mapping any streams, because flushing unmaps all streams.
-  bool needFlush = false;
+  FlushReason flush = MAX_FLUSH_REASONS;
   bool hasVertices = req->vertexCount > 0 && (!req->instanced || !batch);
   bool hasIndices = hasVertices && req->indexCount > 0;
-  needFlush = needFlush || (hasVertices && state.head[STREAM_VERTEX] + req->vertexCount > bufferCount[STREAM_VERTEX]);
-  needFlush = needFlush || (hasVertices && state.head[STREAM_DRAWID] + req->vertexCount > bufferCount[STREAM_DRAWID]);
-  needFlush = needFlush || (hasIndices && state.head[STREAM_INDEX] + req->indexCount > bufferCount[STREAM_INDEX]);
-  needFlush = needFlush || (!batch && state.batchCount >= MAX_BATCHES);
-  needFlush = needFlush || (!batch && state.head[STREAM_MODEL] + MAX_DRAWS > bufferCount[STREAM_MODEL]);
-  needFlush = needFlush || (!batch && state.head[STREAM_COLOR] + MAX_DRAWS > bufferCount[STREAM_COLOR]);
-  if (needFlush) lovrGraphicsFlush();
+  if (!state.recording) {
+    if (hasVertices && state.head[STREAM_VERTEX] + req->vertexCount > state.capacity[STREAM_VERTEX]) flush = FLUSH_STREAM;
+    if (hasVertices && state.head[STREAM_DRAWID] + req->vertexCount > state.capacity[STREAM_DRAWID]) flush = FLUSH_STREAM;
+    if (hasIndices && state.head[STREAM_INDEX] + req->indexCount > state.capacity[STREAM_INDEX]) flush = FLUSH_STREAM;
+  }
+  if (!state.deferred && !batch && flush == MAX_FLUSH_REASONS) {
+    if (state.batches.length >= MAX_BATCHES) flush = FLUSH_BATCHES;
+    if (state.head[STREAM_MODEL] + MAX_DRAWS > state.capacity[STREAM_MODEL]) flush = FLUSH_DRAWS;
+    if (state.head[STREAM_COLOR] + MAX_DRAWS > state.capacity[STREAM_COLOR]) flush = FLUSH_DRAWS;
+  }
+  if (flush != MAX_FLUSH_REASONS) {
+    state.flushReason = flush;
+    lovrGraphicsFlush();
+  }
 
   if (req->vertexCount > 0 && (!req->instanced || !batch)) {
     *(req->vertices) = lovrGraphicsMapBuffer(STREAM_VERTEX, req->vertexCount);
@@ -671,9 +1081,29 @@ next:
   }
 
   // Start a new batch
-  if (!batch || state.batchCount == 0) {
-    float* transforms = lovrGraphicsMapBuffer(STREAM_MODEL, MAX_DRAWS);
-    Color* colors = lovrGraphicsMapBuffer(STREAM_COLOR, MAX_DRAWS);
+  if (!batch || state.batches.length == 0) {
+    float* transforms = NULL;
+    Color* colors = NULL;
+
+    if (state.deferred) {
+
+      // Batches that can't be reordered get their own segment, which also acts as a barrier that
+      // stops any later batches from being sorted in front of them
+      bool reorder = lovrGraphicsCanReorder(pipeline);
+      if (state.batches.length > 0) {
+        Batch* last = &state.batches.data[state.batches.length - 1];
+        state.segment += !reorder || !lovrGraphicsCanReorder(&last->draw.pipeline);
+      }
+
+      if (hash == 0) {
+        hash = lovrGraphicsHashBatch(req, mesh, canvas, shader, material, pipeline);
+      }
+
+      map_set(&state.batchMap, hash, state.batches.length);
+    } else {
+      transforms = lovrGraphicsMapBuffer(STREAM_MODEL, MAX_DRAWS);
+      colors = lovrGraphicsMapBuffer(STREAM_COLOR, MAX_DRAWS);
+    }
 
     uint32_t rangeStart, rangeCount, instances;
     if (req->type == BATCH_MESH) {
@@ -686,7 +1116,8 @@ next:
       instances = 0;
     }
 
-    batch = &state.batches[state.batchCount++];
+    arr_expand(&state.batches, 1);
+    batch = &state.batches.data[state.batches.length++];
     *batch = (Batch) {
       .type = req->type,
       .params = req->params,
@@ -698,30 +1129,52 @@ next:
         .topology = req->topology,
         .rangeStart = rangeStart,
         .rangeCount = rangeCount,
-        .instances = instances
+        .instances = instances,
+        .instanceData = req->type == BATCH_MESH ? req->params.mesh.instanceData : (InstanceData) { 0 }
       },
       .material = material,
       .transforms = transforms,
       .colors = colors,
       .drawStart = state.head[STREAM_MODEL],
+      .segment = state.segment,
       .indexed = req->indexCount > 0
     };
 
-    state.head[STREAM_MODEL] += MAX_DRAWS;
-    state.head[STREAM_COLOR] += MAX_DRAWS;
+    if (!state.deferred) {
+      state.head[STREAM_MODEL] += MAX_DRAWS;
+      state.head[STREAM_COLOR] += MAX_DRAWS;
+    }
+  } else {
+    lovrGpuGetStats()->mergedBatches++;
+  }
+
+  float* transform;
+  Color* color;
+  if (state.deferred) {
+    arr_expand(&state.draws, 1);
+    BatchDraw* draw = &state.draws.data[state.draws.length];
+    draw->prev = batch->drawCount > 0 ? batch->lastDraw : ~0u;
+    batch->lastDraw = (uint32_t) state.draws.length++;
+    transform = draw->transform;
+    color = &draw->color;
+  } else {
+    transform = &batch->transforms[16 * batch->drawCount];
+    color = &batch->colors[batch->drawCount];
   }
 
   // Transform
   if (req->transform) {
-    float transform[16];
     mat4_mul(mat4_init(transform, state.transforms[state.transform]), req->transform);
-    memcpy(&batch->transforms[16 * batch->drawCount], transform, 16 * sizeof(float));
   } else {
-    memcpy(&batch->transforms[16 * batch->drawCount], state.transforms[state.transform], 16 * sizeof(float));
+    mat4_init(transform, state.transforms[state.transform]);
+  }
+
+  if (state.deferred && batch->drawCount == 0) {
+    batch->key = lovrGraphicsGetBatchKey(batch, transform);
   }
 
   // Color
-  batch->colors[batch->drawCount] = state.linearColor;
+  *color = state.linearColor;
 
   // Cursors
   if (!req->instanced || batch->drawCount == 0) {
@@ -740,72 +1193,234 @@ next:
   }
 
   batch->drawCount++;
+  PROFILE_END();
+}
+
+// Batches from a DrawList use its buffers and meshes instead of the streams
+static void lovrGraphicsSubmit(Batch* batch, DrawList* list) {
+  Buffer** buffers = list ? list->buffers : state.buffers;
+  Mesh* mesh = list ? list->mesh : state.mesh;
+  Mesh* instancedMesh = list ? list->instancedMesh : state.instancedMesh;
+  uint32_t indexCount = list ? list->head[STREAM_INDEX] : STREAM_REGIONS * state.capacity[STREAM_INDEX];
+  uint32_t drawStart = batch->drawStart + (list ? 0 : lovrGraphicsGetBase(STREAM_MODEL));
+  uint32_t frame = lovrGraphicsGetBase(STREAM_FRAME) + state.head[STREAM_FRAME] - 1;
+  GpuStats* stats = lovrGpuGetStats();
+  stats->submittedBatches++;
+  stats->submittedDraws += batch->drawCount;
+
+  // Uniforms
+  lovrMaterialBind(batch->material, batch->draw.shader);
+  lovrShaderSetBlock(batch->draw.shader, "lovrModelBlock", buffers[STREAM_MODEL], drawStart * bufferStride[STREAM_MODEL], MAX_DRAWS * bufferStride[STREAM_MODEL], ACCESS_READ);
+  lovrShaderSetBlock(batch->draw.shader, "lovrColorBlock", buffers[STREAM_COLOR], drawStart * bufferStride[STREAM_COLOR], MAX_DRAWS * bufferStride[STREAM_COLOR], ACCESS_READ);
+  lovrShaderSetBlock(batch->draw.shader, "lovrFrameBlock", state.buffers[STREAM_FRAME], frame * bufferStride[STREAM_FRAME], bufferStride[STREAM_FRAME], ACCESS_READ);
+  if (batch->type == BATCH_MESH && batch->params.mesh.pose) {
+    lovrShaderSetBlock(batch->draw.shader, "lovrPoseBlock", batch->params.mesh.pose, batch->params.mesh.poseOffset, MAX_BONES * 16 * sizeof(float), ACCESS_READ);
+  } else {
+    lovrShaderSetBlock(batch->draw.shader, "lovrPoseBlock", state.identityPose, 0, MAX_BONES * 16 * sizeof(float), ACCESS_READ);
+  }
+  if (batch->type == BATCH_TEXT) {
+    Texture* texture = lovrMaterialGetTexture(batch->material, TEXTURE_DIFFUSE);
+    uint32_t width = lovrTextureGetWidth(texture, 0);
+    uint32_t height = lovrTextureGetHeight(texture, 0);
+    float range[2] = { batch->params.text.spread / width, batch->params.text.spread / height };
+    lovrShaderSetFloats(batch->draw.shader, "lovrSdfRange", range, 0, 2);
+  }
+  if (batch->draw.topology == DRAW_POINTS) {
+    lovrShaderSetFloats(batch->draw.shader, "lovrPointSize", &state.pointSize, 0, 1);
+  }
+
+  // Other bindings (TODO try to get rid of all this!)
+  if (batch->type == BATCH_MESH) {
+    lovrMeshSetAttributeEnabled(batch->draw.mesh, "lovrDrawID", batch->params.mesh.instances <= 1);
+  } else {
+    if (batch->draw.mesh == instancedMesh && batch->draw.instances <= 1) {
+      batch->draw.mesh = mesh;
+    }
+
+    // Streamed ranges are relative to the current region
+    if (!list) {
+      batch->draw.rangeStart += lovrGraphicsGetBase(batch->indexed ? STREAM_INDEX : STREAM_VERTEX);
+      batch->draw.baseVertex = batch->indexed ? lovrGraphicsGetBase(STREAM_VERTEX) : 0;
+    }
+
+    if (batch->indexed) {
+      lovrMeshSetIndexBuffer(batch->draw.mesh, buffers[STREAM_INDEX], indexCount, sizeof(uint32_t), 0);
+    } else {
+      lovrMeshSetIndexBuffer(batch->draw.mesh, NULL, 0, 0, 0);
+    }
+  }
+
+  lovrGpuDraw(&batch->draw);
 }
 
-void lovrGraphicsFlush() {
-  if (state.batchCount == 0) {
-    return;
+static void lovrGraphicsSortBatches(Batch* batches, size_t count) {
+  for (size_t i = 0, j = 1; i < count; i = j++) {
+    while (j < count && batches[j].segment == batches[i].segment) j++;
+    qsort(batches + i, j - i, sizeof(Batch), lovrGraphicsCompareBatches);
   }
+}
 
-  // Prevent infinite flushing >_>
-  int batchCount = state.batchCount;
-  state.batchCount = 0;
+static void lovrGraphicsWriteDraws(Batch* batch, float* transforms, Color* colors) {
+  uint32_t index = batch->drawCount;
+  for (uint32_t d = batch->lastDraw; index > 0; d = state.draws.data[d].prev) {
+    BatchDraw* draw = &state.draws.data[d];
+    index--;
+    memcpy(transforms + 16 * index, draw->transform, 16 * sizeof(float));
+    colors[index] = draw->color;
+  }
+}
 
+static void lovrGraphicsWriteFrameData() {
   if (state.frameDataDirty) {
     state.frameDataDirty = false;
     void* data = lovrGraphicsMapBuffer(STREAM_FRAME, 1);
     memcpy(data, &state.frameData, sizeof(FrameData));
     state.head[STREAM_FRAME]++;
   }
+}
 
-  // Flush buffers
-  for (int i = 0; i < MAX_STREAMS; i++) {
-    lovrBufferFlush(state.buffers[i], state.tail[i] * bufferStride[i], (state.head[i] - state.tail[i]) * bufferStride[i]);
-    lovrBufferUnmap(state.buffers[i]);
-    state.tail[i] = state.head[i];
-  }
+// Deferred batches are sorted within each segment, then their transforms and colors are packed
+// into the UBO streams.  Batches still bind a full MAX_DRAWS window, but windows are allowed to
+// overlap, so a round keeps going until the next window would run off the end of the stream.
+static void lovrGraphicsFlushDeferred(Batch* batches, size_t count) {
+  lovrGraphicsSortBatches(batches, count);
+
+  uint32_t align = MAX(lovrGpuGetLimits()->blockAlign / (uint32_t) bufferStride[STREAM_COLOR], 1);
+
+  for (size_t b = 0; b < count;) {
+    size_t start = b;
+    float* transforms = lovrGraphicsMapBuffer(STREAM_MODEL, MAX_DRAWS);
+    Color* colors = lovrGraphicsMapBuffer(STREAM_COLOR, MAX_DRAWS);
+    uint32_t base = state.head[STREAM_MODEL];
+
+    while (b < count && state.head[STREAM_MODEL] + MAX_DRAWS <= state.capacity[STREAM_MODEL]) {
+      Batch* batch = &batches[b++];
+      batch->drawStart = state.head[STREAM_MODEL];
 
-  for (int b = 0; b < batchCount; b++) {
-    Batch* batch = &state.batches[b];
-
-    // Uniforms
-    lovrMaterialBind(batch->material, batch->draw.shader);
-    lovrShaderSetBlock(batch->draw.shader, "lovrModelBlock", state.buffers[STREAM_MODEL], batch->drawStart * bufferStride[STREAM_MODEL], MAX_DRAWS * bufferStride[STREAM_MODEL], ACCESS_READ);
-    lovrShaderSetBlock(batch->draw.shader, "lovrColorBlock", state.buffers[STREAM_COLOR], batch->drawStart * bufferStride[STREAM_COLOR], MAX_DRAWS * bufferStride[STREAM_COLOR], ACCESS_READ);
-    lovrShaderSetBlock(batch->draw.shader, "lovrFrameBlock", state.buffers[STREAM_FRAME], (state.head[STREAM_FRAME] - 1) * bufferStride[STREAM_FRAME], bufferStride[STREAM_FRAME], ACCESS_READ);
-    if (batch->type == BATCH_TEXT) {
-      Texture* texture = lovrMaterialGetTexture(batch->material, TEXTURE_DIFFUSE);
-      uint32_t width = lovrTextureGetWidth(texture, 0);
-      uint32_t height = lovrTextureGetHeight(texture, 0);
-      float range[2] = { batch->params.text.spread / width, batch->params.text.spread / height };
-      lovrShaderSetFloats(batch->draw.shader, "lovrSdfRange", range, 0, 2);
+      uint32_t offset = batch->drawStart - base;
+      lovrGraphicsWriteDraws(batch, transforms + 16 * offset, colors + offset);
+
+      uint32_t advance = (uint32_t) ALIGN(batch->drawCount, align);
+      state.head[STREAM_MODEL] += advance;
+      state.head[STREAM_COLOR] += advance;
     }
-    if (batch->draw.topology == DRAW_POINTS) {
-      lovrShaderSetFloats(batch->draw.shader, "lovrPointSize", &state.pointSize, 0, 1);
+
+    for (int i = STREAM_MODEL; i <= STREAM_COLOR; i++) {
+      lovrBufferFlush(state.buffers[i], state.tail[i] * bufferStride[i], (state.head[i] - state.tail[i]) * bufferStride[i]);
+      lovrBufferUnmap(state.buffers[i]);
+      state.tail[i] = state.head[i];
     }
 
-    // Other bindings (TODO try to get rid of all this!)
-    if (batch->type == BATCH_MESH) {
-      lovrMeshSetAttributeEnabled(batch->draw.mesh, "lovrDrawID", batch->params.mesh.instances <= 1);
+    for (size_t i = start; i < b; i++) {
+      lovrGraphicsSubmit(&batches[i], NULL);
+    }
+  }
+
+  arr_clear(&state.draws);
+  map_clear(&state.batchMap);
+  state.segment = 0;
+}
+
+// Recorded batches are sorted and packed the same way as deferred batches, but they go into the
+// DrawList's memory.  The default material is shared and its texture changes from draw to draw,
+// so batches using it get a copy.
+static void lovrGraphicsFlushRecording(Batch* batches, size_t count) {
+  DrawList* list = state.recording;
+  lovrGraphicsSortBatches(batches, count);
+
+  uint32_t align = MAX(lovrGpuGetLimits()->blockAlign / (uint32_t) bufferStride[STREAM_COLOR], 1);
+
+  for (size_t b = 0; b < count; b++) {
+    Batch* batch = &batches[b];
+    batch->drawStart = state.head[STREAM_MODEL];
+
+    arr_reserve(&list->data[STREAM_MODEL], (batch->drawStart + MAX_DRAWS) * bufferStride[STREAM_MODEL]);
+    arr_reserve(&list->data[STREAM_COLOR], (batch->drawStart + MAX_DRAWS) * bufferStride[STREAM_COLOR]);
+    float* transforms = (float*) list->data[STREAM_MODEL].data + 16 * batch->drawStart;
+    Color* colors = (Color*) list->data[STREAM_COLOR].data + batch->drawStart;
+    memset(transforms, 0, MAX_DRAWS * bufferStride[STREAM_MODEL]);
+    memset(colors, 0, MAX_DRAWS * bufferStride[STREAM_COLOR]);
+    lovrGraphicsWriteDraws(batch, transforms, colors);
+
+    uint32_t advance = (uint32_t) ALIGN(batch->drawCount, align);
+    state.head[STREAM_MODEL] += advance;
+    state.head[STREAM_COLOR] += advance;
+    list->drawSlots = batch->drawStart + MAX_DRAWS;
+
+    if (batch->material == state.defaultMaterial) {
+      Material* material = lovrMaterialCreate();
+      lovrMaterialSetTexture(material, TEXTURE_DIFFUSE, lovrMaterialGetTexture(state.defaultMaterial, TEXTURE_DIFFUSE));
+      batch->material = material;
     } else {
-      if (batch->draw.mesh == state.instancedMesh && batch->draw.instances <= 1) {
-        batch->draw.mesh = state.mesh;
-      }
+      lovrRetain(batch->material);
+    }
 
-      if (batch->indexed) {
-        lovrMeshSetIndexBuffer(batch->draw.mesh, state.buffers[STREAM_INDEX], bufferCount[STREAM_INDEX], sizeof(uint16_t), 0);
-      } else {
-        lovrMeshSetIndexBuffer(batch->draw.mesh, NULL, 0, 0, 0);
-      }
+    if (batch->draw.mesh != state.mesh && batch->draw.mesh != state.instancedMesh) {
+      lovrRetain(batch->draw.mesh);
     }
 
-    lovrGpuDraw(&batch->draw);
+    if (batch->type == BATCH_MESH) {
+      lovrRetain(batch->params.mesh.pose);
+      lovrRetain(batch->draw.instanceData.transforms);
+      lovrRetain(batch->draw.instanceData.colors);
+    }
+
+    lovrRetain(batch->draw.shader);
+    arr_push(&list->batches, *batch);
   }
+
+  arr_clear(&state.draws);
+  map_clear(&state.batchMap);
+  state.segment = 0;
+}
+
+// Callers that flush for a specific reason set state.flushReason first, it's reset afterwards
+void lovrGraphicsFlush() {
+  FlushReason reason = state.flushReason;
+  state.flushReason = FLUSH_STATE;
+
+  if (state.batches.length == 0) {
+    return;
+  }
+
+  // Prevent infinite flushing >_>
+  size_t batchCount = state.batches.length;
+  Batch* batches = state.batches.data;
+  arr_clear(&state.batches);
+
+  if (state.recording) {
+    lovrGraphicsFlushRecording(batches, batchCount);
+    return;
+  }
+
+  lovrGpuGetStats()->flushes[reason]++;
+  PROFILE_BEGIN("Flush");
+  lovrGpuBeginZone("Flush");
+  lovrGraphicsWriteFrameData();
+
+  // Flush buffers
+  for (int i = 0; i < MAX_STREAMS; i++) {
+    lovrBufferFlush(state.buffers[i], state.tail[i] * bufferStride[i], (state.head[i] - state.tail[i]) * bufferStride[i]);
+    lovrBufferUnmap(state.buffers[i]);
+    state.tail[i] = state.head[i];
+  }
+
+  if (state.deferred) {
+    lovrGraphicsFlushDeferred(batches, batchCount);
+  } else {
+    for (size_t b = 0; b < batchCount; b++) {
+      lovrGraphicsSubmit(&batches[b], NULL);
+    }
+  }
+
+  lovrGpuEndZone();
+  PROFILE_END();
 }
 
 void lovrGraphicsFlushCanvas(Canvas* canvas) {
-  for (int i = state.batchCount - 1; i >= 0; i--) {
-    if (state.batches[i].draw.canvas == canvas) {
+  for (size_t i = 0; i < state.batches.length; i++) {
+    if (state.batches.data[i].draw.canvas == canvas) {
+      state.flushReason = FLUSH_CANVAS;
       lovrGraphicsFlush();
       return;
     }
@@ -813,8 +1428,9 @@ void lovrGraphicsFlushCanvas(Canvas* canvas) {
 }
 
 void lovrGraphicsFlushShader(Shader* shader) {
-  for (int i = state.batchCount - 1; i >= 0; i--) {
-    if (state.batches[i].draw.shader == shader) {
+  for (size_t i = 0; i < state.batches.length; i++) {
+    if (state.batches.data[i].draw.shader == shader) {
+      state.flushReason = FLUSH_SHADER;
       lovrGraphicsFlush();
       return;
     }
@@ -822,8 +1438,9 @@ void lovrGraphicsFlushShader(Shader* shader) {
 }
 
 void lovrGraphicsFlushMaterial(Material* material) {
-  for (int i = state.batchCount - 1; i >= 0; i--) {
-    if (state.batches[i].material == material) {
+  for (size_t i = 0; i < state.batches.length; i++) {
+    if (state.batches.data[i].material == material) {
+      state.flushReason = FLUSH_MATERIAL;
       lovrGraphicsFlush();
       return;
     }
@@ -831,15 +1448,191 @@ void lovrGraphicsFlushMaterial(Material* material) {
 }
 
 void lovrGraphicsFlushMesh(Mesh* mesh) {
-  for (int i = state.batchCount - 1; i >= 0; i--) {
-    if (state.batches[i].draw.mesh == mesh) {
+  for (size_t i = 0; i < state.batches.length; i++) {
+    if (state.batches.data[i].draw.mesh == mesh) {
+      state.flushReason = FLUSH_MESH;
       lovrGraphicsFlush();
       return;
     }
   }
 }
 
+void lovrGraphicsFlushPose(Buffer* pose) {
+  for (size_t i = 0; i < state.batches.length; i++) {
+    Batch* batch = &state.batches.data[i];
+    if (batch->type == BATCH_MESH && batch->params.mesh.pose == pose) {
+      state.flushReason = FLUSH_MESH;
+      lovrGraphicsFlush();
+      return;
+    }
+  }
+}
+
+static void lovrGraphicsSwapCursors(DrawList* list) {
+  for (int i = 0; i < MAX_STREAMS; i++) {
+    uint32_t head = state.head[i];
+    uint32_t tail = state.tail[i];
+    state.head[i] = list->head[i];
+    state.tail[i] = list->tail[i];
+    list->head[i] = head;
+    list->tail[i] = tail;
+  }
+}
+
+void lovrGraphicsBeginDrawList() {
+  lovrAssert(!state.recording, "A DrawList is already being recorded");
+  lovrGraphicsFlush();
+
+  DrawList* list = calloc(1, sizeof(DrawList));
+  lovrAssert(list, "Out of memory");
+  list->ref = 1;
+  for (int i = 0; i < MAX_STREAMS; i++) {
+    arr_init(&list->data[i], arr_alloc);
+  }
+  arr_init(&list->batches, arr_alloc);
+  arr_init(&list->poses, arr_alloc);
+  mat4_identity(list->parent);
+
+  // Recording always uses deferred batching, since transforms have to stay on the CPU
+  list->deferred = state.deferred;
+  state.deferred = true;
+  state.recording = list;
+  lovrGraphicsSwapCursors(list);
+}
+
+DrawList* lovrGraphicsEndDrawList() {
+  DrawList* list = state.recording;
+  lovrAssert(list, "No DrawList is being recorded");
+  lovrGraphicsFlush();
+  lovrGraphicsSwapCursors(list);
+  state.deferred = list->deferred;
+  state.recording = NULL;
+
+  // The recorded transforms are kept around so the DrawList can be drawn with a parent transform
+  for (int i = 0; i < MAX_STREAMS; i++) {
+    uint32_t count = (i == STREAM_MODEL || i == STREAM_COLOR) ? list->drawSlots : list->head[i];
+
+    if (count > 0) {
+      BufferUsage usage = i == STREAM_MODEL ? USAGE_DYNAMIC : USAGE_STATIC;
+      list->buffers[i] = lovrBufferCreate(count * bufferStride[i], list->data[i].data, bufferType[i], usage, false);
+    }
+
+    if (i != STREAM_MODEL) {
+      arr_free(&list->data[i]);
+      arr_init(&list->data[i], arr_alloc);
+    }
+  }
+
+  if (list->poses.length > 0) {
+    list->poseBuffer = lovrBufferCreate(list->poses.length * sizeof(float), list->poses.data, BUFFER_UNIFORM, USAGE_STATIC, false);
+    arr_free(&list->poses);
+    arr_init(&list->poses, arr_alloc);
+  }
+
+  if (list->buffers[STREAM_VERTEX]) {
+    lovrGraphicsCreateStreamMeshes(list->buffers[STREAM_VERTEX], list->buffers[STREAM_DRAWID], &list->mesh, &list->instancedMesh);
+  }
+
+  for (size_t i = 0; i < list->batches.length; i++) {
+    Batch* batch = &list->batches.data[i];
+    if (batch->draw.mesh == state.mesh) {
+      batch->draw.mesh = list->mesh;
+    } else if (batch->draw.mesh == state.instancedMesh) {
+      batch->draw.mesh = list->instancedMesh;
+    }
+
+    if (batch->type == BATCH_MESH && batch->params.mesh.recordedPose) {
+      batch->params.mesh.pose = list->poseBuffer;
+      lovrRetain(list->poseBuffer);
+    }
+  }
+
+  return list;
+}
+
+void lovrDrawListDestroy(void* ref) {
+  DrawList* list = ref;
+  for (size_t i = 0; i < list->batches.length; i++) {
+    Batch* batch = &list->batches.data[i];
+    if (batch->draw.mesh != list->mesh && batch->draw.mesh != list->instancedMesh) {
+      lovrRelease(batch->draw.mesh, lovrMeshDestroy);
+    }
+    if (batch->type == BATCH_MESH) {
+      lovrRelease(batch->params.mesh.pose, lovrBufferDestroy);
+      lovrRelease(batch->draw.instanceData.transforms, lovrBufferDestroy);
+      lovrRelease(batch->draw.instanceData.colors, lovrBufferDestroy);
+    }
+    lovrRelease(batch->draw.shader, lovrShaderDestroy);
+    lovrRelease(batch->material, lovrMaterialDestroy);
+  }
+  for (int i = 0; i < MAX_STREAMS; i++) {
+    lovrRelease(list->buffers[i], lovrBufferDestroy);
+    arr_free(&list->data[i]);
+  }
+  lovrRelease(list->mesh, lovrMeshDestroy);
+  lovrRelease(list->instancedMesh, lovrMeshDestroy);
+  lovrRelease(list->poseBuffer, lovrBufferDestroy);
+  arr_free(&list->batches);
+  arr_free(&list->poses);
+  free(list);
+}
+
+// Replaying a DrawList only binds its buffers and issues draws.  The canvas is the one that's
+// active when it's drawn, and default shaders are swapped for the stereo variant if needed.
+void lovrDrawListDraw(DrawList* list, float* transform) {
+  lovrAssert(!state.recording, "DrawLists can not be drawn while recording a DrawList");
+  lovrGraphicsFlush();
+
+  float parent[16];
+  mat4_init(parent, state.transforms[state.transform]);
+  if (transform) {
+    mat4_mul(parent, transform);
+  }
+
+  // Transforms only need to be rewritten when the parent transform changes
+  if (list->buffers[STREAM_MODEL] && memcmp(parent, list->parent, sizeof(parent))) {
+    Buffer* buffer = list->buffers[STREAM_MODEL];
+    float* recorded = (float*) list->data[STREAM_MODEL].data;
+    lovrBufferDiscard(buffer);
+    float* transforms = lovrBufferMap(buffer, 0, true);
+    for (uint32_t i = 0; i < list->drawSlots; i++) {
+      mat4_mul(mat4_init(transforms + 16 * i, parent), recorded + 16 * i);
+    }
+    lovrBufferFlush(buffer, 0, list->drawSlots * bufferStride[STREAM_MODEL]);
+    lovrBufferUnmap(buffer);
+    mat4_init(list->parent, parent);
+  }
+
+  lovrGraphicsWriteFrameData();
+  lovrBufferFlush(state.buffers[STREAM_FRAME], state.tail[STREAM_FRAME] * bufferStride[STREAM_FRAME], (state.head[STREAM_FRAME] - state.tail[STREAM_FRAME]) * bufferStride[STREAM_FRAME]);
+  lovrBufferUnmap(state.buffers[STREAM_FRAME]);
+  state.tail[STREAM_FRAME] = state.head[STREAM_FRAME];
+
+  Canvas* canvas = state.canvas ? state.canvas : state.backbuffer;
+  bool stereo = lovrCanvasIsStereo(canvas);
+
+  for (size_t i = 0; i < list->batches.length; i++) {
+    Batch batch = list->batches.data[i];
+    batch.draw.canvas = canvas;
+
+    for (int j = 0; j < MAX_DEFAULT_SHADERS; j++) {
+      if (batch.draw.shader == state.defaultShaders[j][!stereo]) {
+        batch.draw.shader = lovrGraphicsGetDefaultShader(j, stereo);
+        break;
+      }
+    }
+
+    lovrGraphicsSubmit(&batch, list);
+  }
+}
+
+uint32_t lovrDrawListGetBatchCount(DrawList* list) {
+  return (uint32_t) list->batches.length;
+}
+
+// These act on the canvas immediately, so they can't be recorded into a DrawList
 void lovrGraphicsClear(Color* color, float* depth, int* stencil) {
+  lovrAssert(!state.recording, "Canvases can not be cleared while recording a DrawList");
 #if !defined(LOVR_WEBGL)
   if (color) gammaCorrect(color);
 #endif
@@ -848,23 +1641,48 @@ void lovrGraphicsClear(Color* color, float* depth, int* stencil) {
 }
 
 void lovrGraphicsDiscard(bool color, bool depth, bool stencil) {
+  lovrAssert(!state.recording, "Canvases can not be discarded while recording a DrawList");
   if (color || depth || stencil) lovrGraphicsFlush();
   lovrGpuDiscard(state.canvas ? state.canvas : state.backbuffer, color, depth, stencil);
 }
 
-void lovrGraphicsPoints(uint32_t count, float** vertices) {
+void lovrGraphicsStencil(StencilAction action, int replaceValue, StencilCallback callback, void* userdata) {
+  lovrAssert(!state.recording, "Stencil can not be used while recording a DrawList");
+  lovrGpuStencil(action, replaceValue, callback, userdata);
+}
+
+void lovrGraphicsCompute(Shader* shader, int x, int y, int z) {
+  lovrAssert(!state.recording, "Compute shaders can not be run while recording a DrawList");
+  lovrGpuCompute(shader, x, y, z);
+}
+
+// Points and lines can be split up instead of growing the streams.  These return the number of
+// vertices that were mapped, and the caller keeps drawing until everything is written.  Line
+// chunks share their first vertex with the last vertex of the previous chunk.
+uint32_t lovrGraphicsPoints(uint32_t count, float** vertices) {
+  if (!state.recording) {
+    count = MIN(count, state.capacity[STREAM_VERTEX]);
+  }
+
   lovrGraphicsBatch(&(BatchRequest) {
     .type = BATCH_POINTS,
     .topology = DRAW_POINTS,
     .vertexCount = count,
     .vertices = vertices
   });
+
+  return count;
 }
 
-void lovrGraphicsLine(uint32_t count, float** vertices) {
+uint32_t lovrGraphicsLine(uint32_t count, float** vertices) {
+  if (!state.recording) {
+    uint32_t limit = MIN(state.capacity[STREAM_VERTEX], state.capacity[STREAM_INDEX] - 1);
+    count = MIN(count, limit);
+  }
+
   uint32_t indexCount = count + 1;
-  uint16_t* indices;
-  uint16_t baseVertex;
+  uint32_t* indices;
+  uint32_t baseVertex;
 
   lovrGraphicsBatch(&(BatchRequest) {
     .type = BATCH_LINES,
@@ -876,16 +1694,18 @@ void lovrGraphicsLine(uint32_t count, float** vertices) {
     .baseVertex = &baseVertex
   });
 
-  indices[0] = 0xffff;
+  indices[0] = 0xffffffff;
   for (uint32_t i = 1; i < indexCount; i++) {
     indices[i] = baseVertex + i - 1;
   }
+
+  return count;
 }
 
 void lovrGraphicsPlane(DrawStyle style, Material* material, mat4 transform, float u, float v, float w, float h) {
   float* vertices = NULL;
-  uint16_t* indices = NULL;
-  uint16_t baseVertex;
+  uint32_t* indices = NULL;
+  uint32_t baseVertex;
 
   lovrGraphicsBatch(&(BatchRequest) {
     .type = BATCH_PLANE,
@@ -910,7 +1730,7 @@ void lovrGraphicsPlane(DrawStyle style, Material* material, mat4 transform, floa
 
     memcpy(vertices, vertexData, sizeof(vertexData));
 
-    indices[0] = 0xffff;
+    indices[0] = 0xffffffff;
     indices[1] = 0 + baseVertex;
     indices[2] = 1 + baseVertex;
     indices[3] = 2 + baseVertex;
@@ -925,7 +1745,7 @@ void lovrGraphicsPlane(DrawStyle style, Material* material, mat4 transform, floa
 
     memcpy(vertices, vertexData, sizeof(vertexData));
 
-    static uint16_t indexData[] = { 0, 1, 2, 2, 1, 3 };
+    static uint32_t indexData[] = { 0, 1, 2, 2, 1, 3 };
 
     for (size_t i = 0; i < sizeof(indexData) / sizeof(indexData[0]); i++) {
       indices[i] = indexData[i] + baseVertex;
@@ -935,8 +1755,8 @@ void lovrGraphicsPlane(DrawStyle style, Material* material, mat4 transform, floa
 
 void lovrGraphicsBox(DrawStyle style, Material* material, mat4 transform) {
   float* vertices = NULL;
-  uint16_t* indices = NULL;
-  uint16_t baseVertex;
+  uint32_t* indices = NULL;
+  uint32_t baseVertex;
 
   lovrGraphicsBatch(&(BatchRequest) {
     .type = BATCH_BOX,
@@ -967,7 +1787,7 @@ void lovrGraphicsBox(DrawStyle style, Material* material, mat4 transform) {
 
       memcpy(vertices, vertexData, sizeof(vertexData));
 
-      static uint16_t indexData[] = {
+      static uint32_t indexData[] = {
         0, 1, 1, 2, 2, 3, 3, 0, // Front
         4, 5, 5, 6, 6, 7, 7, 4, // Back
         0, 4, 1, 5, 2, 6, 3, 7  // Connections
@@ -1006,7 +1826,7 @@ void lovrGraphicsBox(DrawStyle style, Material* material, mat4 transform) {
 
       memcpy(vertices, vertexData, sizeof(vertexData));
 
-      uint16_t indexData[] = {
+      uint32_t indexData[] = {
         0,  1,   2,  2,  1,  3,
         4,  5,   6,  6,  5,  7,
         8,  9,  10, 10,  9, 11,
@@ -1081,8 +1901,8 @@ void lovrGraphicsCylinder(Material* material, mat4 transform, float r1, float r2
   uint32_t vertexCount = ((capped && r1) * (segments + 2) + (capped && r2) * (segments + 2) + 2 * (segments + 1));
   uint32_t indexCount = 3 * segments * ((capped && r1) + (capped && r2) + 2);
   float* vertices = NULL;
-  uint16_t* indices = NULL;
-  uint16_t baseVertex;
+  uint32_t* indices = NULL;
+  uint32_t baseVertex;
 
   lovrGraphicsBatch(&(BatchRequest) {
     .type = BATCH_CYLINDER,
@@ -1154,16 +1974,16 @@ void lovrGraphicsCylinder(Material* material, mat4 transform, float r1, float r2
     // Indices
     for (int i = 0; i < segments; i++) {
       int j = 2 * i + baseVertex;
-      memcpy(indices, (uint16_t[6]) { j, j + 2, j + 1, j + 1, j + 2, j + 3 }, 6 * sizeof(uint16_t));
+      memcpy(indices, (uint32_t[6]) { j, j + 2, j + 1, j + 1, j + 2, j + 3 }, 6 * sizeof(uint32_t));
       indices += 6;
 
       if (capped && r1 != 0.f) {
-        memcpy(indices, (uint16_t[3]) { top, top + i + 2, top + i + 1 }, 3 * sizeof(uint16_t));
+        memcpy(indices, (uint32_t[3]) { top, top + i + 2, top + i + 1 }, 3 * sizeof(uint32_t));
         indices += 3;
       }
 
       if (capped && r2 != 0.f) {
-        memcpy(indices, (uint16_t[3]) { bot, bot + i + 1, bot + i + 2 }, 3 * sizeof(uint16_t));
+        memcpy(indices, (uint32_t[3]) { bot, bot + i + 1, bot + i + 2 }, 3 * sizeof(uint32_t));
         indices += 3;
       }
     }
@@ -1172,8 +1992,8 @@ void lovrGraphicsCylinder(Material* material, mat4 transform, float r1, float r2
 
 void lovrGraphicsSphere(Material* material, mat4 transform, int segments) {
   float* vertices = NULL;
-  uint16_t* indices = NULL;
-  uint16_t baseVertex;
+  uint32_t* indices = NULL;
+  uint32_t baseVertex;
 
   lovrGraphicsBatch(&(BatchRequest) {
     .type = BATCH_SPHERE,
@@ -1205,12 +2025,12 @@ void lovrGraphicsSphere(Material* material, mat4 transform, int segments) {
     }
 
     for (int i = 0; i < segments; i++) {
-      uint16_t offset0 = i * (segments + 1) + baseVertex;
-      uint16_t offset1 = (i + 1) * (segments + 1) + baseVertex;
+      uint32_t offset0 = i * (segments + 1) + baseVertex;
+      uint32_t offset1 = (i + 1) * (segments + 1) + baseVertex;
       for (int j = 0; j < segments; j++) {
-        uint16_t i0 = offset0 + j;
-        uint16_t i1 = offset1 + j;
-        memcpy(indices, ((uint16_t[]) { i0, i0 + 1, i1, i1, i0 + 1, i1 + 1 }), 6 * sizeof(uint16_t));
+        uint32_t i0 = offset0 + j;
+        uint32_t i1 = offset1 + j;
+        memcpy(indices, ((uint32_t[]) { i0, i0 + 1, i1, i1, i0 + 1, i1 + 1 }), 6 * sizeof(uint32_t));
         indices += 6;
       }
     }
@@ -1250,13 +2070,9 @@ void lovrGraphicsSkybox(Texture* texture) {
 }
 
 void lovrGraphicsPrint(const char* str, size_t length, mat4 transform, float wrap, HorizontalAlign halign, VerticalAlign valign) {
-  float width;
-  float lastLineWidth;
-  float height;
-  uint32_t lineCount;
-  uint32_t glyphCount;
   Font* font = lovrGraphicsGetFont();
-  lovrFontMeasure(font, str, length, wrap, &width, &lastLineWidth, &height, &lineCount, &glyphCount);
+  const FontLayout* layout = lovrFontLayout(font, str, length, wrap, halign);
+  uint32_t glyphCount = layout->glyphCount;
 
   if (glyphCount == 0) {
     return;
@@ -1264,30 +2080,45 @@ void lovrGraphicsPrint(const char* str, size_t length, mat4 transform, float wra
 
   float scale = 1.f / lovrFontGetPixelDensity(font);
   mat4_scale(transform, scale, scale, scale);
-  mat4_translate(transform, 0.f, height * (valign / 2.f), 0.f);
+  mat4_translate(transform, 0.f, layout->height * (valign / 2.f), 0.f);
 
   Pipeline pipeline = state.pipeline;
   pipeline.blendMode = pipeline.blendMode == BLEND_NONE ? BLEND_ALPHA : pipeline.blendMode;
 
-  float* vertices;
-  uint16_t* indices;
-  uint16_t baseVertex;
-  lovrGraphicsBatch(&(BatchRequest) {
-    .type = BATCH_TEXT,
-    .params.text.spread = lovrFontGetSpread(font),
-    .topology = DRAW_TRIANGLES,
-    .shader = SHADER_FONT,
-    .pipeline = &pipeline,
-    .transform = transform,
-    .texture = lovrFontGetTexture(font),
-    .vertexCount = glyphCount * 4,
-    .indexCount = glyphCount * 6,
-    .vertices = &vertices,
-    .indices = &indices,
-    .baseVertex = &baseVertex
-  });
+  // Each atlas page is a separate batch
+  const float* source = layout->vertices;
+  for (uint32_t page = 0; page < layout->pageCount; page++) {
+    uint32_t count = layout->pageCounts[page];
+    if (count == 0) {
+      continue;
+    }
 
-  lovrFontRender(font, str, length, wrap, halign, vertices, indices, baseVertex);
+    float* vertices;
+    uint32_t* indices;
+    uint32_t baseVertex;
+    lovrGraphicsBatch(&(BatchRequest) {
+      .type = BATCH_TEXT,
+      .params.text.spread = lovrFontGetSpread(font),
+      .topology = DRAW_TRIANGLES,
+      .shader = SHADER_FONT,
+      .pipeline = &pipeline,
+      .transform = transform,
+      .texture = lovrFontGetTexture(font, page),
+      .vertexCount = count * 4,
+      .indexCount = count * 6,
+      .vertices = &vertices,
+      .indices = &indices,
+      .baseVertex = &baseVertex
+    });
+
+    memcpy(vertices, source, count * 32 * sizeof(float));
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t I = baseVertex + 4 * i;
+      memcpy(indices + 6 * i, (uint32_t[6]) { I + 0, I + 1, I + 2, I + 2, I + 1, I + 3 }, 6 * sizeof(uint32_t));
+    }
+
+    source += count * 32;
+  }
 }
 
 void lovrGraphicsFill(Texture* texture, float u, float v, float w, float h) {
@@ -1318,7 +2149,73 @@ void lovrGraphicsFill(Texture* texture, float u, float v, float w, float h) {
   }
 }
 
-void lovrGraphicsDrawMesh(Mesh* mesh, mat4 transform, uint32_t instances, float* pose) {
+// Per-instance data from the CPU is streamed as vec4s, 4 for each transform and 1 for each color.
+// Either part can be left out if it's already in a Buffer or isn't needed.
+void lovrGraphicsStreamInstances(InstanceData* instances, float* transforms, float* colors, uint32_t count) {
+  lovrAssert(!state.recording, "Instance data can not be streamed while recording a DrawList");
+  uint32_t total = (transforms ? 4 * count : 0) + (colors ? count : 0);
+  instances->count = count;
+
+  if (total == 0) {
+    return;
+  } else if (total > state.capacity[STREAM_INSTANCE]) {
+    lovrAssert(total <= MAX_STREAM_VERTICES, "Whoa there!  Tried to stream %d instances, but the limit is %d", count, MAX_STREAM_VERTICES / 5);
+    lovrGraphicsFlush();
+    lovrGraphicsGrowStream(STREAM_INSTANCE, total);
+  } else if (state.head[STREAM_INSTANCE] + total > state.capacity[STREAM_INSTANCE]) {
+    lovrGraphicsFlush();
+  }
+
+  float* data = lovrGraphicsMapBuffer(STREAM_INSTANCE, total);
+  uint32_t offset = (lovrGraphicsGetBase(STREAM_INSTANCE) + state.head[STREAM_INSTANCE]) * bufferStride[STREAM_INSTANCE];
+
+  if (transforms) {
+    memcpy(data, transforms, 16 * count * sizeof(float));
+    instances->transforms = state.buffers[STREAM_INSTANCE];
+    instances->transformOffset = offset;
+    offset += 16 * count * sizeof(float);
+    data += 16 * count;
+  }
+
+  if (colors) {
+    memcpy(data, colors, 4 * count * sizeof(float));
+    instances->colors = state.buffers[STREAM_INSTANCE];
+    instances->colorOffset = offset;
+  }
+
+  state.head[STREAM_INSTANCE] += total;
+}
+
+// Consecutive draws with the same pose (primitives of a node) share a copy
+static uint32_t lovrGraphicsRecordPose(float* poses) {
+  DrawList* list = state.recording;
+  size_t count = MAX_BONES * 16;
+  size_t length = list->poses.length;
+  if (length >= count && !memcmp(list->poses.data + length - count, poses, count * sizeof(float))) {
+    return (uint32_t) ((length - count) * sizeof(float));
+  }
+  arr_append(&list->poses, poses, count);
+  return (uint32_t) (length * sizeof(float));
+}
+
+// poses is the CPU copy of the pose range, used when recording a DrawList
+void lovrGraphicsDrawMesh(Mesh* mesh, Material* material, mat4 transform, uint32_t instances, InstanceData* instanceData, Buffer* pose, uint32_t poseOffset, float* poses, float* bounds) {
+  if (instanceData) {
+    instances = instanceData->count;
+    if (instances == 0) return;
+  }
+
+  if (bounds && instances <= 1 && lovrGraphicsCull(bounds, transform)) {
+    return;
+  }
+
+  bool recordedPose = false;
+  if (state.recording && pose) {
+    poseOffset = lovrGraphicsRecordPose(poses);
+    recordedPose = true;
+    pose = NULL;
+  }
+
   uint32_t vertexCount = lovrMeshGetVertexCount(mesh);
   uint32_t indexCount = lovrMeshGetIndexCount(mesh);
   uint32_t defaultCount = indexCount > 0 ? indexCount : vertexCount;
@@ -1326,7 +2223,7 @@ void lovrGraphicsDrawMesh(Mesh* mesh, mat4 transform, uint32_t instances, float*
   lovrMeshGetDrawRange(mesh, &rangeStart, &rangeCount);
   rangeCount = rangeCount > 0 ? rangeCount : defaultCount;
   DrawMode mode = lovrMeshGetDrawMode(mesh);
-  Material* material = lovrMeshGetMaterial(mesh);
+  material = material ? material : lovrMeshGetMaterial(mesh);
 
   lovrGraphicsBatch(&(BatchRequest) {
     .type = BATCH_MESH,
@@ -1334,6 +2231,9 @@ void lovrGraphicsDrawMesh(Mesh* mesh, mat4 transform, uint32_t instances, float*
     .params.mesh.rangeCount = rangeCount,
     .params.mesh.instances = instances,
     .params.mesh.pose = pose,
+    .params.mesh.poseOffset = poseOffset,
+    .params.mesh.recordedPose = recordedPose,
+    .params.mesh.instanceData = instanceData ? *instanceData : (InstanceData) { 0 },
     .mesh = mesh,
     .topology = mode,
     .transform = transform,
@@ -8,6 +8,7 @@
 
 struct Buffer;
 struct Canvas;
+struct DrawList;
 struct Font;
 struct Material;
 struct Mesh;
@@ -67,6 +68,47 @@ typedef enum {
   WINDING_COUNTERCLOCKWISE
 } Winding;
 
+typedef enum {
+  STREAM_VERTEX,
+  STREAM_DRAWID,
+  STREAM_INDEX,
+  STREAM_MODEL,
+  STREAM_COLOR,
+  STREAM_FRAME,
+  STREAM_INSTANCE,
+  MAX_STREAMS
+} StreamType;
+
+typedef enum {
+  BREAK_TYPE,
+  BREAK_FULL,
+  BREAK_MESH,
+  BREAK_CANVAS,
+  BREAK_SHADER,
+  BREAK_MATERIAL,
+  BREAK_BLEND,
+  BREAK_PIPELINE,
+  BREAK_PARAMS,
+  BREAK_INSTANCED,
+  BREAK_ORDER,
+  BREAK_STREAM,
+  MAX_BATCH_BREAKS
+} BatchBreak;
+
+typedef void (*BatchBreakCallback)(void* userdata, BatchBreak reason);
+
+typedef enum {
+  FLUSH_STATE,
+  FLUSH_CANVAS,
+  FLUSH_SHADER,
+  FLUSH_MATERIAL,
+  FLUSH_MESH,
+  FLUSH_STREAM,
+  FLUSH_BATCHES,
+  FLUSH_DRAWS,
+  MAX_FLUSH_REASONS
+} FlushReason;
+
 typedef struct {
   float lineWidth;
   unsigned alphaSampling : 1;
@@ -82,6 +124,14 @@ typedef struct {
   unsigned wireframe : 1;
 } Pipeline;
 
+typedef struct InstanceData {
+  struct Buffer* transforms;
+  struct Buffer* colors;
+  uint32_t transformOffset;
+  uint32_t colorOffset;
+  uint32_t count;
+} InstanceData;
+
 typedef struct {
   uint32_t width;
   uint32_t height;
@@ -99,7 +149,7 @@ typedef struct {
 } WindowFlags;
 
 // Base
-bool lovrGraphicsInit(bool debug);
+bool lovrGraphicsInit(bool debug, const char* shaderCache, const char* fontCache);
 void lovrGraphicsDestroy(void);
 void lovrGraphicsPresent(void);
 void lovrGraphicsCreateWindow(WindowFlags* flags);
@@ -112,11 +162,17 @@ void lovrGraphicsSetViewMatrix(uint32_t index, float* viewMatrix);
 void lovrGraphicsGetProjection(uint32_t index, float* projection);
 void lovrGraphicsSetProjection(uint32_t index, float* projection);
 struct Buffer* lovrGraphicsGetIdentityBuffer(void);
+bool lovrGraphicsWarmShaders(void);
+const char* lovrGraphicsGetFontCache(void);
 #define lovrGraphicsTick lovrGpuTick
 #define lovrGraphicsTock lovrGpuTock
+#define lovrGraphicsBeginZone lovrGpuBeginZone
+#define lovrGraphicsEndZone lovrGpuEndZone
 #define lovrGraphicsGetFeatures lovrGpuGetFeatures
 #define lovrGraphicsGetLimits lovrGpuGetLimits
 #define lovrGraphicsGetStats lovrGpuGetStats
+#define lovrGraphicsGetTextureStreamBudget lovrGpuGetTextureStreamBudget
+#define lovrGraphicsSetTextureStreamBudget lovrGpuSetTextureStreamBudget
 
 // State
 void lovrGraphicsReset(void);
@@ -136,6 +192,8 @@ bool lovrGraphicsIsCullingEnabled(void);
 void lovrGraphicsSetCullingEnabled(bool culling);
 TextureFilter lovrGraphicsGetDefaultFilter(void);
 void lovrGraphicsSetDefaultFilter(TextureFilter filter);
+bool lovrGraphicsIsDeferred(void);
+void lovrGraphicsSetDeferred(bool deferred);
 void lovrGraphicsGetDepthTest(CompareMode* mode, bool* write);
 void lovrGraphicsSetDepthTest(CompareMode depthTest, bool write);
 struct Font* lovrGraphicsGetFont(void);
@@ -163,15 +221,19 @@ void lovrGraphicsScale(vec3 scale);
 void lovrGraphicsMatrixTransform(mat4 transform);
 
 // Rendering
+bool lovrGraphicsCull(float bounds[6], mat4 transform);
+float lovrGraphicsGetProjectedSize(float bounds[6], mat4 transform);
+void lovrGraphicsSetBatchBreakCallback(BatchBreakCallback callback, void* userdata);
 void lovrGraphicsFlush(void);
 void lovrGraphicsFlushCanvas(struct Canvas* canvas);
 void lovrGraphicsFlushShader(struct Shader* shader);
 void lovrGraphicsFlushMaterial(struct Material* material);
 void lovrGraphicsFlushMesh(struct Mesh* mesh);
+void lovrGraphicsFlushPose(struct Buffer* pose);
 void lovrGraphicsClear(Color* color, float* depth, int* stencil);
 void lovrGraphicsDiscard(bool color, bool depth, bool stencil);
-void lovrGraphicsPoints(uint32_t count, float** vertices);
-void lovrGraphicsLine(uint32_t count, float** vertices);
+uint32_t lovrGraphicsPoints(uint32_t count, float** vertices);
+uint32_t lovrGraphicsLine(uint32_t count, float** vertices);
 void lovrGraphicsPlane(DrawStyle style, struct Material* material, mat4 transform, float u, float v, float w, float h);
 void lovrGraphicsBox(DrawStyle style, struct Material* material, mat4 transform);
 void lovrGraphicsArc(DrawStyle style, ArcMode mode, struct Material* material, mat4 transform, float r1, float r2, int segments);
@@ -181,9 +243,12 @@ void lovrGraphicsSphere(struct Material* material, mat4 transform, int segments)
 void lovrGraphicsSkybox(struct Texture* texture);
 void lovrGraphicsPrint(const char* str, size_t length, mat4 transform, float wrap, HorizontalAlign halign, VerticalAlign valign);
 void lovrGraphicsFill(struct Texture* texture, float u, float v, float w, float h);
-void lovrGraphicsDrawMesh(struct Mesh* mesh, mat4 transform, uint32_t instances, float* pose);
-#define lovrGraphicsStencil lovrGpuStencil
-#define lovrGraphicsCompute lovrGpuCompute
+void lovrGraphicsStreamInstances(InstanceData* instances, float* transforms, float* colors, uint32_t count);
+void lovrGraphicsDrawMesh(struct Mesh* mesh, struct Material* material, mat4 transform, uint32_t instances, InstanceData* instanceData, struct Buffer* pose, uint32_t poseOffset, float* poses, float* bounds);
+void lovrGraphicsBeginDrawList(void);
+struct DrawList* lovrGraphicsEndDrawList(void);
+void lovrGraphicsStencil(StencilAction action, int replaceValue, StencilCallback callback, void* userdata);
+void lovrGraphicsCompute(struct Shader* shader, int x, int y, int z);
 
 // GPU
 
@@ -193,6 +258,7 @@ typedef struct {
   bool dxt;
   bool instancedStereo;
   bool multiview;
+  bool persistent;
   bool timers;
 } GpuFeatures;
 
@@ -210,10 +276,22 @@ typedef struct {
   uint32_t shaderSwitches;
   uint32_t renderPasses;
   uint32_t drawCalls;
+  uint32_t mergedBatches;
+  uint32_t culledDraws;
+  uint32_t fenceWaits;
   uint32_t bufferCount;
   uint32_t textureCount;
   uint64_t bufferMemory;
   uint64_t textureMemory;
+  uint32_t batchBreaks[MAX_BATCH_BREAKS];
+  uint32_t flushes[MAX_FLUSH_REASONS];
+  uint32_t submittedBatches;
+  uint32_t submittedDraws;
+  uint64_t streamBytes[MAX_STREAMS];
+  uint64_t textureStreamBytes;
+  uint32_t textureStreams;
+  uint32_t textureUploads;
+  uint64_t textureUploadBytes;
 } GpuStats;
 
 typedef struct {
@@ -225,9 +303,11 @@ typedef struct {
   uint32_t rangeStart;
   uint32_t rangeCount;
   uint32_t instances;
+  uint32_t baseVertex;
+  InstanceData instanceData;
 } DrawCommand;
 
-void lovrGpuInit(void (*getProcAddress(const char*))(void), bool debug);
+void lovrGpuInit(void (*getProcAddress(const char*))(void), bool debug, const char* shaderCache);
 void lovrGpuDestroy(void);
 void lovrGpuClear(struct Canvas* canvas, Color* color, float* depth, int* stencil);
 void lovrGpuCompute(struct Shader* shader, int x, int y, int z);
@@ -238,6 +318,10 @@ void lovrGpuPresent(void);
 void lovrGpuDirtyTexture(void);
 void lovrGpuTick(const char* label);
 double lovrGpuTock(const char* label);
+void lovrGpuBeginZone(const char* name);
+void lovrGpuEndZone(void);
 const GpuFeatures* lovrGpuGetFeatures(void);
 const GpuLimits* lovrGpuGetLimits(void);
-const GpuStats* lovrGpuGetStats(void);
+GpuStats* lovrGpuGetStats(void);
+size_t lovrGpuGetTextureStreamBudget(void);
+void lovrGpuSetTextureStreamBudget(size_t budget);
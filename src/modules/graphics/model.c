@@ -4,237 +4,897 @@
 #include "graphics/material.h"
 #include "graphics/mesh.h"
 #include "graphics/texture.h"
+#include "core/job.h"
 #include "core/maf.h"
+#include "core/profile.h"
 #include "shaders.h"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <float.h>
 #include <math.h>
 
+#define POSE_VERSIONS 4
+
+enum {
+  NODE_DIRTY = 1,
+  NODE_MOVED = 2,
+  NODE_BOUNDS = 4
+};
+
 typedef struct {
   float properties[3][4];
 } NodeTransform;
 
-struct Model {
+typedef struct {
+  ModelAttribute* attributes[MAX_DEFAULT_ATTRIBUTES];
+  uint32_t offsets[MAX_DEFAULT_ATTRIBUTES];
+  uint32_t stride;
+  bool skinned;
+  bool positions;
+  bool normals;
+  bool tangents;
+  bool texCoords;
+  float dequantize[16];
+  struct Buffer* buffer;
+} VertexPacking;
+
+// GPU objects created from a ModelData, shared by all of the Models that use it
+typedef struct ModelResources {
   uint32_t ref;
   struct ModelData* data;
+  bool quantize;
   struct Buffer** buffers;
   struct Mesh** meshes;
+  VertexPacking* packings;
+  uint32_t* primitivePackings;
+  uint32_t packingCount;
+  struct Mesh** lodMeshes;
+  struct Buffer* lodBuffer;
+  uint32_t lodCount;
+  float lodRatios[MAX_LODS];
   struct Texture** textures;
   struct Material** materials;
+  float* primitiveBounds;
+} ModelResources;
+
+struct Model {
+  uint32_t ref;
+  struct ModelData* data;
+  ModelResources* resources;
+  struct Material** defaults;
+  struct Material** materials;
+  float lodScale;
   float* vertices;
   uint32_t* indices;
   uint32_t vertexCount;
   uint32_t indexCount;
   NodeTransform* localTransforms;
   float* globalTransforms;
+  uint32_t* nodeOrder;
+  uint32_t* nodeParents;
+  uint8_t* nodeFlags;
+  struct Buffer* poseBuffer;
+  uint32_t* poseSlots;
+  uint32_t poseCount;
+  uint32_t poseVersion;
+  float* poses;
+  bool posesDirty;
+  bool posesPending;
+  uint32_t* keyframeCursors;
+  float (*blendSums)[4];
+  float* blendWeights;
+  uint32_t* blendSlots;
+  float* nodeBounds;
+  bool* cullable;
   bool transformsDirty;
+  bool culling;
 };
 
-static void updateGlobalTransform(Model* model, uint32_t nodeIndex, mat4 parent) {
-  mat4 global = model->globalTransforms + 16 * nodeIndex;
-  NodeTransform* local = &model->localTransforms[nodeIndex];
-  vec3 T = local->properties[PROP_TRANSLATION];
-  quat R = local->properties[PROP_ROTATION];
-  vec3 S = local->properties[PROP_SCALE];
+static void expandBounds(float bounds[6], float min[3], float max[3], mat4 m) {
+  float xa[3] = { min[0] * m[0], min[0] * m[1], min[0] * m[2] };
+  float xb[3] = { max[0] * m[0], max[0] * m[1], max[0] * m[2] };
+
+  float ya[3] = { min[1] * m[4], min[1] * m[5], min[1] * m[6] };
+  float yb[3] = { max[1] * m[4], max[1] * m[5], max[1] * m[6] };
 
-  mat4_init(global, parent);
-  mat4_translate(global, T[0], T[1], T[2]);
-  mat4_rotateQuat(global, R);
-  mat4_scale(global, S[0], S[1], S[2]);
+  float za[3] = { min[2] * m[8], min[2] * m[9], min[2] * m[10] };
+  float zb[3] = { max[2] * m[8], max[2] * m[9], max[2] * m[10] };
 
+  bounds[0] = MIN(bounds[0], MIN(xa[0], xb[0]) + MIN(ya[0], yb[0]) + MIN(za[0], zb[0]) + m[12]);
+  bounds[1] = MAX(bounds[1], MAX(xa[0], xb[0]) + MAX(ya[0], yb[0]) + MAX(za[0], zb[0]) + m[12]);
+  bounds[2] = MIN(bounds[2], MIN(xa[1], xb[1]) + MIN(ya[1], yb[1]) + MIN(za[1], zb[1]) + m[13]);
+  bounds[3] = MAX(bounds[3], MAX(xa[1], xb[1]) + MAX(ya[1], yb[1]) + MAX(za[1], zb[1]) + m[13]);
+  bounds[4] = MIN(bounds[4], MIN(xa[2], xb[2]) + MIN(ya[2], yb[2]) + MIN(za[2], zb[2]) + m[14]);
+  bounds[5] = MAX(bounds[5], MAX(xa[2], xb[2]) + MAX(ya[2], yb[2]) + MAX(za[2], zb[2]) + m[14]);
+}
+
+// A node can be culled if every primitive in its subtree has bounds and none of them are skinned
+static bool initCulling(Model* model, uint32_t nodeIndex) {
   ModelNode* node = &model->data->nodes[nodeIndex];
+  bool cullable = node->skin == ~0u;
+
+  for (uint32_t i = 0; i < node->primitiveCount; i++) {
+    ModelAttribute* position = model->data->primitives[node->primitiveIndex + i].attributes[ATTR_POSITION];
+    cullable = cullable && position && position->hasMin && position->hasMax;
+  }
+
   for (uint32_t i = 0; i < node->childCount; i++) {
-    updateGlobalTransform(model, node->children[i], global);
+    cullable = initCulling(model, node->children[i]) && cullable;
   }
+
+  return model->cullable[nodeIndex] = cullable;
 }
 
-static void renderNode(Model* model, uint32_t nodeIndex, uint32_t instances) {
+// Nodes are stored in depth first order, so parents always come before their children
+static void initNodeOrder(Model* model, uint32_t nodeIndex, uint32_t parent, uint32_t* count) {
   ModelNode* node = &model->data->nodes[nodeIndex];
-  mat4 globalTransform = model->globalTransforms + 16 * nodeIndex;
-  float poseMatrix[16 * MAX_BONES];
-  float* pose = NULL;
+  lovrAssert(*count < model->data->nodeCount, "ModelData node hierarchy is not a tree");
+  model->nodeOrder[(*count)++] = nodeIndex;
+  model->nodeParents[nodeIndex] = parent;
+
+  for (uint32_t i = 0; i < node->childCount; i++) {
+    initNodeOrder(model, node->children[i], nodeIndex, count);
+  }
+}
+
+static void markDirty(Model* model, uint32_t nodeIndex) {
+  model->nodeFlags[nodeIndex] |= NODE_DIRTY;
+  model->transformsDirty = true;
+}
+
+// Only recomputes the global transforms of dirty subtrees, then the bounds of their ancestors
+static void updateTransforms(Model* model) {
+  if (!model->transformsDirty) {
+    return;
+  }
+
+  uint32_t nodeCount = model->data->nodeCount;
+  uint8_t* flags = model->nodeFlags;
+
+  for (uint32_t i = 0; i < nodeCount; i++) {
+    uint32_t index = model->nodeOrder[i];
+    uint32_t parent = model->nodeParents[index];
+
+    if (parent != ~0u && (flags[parent] & NODE_MOVED)) {
+      flags[index] |= NODE_MOVED;
+    } else if (flags[index] & NODE_DIRTY) {
+      flags[index] |= NODE_MOVED;
+    } else {
+      continue;
+    }
+
+    mat4 global = model->globalTransforms + 16 * index;
+    NodeTransform* local = &model->localTransforms[index];
+    vec3 T = local->properties[PROP_TRANSLATION];
+    quat R = local->properties[PROP_ROTATION];
+    vec3 S = local->properties[PROP_SCALE];
+
+    if (parent == ~0u) {
+      mat4_fromTRS(global, T, R, S);
+    } else {
+      float transform[16];
+      mat4_init(global, model->globalTransforms + 16 * parent);
+      mat4_mul(global, mat4_fromTRS(transform, T, R, S));
+    }
+  }
+
+  // Bounds cover the whole subtree, so children are visited before their parents
+  for (uint32_t i = nodeCount; i-- > 0;) {
+    uint32_t index = model->nodeOrder[i];
+    uint32_t parent = model->nodeParents[index];
+
+    if (!(flags[index] & (NODE_MOVED | NODE_BOUNDS))) {
+      continue;
+    }
 
-  if (node->skin != ~0u) {
-    ModelSkin* skin = &model->data->skins[node->skin];
-    pose = poseMatrix;
+    mat4 global = model->globalTransforms + 16 * index;
+    float* bounds = model->nodeBounds + 6 * index;
+    bounds[0] = bounds[2] = bounds[4] = FLT_MAX;
+    bounds[1] = bounds[3] = bounds[5] = -FLT_MAX;
+
+    ModelNode* node = &model->data->nodes[index];
+    for (uint32_t j = 0; j < node->primitiveCount; j++) {
+      ModelAttribute* position = model->data->primitives[node->primitiveIndex + j].attributes[ATTR_POSITION];
+      if (position && position->hasMin && position->hasMax) {
+        expandBounds(bounds, position->min, position->max, global);
+      }
+    }
+
+    for (uint32_t j = 0; j < node->childCount; j++) {
+      float* child = model->nodeBounds + 6 * node->children[j];
+      for (int k = 0; k < 6; k += 2) {
+        bounds[k + 0] = MIN(bounds[k + 0], child[k + 0]);
+        bounds[k + 1] = MAX(bounds[k + 1], child[k + 1]);
+      }
+    }
+
+    if (parent != ~0u) {
+      flags[parent] |= NODE_BOUNDS;
+    }
+
+    flags[index] = 0;
+  }
+
+  model->transformsDirty = false;
+  model->posesDirty = model->poseCount > 0;
+}
+
+// Each skinned node has a slot of MAX_BONES joint matrices, relative to the node.  This only
+// touches CPU memory, so it's safe to do on a worker thread.
+static void updatePoses(Model* model) {
+  size_t stride = 16 * MAX_BONES;
+  for (uint32_t i = 0; i < model->data->nodeCount; i++) {
+    uint32_t slot = model->poseSlots[i];
+    if (slot == ~0u) continue;
+
+    ModelSkin* skin = &model->data->skins[model->data->nodes[i].skin];
+    float inverse[16];
+    mat4_init(inverse, model->globalTransforms + 16 * i);
+    mat4_invert(inverse);
 
     for (uint32_t j = 0; j < skin->jointCount; j++) {
-      mat4 globalJointTransform = model->globalTransforms + 16 * skin->joints[j];
-      mat4 inverseBindMatrix = skin->inverseBindMatrices + 16 * j;
-      mat4 jointPose = pose + 16 * j;
+      mat4 jointPose = model->poses + slot * stride + 16 * j;
+      mat4_init(jointPose, inverse);
+      mat4_mul(jointPose, model->globalTransforms + 16 * skin->joints[j]);
+      mat4_mul(jointPose, skin->inverseBindMatrices + 16 * j);
+    }
+  }
+
+  model->posesDirty = false;
+  model->posesPending = true;
+}
+
+// The pose buffer holds POSE_VERSIONS copies of the poses and each upload goes to the next one, so
+// draws that haven't been submitted yet keep their range.  The buffer is only orphaned when the
+// ring wraps, which flushes if a pending batch still uses it.  Each range is written once per
+// orphan, so the other uploads don't need to synchronize.
+static void uploadPoses(Model* model) {
+  size_t size = model->poseCount * MAX_BONES * 16 * sizeof(float);
+  model->poseVersion = (model->poseVersion + 1) % POSE_VERSIONS;
+  size_t offset = model->poseVersion * size;
+
+  if (model->poseVersion == 0) {
+    lovrGraphicsFlushPose(model->poseBuffer);
+    lovrBufferDiscard(model->poseBuffer);
+  }
 
-      mat4_set(jointPose, globalTransform);
-      mat4_invert(jointPose);
-      mat4_mul(jointPose, globalJointTransform);
-      mat4_mul(jointPose, inverseBindMatrix);
+  memcpy(lovrBufferMap(model->poseBuffer, offset, true), model->poses, size);
+  lovrBufferFlush(model->poseBuffer, offset, size);
+  lovrBufferUnmap(model->poseBuffer);
+  model->posesPending = false;
+}
+
+static void renderNode(Model* model, uint32_t nodeIndex, uint32_t instances, InstanceData* instanceData) {
+  ModelNode* node = &model->data->nodes[nodeIndex];
+  mat4 globalTransform = model->globalTransforms + 16 * nodeIndex;
+  float* bounds = model->nodeBounds + 6 * nodeIndex;
+  bool cull = model->culling && model->cullable[nodeIndex] && instances <= 1 && !instanceData;
+
+  if (cull && (bounds[0] > bounds[1] || lovrGraphicsCull(bounds, (float[]) MAT4_IDENTITY))) {
+    return;
+  }
+
+  Buffer* pose = node->skin == ~0u ? NULL : model->poseBuffer;
+  size_t poseStride = MAX_BONES * 16 * sizeof(float);
+  uint32_t poseOffset = node->skin == ~0u ? 0 : (model->poseVersion * model->poseCount + model->poseSlots[nodeIndex]) * poseStride;
+  float* poses = node->skin == ~0u ? NULL : model->poses + model->poseSlots[nodeIndex] * MAX_BONES * 16;
+
+  // Primitives are only tested individually when the node bounds don't already cover just them
+  bool cullPrimitives = cull && (node->primitiveCount > 1 || node->childCount > 0);
+  ModelResources* resources = model->resources;
+  Mesh** meshes = resources->meshes;
+
+  // The coarsest level whose ratio still covers the projected size is used, instancing gets full detail
+  if (resources->lodMeshes && node->primitiveCount > 0 && instances <= 1 && !instanceData && bounds[0] <= bounds[1]) {
+    float size = lovrGraphicsGetProjectedSize(bounds, (float[]) MAT4_IDENTITY) * model->lodScale;
+    for (uint32_t i = 0; i < resources->lodCount && resources->lodRatios[i] >= size; i++) {
+      meshes = resources->lodMeshes + i * model->data->primitiveCount;
     }
   }
 
   for (uint32_t i = 0; i < node->primitiveCount; i++) {
-    lovrGraphicsDrawMesh(model->meshes[node->primitiveIndex + i], globalTransform, instances, pose);
+    uint32_t index = node->primitiveIndex + i;
+    uint32_t materialIndex = model->data->primitives[index].material;
+    Material* material = materialIndex == ~0u ? NULL : model->materials[materialIndex];
+    float* primitiveBounds = cullPrimitives ? resources->primitiveBounds + 6 * index : NULL;
+    float* transform = globalTransform;
+    float dequantized[16];
+
+    if (resources->primitivePackings && resources->primitivePackings[index] != ~0u) {
+      VertexPacking* packing = &resources->packings[resources->primitivePackings[index]];
+      if (packing->positions) {
+        transform = mat4_mul(mat4_init(dequantized, globalTransform), packing->dequantize);
+      }
+    }
+
+    lovrGraphicsDrawMesh(meshes[index], material, transform, instances, instanceData, pose, poseOffset, poses, primitiveBounds);
   }
 
   for (uint32_t i = 0; i < node->childCount; i++) {
-    renderNode(model, node->children[i], instances);
+    renderNode(model, node->children[i], instances, instanceData);
   }
 }
 
-Model* lovrModelCreate(ModelData* data) {
-  Model* model = calloc(1, sizeof(Model));
-  lovrAssert(model, "Out of memory");
-  model->ref = 1;
-  model->data = data;
-  lovrRetain(data);
+static size_t getAttributeSize(ModelAttribute* attribute) {
+  size_t sizes[] = { [I8] = 1, [U8] = 1, [I16] = 2, [U16] = 2, [I32] = 4, [U32] = 4, [F32] = 4 };
+  return sizes[attribute->type] * attribute->components;
+}
 
-  // Materials
-  if (data->materialCount > 0) {
-    model->materials = malloc(data->materialCount * sizeof(Material*));
+static char* getAttributeData(ModelData* data, ModelAttribute* attribute, uint32_t index) {
+  ModelBuffer* buffer = &data->buffers[attribute->buffer];
+  size_t stride = buffer->stride ? buffer->stride : getAttributeSize(attribute);
+  return buffer->data + attribute->offset + index * stride;
+}
 
-    if (data->imageCount > 0) {
-      model->textures = calloc(data->imageCount, sizeof(Texture*));
+static void encodeOctahedral(float* v, int16_t* e) {
+  float length = fabsf(v[0]) + fabsf(v[1]) + fabsf(v[2]);
+  float x = length > 0.f ? v[0] / length : 0.f;
+  float y = length > 0.f ? v[1] / length : 0.f;
+  if (v[2] < 0.f) {
+    float ox = x;
+    x = (1.f - fabsf(y)) * (ox >= 0.f ? 1.f : -1.f);
+    y = (1.f - fabsf(ox)) * (y >= 0.f ? 1.f : -1.f);
+  }
+  e[0] = (int16_t) roundf(CLAMP(x, -1.f, 1.f) * 32767.f);
+  e[1] = (int16_t) roundf(CLAMP(y, -1.f, 1.f) * 32767.f);
+}
+
+// Packs the vertices of a primitive into one interleaved buffer with smaller formats:
+// - Positions become normalized u16s relative to their bounds, the dequantization transform gets
+//   applied to the draw transform.  This only works for primitives that aren't skinned.
+// - Normals and tangents become octahedral i16 pairs in lovrPackedNormal, which the shader decodes.
+//   The tangent's sign goes in the lowest bit of the last component.
+// - Texture coordinates become normalized u16s when they're all between 0 and 1.
+// Everything else is copied as is.
+static bool packVertices(ModelResources* resources, ModelPrimitive* primitive, bool skinned, VertexPacking* packing) {
+  ModelData* data = resources->data;
+  ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+  ModelAttribute* normal = primitive->attributes[ATTR_NORMAL];
+  ModelAttribute* tangent = primitive->attributes[ATTR_TANGENT];
+  ModelAttribute* texCoord = primitive->attributes[ATTR_TEXCOORD];
+
+  if (!position || position->type != F32 || position->components != 3 || position->count == 0) {
+    return false;
+  }
+
+  uint32_t count = position->count;
+  for (uint32_t i = 0; i < MAX_DEFAULT_ATTRIBUTES; i++) {
+    ModelAttribute* attribute = primitive->attributes[i];
+    if (attribute && (attribute->count != count || !data->buffers[attribute->buffer].data)) {
+      return false;
     }
+  }
 
-    for (uint32_t i = 0; i < data->materialCount; i++) {
-      Material* material = lovrMaterialCreate();
+  memset(packing, 0, sizeof(*packing));
+  memcpy(packing->attributes, primitive->attributes, sizeof(primitive->attributes));
+  packing->skinned = skinned;
+  packing->positions = !skinned;
+  packing->normals = normal && normal->type == F32 && normal->components == 3;
+  packing->tangents = packing->normals && tangent && tangent->type == F32 && tangent->components == 4;
+  packing->texCoords = texCoord && texCoord->type == F32 && texCoord->components == 2;
+  mat4_identity(packing->dequantize);
+
+  for (uint32_t v = 0; v < count && packing->texCoords; v++) {
+    float uv[2];
+    memcpy(uv, getAttributeData(data, texCoord, v), sizeof(uv));
+    packing->texCoords = uv[0] >= 0.f && uv[0] <= 1.f && uv[1] >= 0.f && uv[1] <= 1.f;
+  }
 
-      for (uint32_t j = 0; j < MAX_MATERIAL_SCALARS; j++) {
-        lovrMaterialSetScalar(material, j, data->materials[i].scalars[j]);
-      }
+  float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+  float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+  for (uint32_t v = 0; v < count && packing->positions; v++) {
+    float p[3];
+    memcpy(p, getAttributeData(data, position, v), sizeof(p));
+    for (int k = 0; k < 3; k++) {
+      min[k] = MIN(min[k], p[k]);
+      max[k] = MAX(max[k], p[k]);
+    }
+  }
+
+  // The scale is uniform so normals only need to be renormalized
+  float scale = MAX(MAX(max[0] - min[0], max[1] - min[1]), max[2] - min[2]);
+  scale = scale > 0.f ? scale : 1.f;
+  if (packing->positions) {
+    mat4_translate(packing->dequantize, min[0], min[1], min[2]);
+    mat4_scale(packing->dequantize, scale, scale, scale);
+  }
+
+  for (uint32_t i = 0; i < MAX_DEFAULT_ATTRIBUTES; i++) {
+    ModelAttribute* attribute = primitive->attributes[i];
+    if (!attribute || (i == ATTR_TANGENT && packing->tangents)) {
+      packing->offsets[i] = ~0u;
+      continue;
+    }
 
-      for (uint32_t j = 0; j < MAX_MATERIAL_COLORS; j++) {
-        lovrMaterialSetColor(material, j, data->materials[i].colors[j]);
+    size_t size = getAttributeSize(attribute);
+    if (i == ATTR_POSITION && packing->positions) size = 4 * sizeof(uint16_t);
+    if (i == ATTR_NORMAL && packing->normals) size = 4 * sizeof(int16_t);
+    if (i == ATTR_TEXCOORD && packing->texCoords) size = 2 * sizeof(uint16_t);
+    packing->offsets[i] = packing->stride;
+    packing->stride += ALIGN(size, 4);
+  }
+
+  char* vertices = calloc(count, packing->stride);
+  lovrAssert(vertices, "Out of memory");
+
+  for (uint32_t v = 0; v < count; v++) {
+    char* vertex = vertices + v * packing->stride;
+    for (uint32_t i = 0; i < MAX_DEFAULT_ATTRIBUTES; i++) {
+      ModelAttribute* attribute = primitive->attributes[i];
+      if (packing->offsets[i] == ~0u) continue;
+
+      char* src = getAttributeData(data, attribute, v);
+      char* dst = vertex + packing->offsets[i];
+      if (i == ATTR_POSITION && packing->positions) {
+        float p[3];
+        uint16_t q[4] = { 0, 0, 0, 0xffff };
+        memcpy(p, src, sizeof(p));
+        for (int k = 0; k < 3; k++) {
+          q[k] = (uint16_t) roundf(CLAMP((p[k] - min[k]) / scale, 0.f, 1.f) * 65535.f);
+        }
+        memcpy(dst, q, sizeof(q));
+      } else if (i == ATTR_NORMAL && packing->normals) {
+        float n[3];
+        int16_t e[4] = { 0 };
+        memcpy(n, src, sizeof(n));
+        encodeOctahedral(n, e);
+        if (packing->tangents) {
+          float t[4];
+          memcpy(t, getAttributeData(data, tangent, v), sizeof(t));
+          encodeOctahedral(t, e + 2);
+          e[3] = (int16_t) ((e[3] & ~1) | (t[3] < 0.f));
+        }
+        memcpy(dst, e, sizeof(e));
+      } else if (i == ATTR_TEXCOORD && packing->texCoords) {
+        float uv[2];
+        memcpy(uv, src, sizeof(uv));
+        uint16_t q[2] = { (uint16_t) roundf(uv[0] * 65535.f), (uint16_t) roundf(uv[1] * 65535.f) };
+        memcpy(dst, q, sizeof(q));
+      } else {
+        memcpy(dst, src, getAttributeSize(attribute));
       }
+    }
+  }
+
+  packing->buffer = lovrBufferCreate(count * packing->stride, vertices, BUFFER_VERTEX, USAGE_STATIC, false);
+  free(vertices);
+  return true;
+}
 
-      for (uint32_t j = 0; j < MAX_MATERIAL_TEXTURES; j++) {
-        uint32_t index = data->materials[i].images[j];
+static void attachAttributes(ModelResources* resources, uint32_t index, Mesh* mesh) {
+  ModelData* data = resources->data;
+  ModelPrimitive* primitive = &data->primitives[index];
+  VertexPacking* packing = NULL;
 
-        if (index != ~0u) {
-          if (!model->textures[index]) {
-            Image* image = data->images[index];
-            bool srgb = j == TEXTURE_DIFFUSE || j == TEXTURE_EMISSIVE;
-            model->textures[index] = lovrTextureCreate(TEXTURE_2D, &image, 1, srgb, true, 0);
-            lovrTextureSetFilter(model->textures[index], data->materials[i].filters[j]);
-            lovrTextureSetWrap(model->textures[index], data->materials[i].wraps[j]);
+  if (resources->primitivePackings && resources->primitivePackings[index] != ~0u) {
+    packing = &resources->packings[resources->primitivePackings[index]];
+  }
+
+  bool setDrawRange = false;
+  for (uint32_t i = 0; i < MAX_DEFAULT_ATTRIBUTES; i++) {
+    if (primitive->attributes[i]) {
+      ModelAttribute* attribute = primitive->attributes[i];
+
+      if (packing) {
+        if (packing->offsets[i] != ~0u) {
+          MeshAttribute packed = {
+            .buffer = packing->buffer,
+            .offset = packing->offsets[i],
+            .stride = packing->stride,
+            .type = attribute->type,
+            .components = attribute->components,
+            .normalized = attribute->normalized
+          };
+
+          const char* name = lovrShaderAttributeNames[i];
+          if (i == ATTR_POSITION && packing->positions) {
+            packed.type = U16;
+            packed.normalized = true;
+          } else if (i == ATTR_NORMAL && packing->normals) {
+            name = "lovrPackedNormal";
+            packed.type = I16;
+            packed.components = 4;
+            packed.normalized = false;
+          } else if (i == ATTR_TEXCOORD && packing->texCoords) {
+            packed.type = U16;
+            packed.normalized = true;
           }
 
-          lovrMaterialSetTexture(material, j, model->textures[index]);
+          lovrMeshAttachAttribute(mesh, name, &packed);
         }
+      } else {
+        if (!resources->buffers[attribute->buffer]) {
+          ModelBuffer* buffer = &data->buffers[attribute->buffer];
+          resources->buffers[attribute->buffer] = lovrBufferCreate(buffer->size, buffer->data, BUFFER_VERTEX, USAGE_STATIC, false);
+        }
+
+        lovrMeshAttachAttribute(mesh, lovrShaderAttributeNames[i], &(MeshAttribute) {
+          .buffer = resources->buffers[attribute->buffer],
+          .offset = attribute->offset,
+          .stride = data->buffers[attribute->buffer].stride,
+          .type = attribute->type,
+          .components = attribute->components,
+          .normalized = attribute->normalized
+        });
+      }
+
+      if (!setDrawRange && !primitive->indices) {
+        lovrMeshSetDrawRange(mesh, 0, attribute->count);
+        setDrawRange = true;
+      }
+    }
+  }
+
+  lovrMeshAttachAttribute(mesh, "lovrDrawID", &(MeshAttribute) {
+    .buffer = lovrGraphicsGetIdentityBuffer(),
+    .type = U8,
+    .components = 1,
+    .divisor = 1
+  });
+}
+
+// Textures are shared, each Material that uses one retains it
+static Material* createMaterial(ModelResources* resources, uint32_t index) {
+  ModelData* data = resources->data;
+  ModelMaterial* info = &data->materials[index];
+  Material* material = lovrMaterialCreate();
+
+  for (uint32_t i = 0; i < MAX_MATERIAL_SCALARS; i++) {
+    lovrMaterialSetScalar(material, i, info->scalars[i]);
+  }
+
+  for (uint32_t i = 0; i < MAX_MATERIAL_COLORS; i++) {
+    lovrMaterialSetColor(material, i, info->colors[i]);
+  }
+
+  for (uint32_t i = 0; i < MAX_MATERIAL_TEXTURES; i++) {
+    uint32_t image = info->images[i];
+
+    if (image != ~0u) {
+      if (!resources->textures[image]) {
+        Image* pixels = data->images[image];
+        bool srgb = i == TEXTURE_DIFFUSE || i == TEXTURE_EMISSIVE;
+        resources->textures[image] = lovrTextureCreate(TEXTURE_2D, &pixels, 1, srgb, true, 0);
+        lovrTextureSetFilter(resources->textures[image], info->filters[i]);
+        lovrTextureSetWrap(resources->textures[image], info->wraps[i]);
       }
 
-      model->materials[i] = material;
+      lovrMaterialSetTexture(material, i, resources->textures[image]);
+    }
+  }
+
+  return material;
+}
+
+static ModelResources* createResources(ModelData* data, bool quantize) {
+  ModelResources* resources = calloc(1, sizeof(ModelResources));
+  lovrAssert(resources, "Out of memory");
+  resources->ref = 1;
+  resources->data = data;
+  resources->quantize = quantize;
+  resources->lodCount = data->lodCount;
+  memcpy(resources->lodRatios, data->lodRatios, sizeof(resources->lodRatios));
+
+  // Materials
+  if (data->materialCount > 0) {
+    resources->materials = malloc(data->materialCount * sizeof(Material*));
+    lovrAssert(resources->materials, "Out of memory");
+
+    if (data->imageCount > 0) {
+      resources->textures = calloc(data->imageCount, sizeof(Texture*));
+      lovrAssert(resources->textures, "Out of memory");
+    }
+
+    for (uint32_t i = 0; i < data->materialCount; i++) {
+      resources->materials[i] = createMaterial(resources, i);
     }
   }
 
   // Geometry
   if (data->primitiveCount > 0) {
     if (data->bufferCount > 0) {
-      model->buffers = calloc(data->bufferCount, sizeof(Buffer*));
+      resources->buffers = calloc(data->bufferCount, sizeof(Buffer*));
     }
 
-    model->meshes = calloc(data->primitiveCount, sizeof(Mesh*));
-    for (uint32_t i = 0; i < data->primitiveCount; i++) {
-      ModelPrimitive* primitive = &data->primitives[i];
-      uint32_t vertexCount = primitive->attributes[ATTR_POSITION] ? primitive->attributes[ATTR_POSITION]->count : 0;
-      model->meshes[i] = lovrMeshCreate(primitive->mode, NULL, vertexCount);
-
-      if (primitive->material != ~0u) {
-        lovrMeshSetMaterial(model->meshes[i], model->materials[primitive->material]);
+    resources->meshes = calloc(data->primitiveCount, sizeof(Mesh*));
+    resources->primitiveBounds = calloc(data->primitiveCount, 6 * sizeof(float));
+    lovrAssert(resources->meshes && resources->primitiveBounds, "Out of memory");
+
+    // Primitives with the same attributes share packed vertices
+    if (quantize) {
+      bool* skinned = calloc(data->primitiveCount, sizeof(bool));
+      resources->packings = malloc(data->primitiveCount * sizeof(VertexPacking));
+      resources->primitivePackings = malloc(data->primitiveCount * sizeof(uint32_t));
+      lovrAssert(skinned && resources->packings && resources->primitivePackings, "Out of memory");
+
+      for (uint32_t i = 0; i < data->nodeCount; i++) {
+        ModelNode* node = &data->nodes[i];
+        for (uint32_t j = 0; j < node->primitiveCount && node->skin != ~0u; j++) {
+          skinned[node->primitiveIndex + j] = true;
+        }
       }
 
-      bool setDrawRange = false;
-      for (uint32_t j = 0; j < MAX_DEFAULT_ATTRIBUTES; j++) {
-        if (primitive->attributes[j]) {
-          ModelAttribute* attribute = primitive->attributes[j];
+      for (uint32_t i = 0; i < data->primitiveCount; i++) {
+        ModelPrimitive* primitive = &data->primitives[i];
+        resources->primitivePackings[i] = ~0u;
 
-          if (!model->buffers[attribute->buffer]) {
-            ModelBuffer* buffer = &data->buffers[attribute->buffer];
-            model->buffers[attribute->buffer] = lovrBufferCreate(buffer->size, buffer->data, BUFFER_VERTEX, USAGE_STATIC, false);
+        for (uint32_t j = 0; j < resources->packingCount; j++) {
+          VertexPacking* packing = &resources->packings[j];
+          if (packing->skinned == skinned[i] && !memcmp(packing->attributes, primitive->attributes, sizeof(primitive->attributes))) {
+            resources->primitivePackings[i] = j;
+            break;
           }
+        }
 
-          lovrMeshAttachAttribute(model->meshes[i], lovrShaderAttributeNames[j], &(MeshAttribute) {
-            .buffer = model->buffers[attribute->buffer],
-            .offset = attribute->offset,
-            .stride = data->buffers[attribute->buffer].stride,
-            .type = attribute->type,
-            .components = attribute->components,
-            .normalized = attribute->normalized
-          });
+        if (resources->primitivePackings[i] == ~0u && packVertices(resources, primitive, skinned[i], &resources->packings[resources->packingCount])) {
+          resources->primitivePackings[i] = resources->packingCount++;
+        }
+      }
+
+      free(skinned);
+    }
 
-          if (!setDrawRange && !primitive->indices) {
-            lovrMeshSetDrawRange(model->meshes[i], 0, attribute->count);
-            setDrawRange = true;
+    for (uint32_t i = 0; i < data->primitiveCount; i++) {
+      ModelPrimitive* primitive = &data->primitives[i];
+      ModelAttribute* position = primitive->attributes[ATTR_POSITION];
+      uint32_t vertexCount = position ? position->count : 0;
+      resources->meshes[i] = lovrMeshCreate(primitive->mode, NULL, vertexCount);
+
+      if (position && position->hasMin && position->hasMax) {
+        float* bounds = resources->primitiveBounds + 6 * i;
+        bounds[0] = position->min[0];
+        bounds[1] = position->max[0];
+        bounds[2] = position->min[1];
+        bounds[3] = position->max[1];
+        bounds[4] = position->min[2];
+        bounds[5] = position->max[2];
+
+        // Culling happens with the dequantization transform applied, so bounds need to be quantized
+        if (resources->primitivePackings && resources->primitivePackings[i] != ~0u) {
+          float* dequantize = resources->packings[resources->primitivePackings[i]].dequantize;
+          for (int j = 0; j < 6; j++) {
+            bounds[j] = (bounds[j] - dequantize[12 + j / 2]) / dequantize[0];
           }
         }
       }
 
-      lovrMeshAttachAttribute(model->meshes[i], "lovrDrawID", &(MeshAttribute) {
-        .buffer = lovrGraphicsGetIdentityBuffer(),
-        .type = U8,
-        .components = 1,
-        .divisor = 1
-      });
+      if (primitive->material != ~0u) {
+        lovrMeshSetMaterial(resources->meshes[i], resources->materials[primitive->material]);
+      }
+
+      attachAttributes(resources, i, resources->meshes[i]);
 
       if (primitive->indices) {
         ModelAttribute* attribute = primitive->indices;
 
-        if (!model->buffers[attribute->buffer]) {
+        if (!resources->buffers[attribute->buffer]) {
           ModelBuffer* buffer = &data->buffers[attribute->buffer];
-          model->buffers[attribute->buffer] = lovrBufferCreate(buffer->size, buffer->data, BUFFER_INDEX, USAGE_STATIC, false);
+          resources->buffers[attribute->buffer] = lovrBufferCreate(buffer->size, buffer->data, BUFFER_INDEX, USAGE_STATIC, false);
         }
 
         size_t indexSize = attribute->type == U16 ? 2 : 4;
-        lovrMeshSetIndexBuffer(model->meshes[i], model->buffers[attribute->buffer], attribute->count, indexSize, attribute->offset);
-        lovrMeshSetDrawRange(model->meshes[i], 0, attribute->count);
+        lovrMeshSetIndexBuffer(resources->meshes[i], resources->buffers[attribute->buffer], attribute->count, indexSize, attribute->offset);
+        lovrMeshSetDrawRange(resources->meshes[i], 0, attribute->count);
       }
     }
   }
 
-  // Ensure skin bone count doesn't exceed the maximum supported limit
-  for (uint32_t i = 0; i < data->skinCount; i++) {
-    uint32_t jointCount = data->skins[i].jointCount;
-    lovrAssert(jointCount < MAX_BONES, "ModelData skin '%d' has too many joints (%d, max is %d)", i, jointCount, MAX_BONES);
+  // LOD meshes share vertex buffers with the full detail meshes, their indices are all in one buffer
+  if (resources->lodCount > 0 && data->primitiveCount > 0) {
+    resources->lodMeshes = calloc(data->lodCount * data->primitiveCount, sizeof(Mesh*));
+    lovrAssert(resources->lodMeshes, "Out of memory");
+
+    if (data->lodIndexCount > 0) {
+      resources->lodBuffer = lovrBufferCreate(data->lodIndexCount * sizeof(uint32_t), data->lodIndices, BUFFER_INDEX, USAGE_STATIC, false);
+    }
+
+    for (uint32_t level = 0; level < data->lodCount; level++) {
+      for (uint32_t i = 0; i < data->primitiveCount; i++) {
+        ModelPrimitive* primitive = &data->primitives[i];
+        uint32_t* range = data->lodRanges + 2 * (level * data->primitiveCount + i);
+        Mesh** mesh = &resources->lodMeshes[level * data->primitiveCount + i];
+
+        if (range[1] == 0) {
+          *mesh = level == 0 ? resources->meshes[i] : resources->lodMeshes[(level - 1) * data->primitiveCount + i];
+          lovrRetain(*mesh);
+          continue;
+        }
+
+        *mesh = lovrMeshCreate(primitive->mode, NULL, primitive->attributes[ATTR_POSITION]->count);
+
+        if (primitive->material != ~0u) {
+          lovrMeshSetMaterial(*mesh, resources->materials[primitive->material]);
+        }
+
+        attachAttributes(resources, i, *mesh);
+        lovrMeshSetIndexBuffer(*mesh, resources->lodBuffer, range[1], sizeof(uint32_t), range[0] * sizeof(uint32_t));
+        lovrMeshSetDrawRange(*mesh, 0, range[1]);
+      }
+    }
   }
 
-  model->localTransforms = malloc(sizeof(NodeTransform) * data->nodeCount);
-  model->globalTransforms = malloc(16 * sizeof(float) * data->nodeCount);
-  lovrModelResetPose(model);
-  return model;
+  return resources;
 }
 
-void lovrModelDestroy(void* ref) {
-  Model* model = ref;
+static void destroyResources(void* ref) {
+  ModelResources* resources = ref;
+  ModelData* data = resources->data;
+
+  if (data->resources == resources) {
+    data->resources = NULL;
+  }
+
+  if (resources->buffers) {
+    for (uint32_t i = 0; i < data->bufferCount; i++) {
+      lovrRelease(resources->buffers[i], lovrBufferDestroy);
+    }
+    free(resources->buffers);
+  }
+
+  if (resources->meshes) {
+    for (uint32_t i = 0; i < data->primitiveCount; i++) {
+      lovrRelease(resources->meshes[i], lovrMeshDestroy);
+    }
+    free(resources->meshes);
+  }
+
+  if (resources->lodMeshes) {
+    for (uint32_t i = 0; i < resources->lodCount * data->primitiveCount; i++) {
+      lovrRelease(resources->lodMeshes[i], lovrMeshDestroy);
+    }
+    free(resources->lodMeshes);
+  }
+
+  lovrRelease(resources->lodBuffer, lovrBufferDestroy);
 
-  if (model->buffers) {
-    for (uint32_t i = 0; i < model->data->bufferCount; i++) {
-      lovrRelease(model->buffers[i], lovrBufferDestroy);
+  for (uint32_t i = 0; i < resources->packingCount; i++) {
+    lovrRelease(resources->packings[i].buffer, lovrBufferDestroy);
+  }
+  free(resources->packings);
+  free(resources->primitivePackings);
+
+  if (resources->textures) {
+    for (uint32_t i = 0; i < data->imageCount; i++) {
+      lovrRelease(resources->textures[i], lovrTextureDestroy);
+    }
+    free(resources->textures);
+  }
+
+  if (resources->materials) {
+    for (uint32_t i = 0; i < data->materialCount; i++) {
+      lovrRelease(resources->materials[i], lovrMaterialDestroy);
     }
-    free(model->buffers);
+    free(resources->materials);
+  }
+
+  free(resources->primitiveBounds);
+  free(resources);
+}
+
+Model* lovrModelCreate(ModelData* data, bool quantize, bool sharedMaterials) {
+  Model* model = calloc(1, sizeof(Model));
+  lovrAssert(model, "Out of memory");
+  model->ref = 1;
+  model->data = data;
+  lovrRetain(data);
+
+  // Resources are shared with other Models created from the ModelData, when they're compatible
+  if (data->resources && data->resources->quantize == quantize) {
+    model->resources = data->resources;
+    lovrRetain(model->resources);
+  } else {
+    model->resources = createResources(data, quantize);
+    data->resources = data->resources ? data->resources : model->resources;
   }
 
-  if (model->meshes) {
-    for (uint32_t i = 0; i < model->data->primitiveCount; i++) {
-      lovrRelease(model->meshes[i], lovrMeshDestroy);
+  // Each Model gets its own copy of the materials unless they're shared, textures are always shared
+  if (data->materialCount > 0) {
+    model->defaults = malloc(data->materialCount * sizeof(Material*));
+    model->materials = malloc(data->materialCount * sizeof(Material*));
+    lovrAssert(model->defaults && model->materials, "Out of memory");
+    for (uint32_t i = 0; i < data->materialCount; i++) {
+      if (sharedMaterials) {
+        model->defaults[i] = model->resources->materials[i];
+        lovrRetain(model->defaults[i]);
+      } else {
+        model->defaults[i] = createMaterial(model->resources, i);
+      }
+      model->materials[i] = model->defaults[i];
+      lovrRetain(model->materials[i]);
     }
-    free(model->meshes);
   }
 
-  if (model->textures) {
-    for (uint32_t i = 0; i < model->data->imageCount; i++) {
-      lovrRelease(model->textures[i], lovrTextureDestroy);
+  // Ensure skin bone count doesn't exceed the maximum supported limit
+  for (uint32_t i = 0; i < data->skinCount; i++) {
+    uint32_t jointCount = data->skins[i].jointCount;
+    lovrAssert(jointCount <= MAX_BONES, "ModelData skin '%d' has too many joints (%d, max is %d)", i, jointCount, MAX_BONES);
+  }
+
+  // Skinned nodes get a slot in the pose buffer, which is only rewritten when transforms change
+  model->poseSlots = malloc(sizeof(uint32_t) * data->nodeCount);
+  lovrAssert(model->poseSlots, "Out of memory");
+  for (uint32_t i = 0; i < data->nodeCount; i++) {
+    model->poseSlots[i] = data->nodes[i].skin == ~0u ? ~0u : model->poseCount++;
+  }
+
+  // Keyframe cursors are indexed by channel, blend slots by node property
+  model->keyframeCursors = calloc(data->channelCount, sizeof(uint32_t));
+  model->blendSums = malloc(3 * data->nodeCount * sizeof(float[4]));
+  model->blendWeights = calloc(3 * data->nodeCount, sizeof(float));
+  model->blendSlots = malloc(3 * data->nodeCount * sizeof(uint32_t));
+  lovrAssert(model->blendSums && model->blendWeights && model->blendSlots, "Out of memory");
+  lovrAssert(model->keyframeCursors || data->channelCount == 0, "Out of memory");
+
+  if (model->poseCount > 0) {
+    size_t size = model->poseCount * MAX_BONES * 16 * sizeof(float);
+    model->poses = calloc(1, size);
+    lovrAssert(model->poses, "Out of memory");
+    model->poseBuffer = lovrBufferCreate(POSE_VERSIONS * size, NULL, BUFFER_UNIFORM, USAGE_DYNAMIC, false);
+  }
+
+  model->localTransforms = malloc(sizeof(NodeTransform) * data->nodeCount);
+  model->globalTransforms = malloc(16 * sizeof(float) * data->nodeCount);
+  model->nodeBounds = malloc(6 * sizeof(float) * data->nodeCount);
+  model->cullable = malloc(sizeof(bool) * data->nodeCount);
+  model->nodeOrder = malloc(sizeof(uint32_t) * data->nodeCount);
+  model->nodeParents = malloc(sizeof(uint32_t) * data->nodeCount);
+  model->nodeFlags = calloc(data->nodeCount, sizeof(uint8_t));
+  lovrAssert(model->localTransforms && model->globalTransforms && model->nodeBounds && model->cullable, "Out of memory");
+  lovrAssert(model->nodeOrder && model->nodeParents && model->nodeFlags, "Out of memory");
+  initCulling(model, data->rootNode);
+
+  // Every node gets a transform, including ones that aren't reachable from the root node
+  uint32_t orderCount = 0;
+  for (uint32_t i = 0; i < data->nodeCount; i++) {
+    model->nodeParents[i] = ~0u;
+  }
+  for (uint32_t i = 0; i < data->nodeCount; i++) {
+    for (uint32_t j = 0; j < data->nodes[i].childCount; j++) {
+      model->nodeParents[data->nodes[i].children[j]] = i;
+    }
+  }
+  initNodeOrder(model, data->rootNode, ~0u, &orderCount);
+  for (uint32_t i = 0; i < data->nodeCount; i++) {
+    if (i != data->rootNode && model->nodeParents[i] == ~0u) {
+      initNodeOrder(model, i, ~0u, &orderCount);
     }
-    free(model->textures);
   }
+  lovrAssert(orderCount == data->nodeCount, "ModelData node hierarchy is not a tree");
+  model->culling = true;
+  model->lodScale = 1.f;
+  lovrModelResetPose(model);
+  return model;
+}
+
+void lovrModelDestroy(void* ref) {
+  Model* model = ref;
 
   if (model->materials) {
     for (uint32_t i = 0; i < model->data->materialCount; i++) {
       lovrRelease(model->materials[i], lovrMaterialDestroy);
+      lovrRelease(model->defaults[i], lovrMaterialDestroy);
     }
     free(model->materials);
+    free(model->defaults);
   }
 
+  lovrRelease(model->resources, destroyResources);
+  lovrRelease(model->poseBuffer, lovrBufferDestroy);
   lovrRelease(model->data, lovrModelDataDestroy);
   free(model->globalTransforms);
   free(model->localTransforms);
+  free(model->nodeOrder);
+  free(model->nodeParents);
+  free(model->nodeFlags);
+  free(model->poseSlots);
+  free(model->poses);
+  free(model->keyframeCursors);
+  free(model->blendSums);
+  free(model->blendWeights);
+  free(model->blendSlots);
+  free(model->nodeBounds);
+  free(model->cullable);
   free(model);
 }
 
@@ -242,16 +902,108 @@ ModelData* lovrModelGetModelData(Model* model) {
   return model->data;
 }
 
-void lovrModelDraw(Model* model, mat4 transform, uint32_t instances) {
-  if (model->transformsDirty) {
-    updateGlobalTransform(model, model->data->rootNode, (float[]) MAT4_IDENTITY);
-    model->transformsDirty = false;
+void lovrModelDraw(Model* model, mat4 transform, uint32_t instances, InstanceData* instanceData) {
+  PROFILE_BEGIN("Model draw");
+
+  updateTransforms(model);
+  if (model->posesDirty) {
+    updatePoses(model);
+  }
+  if (model->posesPending) {
+    uploadPoses(model);
   }
 
   lovrGraphicsPush();
   lovrGraphicsMatrixTransform(transform);
-  renderNode(model, model->data->rootNode, instances);
+  renderNode(model, model->data->rootNode, instances, instanceData);
   lovrGraphicsPop();
+  PROFILE_END();
+}
+
+// Returns the first keyframe at or after the time.  Playback usually moves forward by a keyframe
+// or two per call, so the previous result is checked first and seeking falls back to a binary search.
+static uint32_t findKeyframe(ModelAnimationChannel* channel, float time, uint32_t* cursor) {
+  uint32_t count = channel->keyframeCount;
+  uint32_t keyframe = MIN(*cursor, count);
+
+  if (keyframe == 0 || lovrModelDataGetKeyframeTime(channel, keyframe - 1) < time) {
+    for (int i = 0; i < 2 && keyframe < count && lovrModelDataGetKeyframeTime(channel, keyframe) < time; i++) {
+      keyframe++;
+    }
+
+    if (keyframe == count || lovrModelDataGetKeyframeTime(channel, keyframe) >= time) {
+      return *cursor = keyframe;
+    }
+  }
+
+  uint32_t lo = 0;
+  uint32_t hi = count;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (lovrModelDataGetKeyframeTime(channel, mid) < time) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return *cursor = lo;
+}
+
+static void sampleChannel(Model* model, ModelAnimationChannel* channel, float time, float property[4]) {
+  uint32_t* cursor = &model->keyframeCursors[channel - model->data->channels];
+  uint32_t keyframe = findKeyframe(channel, time, cursor);
+  bool rotate = channel->property == PROP_ROTATION;
+  size_t n = 3 + rotate;
+  float* (*lerp)(float* a, float* b, float t) = rotate ? quat_slerp : vec3_lerp;
+
+  if (keyframe == 0 || keyframe >= channel->keyframeCount) {
+    size_t index = MIN(keyframe, channel->keyframeCount - 1);
+
+    // For cubic interpolation, each keyframe has 3 parts, and the actual data is in the middle (*3, +1)
+    if (channel->smoothing == SMOOTH_CUBIC) {
+      index = 3 * index + 1;
+    }
+
+    lovrModelDataGetKeyframeValue(channel, index, property);
+  } else {
+    float t1 = lovrModelDataGetKeyframeTime(channel, keyframe - 1);
+    float t2 = lovrModelDataGetKeyframeTime(channel, keyframe);
+    float z = (time - t1) / (t2 - t1);
+
+    switch (channel->smoothing) {
+      case SMOOTH_STEP:
+        lovrModelDataGetKeyframeValue(channel, z >= .5f ? keyframe : keyframe - 1, property);
+        break;
+      case SMOOTH_LINEAR: {
+        float next[4];
+        lovrModelDataGetKeyframeValue(channel, keyframe - 1, property);
+        lovrModelDataGetKeyframeValue(channel, keyframe, next);
+        lerp(property, next, z);
+        break;
+      }
+      case SMOOTH_CUBIC: {
+        float p0[4], m0[4], p1[4], m1[4];
+        lovrModelDataGetKeyframeValue(channel, 3 * (keyframe - 1) + 1, p0);
+        lovrModelDataGetKeyframeValue(channel, 3 * (keyframe - 1) + 2, m0);
+        lovrModelDataGetKeyframeValue(channel, 3 * keyframe + 1, p1);
+        lovrModelDataGetKeyframeValue(channel, 3 * keyframe + 0, m1);
+        float dt = t2 - t1;
+        float z2 = z * z;
+        float z3 = z2 * z;
+        float a = 2.f * z3 - 3.f * z2 + 1.f;
+        float b = 2.f * z3 - 3.f * z2 + 1.f;
+        float c = (-2.f * z3 + 3.f * z2);
+        float d = (z3 * -z2) * dt;
+        for (size_t j = 0; j < n; j++) {
+          property[j] = a * p0[j] + b * m0[j] + c * p1[j] + d * m1[j];
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
 }
 
 void lovrModelAnimate(Model* model, uint32_t animationIndex, float time, float alpha) {
@@ -262,75 +1014,172 @@ void lovrModelAnimate(Model* model, uint32_t animationIndex, float time, float a
   lovrAssert(animationIndex < model->data->animationCount, "Invalid animation index '%d' (Model only has %d animations)", animationIndex, model->data->animationCount);
   ModelAnimation* animation = &model->data->animations[animationIndex];
   time = fmodf(time, animation->duration);
+  PROFILE_BEGIN("Model animate");
 
   for (uint32_t i = 0; i < animation->channelCount; i++) {
     ModelAnimationChannel* channel = &animation->channels[i];
     uint32_t nodeIndex = channel->nodeIndex;
     NodeTransform* transform = &model->localTransforms[nodeIndex];
+    bool rotate = channel->property == PROP_ROTATION;
+    size_t n = 3 + rotate;
 
-    uint32_t keyframe = 0;
-    while (keyframe < channel->keyframeCount && channel->times[keyframe] < time) {
-      keyframe++;
+    float property[4];
+    sampleChannel(model, channel, time, property);
+
+    if (alpha >= 1.f) {
+      memcpy(transform->properties[channel->property], property, n * sizeof(float));
+    } else if (rotate) {
+      quat_slerp(transform->properties[channel->property], property, alpha);
+    } else {
+      vec3_lerp(transform->properties[channel->property], property, alpha);
     }
 
-    float property[4];
-    bool rotate = channel->property == PROP_ROTATION;
-    size_t n = 3 + rotate;
-    float* (*lerp)(float* a, float* b, float t) = rotate ? quat_slerp : vec3_lerp;
+    markDirty(model, nodeIndex);
+  }
+
+  PROFILE_END();
+}
 
-    if (keyframe == 0 || keyframe >= channel->keyframeCount) {
-      size_t index = MIN(keyframe, channel->keyframeCount - 1);
+// Samples are accumulated per node property, weighted by each animation's weight.  Properties end
+// up at the weighted average of the animations that touch them, which is then blended with the
+// current pose by the total weight (capped at 1), like the alpha of lovrModelAnimate.
+void lovrModelBlend(Model* model, AnimationBlend* blends, uint32_t count) {
+  PROFILE_BEGIN("Model blend");
+  float (*sums)[4] = model->blendSums;
+  float* weights = model->blendWeights;
+  uint32_t touched = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t animationIndex = blends[i].animation;
+    lovrAssert(animationIndex < model->data->animationCount, "Invalid animation index '%d' (Model only has %d animations)", animationIndex, model->data->animationCount);
+    ModelAnimation* animation = &model->data->animations[animationIndex];
+    float time = fmodf(blends[i].time, animation->duration);
+    float weight = blends[i].weight;
+
+    if (weight <= 0.f) {
+      continue;
+    }
+
+    for (uint32_t j = 0; j < animation->channelCount; j++) {
+      ModelAnimationChannel* channel = &animation->channels[j];
+      uint32_t slot = 3 * channel->nodeIndex + channel->property;
+      float property[4];
+      sampleChannel(model, channel, time, property);
 
-      // For cubic interpolation, each keyframe has 3 parts, and the actual data is in the middle (*3, +1)
-      if (channel->smoothing == SMOOTH_CUBIC) {
-        index = 3 * index + 1;
+      if (weights[slot] == 0.f) {
+        model->blendSlots[touched++] = slot;
+        memset(sums[slot], 0, sizeof(sums[slot]));
       }
 
-      memcpy(property, channel->data + index * n, n * sizeof(float));
-    } else {
-      float t1 = channel->times[keyframe - 1];
-      float t2 = channel->times[keyframe];
-      float z = (time - t1) / (t2 - t1);
-
-      switch (channel->smoothing) {
-        case SMOOTH_STEP:
-          memcpy(property, channel->data + (z >= .5f ? keyframe : keyframe - 1) * n, n * sizeof(float));
-          break;
-        case SMOOTH_LINEAR:
-          memcpy(property, channel->data + (keyframe - 1) * n, n * sizeof(float));
-          lerp(property, channel->data + keyframe * n, z);
-          break;
-        case SMOOTH_CUBIC: {
-          size_t stride = 3 * n;
-          float* p0 = channel->data + (keyframe - 1) * stride + 1 * n;
-          float* m0 = channel->data + (keyframe - 1) * stride + 2 * n;
-          float* p1 = channel->data + (keyframe - 0) * stride + 1 * n;
-          float* m1 = channel->data + (keyframe - 0) * stride + 0 * n;
-          float dt = t2 - t1;
-          float z2 = z * z;
-          float z3 = z2 * z;
-          float a = 2.f * z3 - 3.f * z2 + 1.f;
-          float b = 2.f * z3 - 3.f * z2 + 1.f;
-          float c = (-2.f * z3 + 3.f * z2);
-          float d = (z3 * -z2) * dt;
-          for (size_t j = 0; j < n; j++) {
-            property[j] = a * p0[j] + b * m0[j] + c * p1[j] + d * m1[j];
-          }
-          break;
-        }
-        default:
-          break;
+      // Quaternions are summed in the same hemisphere and normalized afterwards
+      int n = channel->property == PROP_ROTATION ? 4 : 3;
+      float w = weight;
+      if (n == 4 && weights[slot] > 0.f) {
+        float* q = sums[slot];
+        float dot = q[0] * property[0] + q[1] * property[1] + q[2] * property[2] + q[3] * property[3];
+        w = dot < 0.f ? -w : w;
       }
+
+      for (int k = 0; k < n; k++) {
+        sums[slot][k] += property[k] * w;
+      }
+
+      weights[slot] += weight;
     }
+  }
 
-    if (alpha >= 1.f) {
-      memcpy(transform->properties[channel->property], property, n * sizeof(float));
+  for (uint32_t i = 0; i < touched; i++) {
+    uint32_t slot = model->blendSlots[i];
+    uint32_t nodeIndex = slot / 3;
+    AnimationProperty property = slot % 3;
+    float* target = model->localTransforms[nodeIndex].properties[property];
+    float* value = sums[slot];
+    float alpha = MIN(weights[slot], 1.f);
+
+    if (property == PROP_ROTATION) {
+      quat_normalize(value);
+      quat_slerp(target, value, alpha);
     } else {
-      lerp(transform->properties[channel->property], property, alpha);
+      vec3_scale(value, 1.f / weights[slot]);
+      vec3_lerp(target, value, alpha);
     }
+
+    weights[slot] = 0.f;
+    markDirty(model, nodeIndex);
   }
 
-  model->transformsDirty = true;
+  PROFILE_END();
+}
+
+typedef struct {
+  AnimationRequest* requests;
+  uint32_t count;
+  uint32_t group;
+} AnimationJob;
+
+// Does everything lovrModelAnimate and lovrModelDraw would do on the CPU, for one group of Models
+static void animateGroup(void* arg) {
+  AnimationJob* job = arg;
+  PROFILE_BEGIN("Model animate group");
+
+  for (uint32_t i = 0; i < job->count; i++) {
+    if (job->requests[i].group == job->group) {
+      AnimationRequest* request = &job->requests[i];
+      lovrModelAnimate(request->model, request->animation, request->time, request->alpha);
+    }
+  }
+
+  for (uint32_t i = 0; i < job->count; i++) {
+    if (job->requests[i].group == job->group) {
+      Model* model = job->requests[i].model;
+      updateTransforms(model);
+      if (model->posesDirty) {
+        updatePoses(model);
+      }
+    }
+  }
+
+  PROFILE_END();
+}
+
+// Every request for a Model goes to the same group and keeps its order, so the results match
+// calling lovrModelAnimate for each request.  Poses are uploaded when the Models are drawn.
+void lovrModelAnimateAll(AnimationRequest* requests, uint32_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    Model* model = requests[i].model;
+    uint32_t animation = requests[i].animation;
+    lovrAssert(animation < model->data->animationCount, "Invalid animation index '%d' (Model only has %d animations)", animation, model->data->animationCount);
+  }
+
+  map_t models;
+  map_init(&models, 0);
+  uint32_t groupCount = MIN(job_get_worker_count() + 1, JOB_MAX_WORKERS + 1);
+  uint32_t modelCount = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    Model* model = requests[i].model;
+    uint64_t hash = hash64(&model, sizeof(model));
+    uint64_t group = map_get(&models, hash);
+    if (group == MAP_NIL) {
+      group = modelCount++ % groupCount;
+      map_set(&models, hash, group);
+    }
+    requests[i].group = (uint32_t) group;
+  }
+
+  map_free(&models);
+  groupCount = MIN(groupCount, modelCount);
+
+  AnimationJob jobs[JOB_MAX_WORKERS + 1];
+  for (uint32_t i = 0; i < groupCount; i++) {
+    jobs[i] = (AnimationJob) { requests, count, i };
+  }
+
+  job_run_all(animateGroup, jobs, sizeof(AnimationJob), groupCount);
 }
 
 void lovrModelGetNodePose(Model* model, uint32_t nodeIndex, float position[4], float rotation[4], CoordinateSpace space) {
@@ -339,10 +1188,7 @@ void lovrModelGetNodePose(Model* model, uint32_t nodeIndex, float position[4], f
     vec3_init(position, model->localTransforms[nodeIndex].properties[PROP_TRANSLATION]);
     quat_init(rotation, model->localTransforms[nodeIndex].properties[PROP_ROTATION]);
   } else {
-    if (model->transformsDirty) {
-      updateGlobalTransform(model, model->data->rootNode, (float[]) MAT4_IDENTITY);
-      model->transformsDirty = false;
-    }
+    updateTransforms(model);
 
     mat4_getPosition(model->globalTransforms + 16 * nodeIndex, position);
     mat4_getOrientation(model->globalTransforms + 16 * nodeIndex, rotation);
@@ -363,7 +1209,7 @@ void lovrModelPose(Model* model, uint32_t nodeIndex, float position[4], float ro
     vec3_lerp(transform->properties[PROP_TRANSLATION], position, alpha);
     quat_slerp(transform->properties[PROP_ROTATION], rotation, alpha);
   }
-  model->transformsDirty = true;
+  markDirty(model, nodeIndex);
 }
 
 void lovrModelResetPose(Model* model) {
@@ -377,9 +1223,10 @@ void lovrModelResetPose(Model* model) {
       quat_init(model->localTransforms[i].properties[PROP_ROTATION], model->data->nodes[i].transform.properties.rotation);
       vec3_init(model->localTransforms[i].properties[PROP_SCALE], model->data->nodes[i].transform.properties.scale);
     }
+
+    markDirty(model, i);
   }
 
-  model->transformsDirty = true;
 }
 
 Material* lovrModelGetMaterial(Model* model, uint32_t material) {
@@ -387,58 +1234,34 @@ Material* lovrModelGetMaterial(Model* model, uint32_t material) {
   return model->materials[material];
 }
 
-static void applyAABB(Model* model, uint32_t nodeIndex, float aabb[6]) {
-  ModelNode* node = &model->data->nodes[nodeIndex];
-
-  for (uint32_t i = 0; i < node->primitiveCount; i++) {
-    ModelAttribute* position = model->data->primitives[node->primitiveIndex + i].attributes[ATTR_POSITION];
-    if (position && position->hasMin && position->hasMax) {
-      mat4 m = model->globalTransforms + 16 * nodeIndex;
-
-      float xa[3] = { position->min[0] * m[0], position->min[0] * m[1], position->min[0] * m[2] };
-      float xb[3] = { position->max[0] * m[0], position->max[0] * m[1], position->max[0] * m[2] };
-
-      float ya[3] = { position->min[1] * m[4], position->min[1] * m[5], position->min[1] * m[6] };
-      float yb[3] = { position->max[1] * m[4], position->max[1] * m[5], position->max[1] * m[6] };
-
-      float za[3] = { position->min[2] * m[8], position->min[2] * m[9], position->min[2] * m[10] };
-      float zb[3] = { position->max[2] * m[8], position->max[2] * m[9], position->max[2] * m[10] };
+void lovrModelSetMaterial(Model* model, uint32_t material, Material* override) {
+  lovrAssert(material < model->data->materialCount, "Invalid material index '%d' (Model only has %d material%s)", material + 1, model->data->materialCount, model->data->materialCount == 1 ? "" : "s");
+  override = override ? override : model->defaults[material];
+  lovrRetain(override);
+  lovrRelease(model->materials[material], lovrMaterialDestroy);
+  model->materials[material] = override;
+}
 
-      float min[3] = {
-        MIN(xa[0], xb[0]) + MIN(ya[0], yb[0]) + MIN(za[0], zb[0]) + m[12],
-        MIN(xa[1], xb[1]) + MIN(ya[1], yb[1]) + MIN(za[1], zb[1]) + m[13],
-        MIN(xa[2], xb[2]) + MIN(ya[2], yb[2]) + MIN(za[2], zb[2]) + m[14]
-      };
+void lovrModelGetAABB(Model* model, float aabb[6]) {
+  updateTransforms(model);
 
-      float max[3] = {
-        MAX(xa[0], xb[0]) + MAX(ya[0], yb[0]) + MAX(za[0], zb[0]) + m[12],
-        MAX(xa[1], xb[1]) + MAX(ya[1], yb[1]) + MAX(za[1], zb[1]) + m[13],
-        MAX(xa[2], xb[2]) + MAX(ya[2], yb[2]) + MAX(za[2], zb[2]) + m[14]
-      };
+  memcpy(aabb, model->nodeBounds + 6 * model->data->rootNode, 6 * sizeof(float));
+}
 
-      aabb[0] = MIN(aabb[0], min[0]);
-      aabb[1] = MAX(aabb[1], max[0]);
-      aabb[2] = MIN(aabb[2], min[1]);
-      aabb[3] = MAX(aabb[3], max[1]);
-      aabb[4] = MIN(aabb[4], min[2]);
-      aabb[5] = MAX(aabb[5], max[2]);
-    }
-  }
+bool lovrModelIsCulling(Model* model) {
+  return model->culling;
+}
 
-  for (uint32_t i = 0; i < node->childCount; i++) {
-    applyAABB(model, node->children[i], aabb);
-  }
+void lovrModelSetCulling(Model* model, bool culling) {
+  model->culling = culling;
 }
 
-void lovrModelGetAABB(Model* model, float aabb[6]) {
-  if (model->transformsDirty) {
-    updateGlobalTransform(model, model->data->rootNode, (float[]) MAT4_IDENTITY);
-    model->transformsDirty = false;
-  }
+float lovrModelGetLodScale(Model* model) {
+  return model->lodScale;
+}
 
-  aabb[0] = aabb[2] = aabb[4] = FLT_MAX;
-  aabb[1] = aabb[3] = aabb[5] = -FLT_MAX;
-  applyAABB(model, model->data->rootNode, aabb);
+void lovrModelSetLodScale(Model* model, float scale) {
+  model->lodScale = scale;
 }
 
 static void countVertices(Model* model, uint32_t nodeIndex, uint32_t* vertexCount, uint32_t* indexCount) {
@@ -511,10 +1334,7 @@ static void collectVertices(Model* model, uint32_t nodeIndex, float** vertices,
 }
 
 void lovrModelGetTriangles(Model* model, float** vertices, uint32_t* vertexCount, uint32_t** indices, uint32_t* indexCount) {
-  if (model->transformsDirty) {
-    updateGlobalTransform(model, model->data->rootNode, (float[]) MAT4_IDENTITY);
-    model->transformsDirty = false;
-  }
+  updateTransforms(model);
 
   if (!model->vertices) {
     countVertices(model, model->data->rootNode, &model->vertexCount, &model->indexCount);
@@ -5,21 +5,44 @@
 
 struct Material;
 struct ModelData;
+struct InstanceData;
 
 typedef enum {
   SPACE_LOCAL,
   SPACE_GLOBAL
 } CoordinateSpace;
 
+typedef struct {
+  uint32_t animation;
+  float time;
+  float weight;
+} AnimationBlend;
+
 typedef struct Model Model;
-Model* lovrModelCreate(struct ModelData* data);
+
+typedef struct {
+  Model* model;
+  uint32_t animation;
+  float time;
+  float alpha;
+  uint32_t group;
+} AnimationRequest;
+
+Model* lovrModelCreate(struct ModelData* data, bool quantize, bool sharedMaterials);
 void lovrModelDestroy(void* ref);
 struct ModelData* lovrModelGetModelData(Model* model);
-void lovrModelDraw(Model* model, float* transform, uint32_t instances);
+void lovrModelDraw(Model* model, float* transform, uint32_t instances, struct InstanceData* instanceData);
 void lovrModelAnimate(Model* model, uint32_t animationIndex, float time, float alpha);
+void lovrModelBlend(Model* model, AnimationBlend* blends, uint32_t count);
+void lovrModelAnimateAll(AnimationRequest* requests, uint32_t count);
 void lovrModelGetNodePose(Model* model, uint32_t nodeIndex, float position[4], float rotation[4], CoordinateSpace space);
 void lovrModelPose(Model* model, uint32_t nodeIndex, float position[4], float rotation[4], float alpha);
 void lovrModelResetPose(Model* model);
 struct Material* lovrModelGetMaterial(Model* model, uint32_t material);
+void lovrModelSetMaterial(Model* model, uint32_t material, struct Material* override);
 void lovrModelGetAABB(Model* model, float aabb[6]);
+bool lovrModelIsCulling(Model* model);
+void lovrModelSetCulling(Model* model, bool culling);
+float lovrModelGetLodScale(Model* model);
+void lovrModelSetLodScale(Model* model, float scale);
 void lovrModelGetTriangles(Model* model, float** vertices, uint32_t* vertexCount, uint32_t** indices, uint32_t* indexCount);
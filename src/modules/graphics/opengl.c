@@ -8,6 +8,10 @@
 #include "data/blob.h"
 #include "data/modelData.h"
 #include "math/math.h"
+#include "core/fs.h"
+#include "core/job.h"
+#include "core/os.h"
+#include "core/profile.h"
 #include "shaders.h"
 #include <math.h>
 #include <limits.h>
@@ -24,11 +28,20 @@
 #include "lib/glad/glad.h"
 #endif
 
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 // Types
 
 #define MAX_TEXTURES 16
 #define MAX_IMAGES 8
 #define MAX_BLOCK_BUFFERS 8
+#define MAX_BUFFER_LOCKS 4
+#define MAX_GPU_ZONES 256
+#define MAX_STREAM_SLICES 6
+#define STREAM_FRAMES 3
 
 #define LOVR_SHADER_POSITION 0
 #define LOVR_SHADER_NORMAL 1
@@ -38,6 +51,15 @@
 #define LOVR_SHADER_BONES 5
 #define LOVR_SHADER_BONE_WEIGHTS 6
 #define LOVR_SHADER_DRAW_ID 7
+#define LOVR_SHADER_INSTANCE_COLOR 8
+#define LOVR_SHADER_INSTANCE_TRANSFORM 9
+#define LOVR_SHADER_PACKED_NORMAL 13
+
+typedef struct {
+  size_t offset;
+  size_t size;
+  GLsync sync;
+} BufferLock;
 
 struct Buffer {
   uint32_t ref;
@@ -50,7 +72,9 @@ struct Buffer {
   BufferUsage usage;
   bool mapped;
   bool readable;
+  bool persistent;
   uint8_t incoherent;
+  BufferLock locks[MAX_BUFFER_LOCKS];
 };
 
 struct Texture {
@@ -73,6 +97,7 @@ struct Texture {
   bool allocated;
   bool native;
   uint8_t incoherent;
+  struct TextureStream* stream;
 };
 
 struct Canvas {
@@ -99,16 +124,43 @@ struct ShaderBlock {
   struct Buffer* buffer;
 };
 
+// Uniforms and blocks sent before the program finished linking, applied in order when it does
+typedef enum {
+  PENDING_UNIFORM,
+  PENDING_VALUE,
+  PENDING_BLOCK
+} PendingKind;
+
+typedef struct {
+  char name[LOVR_MAX_UNIFORM_LENGTH];
+  PendingKind kind;
+  UniformType type;
+  int start;
+  int count;
+  int size;
+  void* data;
+  UniformValue value;
+  struct Buffer* buffer;
+  size_t offset;
+  size_t extent;
+  UniformAccess access;
+} PendingUniform;
+
 struct Shader {
   uint32_t ref;
   uint32_t program;
+  uint32_t stages[2];
+  uint64_t key;
   ShaderType type;
   arr_uniform_t uniforms;
   arr_block_t blocks[2];
   map_t attributes;
   map_t uniformMap;
   map_t blockMap;
+  arr_t(PendingUniform) pending;
   bool multiview;
+  bool standard;
+  bool ready;
 };
 
 struct Mesh {
@@ -162,6 +214,67 @@ typedef struct {
   uint64_t nanoseconds;
 } Timer;
 
+// Ring of timestamp queries, names are NULL for the end of a zone
+typedef struct {
+  GLuint queries[MAX_GPU_ZONES];
+  const char* names[MAX_GPU_ZONES];
+  uint32_t head;
+  uint32_t tail;
+  uint32_t depth;
+  uint32_t dropped;
+} ZoneQueries;
+
+// Decoded on a worker, mipmaps holds levels 1+ for RGBA8 images (the GPU generates them otherwise)
+typedef struct {
+  Blob* blob;
+  Image* image;
+  uint8_t* mipmaps;
+  bool flip;
+  bool srgb;
+  bool generateMipmaps;
+} StreamSlice;
+
+// Levels are uploaded from the coarsest one down, a few rows at a time.  A stream that fails to
+// decode keeps its error and throws it whenever the Texture is used or polled.
+typedef struct TextureStream {
+  StreamSlice slices[MAX_STREAM_SLICES];
+  Job* job;
+  char error[256];
+  uint32_t sliceCount;
+  uint32_t levelCount;
+  uint32_t level;
+  uint32_t slice;
+  uint32_t row;
+  bool decoded;
+  bool visible;
+  bool done;
+} TextureStream;
+
+typedef struct {
+  Texture* texture;
+  const void* data;
+  size_t size;
+  uint32_t level;
+  uint32_t slice;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+  bool buffered;
+  bool completesLevel;
+} StreamUpload;
+
+// The pixel buffer is split into one region per frame in flight, each guarded by a fence
+typedef struct {
+  arr_t(Texture*) queue;
+  arr_t(StreamUpload) uploads;
+  Texture* placeholders[4];
+  GLuint buffer;
+  GLsync fences[STREAM_FRAMES];
+  size_t budget;
+  size_t bufferSize;
+  uint32_t frame;
+} TextureStreams;
+
 static struct {
   Texture* defaultTexture;
   enum { NONE, INSTANCED_STEREO, MULTIVIEW } singlepass;
@@ -197,10 +310,15 @@ static struct {
   arr_t(Timer) timers;
   uint32_t activeTimer;
   map_t timerMap;
+  ZoneQueries zones;
+  TextureStreams streams;
   GpuFeatures features;
   GpuLimits limits;
   GpuStats stats;
   bool amd;
+  const char* shaderCache;
+  uint64_t driverHash;
+  bool parallelCompile;
 } state;
 
 // Helper functions
@@ -393,6 +511,30 @@ static bool isTextureFormatDepth(TextureFormat format) {
   }
 }
 
+static size_t getTextureFormatPixelSize(TextureFormat format) {
+  switch (format) {
+    case FORMAT_RGB: return 3;
+    case FORMAT_RGBA: return 4;
+    case FORMAT_RGBA4: return 2;
+    case FORMAT_R16: return 2;
+    case FORMAT_RG16: return 4;
+    case FORMAT_RGBA16: return 8;
+    case FORMAT_RGBA16F: return 8;
+    case FORMAT_RGBA32F: return 16;
+    case FORMAT_R16F: return 2;
+    case FORMAT_R32F: return 4;
+    case FORMAT_RG16F: return 4;
+    case FORMAT_RG32F: return 8;
+    case FORMAT_RGB5A1: return 2;
+    case FORMAT_RGB10A2: return 4;
+    case FORMAT_RG11B10F: return 4;
+    case FORMAT_D16: return 2;
+    case FORMAT_D32F: return 4;
+    case FORMAT_D24S8: return 4;
+    default: lovrThrow("Unreachable");
+  }
+}
+
 static uint64_t getTextureMemorySize(Texture* texture) {
   if (texture->native) return 0;
   float size = 0.f;
@@ -766,6 +908,430 @@ static void lovrGpuBindTexture(Texture* texture, int slot) {
   }
 }
 
+static void generateMipmaps(Texture* texture, uint32_t width) {
+#if defined(__APPLE__) || defined(LOVR_WEBGL) // glGenerateMipmap doesn't work on big cubemap textures on macOS
+  if (texture->type != TEXTURE_CUBE || width < 2048) {
+    glGenerateMipmap(texture->target);
+  } else {
+    glTexParameteri(texture->target, GL_TEXTURE_MAX_LEVEL, 0);
+  }
+#else
+  glGenerateMipmap(texture->target);
+#endif
+}
+
+// Texture streaming
+
+// Filled in on the main thread before any decode jobs start
+static float srgbToLinear[256];
+
+static uint8_t linearToSrgb(float x) {
+  x = x <= .0031308f ? x * 12.92f : 1.055f * powf(x, 1.f / 2.4f) - .055f;
+  return (uint8_t) CLAMP(x * 255.f + .5f, 0.f, 255.f);
+}
+
+// sRGB color channels are averaged in linear space, alpha is always linear
+static void downsample(const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst, bool srgb) {
+  uint32_t w = MAX(width >> 1, 1);
+  uint32_t h = MAX(height >> 1, 1);
+  for (uint32_t y = 0; y < h; y++) {
+    const uint8_t* r0 = src + MIN(2 * y, height - 1) * width * 4;
+    const uint8_t* r1 = src + MIN(2 * y + 1, height - 1) * width * 4;
+    for (uint32_t x = 0; x < w; x++) {
+      uint32_t x0 = MIN(2 * x, width - 1) * 4;
+      uint32_t x1 = MIN(2 * x + 1, width - 1) * 4;
+      for (uint32_t c = 0; c < 4; c++) {
+        if (srgb && c < 3) {
+          float sum = srgbToLinear[r0[x0 + c]] + srgbToLinear[r0[x1 + c]] + srgbToLinear[r1[x0 + c]] + srgbToLinear[r1[x1 + c]];
+          *dst++ = linearToSrgb(sum * .25f);
+        } else {
+          *dst++ = (r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c] + 2) >> 2;
+        }
+      }
+    }
+  }
+}
+
+static void decodeStreamSlice(void* arg) {
+  StreamSlice* slice = arg;
+  if (!slice->image) {
+    slice->image = lovrImageCreateFromBlob(slice->blob, slice->flip);
+  }
+
+  Image* image = slice->image;
+  if (!slice->generateMipmaps || image->format != FORMAT_RGBA) {
+    return;
+  }
+
+  size_t size = 0;
+  for (uint32_t w = image->width, h = image->height; w > 1 || h > 1;) {
+    w = MAX(w >> 1, 1);
+    h = MAX(h >> 1, 1);
+    size += w * h * 4;
+  }
+
+  if (size == 0) {
+    return;
+  }
+
+  slice->mipmaps = malloc(size);
+  lovrAssert(slice->mipmaps, "Out of memory");
+
+  const uint8_t* src = image->blob->data;
+  uint8_t* dst = slice->mipmaps;
+  for (uint32_t w = image->width, h = image->height; w > 1 || h > 1;) {
+    downsample(src, w, h, dst, slice->srgb);
+    src = dst;
+    w = MAX(w >> 1, 1);
+    h = MAX(h >> 1, 1);
+    dst += w * h * 4;
+  }
+}
+
+// Runs on a worker thread, the slices are decoded in parallel
+static void decodeStream(void* arg) {
+  TextureStream* stream = arg;
+  job_run_all(decodeStreamSlice, stream->slices, sizeof(StreamSlice), stream->sliceCount);
+}
+
+static const uint8_t* getStreamLevel(StreamSlice* slice, uint32_t level, uint32_t* width, uint32_t* height, size_t* size) {
+  Image* image = slice->image;
+  if (isTextureFormatCompressed(image->format)) {
+    Mipmap* mipmap = &image->mipmaps[level];
+    *width = mipmap->width;
+    *height = mipmap->height;
+    *size = mipmap->size;
+    return mipmap->data;
+  }
+
+  size_t pixelSize = getTextureFormatPixelSize(image->format);
+  const uint8_t* data = image->blob->data;
+  uint32_t w = image->width;
+  uint32_t h = image->height;
+  for (uint32_t i = 0; i < level; i++) {
+    data = i == 0 ? slice->mipmaps : data + w * h * pixelSize;
+    w = MAX(w >> 1, 1);
+    h = MAX(h >> 1, 1);
+  }
+
+  *width = w;
+  *height = h;
+  *size = w * h * pixelSize;
+  return data;
+}
+
+static void lovrTextureUnqueueStream(Texture* texture) {
+  TextureStream* stream = texture->stream;
+  if (stream->job) {
+    job_wait(stream->job);
+    job_free(stream->job);
+    stream->job = NULL;
+  }
+
+  for (uint32_t i = 0; i < stream->sliceCount; i++) {
+    StreamSlice* slice = &stream->slices[i];
+    lovrRelease(slice->blob, lovrBlobDestroy);
+    lovrRelease(slice->image, lovrImageDestroy);
+    free(slice->mipmaps);
+    memset(slice, 0, sizeof(*slice));
+  }
+
+  for (size_t i = 0; i < state.streams.queue.length; i++) {
+    if (state.streams.queue.data[i] == texture) {
+      arr_splice(&state.streams.queue, i, 1);
+      break;
+    }
+  }
+
+  state.stats.textureStreams = (uint32_t) state.streams.queue.length;
+}
+
+static void lovrTextureFreeStream(Texture* texture) {
+  lovrTextureUnqueueStream(texture);
+  free(texture->stream);
+  texture->stream = NULL;
+}
+
+// Waits for the decode job and allocates storage for the decoded size.  This runs during present,
+// so failures don't throw.  The stream is dequeued and keeps the error, lovrTextureResolveStream
+// reports it the next time the Texture is used.
+static void lovrTextureStreamAllocate(Texture* texture) {
+  TextureStream* stream = texture->stream;
+  char* error = stream->error;
+
+  const char* message = job_wait(stream->job);
+  if (message) {
+    snprintf(error, sizeof(stream->error), "%s", message);
+  }
+
+  Image* image = stream->slices[0].image;
+  for (uint32_t i = 1; i < stream->sliceCount && !error[0]; i++) {
+    Image* slice = stream->slices[i].image;
+    if (slice->width != image->width || slice->height != image->height || slice->format != image->format || slice->mipmapCount != image->mipmapCount) {
+      snprintf(error, sizeof(stream->error), "Texture slices must have the same size and format");
+    }
+  }
+
+  if (!error[0] && texture->type == TEXTURE_CUBE && image->width != image->height) {
+    snprintf(error, sizeof(stream->error), "Cubemap images must be square");
+  } else if (!error[0] && MAX(image->width, image->height) > (uint32_t) state.limits.textureSize) {
+    snprintf(error, sizeof(stream->error), "Texture size %dx%d exceeds max of %d", image->width, image->height, state.limits.textureSize);
+  }
+
+  if (error[0]) {
+    lovrTextureUnqueueStream(texture);
+    return;
+  }
+
+  job_free(stream->job);
+  stream->job = NULL;
+
+  for (uint32_t i = 0; i < stream->sliceCount; i++) {
+    StreamSlice* slice = &stream->slices[i];
+    lovrRelease(slice->blob, lovrBlobDestroy);
+    slice->blob = NULL;
+  }
+
+  lovrGpuBindTexture(texture, 0);
+  lovrTextureAllocate(texture, image->width, image->height, stream->sliceCount, image->format);
+
+  if (isTextureFormatCompressed(image->format)) {
+    stream->levelCount = MAX(image->mipmapCount, 1);
+    glTexParameteri(texture->target, GL_TEXTURE_MAX_LEVEL, stream->levelCount - 1);
+
+    // lovrTextureAllocate leaves compressed storage to the uploads, but array slices are uploaded
+    // with a sub image call, so every level of the array is defined up front
+    if (texture->type == TEXTURE_ARRAY) {
+      GLenum glInternalFormat = convertTextureFormatInternal(image->format, texture->srgb);
+      for (uint32_t i = 0; i < stream->levelCount; i++) {
+        Mipmap* mipmap = &image->mipmaps[i];
+        GLsizei size = (GLsizei) (mipmap->size * stream->sliceCount);
+        glCompressedTexImage3D(texture->target, i, glInternalFormat, mipmap->width, mipmap->height, stream->sliceCount, 0, size, NULL);
+      }
+    }
+  } else if (stream->slices[0].mipmaps) {
+    stream->levelCount = texture->mipmapCount;
+  } else {
+    stream->levelCount = 1;
+  }
+
+  stream->level = stream->levelCount - 1;
+  stream->decoded = true;
+}
+
+// Queues uploads for the next rows of a stream until the budget runs out.  At least one upload is
+// always queued per frame so big levels make progress.  When the pixel buffer is mapped and has
+// room, the rows are copied into it and the upload reads from there.
+static void lovrTextureStreamRecord(Texture* texture, size_t* budget, uint8_t* mapped, size_t base, size_t* offset, size_t capacity) {
+  TextureStream* stream = texture->stream;
+  while (!stream->done) {
+    StreamSlice* slice = &stream->slices[stream->slice];
+    uint32_t width, height;
+    size_t size;
+    const uint8_t* data = getStreamLevel(slice, stream->level, &width, &height, &size);
+    bool compressed = isTextureFormatCompressed(slice->image->format);
+    size_t rowSize = compressed ? size : size / height;
+    uint32_t count = (uint32_t) MIN(compressed ? 1 : height - stream->row, *budget / rowSize);
+
+    if (count == 0) {
+      if (state.streams.uploads.length > 0) {
+        return;
+      }
+      count = 1;
+    }
+
+    size_t bytes = count * rowSize;
+    StreamUpload upload = {
+      .texture = texture,
+      .data = data + stream->row * rowSize,
+      .size = bytes,
+      .level = stream->level,
+      .slice = stream->slice,
+      .y = stream->row,
+      .width = width,
+      .height = compressed ? height : count
+    };
+
+    if (mapped && *offset + bytes <= capacity) {
+      memcpy(mapped + *offset, upload.data, bytes);
+      upload.data = (const void*) (base + *offset);
+      upload.buffered = true;
+      *offset = ALIGN(*offset + bytes, 16);
+    }
+
+    *budget -= MIN(*budget, bytes);
+    stream->row += compressed ? height : count;
+
+    if (stream->row == height) {
+      stream->row = 0;
+      if (++stream->slice == stream->sliceCount) {
+        stream->slice = 0;
+        upload.completesLevel = true;
+        if (stream->level == 0) {
+          stream->done = true;
+        } else {
+          stream->level--;
+        }
+      }
+    }
+
+    arr_push(&state.streams.uploads, upload);
+  }
+}
+
+// Once a level is complete the texture starts sampling from it, so it sharpens as it streams in
+static void lovrTextureStreamIssue(void) {
+  bool buffered = false;
+  for (size_t i = 0; i < state.streams.uploads.length; i++) {
+    StreamUpload* upload = &state.streams.uploads.data[i];
+    Texture* texture = upload->texture;
+    TextureStream* stream = texture->stream;
+
+#ifndef LOVR_WEBGL
+    if (upload->buffered != buffered) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload->buffered ? state.streams.buffer : 0);
+      buffered = upload->buffered;
+    }
+#endif
+
+    lovrGpuBindTexture(texture, 0);
+    GLenum binding = (texture->type == TEXTURE_CUBE) ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + upload->slice : texture->target;
+    if (isTextureFormatCompressed(texture->format)) {
+      GLenum glInternalFormat = convertTextureFormatInternal(texture->format, texture->srgb);
+      if (texture->type == TEXTURE_ARRAY) {
+        glCompressedTexSubImage3D(binding, upload->level, 0, 0, upload->slice, upload->width, upload->height, 1, glInternalFormat, (GLsizei) upload->size, upload->data);
+      } else {
+        glCompressedTexImage2D(binding, upload->level, glInternalFormat, upload->width, upload->height, 0, (GLsizei) upload->size, upload->data);
+      }
+    } else {
+      GLenum glFormat = convertTextureFormat(texture->format);
+      GLenum glType = convertTextureFormatType(texture->format);
+      if (texture->type == TEXTURE_ARRAY) {
+        glTexSubImage3D(binding, upload->level, 0, upload->y, upload->slice, upload->width, upload->height, 1, glFormat, glType, upload->data);
+      } else {
+        glTexSubImage2D(binding, upload->level, 0, upload->y, upload->width, upload->height, glFormat, glType, upload->data);
+      }
+    }
+
+    state.stats.textureStreamBytes += upload->size;
+
+    if (upload->completesLevel) {
+      glTexParameteri(texture->target, GL_TEXTURE_BASE_LEVEL, upload->level);
+      stream->visible = true;
+      if (stream->done) {
+        if (stream->levelCount == 1 && texture->mipmapCount > 1 && !isTextureFormatCompressed(texture->format)) {
+          generateMipmaps(texture, texture->width);
+        }
+        lovrTextureFreeStream(texture);
+      }
+    }
+  }
+
+#ifndef LOVR_WEBGL
+  if (buffered) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+#endif
+
+  state.streams.uploads.length = 0;
+}
+
+// Finishes decoding a stream, and optionally uploads the rest of it right away
+static void lovrTextureResolveStream(Texture* texture, bool upload) {
+  TextureStream* stream = texture->stream;
+  if (!stream->decoded && !stream->error[0]) {
+    lovrTextureStreamAllocate(texture);
+  }
+
+  lovrAssert(!stream->error[0], "Could not stream Texture: %s", stream->error);
+
+  if (upload) {
+    size_t budget = SIZE_MAX;
+    size_t offset = 0;
+    lovrTextureStreamRecord(texture, &budget, NULL, 0, &offset, 0);
+    lovrTextureStreamIssue();
+  }
+}
+
+// Called once per frame, uploads as much of the queued textures as fits in the budget
+static void lovrGpuStreamTextures(void) {
+  TextureStreams* streams = &state.streams;
+  bool pending = false;
+
+  for (size_t i = 0; i < streams->queue.length;) {
+    TextureStream* stream = streams->queue.data[i]->stream;
+    if (!stream->decoded) {
+      if (job_done(stream->job)) {
+        lovrTextureStreamAllocate(streams->queue.data[i]);
+        if (stream->error[0]) {
+          continue; // Dequeued
+        }
+      }
+    }
+    pending |= stream->decoded;
+    i++;
+  }
+
+  if (!pending || streams->budget == 0) {
+    return;
+  }
+
+  size_t budget = streams->budget;
+  uint8_t* mapped = NULL;
+  size_t base = 0;
+  size_t offset = 0;
+
+#ifndef LOVR_WEBGL
+  uint32_t region = streams->frame++ % STREAM_FRAMES;
+  if (streams->bufferSize != budget * STREAM_FRAMES) {
+    for (uint32_t i = 0; i < STREAM_FRAMES; i++) {
+      glDeleteSync(streams->fences[i]);
+      streams->fences[i] = NULL;
+    }
+    glDeleteBuffers(1, &streams->buffer);
+    glGenBuffers(1, &streams->buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, streams->buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, budget * STREAM_FRAMES, NULL, GL_STREAM_DRAW);
+    streams->bufferSize = budget * STREAM_FRAMES;
+  } else {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, streams->buffer);
+  }
+
+  GLsync fence = streams->fences[region];
+  if (fence) {
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+      state.stats.fenceWaits++;
+      while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+    }
+    glDeleteSync(fence);
+    streams->fences[region] = NULL;
+  }
+
+  base = region * budget;
+  mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, base, budget, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+#endif
+
+  for (size_t i = 0; i < streams->queue.length && budget > 0; i++) {
+    Texture* texture = streams->queue.data[i];
+    if (texture->stream->decoded) {
+      lovrTextureStreamRecord(texture, &budget, mapped, base, &offset, streams->budget);
+    }
+  }
+
+#ifndef LOVR_WEBGL
+  if (mapped) {
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+#endif
+
+  lovrTextureStreamIssue();
+
+#ifndef LOVR_WEBGL
+  streams->fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+}
+
 #ifndef LOVR_WEBGL
 static void lovrGpuBindImage(StorageImage* image, int slot, const char* name) {
   lovrAssert(slot >= 0 && slot < MAX_IMAGES, "Invalid image slot %d", slot);
@@ -774,6 +1340,7 @@ static void lovrGpuBindImage(StorageImage* image, int slot, const char* name) {
   if (memcmp(state.images + slot, image, sizeof(StorageImage))) {
     Texture* texture = image->texture;
     lovrAssert(texture, "No Texture bound to image uniform '%s'", name);
+    if (texture->stream) lovrTextureResolveStream(texture, true);
     lovrAssert(texture->format != FORMAT_RGBA || !texture->srgb, "Attempt to bind sRGB texture to image uniform '%s'", name);
     lovrAssert(!isTextureFormatCompressed(texture->format), "Attempt to bind compressed texture to image uniform '%s'", name);
     lovrAssert(texture->format != FORMAT_RGB && texture->format != FORMAT_RGBA4 && texture->format != FORMAT_RGB5A1, "Unsupported texture format for image uniform '%s'", name);
@@ -792,7 +1359,9 @@ static void lovrGpuBindImage(StorageImage* image, int slot, const char* name) {
 }
 #endif
 
-static void lovrGpuBindMesh(Mesh* mesh, Shader* shader, int baseDivisor) {
+// Instance buffers aren't part of the Mesh, they're bound to the instance attribute locations
+// after its attributes.  Locations they use are marked as stale in the Mesh's binding cache.
+static void lovrGpuBindMesh(Mesh* mesh, Shader* shader, InstanceData* instances, int baseDivisor) {
   lovrGpuBindVertexArray(mesh);
 
   if (mesh->indexBuffer && mesh->indexCount > 0) {
@@ -839,6 +1408,37 @@ static void lovrGpuBindMesh(Mesh* mesh, Shader* shader, int baseDivisor) {
     }
   }
 
+  static const char* instanceNames[] = {
+    "lovrInstanceTransform0",
+    "lovrInstanceTransform1",
+    "lovrInstanceTransform2",
+    "lovrInstanceTransform3",
+    "lovrInstanceColor"
+  };
+
+  for (uint32_t i = 0; i < COUNTOF(instanceNames); i++) {
+    Buffer* buffer = i < 4 ? instances->transforms : instances->colors;
+    int location;
+    bool integer;
+
+    if (!buffer) { continue; }
+    if ((location = lovrShaderGetAttributeLocation(shader, instanceNames[i], &integer)) < 0) { continue; }
+
+    lovrBufferUnmap(buffer);
+    enabledLocations |= (1 << location);
+
+    if (mesh->divisors[location] != baseDivisor) {
+      glVertexAttribDivisor(location, baseDivisor);
+      mesh->divisors[location] = baseDivisor;
+    }
+
+    mesh->locations[location] = 0xff;
+    lovrGpuBindBuffer(BUFFER_VERTEX, buffer->id);
+    uint32_t offset = i < 4 ? instances->transformOffset + 4 * i * sizeof(float) : instances->colorOffset;
+    GLsizei stride = i < 4 ? 16 * sizeof(float) : 4 * sizeof(float);
+    glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*) (intptr_t) offset);
+  }
+
   uint16_t diff = enabledLocations ^ mesh->enabledLocations;
   if (diff != 0) {
     for (uint32_t i = 0; i < MAX_ATTRIBUTES; i++) {
@@ -1191,6 +1791,9 @@ static void lovrGpuBindShader(Shader* shader) {
           Texture* texture = uniform->value.textures[j];
           lovrAssert(!texture || texture->type == uniform->textureType, "Uniform texture type mismatch for uniform '%s'", uniform->name);
           lovrAssert(!texture || (uniform->shadow == (texture->compareMode != COMPARE_NONE)), "Uniform '%s' requires a Texture with%s a compare mode", uniform->name, uniform->shadow ? "" : "out");
+          if (texture && texture->stream && !texture->stream->visible) {
+            texture = state.streams.placeholders[texture->type];
+          }
           lovrGpuBindTexture(texture, uniform->baseSlot + j);
         }
         break;
@@ -1247,7 +1850,7 @@ static void GLAPIENTRY onMessage(GLenum source, GLenum type, GLuint id, GLenum s
 }
 #endif
 
-void lovrGpuInit(void (*getProcAddress(const char*))(void), bool debug) {
+void lovrGpuInit(void (*getProcAddress(const char*))(void), bool debug, const char* shaderCache) {
 #ifdef LOVR_GL
   gladLoadGLLoader((GLADloadproc) getProcAddress);
 #elif defined(LOVR_GLES)
@@ -1267,6 +1870,48 @@ void lovrGpuInit(void (*getProcAddress(const char*))(void), bool debug) {
   state.features.instancedStereo = GLAD_GL_ARB_viewport_array && GLAD_GL_AMD_vertex_shader_viewport_index && GLAD_GL_ARB_fragment_layer_viewport;
   state.features.multiview = GLAD_GL_ES_VERSION_3_0 && GLAD_GL_OVR_multiview2 && GLAD_GL_OVR_multiview_multisampled_render_to_texture;
   state.features.timers = GLAD_GL_VERSION_3_3;
+  state.features.persistent = GLAD_GL_ARB_buffer_storage;
+
+  // KHR_parallel_shader_compile isn't in glad, so look for it manually
+  GLint extensionCount = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+  for (GLint i = 0; i < extensionCount; i++) {
+    const char* extension = (const char*) glGetStringi(GL_EXTENSIONS, i);
+    if (extension && (!strcmp(extension, "GL_KHR_parallel_shader_compile") || !strcmp(extension, "GL_ARB_parallel_shader_compile"))) {
+      void (APIENTRYP maxShaderCompilerThreads)(GLuint) = (void (APIENTRYP)(GLuint)) getProcAddress("glMaxShaderCompilerThreadsKHR");
+      maxShaderCompilerThreads = maxShaderCompilerThreads ? maxShaderCompilerThreads : (void (APIENTRYP)(GLuint)) getProcAddress("glMaxShaderCompilerThreadsARB");
+      if (maxShaderCompilerThreads) {
+        maxShaderCompilerThreads(0xffffffff);
+      }
+      state.parallelCompile = true;
+      break;
+    }
+  }
+
+  // glad only loads the program binary functions for GLES, so desktop GL looks for them manually
+  if (!glProgramBinary || !glGetProgramBinary || !glProgramParameteri) {
+    glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC) getProcAddress("glProgramBinary");
+    glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC) getProcAddress("glGetProgramBinary");
+    glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC) getProcAddress("glProgramParameteri");
+  }
+
+  // Cached program binaries are only valid for the exact driver (and version of LÖVR) that made them
+  GLint binaryFormats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+  bool binaries = glProgramBinary && glGetProgramBinary && glProgramParameteri;
+  if (shaderCache && binaries && binaryFormats > 0) {
+    const char* strings[] = {
+      vendor,
+      (const char*) glGetString(GL_RENDERER),
+      (const char*) glGetString(GL_VERSION)
+    };
+    uint64_t hashes[4] = { LOVR_VERSION_MAJOR << 16 | LOVR_VERSION_MINOR << 8 | LOVR_VERSION_PATCH };
+    for (int i = 0; i < 3; i++) {
+      hashes[i + 1] = strings[i] ? hash64(strings[i], strlen(strings[i])) : 0;
+    }
+    state.driverHash = hash64(hashes, sizeof(hashes));
+    state.shaderCache = shaderCache;
+  }
 #ifdef LOVR_GL
   glEnable(GL_LINE_SMOOTH);
   glEnable(GL_PROGRAM_POINT_SIZE);
@@ -1363,9 +2008,25 @@ void lovrGpuInit(void (*getProcAddress(const char*))(void), bool debug) {
   map_init(&state.timerMap, 4);
   state.queryPool.next = ~0u;
   state.activeTimer = ~0u;
+
+  arr_init(&state.streams.queue, arr_alloc);
+  arr_init(&state.streams.uploads, arr_alloc);
+  state.streams.budget = 4 << 20;
 }
 
 void lovrGpuDestroy() {
+  while (state.streams.queue.length > 0) {
+    lovrTextureFreeStream(state.streams.queue.data[0]);
+  }
+  for (int i = 0; i < 4; i++) {
+    lovrRelease(state.streams.placeholders[i], lovrTextureDestroy);
+  }
+  for (int i = 0; i < STREAM_FRAMES; i++) {
+    glDeleteSync(state.streams.fences[i]);
+  }
+  glDeleteBuffers(1, &state.streams.buffer);
+  arr_free(&state.streams.queue);
+  arr_free(&state.streams.uploads);
   lovrRelease(state.defaultTexture, lovrTextureDestroy);
   for (int i = 0; i < MAX_TEXTURES; i++) {
     lovrRelease(state.textures[i], lovrTextureDestroy);
@@ -1378,6 +2039,9 @@ void lovrGpuDestroy() {
   }
   glDeleteQueries(state.queryPool.count, state.queryPool.queries);
   free(state.queryPool.queries);
+  if (state.zones.queries[0]) {
+    glDeleteQueries(MAX_GPU_ZONES, state.zones.queries);
+  }
   arr_free(&state.timers);
   map_free(&state.timerMap);
   memset(&state, 0, sizeof(state));
@@ -1450,6 +2114,7 @@ void lovrGpuDiscard(Canvas* canvas, bool color, bool depth, bool stencil) {
 
 void lovrGpuDraw(DrawCommand* draw) {
   lovrAssert(state.singlepass != MULTIVIEW || draw->shader->multiview == draw->canvas->flags.stereo, "Shader and Canvas multiview settings must match!");
+  PROFILE_BEGIN("Draw");
   uint32_t viewportCount = (draw->canvas->flags.stereo && state.singlepass != MULTIVIEW) ? 2 : 1;
   uint32_t drawCount = state.singlepass == NONE ? viewportCount : 1;
   uint32_t instanceMultiplier = state.singlepass == INSTANCED_STEREO ? viewportCount : 1;
@@ -1463,7 +2128,7 @@ void lovrGpuDraw(DrawCommand* draw) {
 
   lovrGpuBindCanvas(draw->canvas, true);
   lovrGpuBindPipeline(&draw->pipeline);
-  lovrGpuBindMesh(draw->mesh, draw->shader, instanceMultiplier);
+  lovrGpuBindMesh(draw->mesh, draw->shader, &draw->instanceData, instanceMultiplier);
 
   for (uint32_t i = 0; i < drawCount; i++) {
     lovrGpuSetViewports(&viewports[i][0], viewportsPerDraw);
@@ -1475,6 +2140,11 @@ void lovrGpuDraw(DrawCommand* draw) {
     if (mesh->indexCount > 0) {
       GLenum indexType = mesh->indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
       GLvoid* offset = (GLvoid*) (mesh->indexOffset + draw->rangeStart * mesh->indexSize);
+#ifndef LOVR_WEBGL
+      if (draw->baseVertex > 0) {
+        glDrawElementsInstancedBaseVertex(topology, draw->rangeCount, indexType, offset, instances, draw->baseVertex);
+      } else
+#endif
       if (instances > 1) {
         glDrawElementsInstanced(topology, draw->rangeCount, indexType, offset, instances);
       } else {
@@ -1490,12 +2160,56 @@ void lovrGpuDraw(DrawCommand* draw) {
 
     state.stats.drawCalls++;
   }
+
+  PROFILE_END();
+}
+
+// Timestamps are converted to CPU time using the current offset between the clocks
+static void lovrGpuResolveZones() {
+#ifdef LOVR_GL
+  ZoneQueries* zones = &state.zones;
+  if (zones->head == zones->tail) {
+    return;
+  }
+
+  GLint64 gpuTime;
+  glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+  double offset = profile_time() - gpuTime / 1e9;
+
+  while (zones->tail != zones->head) {
+    uint32_t index = zones->tail & (MAX_GPU_ZONES - 1);
+
+    GLuint available;
+    glGetQueryObjectuiv(zones->queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      break;
+    }
+
+    GLuint64 nanoseconds;
+    glGetQueryObjectui64v(zones->queries[index], GL_QUERY_RESULT, &nanoseconds);
+    profile_gpu(zones->names[index], zones->names[index] != NULL, nanoseconds / 1e9 + offset);
+    zones->tail++;
+  }
+#endif
 }
 
 void lovrGpuPresent() {
+  lovrGpuResolveZones();
   state.stats.shaderSwitches = 0;
   state.stats.renderPasses = 0;
   state.stats.drawCalls = 0;
+  state.stats.mergedBatches = 0;
+  state.stats.culledDraws = 0;
+  state.stats.fenceWaits = 0;
+  memset(state.stats.batchBreaks, 0, sizeof(state.stats.batchBreaks));
+  memset(state.stats.flushes, 0, sizeof(state.stats.flushes));
+  state.stats.submittedBatches = 0;
+  state.stats.submittedDraws = 0;
+  memset(state.stats.streamBytes, 0, sizeof(state.stats.streamBytes));
+  state.stats.textureStreamBytes = 0;
+  state.stats.textureUploads = 0;
+  state.stats.textureUploadBytes = 0;
+  lovrGpuStreamTextures();
 }
 
 void lovrGpuStencil(StencilAction action, int replaceValue, StencilCallback callback, void* userdata) {
@@ -1641,6 +2355,44 @@ double lovrGpuTock(const char* label) {
   return 0.;
 }
 
+// Zones that don't fit in the query ring (or start while profiling is off) are dropped, along with
+// their ends.  Zones nest, so a count is enough to tell which ends to skip.
+void lovrGpuBeginZone(const char* name) {
+#ifdef LOVR_GL
+  ZoneQueries* zones = &state.zones;
+  if (!profile_active || !state.features.timers || zones->head - zones->tail + zones->depth + 2 > MAX_GPU_ZONES) {
+    zones->dropped++;
+    return;
+  }
+
+  if (!zones->queries[0]) {
+    glGenQueries(MAX_GPU_ZONES, zones->queries);
+  }
+
+  uint32_t index = zones->head++ & (MAX_GPU_ZONES - 1);
+  glQueryCounter(zones->queries[index], GL_TIMESTAMP);
+  zones->names[index] = name;
+  zones->depth++;
+#endif
+}
+
+void lovrGpuEndZone() {
+#ifdef LOVR_GL
+  ZoneQueries* zones = &state.zones;
+  if (zones->dropped > 0) {
+    zones->dropped--;
+    return;
+  }
+
+  if (zones->depth > 0) {
+    uint32_t index = zones->head++ & (MAX_GPU_ZONES - 1);
+    glQueryCounter(zones->queries[index], GL_TIMESTAMP);
+    zones->names[index] = NULL;
+    zones->depth--;
+  }
+#endif
+}
+
 const GpuFeatures* lovrGpuGetFeatures() {
   return &state.features;
 }
@@ -1649,10 +2401,18 @@ const GpuLimits* lovrGpuGetLimits() {
   return &state.limits;
 }
 
-const GpuStats* lovrGpuGetStats() {
+GpuStats* lovrGpuGetStats() {
   return &state.stats;
 }
 
+size_t lovrGpuGetTextureStreamBudget() {
+  return state.streams.budget;
+}
+
+void lovrGpuSetTextureStreamBudget(size_t budget) {
+  state.streams.budget = budget;
+}
+
 // Texture
 
 Texture* lovrTextureCreate(TextureType type, Image** slices, uint32_t sliceCount, bool srgb, bool mipmaps, uint32_t msaa) {
@@ -1686,14 +2446,63 @@ Texture* lovrTextureCreate(TextureType type, Image** slices, uint32_t sliceCount
   return texture;
 }
 
-Texture* lovrTextureCreateFromHandle(uint32_t handle, TextureType type, uint32_t depth, uint32_t msaa) {
-  Texture* texture = calloc(1, sizeof(Texture));
-  lovrAssert(texture, "Out of memory");
-  texture->ref = 1;
-  texture->type = type;
-  texture->id = handle;
-  texture->target = convertTextureTarget(type);
-  texture->compareMode = COMPARE_NONE;
+// Images are decoded on the job pool and uploaded a bit each frame, until then a white
+// placeholder is bound instead.  Queries that need the size wait for decoding to finish.
+Texture* lovrTextureCreateStream(TextureType type, Blob** blobs, Image** images, uint32_t sliceCount, bool srgb, bool mipmaps) {
+  lovrAssert(type != TEXTURE_VOLUME, "Volume textures can not be streamed");
+  lovrAssert(type != TEXTURE_CUBE || sliceCount == 6, "6 images are required for a cube texture");
+  lovrAssert(type != TEXTURE_2D || sliceCount == 1, "2D textures can only contain a single image");
+  lovrAssert(sliceCount > 0 && sliceCount <= MAX_STREAM_SLICES, "Streamed textures can have at most %d slices", MAX_STREAM_SLICES);
+
+  if (srgbToLinear[255] == 0.f) {
+    for (uint32_t i = 0; i < 256; i++) {
+      float x = i / 255.f;
+      srgbToLinear[i] = x <= .04045f ? x / 12.92f : powf((x + .055f) / 1.055f, 2.4f);
+    }
+  }
+
+  if (!state.streams.placeholders[type]) {
+    Image* image = lovrImageCreate(1, 1, NULL, 0xff, FORMAT_RGBA);
+    Image* faces[6] = { image, image, image, image, image, image };
+    Texture* placeholder = lovrTextureCreate(type, faces, type == TEXTURE_CUBE ? 6 : 1, true, false, 0);
+    lovrTextureSetFilter(placeholder, (TextureFilter) { .mode = FILTER_NEAREST });
+    lovrRelease(image, lovrImageDestroy);
+    state.streams.placeholders[type] = placeholder;
+  }
+
+  Texture* texture = lovrTextureCreate(type, NULL, 0, srgb, mipmaps, 0);
+  TextureStream* stream = calloc(1, sizeof(TextureStream));
+  lovrAssert(stream, "Out of memory");
+  texture->stream = stream;
+  stream->sliceCount = sliceCount;
+
+  for (uint32_t i = 0; i < sliceCount; i++) {
+    StreamSlice* slice = &stream->slices[i];
+    slice->blob = blobs ? blobs[i] : NULL;
+    slice->image = images ? images[i] : NULL;
+    slice->flip = type != TEXTURE_CUBE;
+    slice->srgb = srgb;
+    slice->generateMipmaps = mipmaps;
+    lovrAssert(slice->blob || slice->image, "Missing image data for Texture slice %d", i + 1);
+    lovrRetain(slice->blob);
+    lovrRetain(slice->image);
+  }
+
+  stream->job = job_start(decodeStream, stream);
+
+  arr_push(&state.streams.queue, texture);
+  state.stats.textureStreams = (uint32_t) state.streams.queue.length;
+  return texture;
+}
+
+Texture* lovrTextureCreateFromHandle(uint32_t handle, TextureType type, uint32_t depth, uint32_t msaa) {
+  Texture* texture = calloc(1, sizeof(Texture));
+  lovrAssert(texture, "Out of memory");
+  texture->ref = 1;
+  texture->type = type;
+  texture->id = handle;
+  texture->target = convertTextureTarget(type);
+  texture->compareMode = COMPARE_NONE;
   texture->native = true;
   state.stats.textureCount++;
 
@@ -1720,6 +2529,7 @@ Texture* lovrTextureCreateFromHandle(uint32_t handle, TextureType type, uint32_t
 
 void lovrTextureDestroy(void* ref) {
   Texture* texture = ref;
+  if (texture->stream) lovrTextureFreeStream(texture);
   if (!texture->native) glDeleteTextures(1, &texture->id);
   glDeleteRenderbuffers(1, &texture->msaaId);
   lovrGpuDestroySyncResource(texture, texture->incoherent);
@@ -1801,6 +2611,7 @@ void lovrTextureAllocate(Texture* texture, uint32_t width, uint32_t height, uint
 
 void lovrTextureReplacePixels(Texture* texture, Image* image, uint32_t x, uint32_t y, uint32_t slice, uint32_t mipmap) {
   lovrGraphicsFlush();
+  if (texture->stream) lovrTextureResolveStream(texture, true);
   lovrAssert(texture->allocated, "Texture is not allocated");
 
 #ifndef LOVR_WEBGL
@@ -1819,6 +2630,7 @@ void lovrTextureReplacePixels(Texture* texture, Image* image, uint32_t x, uint32
   GLenum glFormat = convertTextureFormat(image->format);
   GLenum glInternalFormat = convertTextureFormatInternal(image->format, texture->srgb);
   GLenum binding = (texture->type == TEXTURE_CUBE) ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + slice : texture->target;
+  state.stats.textureUploads++;
 
   lovrGpuBindTexture(texture, 0);
   if (isTextureFormatCompressed(image->format)) {
@@ -1836,6 +2648,7 @@ void lovrTextureReplacePixels(Texture* texture, Image* image, uint32_t x, uint32
           glCompressedTexSubImage3D(binding, i, x, y, slice, m->width, m->height, 1, glInternalFormat, (GLsizei) m->size, m->data);
           break;
       }
+      state.stats.textureUploadBytes += m->size;
     }
   } else {
     lovrAssert(image->blob->data, "Trying to replace Texture pixels with empty pixel data");
@@ -1852,37 +2665,40 @@ void lovrTextureReplacePixels(Texture* texture, Image* image, uint32_t x, uint32
         break;
     }
 
+    state.stats.textureUploadBytes += width * height * getTextureFormatPixelSize(image->format);
+
     if (texture->mipmaps) {
-#if defined(__APPLE__) || defined(LOVR_WEBGL) // glGenerateMipmap doesn't work on big cubemap textures on macOS
-      if (texture->type != TEXTURE_CUBE || width < 2048) {
-        glGenerateMipmap(texture->target);
-      } else {
-        glTexParameteri(texture->target, GL_TEXTURE_MAX_LEVEL, 0);
-      }
-#else
-      glGenerateMipmap(texture->target);
-#endif
+      generateMipmaps(texture, width);
     }
   }
 }
 
+bool lovrTextureIsReady(Texture* texture) {
+  lovrAssert(!texture->stream || !texture->stream->error[0], "Could not stream Texture: %s", texture->stream->error);
+  return !texture->stream;
+}
+
 uint64_t lovrTextureGetId(Texture* texture) {
   return texture->id;
 }
 
 uint32_t lovrTextureGetWidth(Texture* texture, uint32_t mipmap) {
+  if (texture->stream) lovrTextureResolveStream(texture, false);
   return MAX(texture->width >> mipmap, 1);
 }
 
 uint32_t lovrTextureGetHeight(Texture* texture, uint32_t mipmap) {
+  if (texture->stream) lovrTextureResolveStream(texture, false);
   return MAX(texture->height >> mipmap, 1);
 }
 
 uint32_t lovrTextureGetDepth(Texture* texture, uint32_t mipmap) {
+  if (texture->stream) lovrTextureResolveStream(texture, false);
   return texture->type == TEXTURE_VOLUME ? MAX(texture->depth >> mipmap, 1) : texture->depth;
 }
 
 uint32_t lovrTextureGetMipmapCount(Texture* texture) {
+  if (texture->stream) lovrTextureResolveStream(texture, false);
   return texture->mipmapCount;
 }
 
@@ -1895,6 +2711,7 @@ TextureType lovrTextureGetType(Texture* texture) {
 }
 
 TextureFormat lovrTextureGetFormat(Texture* texture) {
+  if (texture->stream) lovrTextureResolveStream(texture, false);
   return texture->format;
 }
 
@@ -2154,6 +2971,7 @@ void lovrCanvasSetAttachments(Canvas* canvas, Attachment* attachments, uint32_t
 
   for (uint32_t i = 0; i < count; i++) {
     Texture* texture = attachments[i].texture;
+    if (texture->stream) lovrTextureResolveStream(texture, true);
     uint32_t slice = attachments[i].slice;
     uint32_t level = attachments[i].level;
     uint32_t width = lovrTextureGetWidth(texture, level);
@@ -2248,12 +3066,48 @@ Buffer* lovrBufferCreate(size_t size, void* data, BufferType type, BufferUsage u
   return buffer;
 }
 
+// Persistent buffers are mapped once and stay mapped.  Writes are coherent, so there's no need to
+// flush or unmap them, but the caller is responsible for synchronization using lovrBufferLock.
+Buffer* lovrBufferCreatePersistent(size_t size, BufferType type) {
+#ifdef LOVR_WEBGL
+  lovrThrow("Persistent Buffers are not supported on this system");
+#else
+  lovrAssert(state.features.persistent, "Persistent Buffers are not supported on this system");
+  Buffer* buffer = calloc(1, sizeof(Buffer));
+  lovrAssert(buffer, "Out of memory");
+  buffer->ref = 1;
+
+  state.stats.bufferCount++;
+  state.stats.bufferMemory += size;
+  buffer->size = size;
+  buffer->type = type;
+  buffer->usage = USAGE_STREAM;
+  buffer->persistent = true;
+  buffer->mapped = true;
+  glGenBuffers(1, &buffer->id);
+  lovrGpuBindBuffer(type, buffer->id);
+  GLenum glType = convertBufferType(type);
+  GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glBufferStorage(glType, size, NULL, flags);
+  buffer->data = glMapBufferRange(glType, 0, size, flags);
+  lovrAssert(buffer->data, "Could not map persistent Buffer");
+  return buffer;
+#endif
+}
+
 void lovrBufferDestroy(void* ref) {
   Buffer* buffer = ref;
   lovrGpuDestroySyncResource(buffer, buffer->incoherent);
+#ifndef LOVR_WEBGL
+  for (int i = 0; i < MAX_BUFFER_LOCKS; i++) {
+    if (buffer->locks[i].sync) {
+      glDeleteSync(buffer->locks[i].sync);
+    }
+  }
+#endif
   glDeleteBuffers(1, &buffer->id);
 #ifndef LOVR_WEBGL
-  if (state.amd)
+  if (state.amd && !buffer->persistent)
 #endif
     free(buffer->data);
   state.stats.bufferMemory -= buffer->size;
@@ -2299,7 +3153,9 @@ void lovrBufferFlush(Buffer* buffer, size_t offset, size_t size) {
 
 void lovrBufferUnmap(Buffer* buffer) {
 #ifndef LOVR_WEBGL
-  if (state.amd) {
+  if (buffer->persistent) {
+    // Coherent, nothing to do
+  } else if (state.amd) {
 #endif
     if (buffer->flushTo > buffer->flushFrom) {
       lovrGpuBindBuffer(buffer->type, buffer->id);
@@ -2323,6 +3179,7 @@ void lovrBufferUnmap(Buffer* buffer) {
 }
 
 void lovrBufferDiscard(Buffer* buffer) {
+  lovrAssert(!buffer->persistent, "Persistent Buffers can not be discarded");
   lovrAssert(!buffer->readable, "Readable Buffers can not be discarded");
   lovrAssert(!buffer->mapped, "Mapped Buffers can not be discarded");
   lovrGpuBindBuffer(buffer->type, buffer->id);
@@ -2340,12 +3197,66 @@ void lovrBufferDiscard(Buffer* buffer) {
 #endif
 }
 
+// Places a fence after all the commands that have been issued so far.  Before writing to the
+// range again, lovrBufferUnlock waits for the fence.
+void lovrBufferLock(Buffer* buffer, size_t offset, size_t size) {
+#ifndef LOVR_WEBGL
+  BufferLock* lock = NULL;
+  for (int i = 0; i < MAX_BUFFER_LOCKS; i++) {
+    if (!buffer->locks[i].sync) {
+      lock = &buffer->locks[i];
+      break;
+    }
+  }
+
+  // Out of locks, merge with the first one (waiting on the newer fence covers both)
+  if (!lock) {
+    lock = &buffer->locks[0];
+    size_t end = MAX(lock->offset + lock->size, offset + size);
+    offset = MIN(lock->offset, offset);
+    size = end - offset;
+    glDeleteSync(lock->sync);
+  }
+
+  lock->offset = offset;
+  lock->size = size;
+  lock->sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+}
+
+void lovrBufferUnlock(Buffer* buffer, size_t offset, size_t size) {
+#ifndef LOVR_WEBGL
+  for (int i = 0; i < MAX_BUFFER_LOCKS; i++) {
+    BufferLock* lock = &buffer->locks[i];
+    if (!lock->sync || lock->offset >= offset + size || offset >= lock->offset + lock->size) {
+      continue;
+    }
+
+    if (glClientWaitSync(lock->sync, 0, 0) == GL_TIMEOUT_EXPIRED) {
+      state.stats.fenceWaits++;
+      while (glClientWaitSync(lock->sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+    }
+
+    glDeleteSync(lock->sync);
+    lock->sync = NULL;
+  }
+#endif
+}
+
 // Shader
 
+// Compiling and linking only queue work, the driver is free to do it in the background until the
+// status is queried by checkShader/checkProgram
 static GLuint compileShader(GLenum type, const char** sources, int* lengths, int count) {
   GLuint shader = glCreateShader(type);
   glShaderSource(shader, count, sources, lengths);
   glCompileShader(shader);
+  return shader;
+}
+
+static void checkShader(GLuint shader) {
+  GLint type;
+  glGetShaderiv(shader, GL_SHADER_TYPE, &type);
 
   int isShaderCompiled;
   glGetShaderiv(shader, GL_COMPILE_STATUS, &isShaderCompiled);
@@ -2364,13 +3275,9 @@ static GLuint compileShader(GLenum type, const char** sources, int* lengths, int
     }
     lovrThrow("Could not compile %s:\n%s", name, log);
   }
-
-  return shader;
 }
 
-static GLuint linkProgram(GLuint program) {
-  glLinkProgram(program);
-
+static void checkProgram(GLuint program) {
   int isLinked;
   glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
   if (!isLinked) {
@@ -2381,8 +3288,6 @@ static GLuint linkProgram(GLuint program) {
     glGetProgramInfoLog(program, logLength, &logLength, log);
     lovrThrow("Could not link shader:\n%s", log);
   }
-
-  return program;
 }
 
 static void lovrShaderSetupUniforms(Shader* shader) {
@@ -2621,11 +3526,187 @@ static char* lovrShaderGetFlagCode(ShaderFlag* flags, uint32_t flagCount) {
   return code;
 }
 
-Shader* lovrShaderCreateGraphics(const char* vertexSource, int vertexSourceLength, const char* fragmentSource, int fragmentSourceLength, ShaderFlag* flags, uint32_t flagCount, bool multiview) {
-  Shader* shader = calloc(1, sizeof(Shader));
-  lovrAssert(shader, "Out of memory");
-  shader->ref = 1;
+static void lovrShaderBindAttributes(GLuint program) {
+  glBindAttribLocation(program, LOVR_SHADER_POSITION, "lovrPosition");
+  glBindAttribLocation(program, LOVR_SHADER_NORMAL, "lovrNormal");
+  glBindAttribLocation(program, LOVR_SHADER_TEX_COORD, "lovrTexCoord");
+  glBindAttribLocation(program, LOVR_SHADER_VERTEX_COLOR, "lovrVertexColor");
+  glBindAttribLocation(program, LOVR_SHADER_TANGENT, "lovrTangent");
+  glBindAttribLocation(program, LOVR_SHADER_BONES, "lovrBones");
+  glBindAttribLocation(program, LOVR_SHADER_BONE_WEIGHTS, "lovrBoneWeights");
+  glBindAttribLocation(program, LOVR_SHADER_DRAW_ID, "lovrDrawID");
+  glBindAttribLocation(program, LOVR_SHADER_INSTANCE_COLOR, "lovrInstanceColor");
+  glBindAttribLocation(program, LOVR_SHADER_INSTANCE_TRANSFORM + 0, "lovrInstanceTransform0");
+  glBindAttribLocation(program, LOVR_SHADER_INSTANCE_TRANSFORM + 1, "lovrInstanceTransform1");
+  glBindAttribLocation(program, LOVR_SHADER_INSTANCE_TRANSFORM + 2, "lovrInstanceTransform2");
+  glBindAttribLocation(program, LOVR_SHADER_INSTANCE_TRANSFORM + 3, "lovrInstanceTransform3");
+  glBindAttribLocation(program, LOVR_SHADER_PACKED_NORMAL, "lovrPackedNormal");
+}
+
+// The program cache stores binaries in files named after a hash of every source string (which
+// includes the flags and multiview defines) and the driver.  Any failure falls back to compiling.
+#ifndef LOVR_WEBGL
+static uint64_t lovrShaderHashSources(uint64_t hash, const char** sources, int* lengths, int count) {
+  for (int i = 0; i < count; i++) {
+    uint64_t hashes[2] = { hash, hash64(sources[i], lengths[i] < 0 ? strlen(sources[i]) : (size_t) lengths[i]) };
+    hash = hash64(hashes, sizeof(hashes));
+  }
+  return hash;
+}
+
+static void lovrShaderGetCachePath(uint64_t key, char* path, size_t size) {
+  snprintf(path, size, "%s/%016llx", state.shaderCache, (unsigned long long) key);
+}
+
+static bool lovrShaderLoadBinary(GLuint program, uint64_t key) {
+  char path[1024];
+  lovrShaderGetCachePath(key, path, sizeof(path));
+
+  FileInfo info;
+  fs_handle file;
+  if (!fs_stat(path, &info) || info.size <= sizeof(GLenum) || !fs_open(path, OPEN_READ, &file)) {
+    return false;
+  }
+
+  size_t size = info.size;
+  void* data = malloc(size);
+  lovrAssert(data, "Out of memory");
+  bool success = fs_read(file, data, &size) && size == info.size;
+  fs_close(file);
+
+  if (success) {
+    GLenum format;
+    memcpy(&format, data, sizeof(GLenum));
+    glProgramBinary(program, format, (char*) data + sizeof(GLenum), (GLsizei) (size - sizeof(GLenum)));
+    GLint isLinked;
+    glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+    success = isLinked;
+  }
+
+  free(data);
+  return success;
+}
+
+static void lovrShaderSaveBinary(GLuint program, uint64_t key) {
+  GLint length;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
 
+  size_t size = sizeof(GLenum) + length;
+  char* data = malloc(size);
+  lovrAssert(data, "Out of memory");
+  GLenum format;
+  glGetProgramBinary(program, length, &length, &format, data + sizeof(GLenum));
+  memcpy(data, &format, sizeof(GLenum));
+  size = sizeof(GLenum) + length;
+
+  char path[1024];
+  fs_handle file;
+  lovrShaderGetCachePath(key, path, sizeof(path));
+  fs_mkdir(state.shaderCache);
+  if (fs_open(path, OPEN_WRITE, &file)) {
+    size_t written = size;
+    bool success = fs_write(file, data, &written) && written == size;
+    fs_close(file);
+    if (!success) {
+      fs_remove(path);
+    }
+  }
+
+  free(data);
+}
+#endif
+
+static void lovrShaderLinkProgram(Shader* shader) {
+#ifndef LOVR_WEBGL
+  if (state.shaderCache) {
+    glProgramParameteri(shader->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+#endif
+  glLinkProgram(shader->program);
+}
+
+static void lovrShaderApplyPending(Shader* shader);
+
+// Waits for the program to finish linking and sets everything up that needs to query it
+static void lovrShaderFinish(Shader* shader) {
+  if (shader->ready) {
+    return;
+  }
+
+  uint32_t program = shader->program;
+  if (shader->stages[0]) {
+    for (int i = 0; i < 2 && shader->stages[i]; i++) {
+      checkShader(shader->stages[i]);
+    }
+
+    checkProgram(program);
+
+#ifndef LOVR_WEBGL
+    if (state.shaderCache) {
+      lovrShaderSaveBinary(program, shader->key);
+    }
+#endif
+
+    for (int i = 0; i < 2 && shader->stages[i]; i++) {
+      glDetachShader(program, shader->stages[i]);
+      glDeleteShader(shader->stages[i]);
+      shader->stages[i] = 0;
+    }
+  }
+
+  shader->ready = true;
+
+  if (shader->type == SHADER_COMPUTE) {
+    lovrShaderSetupUniforms(shader);
+    lovrShaderApplyPending(shader);
+    return;
+  }
+
+  // Generic attributes
+  lovrGpuUseProgram(program);
+  glVertexAttrib4fv(LOVR_SHADER_VERTEX_COLOR, (float[4]) { 1., 1., 1., 1. });
+  glVertexAttribI4uiv(LOVR_SHADER_BONES, (uint32_t[4]) { 0., 0., 0., 0. });
+  glVertexAttrib4fv(LOVR_SHADER_BONE_WEIGHTS, (float[4]) { 1., 0., 0., 0. });
+  glVertexAttribI4ui(LOVR_SHADER_DRAW_ID, 0, 0, 0, 0);
+  glVertexAttribI4i(LOVR_SHADER_PACKED_NORMAL, -32768, 0, 0, 0);
+  glVertexAttrib4fv(LOVR_SHADER_INSTANCE_COLOR, (float[4]) { 1., 1., 1., 1. });
+  glVertexAttrib4fv(LOVR_SHADER_INSTANCE_TRANSFORM + 0, (float[4]) { 1., 0., 0., 0. });
+  glVertexAttrib4fv(LOVR_SHADER_INSTANCE_TRANSFORM + 1, (float[4]) { 0., 1., 0., 0. });
+  glVertexAttrib4fv(LOVR_SHADER_INSTANCE_TRANSFORM + 2, (float[4]) { 0., 0., 1., 0. });
+  glVertexAttrib4fv(LOVR_SHADER_INSTANCE_TRANSFORM + 3, (float[4]) { 0., 0., 0., 1. });
+
+  lovrShaderSetupUniforms(shader);
+
+  // Attribute cache
+  int32_t attributeCount;
+  glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+  map_init(&shader->attributes, attributeCount);
+  for (int i = 0; i < attributeCount; i++) {
+    char name[LOVR_MAX_ATTRIBUTE_LENGTH];
+    GLint size;
+    GLenum type;
+    GLsizei length;
+    glGetActiveAttrib(program, i, LOVR_MAX_ATTRIBUTE_LENGTH, &length, &size, &type, name);
+    int location = glGetAttribLocation(program, name);
+    if (location >= 0) {
+      map_set(&shader->attributes, hash64(name, length), (location << 1) | isAttributeTypeInteger(type));
+    }
+  }
+
+  // Builtin uniforms
+  if (shader->standard) {
+    lovrShaderSetFloats(shader, "lovrExposure", (float[1]) { 1.f }, 0, 1);
+    lovrShaderSetFloats(shader, "lovrLightDirection", (float[3]) { -1.f, -1.f, -1.f }, 0, 3);
+    lovrShaderSetFloats(shader, "lovrLightColor", (float[4]) { 1.f, 1.f, 1.f, 1.f }, 0, 4);
+  }
+
+  lovrShaderApplyPending(shader);
+}
+
+static Shader* lovrShaderInit(Shader* shader, const char* vertexSource, int vertexSourceLength, const char* fragmentSource, int fragmentSourceLength, ShaderFlag* flags, uint32_t flagCount, bool multiview, bool async) {
 #if defined(LOVR_WEBGL) || defined(LOVR_GLES)
   const char* version = "#version 300 es\n";
   const char* computeExtensions = "";
@@ -2657,79 +3738,66 @@ Shader* lovrShaderCreateGraphics(const char* vertexSource, int vertexSourceLengt
     fragmentSourceLength = -1;
   }
 
-  // Vertex
   const char* vertexSources[] = { version, computeExtensions, singlepass[0], flagSource ? flagSource : "", lovrShaderVertexPrefix, vertexSource, lovrShaderVertexSuffix };
   int vertexSourceLengths[] = { -1, -1, -1, -1, -1, vertexSourceLength, -1 };
   int vertexSourceCount = sizeof(vertexSources) / sizeof(vertexSources[0]);
-  GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSources, vertexSourceLengths, vertexSourceCount);
 
-  // Fragment
   const char* fragmentSources[] = { version, computeExtensions, singlepass[1], flagSource ? flagSource : "", lovrShaderFragmentPrefix, fragmentSource, lovrShaderFragmentSuffix };
   int fragmentSourceLengths[] = { -1, -1, -1, -1, -1, fragmentSourceLength, -1 };
   int fragmentSourceCount = sizeof(fragmentSources) / sizeof(fragmentSources[0]);
-  GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSources, fragmentSourceLengths, fragmentSourceCount);
-
-  free(flagSource);
 
-  // Link
-  uint32_t program = glCreateProgram();
-  glAttachShader(program, vertexShader);
-  glAttachShader(program, fragmentShader);
-  glBindAttribLocation(program, LOVR_SHADER_POSITION, "lovrPosition");
-  glBindAttribLocation(program, LOVR_SHADER_NORMAL, "lovrNormal");
-  glBindAttribLocation(program, LOVR_SHADER_TEX_COORD, "lovrTexCoord");
-  glBindAttribLocation(program, LOVR_SHADER_VERTEX_COLOR, "lovrVertexColor");
-  glBindAttribLocation(program, LOVR_SHADER_TANGENT, "lovrTangent");
-  glBindAttribLocation(program, LOVR_SHADER_BONES, "lovrBones");
-  glBindAttribLocation(program, LOVR_SHADER_BONE_WEIGHTS, "lovrBoneWeights");
-  glBindAttribLocation(program, LOVR_SHADER_DRAW_ID, "lovrDrawID");
-  linkProgram(program);
-  glDetachShader(program, vertexShader);
-  glDeleteShader(vertexShader);
-  glDetachShader(program, fragmentShader);
-  glDeleteShader(fragmentShader);
-  shader->program = program;
+  shader->program = glCreateProgram();
   shader->type = SHADER_GRAPHICS;
+  arr_init(&shader->pending, arr_alloc);
+  shader->multiview = multiview;
 
-  // Generic attributes
-  lovrGpuUseProgram(program);
-  glVertexAttrib4fv(LOVR_SHADER_VERTEX_COLOR, (float[4]) { 1., 1., 1., 1. });
-  glVertexAttribI4uiv(LOVR_SHADER_BONES, (uint32_t[4]) { 0., 0., 0., 0. });
-  glVertexAttrib4fv(LOVR_SHADER_BONE_WEIGHTS, (float[4]) { 1., 0., 0., 0. });
-  glVertexAttribI4ui(LOVR_SHADER_DRAW_ID, 0, 0, 0, 0);
-
-  lovrShaderSetupUniforms(shader);
+  bool cached = false;
+#ifndef LOVR_WEBGL
+  if (state.shaderCache) {
+    shader->key = lovrShaderHashSources(state.driverHash, vertexSources, vertexSourceLengths, vertexSourceCount);
+    shader->key = lovrShaderHashSources(shader->key, fragmentSources, fragmentSourceLengths, fragmentSourceCount);
+    cached = lovrShaderLoadBinary(shader->program, shader->key);
+  }
+#endif
 
-  // Attribute cache
-  int32_t attributeCount;
-  glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &attributeCount);
-  map_init(&shader->attributes, attributeCount);
-  for (int i = 0; i < attributeCount; i++) {
-    char name[LOVR_MAX_ATTRIBUTE_LENGTH];
-    GLint size;
-    GLenum type;
-    GLsizei length;
-    glGetActiveAttrib(program, i, LOVR_MAX_ATTRIBUTE_LENGTH, &length, &size, &type, name);
-    int location = glGetAttribLocation(program, name);
-    if (location >= 0) {
-      map_set(&shader->attributes, hash64(name, length), (location << 1) | isAttributeTypeInteger(type));
-    }
+  if (!cached) {
+    shader->stages[0] = compileShader(GL_VERTEX_SHADER, vertexSources, vertexSourceLengths, vertexSourceCount);
+    shader->stages[1] = compileShader(GL_FRAGMENT_SHADER, fragmentSources, fragmentSourceLengths, fragmentSourceCount);
+    glAttachShader(shader->program, shader->stages[0]);
+    glAttachShader(shader->program, shader->stages[1]);
+    lovrShaderBindAttributes(shader->program);
+    lovrShaderLinkProgram(shader);
   }
 
-  shader->multiview = multiview;
+  free(flagSource);
+
+  if (!async) {
+    lovrShaderFinish(shader);
+  }
 
   return shader;
 }
 
-Shader* lovrShaderCreateDefault(DefaultShader type, ShaderFlag* flags, uint32_t flagCount, bool multiview) {
+Shader* lovrShaderCreateGraphics(const char* vertexSource, int vertexSourceLength, const char* fragmentSource, int fragmentSourceLength, ShaderFlag* flags, uint32_t flagCount, bool multiview, bool async) {
+  Shader* shader = calloc(1, sizeof(Shader));
+  lovrAssert(shader, "Out of memory");
+  shader->ref = 1;
+  return lovrShaderInit(shader, vertexSource, vertexSourceLength, fragmentSource, fragmentSourceLength, flags, flagCount, multiview, async);
+}
+
+Shader* lovrShaderCreateDefault(DefaultShader type, ShaderFlag* flags, uint32_t flagCount, bool multiview, bool async) {
+  Shader* shader = calloc(1, sizeof(Shader));
+  lovrAssert(shader, "Out of memory");
+  shader->ref = 1;
+  shader->standard = type == SHADER_STANDARD;
   switch (type) {
-    case SHADER_UNLIT: return lovrShaderCreateGraphics(NULL, -1, NULL, -1, flags, flagCount, multiview);
-    case SHADER_STANDARD: return lovrShaderCreateGraphics(lovrStandardVertexShader, -1, lovrStandardFragmentShader, -1, flags, flagCount, multiview);
-    case SHADER_CUBE: return lovrShaderCreateGraphics(lovrCubeVertexShader, -1, lovrCubeFragmentShader, -1, flags, flagCount, multiview);
-    case SHADER_PANO: return lovrShaderCreateGraphics(lovrCubeVertexShader, -1, lovrPanoFragmentShader, -1, flags, flagCount, multiview);
-    case SHADER_FONT: return lovrShaderCreateGraphics(NULL, -1, lovrFontFragmentShader, -1, flags, flagCount, multiview);
-    case SHADER_FILL: return lovrShaderCreateGraphics(lovrFillVertexShader, -1, NULL, -1, flags, flagCount, multiview);
-    default: lovrThrow("Unknown default shader type"); return NULL;
+    case SHADER_UNLIT: return lovrShaderInit(shader, NULL, -1, NULL, -1, flags, flagCount, multiview, async);
+    case SHADER_STANDARD: return lovrShaderInit(shader, lovrStandardVertexShader, -1, lovrStandardFragmentShader, -1, flags, flagCount, multiview, async);
+    case SHADER_CUBE: return lovrShaderInit(shader, lovrCubeVertexShader, -1, lovrCubeFragmentShader, -1, flags, flagCount, multiview, async);
+    case SHADER_PANO: return lovrShaderInit(shader, lovrCubeVertexShader, -1, lovrPanoFragmentShader, -1, flags, flagCount, multiview, async);
+    case SHADER_FONT: return lovrShaderInit(shader, NULL, -1, lovrFontFragmentShader, -1, flags, flagCount, multiview, async);
+    case SHADER_FILL: return lovrShaderInit(shader, lovrFillVertexShader, -1, NULL, -1, flags, flagCount, multiview, async);
+    default: free(shader); lovrThrow("Unknown default shader type"); return NULL;
   }
 }
 
@@ -2745,24 +3813,91 @@ Shader* lovrShaderCreateCompute(const char* source, int length, ShaderFlag* flag
   const char* sources[] = { lovrShaderComputePrefix, flagSource ? flagSource : "", source, lovrShaderComputeSuffix };
   int lengths[] = { -1, -1, length, -1 };
   int count = sizeof(sources) / sizeof(sources[0]);
-  GLuint computeShader = compileShader(GL_COMPUTE_SHADER, sources, lengths, count);
-  free(flagSource);
-  GLuint program = glCreateProgram();
-  glAttachShader(program, computeShader);
-  linkProgram(program);
-  glDetachShader(program, computeShader);
-  glDeleteShader(computeShader);
-  shader->program = program;
+  shader->program = glCreateProgram();
   shader->type = SHADER_COMPUTE;
-  lovrShaderSetupUniforms(shader);
+  arr_init(&shader->pending, arr_alloc);
+  shader->key = state.shaderCache ? lovrShaderHashSources(state.driverHash, sources, lengths, count) : 0;
+  if (!state.shaderCache || !lovrShaderLoadBinary(shader->program, shader->key)) {
+    shader->stages[0] = compileShader(GL_COMPUTE_SHADER, sources, lengths, count);
+    glAttachShader(shader->program, shader->stages[0]);
+    lovrShaderLinkProgram(shader);
+  }
+  free(flagSource);
+  lovrShaderFinish(shader);
 #endif
   return shader;
 }
 
+static void lovrShaderFreeValue(UniformValue* value) {
+  for (uint32_t i = 0; value->textures && i < value->itemCount; i++) {
+    lovrRelease(value->textures[i], lovrTextureDestroy);
+  }
+  free(value->numbers);
+  free(value->lengths);
+  free(value->textures);
+  free(value->bytes);
+  memset(value, 0, sizeof(*value));
+}
+
+static void lovrShaderFreePending(PendingUniform* pending) {
+  switch (pending->kind) {
+    case PENDING_UNIFORM:
+      for (int i = 0; i < pending->count; i++) {
+        if (pending->type == UNIFORM_SAMPLER) {
+          lovrRelease(((Texture**) pending->data)[i], lovrTextureDestroy);
+        } else if (pending->type == UNIFORM_IMAGE) {
+          lovrRelease(((StorageImage*) pending->data)[i].texture, lovrTextureDestroy);
+        }
+      }
+      free(pending->data);
+      break;
+    case PENDING_VALUE: lovrShaderFreeValue(&pending->value); break;
+    case PENDING_BLOCK: lovrRelease(pending->buffer, lovrBufferDestroy); break;
+  }
+}
+
+// A later send to the same name (and start) replaces the earlier one.  Names that are too long
+// can't match a uniform, so they're dropped.
+static PendingUniform* lovrShaderQueue(Shader* shader, const char* name, PendingKind kind, int start) {
+  if (strlen(name) >= LOVR_MAX_UNIFORM_LENGTH) {
+    return NULL;
+  }
+
+  PendingUniform* pending = NULL;
+  for (size_t i = 0; i < shader->pending.length; i++) {
+    PendingUniform* entry = &shader->pending.data[i];
+    if (entry->kind == kind && entry->start == start && !strcmp(entry->name, name)) {
+      lovrShaderFreePending(entry);
+      pending = entry;
+      break;
+    }
+  }
+
+  if (!pending) {
+    arr_push(&shader->pending, (PendingUniform) { 0 });
+    pending = &shader->pending.data[shader->pending.length - 1];
+  }
+
+  memset(pending, 0, sizeof(*pending));
+  strcpy(pending->name, name);
+  pending->kind = kind;
+  pending->start = start;
+  return pending;
+}
+
 void lovrShaderDestroy(void* ref) {
   Shader* shader = ref;
   lovrGraphicsFlushShader(shader);
+  for (int i = 0; i < 2; i++) {
+    if (shader->stages[i]) {
+      glDeleteShader(shader->stages[i]);
+    }
+  }
   glDeleteProgram(shader->program);
+  for (size_t i = 0; i < shader->pending.length; i++) {
+    lovrShaderFreePending(&shader->pending.data[i]);
+  }
+  arr_free(&shader->pending);
   for (size_t i = 0; i < shader->uniforms.length; i++) {
     free(shader->uniforms.data[i].value.data);
   }
@@ -2785,35 +3920,72 @@ ShaderType lovrShaderGetType(Shader* shader) {
   return shader->type;
 }
 
+// Without KHR_parallel_shader_compile there's no way to ask without waiting
+bool lovrShaderIsReady(Shader* shader) {
+  if (!shader->ready) {
+    if (state.parallelCompile) {
+      GLint complete;
+      glGetProgramiv(shader->program, GL_COMPLETION_STATUS_KHR, &complete);
+      if (!complete) {
+        return false;
+      }
+    }
+
+    lovrShaderFinish(shader);
+  }
+
+  return true;
+}
+
+// Doesn't poll or wait, setters queue their values until the Shader is finished
+bool lovrShaderIsPending(Shader* shader) {
+  return !shader->ready;
+}
+
 int lovrShaderGetAttributeLocation(Shader* shader, const char* name, bool* integer) {
+  lovrShaderFinish(shader);
   uint64_t info = map_get(&shader->attributes, hash64(name, strlen(name)));
   *integer = info & 1;
   return info == MAP_NIL ? -1 : (int) (info >> 1);
 }
 
 bool lovrShaderHasUniform(Shader* shader, const char* name) {
+  lovrShaderFinish(shader);
   return map_get(&shader->uniformMap, hash64(name, strlen(name))) != MAP_NIL;
 }
 
 bool lovrShaderHasBlock(Shader* shader, const char* name) {
+  lovrShaderFinish(shader);
   return map_get(&shader->blockMap, hash64(name, strlen(name))) != MAP_NIL;
 }
 
 const Uniform* lovrShaderGetUniform(Shader* shader, const char* name) {
+  lovrShaderFinish(shader);
   uint64_t index = map_get(&shader->uniformMap, hash64(name, strlen(name)));
   return index == MAP_NIL ? NULL : &shader->uniforms.data[index];
 }
 
-static void lovrShaderSetUniform(Shader* shader, const char* name, UniformType type, void* data, int start, int count, int size, const char* debug) {
+static Uniform* lovrShaderFindUniform(Shader* shader, const char* name) {
   uint64_t index = map_get(&shader->uniformMap, hash64(name, strlen(name)));
-  if (index == MAP_NIL) {
-    return;
+  return index == MAP_NIL ? NULL : &shader->uniforms.data[index];
+}
+
+// Errors are written to a buffer instead of thrown, so pending uniforms can be cleaned up first
+static bool lovrShaderCheckUniform(Uniform* uniform, UniformType type, int start, int count, int size, const char* debug, char* error, size_t errorSize) {
+  if (uniform->type != type) {
+    snprintf(error, errorSize, "Unable to send %ss to uniform %s", debug, uniform->name);
+    return false;
   }
 
-  Uniform* uniform = &shader->uniforms.data[index];
-  lovrAssert(uniform->type == type, "Unable to send %ss to uniform %s", debug, name);
-  lovrAssert((start + count) * size <= uniform->size, "Too many %ss for uniform %s, maximum is %d", debug, name, uniform->size / size);
+  if ((start + count) * size > uniform->size) {
+    snprintf(error, errorSize, "Too many %ss for uniform %s, maximum is %d", debug, uniform->name, uniform->size / size);
+    return false;
+  }
+
+  return true;
+}
 
+static void lovrShaderWriteUniform(Shader* shader, Uniform* uniform, void* data, int start, int count, int size) {
   void* dest = uniform->value.bytes + start * size;
   if (memcmp(dest, data, count * size)) {
     lovrGraphicsFlushShader(shader);
@@ -2822,6 +3994,40 @@ static void lovrShaderSetUniform(Shader* shader, const char* name, UniformType t
   }
 }
 
+static void lovrShaderSetUniform(Shader* shader, const char* name, UniformType type, void* data, int start, int count, int size, const char* debug) {
+  if (!shader->ready) {
+    PendingUniform* pending = lovrShaderQueue(shader, name, PENDING_UNIFORM, start);
+    if (pending) {
+      pending->type = type;
+      pending->count = count;
+      pending->size = size;
+      pending->data = malloc(count * size);
+      lovrAssert(pending->data, "Out of memory");
+      memcpy(pending->data, data, count * size);
+      for (int i = 0; i < count; i++) {
+        if (type == UNIFORM_SAMPLER) {
+          lovrRetain(((Texture**) data)[i]);
+        } else if (type == UNIFORM_IMAGE) {
+          lovrRetain(((StorageImage*) data)[i].texture);
+        }
+      }
+    }
+    return;
+  }
+
+  Uniform* uniform = lovrShaderFindUniform(shader, name);
+  if (!uniform) {
+    return;
+  }
+
+  char error[256];
+  if (!lovrShaderCheckUniform(uniform, type, start, count, size, debug, error, sizeof(error))) {
+    lovrThrow("%s", error);
+  }
+
+  lovrShaderWriteUniform(shader, uniform, data, start, count, size);
+}
+
 void lovrShaderSetFloats(Shader* shader, const char* name, float* data, int start, int count) {
   lovrShaderSetUniform(shader, name, UNIFORM_FLOAT, data, start, count, sizeof(float), "float");
 }
@@ -2850,6 +4056,18 @@ void lovrShaderSetColor(Shader* shader, const char* name, Color color) {
 }
 
 void lovrShaderSetBlock(Shader* shader, const char* name, Buffer* buffer, size_t offset, size_t size, UniformAccess access) {
+  if (!shader->ready) {
+    PendingUniform* pending = lovrShaderQueue(shader, name, PENDING_BLOCK, 0);
+    if (pending) {
+      pending->buffer = buffer;
+      pending->offset = offset;
+      pending->extent = size;
+      pending->access = access;
+      lovrRetain(buffer);
+    }
+    return;
+  }
+
   uint64_t id = map_get(&shader->blockMap, hash64(name, strlen(name)));
   if (id == MAP_NIL) return;
 
@@ -2868,6 +4086,201 @@ void lovrShaderSetBlock(Shader* shader, const char* name, Buffer* buffer, size_t
   }
 }
 
+#define CONVERT_CHECK(x, ...) if (!(x)) { snprintf(error, errorSize, __VA_ARGS__); return false; }
+
+// Converts a value from Lua into the layout of a uniform: tightly packed floats or ints, Textures, or
+// StorageImages.  Shader:send (including values queued while the Shader compiles) and
+// ShaderBlock:send both go through here.  Errors are written to a buffer instead of thrown.
+bool lovrShaderConvertValue(const Uniform* uniform, UniformValue* value, void* dest, char* error, size_t errorSize) {
+  static const char* textureTypes[] = { [TEXTURE_2D] = "2d", [TEXTURE_ARRAY] = "array", [TEXTURE_CUBE] = "cube", [TEXTURE_VOLUME] = "volume" };
+  const char* name = uniform->name;
+  UniformType type = uniform->type;
+  int components = type == UNIFORM_MATRIX ? uniform->components * uniform->components : uniform->components;
+  int count = uniform->count;
+  int total = count * components;
+
+  if (value->bytes) {
+    CONVERT_CHECK(type != UNIFORM_SAMPLER, "Sampler uniform '%s' can not be updated with a Blob", name);
+    CONVERT_CHECK(type != UNIFORM_IMAGE, "Image uniform '%s' can not be updated with a Blob", name);
+    size_t capacity = value->size / sizeof(float);
+    const char* unit = type == UNIFORM_INT ? "int" : "float";
+    CONVERT_CHECK(capacity >= (size_t) total, "Blob can only hold %d %s%s, at least %d needed for uniform '%s'", (int) capacity, unit, capacity == 1 ? "" : "s", total, name);
+    memcpy(dest, value->bytes, total * sizeof(float));
+    return true;
+  }
+
+  if (type == UNIFORM_SAMPLER || type == UNIFORM_IMAGE) {
+    const char* kind = type == UNIFORM_SAMPLER ? "sampler" : "storage image";
+    for (int i = 0; i < count; i++) {
+      Texture* texture = (uint32_t) i < value->itemCount ? value->textures[i] : NULL;
+      CONVERT_CHECK(texture, "Expected a Texture for uniform '%s'", name);
+      CONVERT_CHECK(texture->type == uniform->textureType, "Attempt to send %s texture to %s %s uniform", textureTypes[texture->type], textureTypes[uniform->textureType], kind);
+      if (type == UNIFORM_SAMPLER) {
+        ((Texture**) dest)[i] = texture;
+      } else {
+        ((StorageImage*) dest)[i] = (StorageImage) { .texture = texture, .slice = -1, .mipmap = 0, .access = ACCESS_READ_WRITE };
+      }
+    }
+    return true;
+  }
+
+  for (uint32_t i = 0; i < value->itemCount; i++) {
+    CONVERT_CHECK(!value->textures[i], "Unable to send Textures to uniform '%s'", name);
+  }
+
+  // A table of numbers fills a scalar uniform, otherwise each item is one element and any missing
+  // numbers are zero.  Separate arguments have to cover every element of a vector or matrix uniform.
+  float* floats = dest;
+  int* ints = dest;
+  bool integer = type == UNIFORM_INT;
+  double* numbers = value->numbers;
+  memset(dest, 0, total * sizeof(float));
+  if (value->flat && components == 1) {
+    uint32_t length = MIN(value->lengths[0], (uint32_t) total);
+    for (uint32_t i = 0; i < length; i++) {
+      if (integer) ints[i] = (int) numbers[i]; else floats[i] = (float) numbers[i];
+    }
+  } else {
+    CONVERT_CHECK(value->wrapped || components == 1 || value->itemCount >= (uint32_t) count, "Expected %d value%s for uniform '%s'", count, count == 1 ? "" : "s", name);
+    for (uint32_t i = 0; i < value->itemCount && i < (uint32_t) count; i++) {
+      uint32_t length = MIN(value->lengths[i], (uint32_t) components);
+      for (uint32_t j = 0; j < length; j++) {
+        uint32_t k = i * components + j;
+        if (integer) ints[k] = (int) numbers[j]; else floats[k] = (float) numbers[j];
+      }
+      numbers += value->lengths[i];
+    }
+  }
+
+  return true;
+}
+
+#undef CONVERT_CHECK
+
+// Number of elements (and their size) lovrShaderConvertValue writes for a uniform
+static int lovrShaderGetValueLayout(const Uniform* uniform, int* size) {
+  switch (uniform->type) {
+    case UNIFORM_SAMPLER: *size = sizeof(Texture*); return uniform->count;
+    case UNIFORM_IMAGE: *size = sizeof(StorageImage); return uniform->count;
+    case UNIFORM_MATRIX: *size = sizeof(float); return uniform->count * uniform->components * uniform->components;
+    default: *size = sizeof(float); return uniform->count * uniform->components;
+  }
+}
+
+static bool lovrShaderApplyValue(Shader* shader, Uniform* uniform, UniformValue* value, char* error, size_t errorSize) {
+  int size;
+  int count = lovrShaderGetValueLayout(uniform, &size);
+  void* data = malloc(MAX(count * size, 1));
+  lovrAssert(data, "Out of memory");
+  bool success = lovrShaderConvertValue(uniform, value, data, error, errorSize);
+  if (success) {
+    lovrShaderWriteUniform(shader, uniform, data, 0, count, size);
+  }
+  free(data);
+  return success;
+}
+
+static void lovrShaderCopyValue(UniformValue* dst, UniformValue* src) {
+  uint32_t numberCount = 0;
+  for (uint32_t i = 0; i < src->itemCount; i++) {
+    numberCount += src->lengths[i];
+  }
+
+  *dst = (UniformValue) { .itemCount = src->itemCount, .flat = src->flat, .wrapped = src->wrapped, .size = src->size };
+  dst->numbers = malloc(MAX(numberCount, 1) * sizeof(double));
+  dst->lengths = malloc(MAX(src->itemCount, 1) * sizeof(uint32_t));
+  dst->textures = malloc(MAX(src->itemCount, 1) * sizeof(Texture*));
+  dst->bytes = src->bytes ? malloc(MAX(src->size, 1)) : NULL;
+  lovrAssert(dst->numbers && dst->lengths && dst->textures && (dst->bytes || !src->bytes), "Out of memory");
+
+  if (src->itemCount > 0) {
+    memcpy(dst->numbers, src->numbers, numberCount * sizeof(double));
+    memcpy(dst->lengths, src->lengths, src->itemCount * sizeof(uint32_t));
+    memcpy(dst->textures, src->textures, src->itemCount * sizeof(Texture*));
+  }
+
+  if (src->bytes) {
+    memcpy(dst->bytes, src->bytes, src->size);
+  }
+
+  for (uint32_t i = 0; i < dst->itemCount; i++) {
+    lovrRetain(dst->textures[i]);
+  }
+}
+
+// Returns whether the uniform exists.  Values sent before the Shader is ready are copied and
+// converted once it is, so the caller keeps ownership of the value.
+bool lovrShaderSetValue(Shader* shader, const char* name, UniformValue* value) {
+  if (!shader->ready) {
+    PendingUniform* pending = lovrShaderQueue(shader, name, PENDING_VALUE, 0);
+    if (pending) {
+      lovrShaderCopyValue(&pending->value, value);
+    }
+    return true;
+  }
+
+  Uniform* uniform = lovrShaderFindUniform(shader, name);
+  if (!uniform) {
+    return false;
+  }
+
+  char error[256];
+  if (!lovrShaderApplyValue(shader, uniform, value, error, sizeof(error))) {
+    lovrThrow("%s", error);
+  }
+
+  return true;
+}
+
+// The queue is detached so it's never applied twice.  Every entry is applied and freed, even if one
+// of them fails, and then the first error is thrown.
+static void lovrShaderApplyPending(Shader* shader) {
+  if (shader->pending.length == 0) {
+    return;
+  }
+
+  PendingUniform* pending = shader->pending.data;
+  size_t count = shader->pending.length;
+  arr_init(&shader->pending, arr_alloc);
+
+  char error[256] = { 0 };
+  for (size_t i = 0; i < count; i++) {
+    PendingUniform* entry = &pending[i];
+    Uniform* uniform = entry->kind == PENDING_BLOCK ? NULL : lovrShaderFindUniform(shader, entry->name);
+    char message[256];
+    bool success = true;
+
+    switch (entry->kind) {
+      case PENDING_UNIFORM:
+        if (uniform) {
+          const char* debug = entry->type == UNIFORM_SAMPLER ? "texture" : entry->type == UNIFORM_IMAGE ? "image" : entry->type == UNIFORM_INT ? "int" : "float";
+          success = lovrShaderCheckUniform(uniform, entry->type, entry->start, entry->count, entry->size, debug, message, sizeof(message));
+          if (success) {
+            lovrShaderWriteUniform(shader, uniform, entry->data, entry->start, entry->count, entry->size);
+          }
+        }
+        break;
+      case PENDING_VALUE:
+        if (uniform) {
+          success = lovrShaderApplyValue(shader, uniform, &entry->value, message, sizeof(message));
+        }
+        break;
+      case PENDING_BLOCK:
+        lovrShaderSetBlock(shader, entry->name, entry->buffer, entry->offset, entry->extent, entry->access);
+        break;
+    }
+
+    if (!success && !error[0]) {
+      memcpy(error, message, sizeof(error));
+    }
+
+    lovrShaderFreePending(entry);
+  }
+
+  free(pending);
+  lovrAssert(!error[0], "%s", error);
+}
+
 // ShaderBlock
 
 // Calculates uniform size and byte offsets using std140 rules, returning the total buffer size
@@ -102,14 +102,30 @@ typedef struct {
 
 typedef arr_t(UniformBlock) arr_block_t;
 
+// A value sent from Lua, kept as numbers and Textures so it can be converted once the uniform's type
+// is known (see lovrShaderConvertValue).  Each item is one number, table, vector, or Texture.  Flat
+// values start with a table of numbers, wrapped values are the entries of one table.
+typedef struct {
+  double* numbers;
+  uint32_t* lengths;
+  struct Texture** textures;
+  uint32_t itemCount;
+  bool flat;
+  bool wrapped;
+  void* bytes;
+  size_t size;
+} UniformValue;
+
 // Shader
 
 typedef struct Shader Shader;
-Shader* lovrShaderCreateGraphics(const char* vertexSource, int vertexSourceLength, const char* fragmentSource, int fragmentSourceLength, ShaderFlag* flags, uint32_t flagCount, bool multiview);
+Shader* lovrShaderCreateGraphics(const char* vertexSource, int vertexSourceLength, const char* fragmentSource, int fragmentSourceLength, ShaderFlag* flags, uint32_t flagCount, bool multiview, bool async);
 Shader* lovrShaderCreateCompute(const char* source, int length, ShaderFlag* flags, uint32_t flagCount);
-Shader* lovrShaderCreateDefault(DefaultShader type, ShaderFlag* flags, uint32_t flagCount, bool multiview);
+Shader* lovrShaderCreateDefault(DefaultShader type, ShaderFlag* flags, uint32_t flagCount, bool multiview, bool async);
 void lovrShaderDestroy(void* ref);
 ShaderType lovrShaderGetType(Shader* shader);
+bool lovrShaderIsReady(Shader* shader);
+bool lovrShaderIsPending(Shader* shader);
 int lovrShaderGetAttributeLocation(Shader* shader, const char* name, bool* integer);
 bool lovrShaderHasUniform(Shader* shader, const char* name);
 bool lovrShaderHasBlock(Shader* shader, const char* name);
@@ -121,6 +137,8 @@ void lovrShaderSetTextures(Shader* shader, const char* name, struct Texture** da
 void lovrShaderSetImages(Shader* shader, const char* name, StorageImage* data, int start, int count);
 void lovrShaderSetColor(Shader* shader, const char* name, Color color);
 void lovrShaderSetBlock(Shader* shader, const char* name, struct Buffer* buffer, size_t offset, size_t size, UniformAccess access);
+bool lovrShaderSetValue(Shader* shader, const char* name, UniformValue* value);
+bool lovrShaderConvertValue(const Uniform* uniform, UniformValue* value, void* dest, char* error, size_t errorSize);
 
 // ShaderBlock
 
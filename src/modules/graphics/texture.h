@@ -5,6 +5,7 @@
 
 #pragma once
 
+struct Blob;
 struct Image;
 
 typedef enum {
@@ -16,10 +17,12 @@ typedef enum {
 
 typedef struct Texture Texture;
 Texture* lovrTextureCreate(TextureType type, struct Image** slices, uint32_t sliceCount, bool srgb, bool mipmaps, uint32_t msaa);
+Texture* lovrTextureCreateStream(TextureType type, struct Blob** blobs, struct Image** images, uint32_t sliceCount, bool srgb, bool mipmaps);
 Texture* lovrTextureCreateFromHandle(uint32_t handle, TextureType type, uint32_t depth, uint32_t msaa);
 void lovrTextureDestroy(void* ref);
 void lovrTextureAllocate(Texture* texture, uint32_t width, uint32_t height, uint32_t depth, TextureFormat format);
 void lovrTextureReplacePixels(Texture* texture, struct Image* data, uint32_t x, uint32_t y, uint32_t slice, uint32_t mipmap);
+bool lovrTextureIsReady(Texture* texture);
 uint64_t lovrTextureGetId(Texture* texture);
 uint32_t lovrTextureGetWidth(Texture* texture, uint32_t mipmap);
 uint32_t lovrTextureGetHeight(Texture* texture, uint32_t mipmap);
@@ -1,5 +1,6 @@
 #include "physics.h"
 #include "core/maf.h"
+#include "core/profile.h"
 #include "util.h"
 #include <ode/ode.h>
 #include <stdlib.h>
@@ -178,6 +179,8 @@ void lovrWorldDestroyData(World* world) {
 }
 
 void lovrWorldUpdate(World* world, float dt, CollisionResolver resolver, void* userdata) {
+  PROFILE_BEGIN("Physics update");
+
   if (resolver) {
     resolver(world, userdata);
   } else {
@@ -189,6 +192,7 @@ void lovrWorldUpdate(World* world, float dt, CollisionResolver resolver, void* u
   }
 
   dJointGroupEmpty(world->contactGroup);
+  PROFILE_END();
 }
 
 int lovrWorldGetStepCount(World* world) {
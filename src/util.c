@@ -12,6 +12,11 @@ void lovrSetErrorCallback(errorFn* callback, void* userdata) {
   lovrErrorUserdata = userdata;
 }
 
+void lovrGetErrorCallback(errorFn** callback, void** userdata) {
+  *callback = lovrErrorCallback;
+  *userdata = lovrErrorUserdata;
+}
+
 void lovrThrow(const char* format, ...) {
   va_list args;
   va_start(args, format);
@@ -114,6 +119,11 @@ void map_free(map_t* map) {
   free(map->hashes);
 }
 
+void map_clear(map_t* map) {
+  memset(map->hashes, 0xff, 2 * map->size * sizeof(uint64_t));
+  map->used = 0;
+}
+
 uint64_t map_get(map_t* map, uint64_t hash) {
   return map->values[map_find(map, hash)];
 }
@@ -31,6 +31,7 @@ typedef struct Color { float r, g, b, a; } Color;
 // Error handling
 typedef void errorFn(void*, const char*, va_list);
 void lovrSetErrorCallback(errorFn* callback, void* userdata);
+void lovrGetErrorCallback(errorFn** callback, void** userdata);
 _Noreturn void lovrThrow(const char* format, ...);
 #define lovrAssert(c, ...) if (!(c)) { lovrThrow(__VA_ARGS__); }
 
@@ -95,6 +96,7 @@ typedef struct {
 
 void map_init(map_t* map, uint32_t n);
 void map_free(map_t* map);
+void map_clear(map_t* map);
 uint64_t map_get(map_t* map, uint64_t hash);
 void map_set(map_t* map, uint64_t hash, uint64_t value);
 void map_remove(map_t* map, uint64_t hash);